@@ -21,6 +21,7 @@
 #include "../unicode/unicode.cpp"
 #include "../data_io/image_dataset_metadata.cpp"
 #include "../data_io/mnist.cpp"
+#include "../data_io/memory_mapped_file.cpp"
 
 
 
@@ -6,9 +6,11 @@
 #include "data_io/libsvm_io.h"
 #include "data_io/image_dataset_metadata.h"
 #include "data_io/mnist.h"
+#include "data_io/memory_mapped_file.h"
 
 #ifndef DLIB_ISO_CPP_ONLY
 #include "data_io/load_image_dataset.h"
+#include "data_io/image_dataset_shard.h"
 #endif
 
 #endif // DLIB_DATA_Io_HEADER
@@ -0,0 +1,564 @@
+// Copyright (C) 2026  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_IMAGE_DAtASET_SHARD_Hh_
+#define DLIB_IMAGE_DAtASET_SHARD_Hh_
+
+#include "image_dataset_shard_abstract.h"
+#include "load_image_dataset.h"
+#include "memory_mapped_file.h"
+#include "../image_io.h"
+#include "../image_processing/full_object_detection.h"
+#include "../matrix.h"
+#include "../serialize.h"
+#include "../string.h"
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <set>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    enum class image_shard_encoding
+    {
+        raw,
+        original
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        /*
+            A shard file is laid out as follows, with all the fixed size integers stored
+            little endian:
+                - the 8 bytes "DLIBSHRD"
+                - uint32 format version, currently 1
+                - uint32 reserved, always 0
+                - uint64 the number of records
+                - uint64 the offset of the metadata block
+                - uint64 the offset of the index
+                - the records, one after another
+                - the metadata block: the serialized parts list
+                - the index: number of records + 1 uint64 offsets.  Record i occupies the
+                  bytes [index[i], index[i+1]).
+            Each record holds, in dlib's serialization format: the image filename, its
+            mmod_rects, its full_object_detections, the encoding, the image dimensions and
+            channel count (for raw images) and the number of image bytes.  The image bytes
+            follow directly, so they can be used straight out of the mapped file.
+        */
+        const char image_shard_magic[8] = {'D','L','I','B','S','H','R','D'};
+        const uint32 image_shard_version = 1;
+        const size_t image_shard_header_size = 40;
+
+        const int image_shard_raw = 0;
+        const int image_shard_jpeg = 1;
+        const int image_shard_png = 2;
+
+        inline void write_shard_uint (std::ostream& out, uint64 val, int num_bytes)
+        {
+            char buf[8];
+            for (int i = 0; i < num_bytes; ++i)
+                buf[i] = static_cast<char>((val >> (8*i))&0xFF);
+            out.write(buf, num_bytes);
+        }
+
+        inline uint64 read_shard_uint (const char* buf, int num_bytes)
+        {
+            uint64 val = 0;
+            for (int i = 0; i < num_bytes; ++i)
+                val |= static_cast<uint64>(static_cast<unsigned char>(buf[i])) << (8*i);
+            return val;
+        }
+
+        // An istream buffer over memory that's already there, so we can deserialize out
+        // of the mapped file without copying it first.
+        class shard_record_buf : public std::streambuf
+        {
+        public:
+            shard_record_buf(const char* begin, const char* end)
+            {
+                char* b = const_cast<char*>(begin);
+                setg(b, b, const_cast<char*>(end));
+            }
+
+            size_t position() const { return gptr() - eback(); }
+        };
+
+        struct shard_record_header
+        {
+            std::string filename;
+            std::vector<mmod_rect> boxes;
+            std::vector<full_object_detection> dets;
+            int encoding = image_shard_raw;
+            long nr = 0;
+            long nc = 0;
+            int channels = 0;
+            uint64 num_bytes = 0;
+        };
+
+        inline void serialize_shard_record_header (const shard_record_header& item, std::ostream& out)
+        {
+            serialize(item.filename, out);
+            serialize(item.boxes, out);
+            serialize(item.dets, out);
+            serialize(item.encoding, out);
+            serialize(item.nr, out);
+            serialize(item.nc, out);
+            serialize(item.channels, out);
+            serialize(item.num_bytes, out);
+        }
+
+        inline void deserialize_shard_record_header (shard_record_header& item, std::istream& in)
+        {
+            deserialize(item.filename, in);
+            deserialize(item.boxes, in);
+            deserialize(item.dets, in);
+            deserialize(item.encoding, in);
+            deserialize(item.nr, in);
+            deserialize(item.nc, in);
+            deserialize(item.channels, in);
+            deserialize(item.num_bytes, in);
+        }
+
+        inline void read_file_bytes (const std::string& filename, std::vector<char>& bytes)
+        {
+            std::ifstream fin(filename, std::ios::binary);
+            if (!fin)
+                throw image_load_error("Unable to open file: " + filename);
+            fin.seekg(0, std::ios::end);
+            bytes.resize(static_cast<size_t>(fin.tellg()));
+            fin.seekg(0, std::ios::beg);
+            fin.read(bytes.data(), bytes.size());
+            if (!fin)
+                throw image_load_error("Error reading file: " + filename);
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    class image_dataset_shard
+    {
+    public:
+
+        image_dataset_shard(
+        ) = default;
+
+        explicit image_dataset_shard(
+            const std::string& filename
+        )
+        {
+            open(filename);
+        }
+
+        void open (
+            const std::string& filename
+        )
+        {
+            using namespace impl;
+            memory_mapped_file temp(filename);
+            const char* d = temp.data();
+            if (temp.size() < image_shard_header_size || std::memcmp(d, image_shard_magic, 8) != 0)
+                throw serialization_error("The file " + filename + " is not an image dataset shard.");
+            if (read_shard_uint(d+8, 4) != image_shard_version)
+                throw serialization_error("Unsupported image dataset shard version found in " + filename + ".");
+
+            const uint64 n = read_shard_uint(d+16, 8);
+            const uint64 metadata_offset = read_shard_uint(d+24, 8);
+            const uint64 index_offset = read_shard_uint(d+32, 8);
+            // The index holds n+1 offsets.  n is checked against the space left for it
+            // before computing n+1, which could otherwise overflow.
+            if (metadata_offset > index_offset || index_offset > temp.size() ||
+                n >= (temp.size()-index_offset)/8)
+                throw serialization_error("The image dataset shard " + filename + " is corrupted.");
+
+            std::vector<uint64> offsets(n+1);
+            for (uint64 i = 0; i <= n; ++i)
+            {
+                offsets[i] = read_shard_uint(d+index_offset+8*i, 8);
+                if (offsets[i] < image_shard_header_size || offsets[i] > metadata_offset ||
+                    (i != 0 && offsets[i] < offsets[i-1]))
+                    throw serialization_error("The image dataset shard " + filename + " has a corrupted index.");
+            }
+
+            std::vector<std::string> parts;
+            shard_record_buf buf(d+metadata_offset, d+index_offset);
+            std::istream in(&buf);
+            deserialize(parts, in);
+
+            mapped.swap(temp);
+            record_offsets.swap(offsets);
+            parts_list.swap(parts);
+        }
+
+        bool is_open (
+        ) const { return mapped.is_open(); }
+
+        size_t size (
+        ) const { return record_offsets.size() == 0 ? 0 : record_offsets.size()-1; }
+
+        const std::vector<std::string>& get_parts_list (
+        ) const { return parts_list; }
+
+        std::string get_image_filename (
+            size_t idx
+        ) const
+        {
+            impl::shard_record_header h;
+            read_record(idx, h);
+            return h.filename;
+        }
+
+        void get_boxes (
+            size_t idx,
+            std::vector<mmod_rect>& boxes
+        ) const
+        {
+            impl::shard_record_header h;
+            read_record(idx, h);
+            boxes.swap(h.boxes);
+        }
+
+        void get_object_detections (
+            size_t idx,
+            std::vector<full_object_detection>& dets
+        ) const
+        {
+            impl::shard_record_header h;
+            read_record(idx, h);
+            dets.swap(h.dets);
+        }
+
+        std::vector<std::vector<mmod_rect>> get_all_boxes (
+        ) const
+        {
+            std::vector<std::vector<mmod_rect>> all(size());
+            for (size_t i = 0; i < all.size(); ++i)
+                get_boxes(i, all[i]);
+            return all;
+        }
+
+        template <typename image_type>
+        void get_image (
+            size_t idx,
+            image_type& img
+        ) const
+        {
+            impl::shard_record_header h;
+            const char* bytes = read_record(idx, h);
+            decode_image(h, bytes, img);
+        }
+
+        template <typename image_type>
+        void get (
+            size_t idx,
+            image_type& img,
+            std::vector<mmod_rect>& boxes
+        ) const
+        {
+            impl::shard_record_header h;
+            const char* bytes = read_record(idx, h);
+            decode_image(h, bytes, img);
+            boxes.swap(h.boxes);
+        }
+
+    private:
+
+        const char* read_record (
+            size_t idx,
+            impl::shard_record_header& h
+        ) const
+        /*!
+            ensures
+                - loads the header of the idx-th record into h and returns a pointer to
+                  its image bytes.
+        !*/
+        {
+            DLIB_CASSERT(idx < size());
+            const char* begin = mapped.data() + record_offsets[idx];
+            const char* end = mapped.data() + record_offsets[idx+1];
+            impl::shard_record_buf buf(begin, end);
+            std::istream in(&buf);
+            impl::deserialize_shard_record_header(h, in);
+            if (h.num_bytes > static_cast<uint64>(end - begin) - buf.position())
+                throw serialization_error("Record " + cast_to_string(idx) + " of the image dataset shard " +
+                    mapped.get_filename() + " is corrupted.");
+            return begin + buf.position();
+        }
+
+        template <typename image_type>
+        void decode_image (
+            const impl::shard_record_header& h,
+            const char* bytes,
+            image_type& img
+        ) const
+        {
+            const unsigned char* b = reinterpret_cast<const unsigned char*>(bytes);
+            switch (h.encoding)
+            {
+                case impl::image_shard_raw:
+                {
+                    if (h.channels != 1 && h.channels != 3)
+                        throw serialization_error("Unsupported channel count in image dataset shard.");
+                    if (h.nr < 0 || h.nc < 0)
+                        throw serialization_error("Negative image size in image dataset shard.");
+                    // Compare nr*nc against num_bytes before multiplying it out, so a
+                    // corrupt size can't overflow.
+                    const uint64 nr = h.nr, nc = h.nc;
+                    if ((nc != 0 && nr > h.num_bytes/nc) || h.num_bytes != nr*nc*h.channels)
+                        throw serialization_error("Image size doesn't match its data in image dataset shard.");
+                    image_view<image_type> v(img);
+                    v.set_size(h.nr, h.nc);
+                    for (long r = 0; r < h.nr; ++r)
+                    {
+                        for (long c = 0; c < h.nc; ++c)
+                        {
+                            if (h.channels == 1)
+                            {
+                                assign_pixel(v[r][c], *b);
+                            }
+                            else
+                            {
+                                assign_pixel(v[r][c], rgb_pixel(b[0], b[1], b[2]));
+                            }
+                            b += h.channels;
+                        }
+                    }
+                    return;
+                }
+                case impl::image_shard_jpeg:
+#ifdef DLIB_JPEG_SUPPORT
+                    jpeg_loader(b, h.num_bytes).get_image(img);
+                    return;
+#else
+                    throw image_load_error("Unable to decode a JPEG image from an image dataset shard because DLIB_JPEG_SUPPORT is not #defined.");
+#endif
+                case impl::image_shard_png:
+#ifdef DLIB_PNG_SUPPORT
+                    png_loader(b, h.num_bytes).get_image(img);
+                    return;
+#else
+                    throw image_load_error("Unable to decode a PNG image from an image dataset shard because DLIB_PNG_SUPPORT is not #defined.");
+#endif
+                default:
+                    throw serialization_error("Unknown image encoding found in image dataset shard.");
+            }
+        }
+
+        memory_mapped_file mapped;
+        std::vector<uint64> record_offsets;
+        std::vector<std::string> parts_list;
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename image_type
+        >
+    class image_dataset_shard_view
+    {
+    public:
+        typedef image_type value_type;
+
+        explicit image_dataset_shard_view(
+            const image_dataset_shard& shard_
+        ) : shard(&shard_) {}
+
+        size_t size (
+        ) const { return shard->size(); }
+
+        image_type operator[] (
+            size_t idx
+        ) const
+        {
+            image_type img;
+            shard->get_image(idx, img);
+            return img;
+        }
+
+    private:
+        const image_dataset_shard* shard;
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    inline void convert_image_dataset_to_shard (
+        const image_dataset_file& source,
+        const std::string& shard_filename,
+        image_shard_encoding encoding = image_shard_encoding::original
+    )
+    {
+        using namespace dlib::image_dataset_metadata;
+        using namespace impl;
+
+        dataset data;
+        load_image_dataset_metadata(data, source.get_filename());
+
+        std::ofstream fout(shard_filename, std::ios::binary);
+        if (!fout)
+            throw error("Unable to create the image dataset shard " + shard_filename + ".");
+
+        // Image paths are relative to the folder holding the metadata file, but only
+        // after we have opened the output file, which might be relative to the caller's.
+        locally_change_current_dir chdir(get_parent_directory(file(source.get_filename())));
+
+        // Number the parts the same way load_image_dataset() does.
+        std::set<std::string> all_parts;
+        for (auto& img : data.images)
+        {
+            for (auto& b : img.boxes)
+            {
+                if (source.should_load_box(b))
+                {
+                    for (auto& p : b.parts)
+                        all_parts.insert(p.first);
+                }
+            }
+        }
+        const std::vector<std::string> parts_list(all_parts.begin(), all_parts.end());
+        std::map<std::string,unsigned long> parts_idx;
+        for (unsigned long i = 0; i < parts_list.size(); ++i)
+            parts_idx[parts_list[i]] = i;
+
+        // The header gets filled in once we know where everything ended up.
+        fout.write(std::string(image_shard_header_size, '\0').data(), image_shard_header_size);
+
+        std::vector<uint64> offsets;
+        std::vector<char> file_bytes;
+        matrix<rgb_pixel> img;
+        std::vector<unsigned char> raw;
+        for (auto& image : data.images)
+        {
+            shard_record_header h;
+            h.filename = image.filename;
+            double min_rect_size = std::numeric_limits<double>::infinity();
+            for (auto& b : image.boxes)
+            {
+                if (!source.should_load_box(b))
+                    continue;
+                h.boxes.push_back(b.ignore ? ignored_mmod_rect(b.rect) : mmod_rect(b.rect));
+                h.boxes.back().label = b.label;
+                if (!b.ignore)
+                    min_rect_size = std::min<double>(min_rect_size, b.rect.area());
+                if (parts_list.size() != 0)
+                {
+                    std::vector<point> partlist(parts_list.size(), OBJECT_PART_NOT_PRESENT);
+                    for (auto& p : b.parts)
+                        partlist[parts_idx[p.first]] = p.second;
+                    h.dets.push_back(full_object_detection(b.rect, partlist));
+                }
+            }
+
+            if (source.should_skip_empty_images() && impl::num_non_ignored_boxes(h.boxes) == 0)
+                continue;
+
+            // Images load_image_dataset() would shrink have to be decoded and stored raw.
+            if (!std::isfinite(min_rect_size))
+                min_rect_size = 0;
+            const bool needs_shrinking = min_rect_size*(2.0/3.0)*(2.0/3.0) > source.box_area_thresh();
+            const image_file_type::type type = image_file_type::read_type(image.filename);
+            if (encoding == image_shard_encoding::original && !needs_shrinking &&
+                (type == image_file_type::JPG || type == image_file_type::PNG))
+            {
+                read_file_bytes(image.filename, file_bytes);
+                h.encoding = type == image_file_type::JPG ? image_shard_jpeg : image_shard_png;
+                h.num_bytes = file_bytes.size();
+                offsets.push_back(fout.tellp());
+                serialize_shard_record_header(h, fout);
+                fout.write(file_bytes.data(), file_bytes.size());
+                continue;
+            }
+
+            load_image(img, image.filename);
+            while(min_rect_size/2/2 > source.box_area_thresh())
+            {
+                pyramid_down<2> pyr;
+                pyr(img);
+                min_rect_size *= (1.0/2.0)*(1.0/2.0);
+                for (auto&& r : h.boxes)
+                    r.rect = pyr.rect_down(r.rect);
+                for (auto&& r : h.dets)
+                {
+                    r.get_rect() = pyr.rect_down(r.get_rect());
+                    for (unsigned long k = 0; k < r.num_parts(); ++k)
+                        r.part(k) = pyr.point_down(r.part(k));
+                }
+            }
+            while(min_rect_size*(2.0/3.0)*(2.0/3.0) > source.box_area_thresh())
+            {
+                pyramid_down<3> pyr;
+                pyr(img);
+                min_rect_size *= (2.0/3.0)*(2.0/3.0);
+                for (auto&& r : h.boxes)
+                    r.rect = pyr.rect_down(r.rect);
+                for (auto&& r : h.dets)
+                {
+                    r.get_rect() = pyr.rect_down(r.get_rect());
+                    for (unsigned long k = 0; k < r.num_parts(); ++k)
+                        r.part(k) = pyr.point_down(r.part(k));
+                }
+            }
+
+            // Store grayscale images with one channel rather than three.
+            bool is_gray = true;
+            for (auto& p : img)
+            {
+                if (p.red != p.green || p.red != p.blue)
+                {
+                    is_gray = false;
+                    break;
+                }
+            }
+            h.encoding = image_shard_raw;
+            h.nr = img.nr();
+            h.nc = img.nc();
+            h.channels = is_gray ? 1 : 3;
+            raw.clear();
+            raw.reserve(img.size()*h.channels);
+            for (auto& p : img)
+            {
+                raw.push_back(p.red);
+                if (!is_gray)
+                {
+                    raw.push_back(p.green);
+                    raw.push_back(p.blue);
+                }
+            }
+            h.num_bytes = raw.size();
+            offsets.push_back(fout.tellp());
+            serialize_shard_record_header(h, fout);
+            fout.write(reinterpret_cast<const char*>(raw.data()), raw.size());
+        }
+
+        const uint64 metadata_offset = fout.tellp();
+        offsets.push_back(metadata_offset);
+        serialize(parts_list, fout);
+        const uint64 index_offset = fout.tellp();
+        for (auto off : offsets)
+            write_shard_uint(fout, off, 8);
+
+        fout.seekp(0);
+        fout.write(image_shard_magic, 8);
+        write_shard_uint(fout, image_shard_version, 4);
+        write_shard_uint(fout, 0, 4);
+        write_shard_uint(fout, offsets.size()-1, 8);
+        write_shard_uint(fout, metadata_offset, 8);
+        write_shard_uint(fout, index_offset, 8);
+        fout.flush();
+        if (!fout)
+            throw error("Error writing the image dataset shard " + shard_filename + ".");
+    }
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_IMAGE_DAtASET_SHARD_Hh_
+
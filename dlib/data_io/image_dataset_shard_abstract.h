@@ -0,0 +1,276 @@
+// Copyright (C) 2026  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#undef DLIB_IMAGE_DAtASET_SHARD_ABSTRACT_Hh_
+#ifdef DLIB_IMAGE_DAtASET_SHARD_ABSTRACT_Hh_
+
+#include "load_image_dataset_abstract.h"
+#include "memory_mapped_file_abstract.h"
+#include "../image_processing/full_object_detection_abstract.h"
+#include <string>
+#include <vector>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    enum class image_shard_encoding
+    {
+        raw,      // Images are stored decoded, as 8 bit grayscale or RGB pixels.
+        original  // JPEG and PNG images are stored exactly as they are on disk.
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    void convert_image_dataset_to_shard (
+        const image_dataset_file& source,
+        const std::string& shard_filename,
+        image_shard_encoding encoding = image_shard_encoding::original
+    );
+    /*!
+        ensures
+            - Reads the images and boxes listed in the image_dataset_metadata XML file
+              source.get_filename() and packs them all into the single file
+              shard_filename, which can then be read with image_dataset_shard.
+            - The options in source are applied just like load_image_dataset() applies
+              them.  That is, the shard contains exactly the images and boxes that
+              load_image_dataset(images, boxes, source) would load, in the same order.
+            - If encoding == image_shard_encoding::original then JPEG and PNG files are
+              copied into the shard as they are, which keeps the shard small but means
+              they have to be decoded again each time they are read.  Images of any other
+              type, as well as images that source.shrink_big_images() says to shrink, are
+              stored raw.
+            - If encoding == image_shard_encoding::raw then all the images are decoded
+              and stored as raw pixels.  Reading them back is then little more than a
+              memcpy, at the cost of a much bigger file.  Grayscale images are stored
+              with one byte per pixel and everything else with three.
+        throws
+            - dlib::error, image_load_error, or an exception thrown by
+              load_image_dataset_metadata() if any of the files can't be read or
+              shard_filename can't be written.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    class image_dataset_shard
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object gives random access to the images and labels in a shard file
+                created by convert_image_dataset_to_shard().  The file is memory mapped
+                (see memory_mapped_file) rather than loaded, so opening a shard is
+                nearly instant no matter how big it is, and only the images you actually
+                read are brought into RAM, by the operating system, which can drop them
+                again when memory gets tight.
+
+                This makes it suitable for streaming training data into a dnn_trainer,
+                e.g. from the load function of a dnn_data_loader, or as the source of
+                images for random_cropper via image_dataset_shard_view.
+
+            THREAD SAFETY
+                All the const member functions can be called concurrently from any
+                number of threads.
+        !*/
+
+    public:
+
+        image_dataset_shard(
+        );
+        /*!
+            ensures
+                - #is_open() == false
+                - #size() == 0
+        !*/
+
+        explicit image_dataset_shard(
+            const std::string& filename
+        );
+        /*!
+            ensures
+                - performs open(filename)
+        !*/
+
+        void open (
+            const std::string& filename
+        );
+        /*!
+            ensures
+                - maps the shard file with the given name into memory, replacing any
+                  shard this object had open before.
+                - #is_open() == true
+                - #size() == the number of images in the shard.
+            throws
+                - dlib::error
+                  The file couldn't be opened.
+                - serialization_error
+                  The file isn't a valid shard.
+                If an exception is thrown then this object is unchanged.
+        !*/
+
+        bool is_open (
+        ) const;
+        /*!
+            ensures
+                - returns true if this object has a shard open.
+        !*/
+
+        size_t size (
+        ) const;
+        /*!
+            ensures
+                - returns the number of images in the shard.
+        !*/
+
+        const std::vector<std::string>& get_parts_list (
+        ) const;
+        /*!
+            ensures
+                - returns the names of the object parts used by get_object_detections().
+                  That is, part(i) of each full_object_detection is the part named
+                  get_parts_list()[i].  This is the same parts list load_image_dataset()
+                  produces.
+        !*/
+
+        std::string get_image_filename (
+            size_t idx
+        ) const;
+        /*!
+            requires
+                - idx < size()
+            ensures
+                - returns the filename the idx-th image had in the original XML file.
+        !*/
+
+        void get_boxes (
+            size_t idx,
+            std::vector<mmod_rect>& boxes
+        ) const;
+        /*!
+            requires
+                - idx < size()
+            ensures
+                - #boxes == the boxes on the idx-th image, including the ignored ones,
+                  with their labels.
+        !*/
+
+        void get_object_detections (
+            size_t idx,
+            std::vector<full_object_detection>& dets
+        ) const;
+        /*!
+            requires
+                - idx < size()
+            ensures
+                - if (get_parts_list().size() == 0) then
+                    - #dets.size() == 0
+                - else
+                    - #dets.size() == the number of boxes get_boxes(idx) returns, and
+                      #dets[i] holds the rectangle and parts of the i-th of those boxes.
+                      Parts an object doesn't have are set to OBJECT_PART_NOT_PRESENT.
+        !*/
+
+        std::vector<std::vector<mmod_rect>> get_all_boxes (
+        ) const;
+        /*!
+            ensures
+                - returns the boxes of all the images.  That is, returns a vector B such
+                  that B.size() == size() and get_boxes(i, B[i]) for all i.
+        !*/
+
+        template <typename image_type>
+        void get_image (
+            size_t idx,
+            image_type& img
+        ) const;
+        /*!
+            requires
+                - idx < size()
+                - image_type == an image object that implements the interface defined in
+                  dlib/image_processing/generic_image.h
+            ensures
+                - #img == the idx-th image, converted to the pixel type of image_type with
+                  assign_pixel().
+            throws
+                - image_load_error
+                  The image couldn't be decoded, including because the shard holds a
+                  JPEG or PNG image but DLIB_JPEG_SUPPORT or DLIB_PNG_SUPPORT isn't
+                  defined.
+                - serialization_error
+                  The record for the image is corrupted.
+        !*/
+
+        template <typename image_type>
+        void get (
+            size_t idx,
+            image_type& img,
+            std::vector<mmod_rect>& boxes
+        ) const;
+        /*!
+            requires
+                - idx < size()
+                - image_type == an image object that implements the interface defined in
+                  dlib/image_processing/generic_image.h
+            ensures
+                - performs get_image(idx,img) and get_boxes(idx,boxes), but only reads
+                  the record once.
+        !*/
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename image_type
+        >
+    class image_dataset_shard_view
+    {
+        /*!
+            REQUIREMENTS ON image_type
+                image_type == an image object that implements the interface defined in
+                dlib/image_processing/generic_image.h
+
+            WHAT THIS OBJECT REPRESENTS
+                This object makes an image_dataset_shard look like a read-only array of
+                images, decoding each one when it is asked for.  So it can be handed to
+                functions like random_cropper::operator() that expect an array of images,
+                without loading the whole dataset into memory first.  E.g.
+                    image_dataset_shard shard("faces.dat");
+                    auto boxes = shard.get_all_boxes();
+                    cropper(150, image_dataset_shard_view<matrix<rgb_pixel>>(shard), boxes, crops, crop_boxes);
+        !*/
+
+    public:
+        typedef image_type value_type;
+
+        explicit image_dataset_shard_view(
+            const image_dataset_shard& shard
+        );
+        /*!
+            ensures
+                - #size() == shard.size()
+                - This object holds a pointer to shard, so shard must outlive it.
+        !*/
+
+        size_t size (
+        ) const;
+        /*!
+            ensures
+                - returns the number of images in the shard.
+        !*/
+
+        image_type operator[] (
+            size_t idx
+        ) const;
+        /*!
+            requires
+                - idx < size()
+            ensures
+                - returns the idx-th image in the shard.
+        !*/
+    };
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_IMAGE_DAtASET_SHARD_ABSTRACT_Hh_
+
@@ -0,0 +1,139 @@
+// Copyright (C) 2026  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_MEMORY_MAPPED_FiLE_CPPh_
+#define DLIB_MEMORY_MAPPED_FiLE_CPPh_
+
+#include "memory_mapped_file.h"
+#include "../platform.h"
+#include <utility>
+
+#ifdef WIN32
+#include "../windows_magic.h"
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// ----------------------------------------------------------------------------------------
+
+namespace dlib
+{
+    void memory_mapped_file::
+    open (
+        const std::string& filename
+    )
+    {
+        close();
+
+#ifdef WIN32
+        HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+            throw error("Unable to open " + filename + " for memory mapping.");
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file, &file_size))
+        {
+            CloseHandle(file);
+            throw error("Unable to get the size of " + filename + ".");
+        }
+        const char* mapped = nullptr;
+        HANDLE mapping = NULL;
+        if (file_size.QuadPart != 0)
+        {
+            mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (mapping == NULL)
+            {
+                CloseHandle(file);
+                throw error("Unable to memory map " + filename + ".");
+            }
+            mapped = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            if (mapped == nullptr)
+            {
+                CloseHandle(mapping);
+                CloseHandle(file);
+                throw error("Unable to memory map " + filename + ".");
+            }
+        }
+        _file_handle = file;
+        _mapping_handle = mapping;
+        _size = static_cast<size_t>(file_size.QuadPart);
+        _data = mapped;
+#else
+        const int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw error("Unable to open " + filename + " for memory mapping.");
+        struct stat info;
+        if (fstat(fd, &info) != 0)
+        {
+            ::close(fd);
+            throw error("Unable to get the size of " + filename + ".");
+        }
+        const char* mapped = nullptr;
+        if (info.st_size != 0)
+        {
+            void* temp = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (temp == MAP_FAILED)
+            {
+                ::close(fd);
+                throw error("Unable to memory map " + filename + ".");
+            }
+            mapped = static_cast<const char*>(temp);
+        }
+        // The mapping stays valid after the file is closed.
+        ::close(fd);
+        _size = static_cast<size_t>(info.st_size);
+        _data = mapped;
+#endif
+        _filename = filename;
+        _is_open = true;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void memory_mapped_file::
+    close (
+    )
+    {
+        if (!_is_open)
+            return;
+#ifdef WIN32
+        if (_data)
+            UnmapViewOfFile(_data);
+        if (_mapping_handle)
+            CloseHandle(_mapping_handle);
+        CloseHandle(_file_handle);
+#else
+        if (_data)
+            munmap(const_cast<char*>(_data), _size);
+#endif
+        _is_open = false;
+        _filename.clear();
+        _data = nullptr;
+        _size = 0;
+        _file_handle = nullptr;
+        _mapping_handle = nullptr;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void memory_mapped_file::
+    swap (
+        memory_mapped_file& item
+    )
+    {
+        std::swap(_is_open, item._is_open);
+        _filename.swap(item._filename);
+        std::swap(_data, item._data);
+        std::swap(_size, item._size);
+        std::swap(_file_handle, item._file_handle);
+        std::swap(_mapping_handle, item._mapping_handle);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_MEMORY_MAPPED_FiLE_CPPh_
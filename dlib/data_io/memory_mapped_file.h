@@ -0,0 +1,76 @@
+// Copyright (C) 2026  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_MEMORY_MAPPED_FiLE_Hh_
+#define DLIB_MEMORY_MAPPED_FiLE_Hh_
+
+#include "memory_mapped_file_abstract.h"
+#include "../noncopyable.h"
+#include "../error.h"
+#include <string>
+#include <cstddef>
+
+// ----------------------------------------------------------------------------------------
+
+namespace dlib
+{
+    class memory_mapped_file : noncopyable
+    {
+    public:
+
+        memory_mapped_file(
+        ) = default;
+
+        explicit memory_mapped_file(
+            const std::string& filename
+        ) { open(filename); }
+
+        ~memory_mapped_file(
+        ) { close(); }
+
+        void open (
+            const std::string& filename
+        );
+
+        void close (
+        );
+
+        bool is_open (
+        ) const { return _is_open; }
+
+        const std::string& get_filename (
+        ) const { return _filename; }
+
+        const char* data (
+        ) const { return _data; }
+
+        size_t size (
+        ) const { return _size; }
+
+        void swap (
+            memory_mapped_file& item
+        );
+
+    private:
+
+        bool _is_open = false;
+        std::string _filename;
+        const char* _data = nullptr;
+        size_t _size = 0;
+        // The file and mapping handles on windows.  Unused elsewhere.
+        void* _file_handle = nullptr;
+        void* _mapping_handle = nullptr;
+    };
+
+    inline void swap (
+        memory_mapped_file& a,
+        memory_mapped_file& b
+    ) { a.swap(b); }
+}
+
+// ----------------------------------------------------------------------------------------
+
+#ifdef NO_MAKEFILE
+#include "memory_mapped_file.cpp"
+#endif
+
+#endif // DLIB_MEMORY_MAPPED_FiLE_Hh_
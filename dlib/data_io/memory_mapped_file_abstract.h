@@ -0,0 +1,130 @@
+// Copyright (C) 2026  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#undef DLIB_MEMORY_MAPPED_FiLE_ABSTRACT_Hh_
+#ifdef DLIB_MEMORY_MAPPED_FiLE_ABSTRACT_Hh_
+
+#include <string>
+
+// ----------------------------------------------------------------------------------------
+
+namespace dlib
+{
+    class memory_mapped_file : noncopyable
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object maps the contents of a file into memory, read-only.  The
+                operating system pages the file in as it is read and can drop those pages
+                again whenever it likes, so this is a way to randomly access files far
+                bigger than RAM as if they were one big array.
+
+            THREAD SAFETY
+                The memory returned by data() can be read from any number of threads at
+                once.
+        !*/
+
+    public:
+
+        memory_mapped_file(
+        );
+        /*!
+            ensures
+                - #is_open() == false
+        !*/
+
+        explicit memory_mapped_file(
+            const std::string& filename
+        );
+        /*!
+            ensures
+                - performs open(filename)
+        !*/
+
+        ~memory_mapped_file(
+        );
+        /*!
+            ensures
+                - performs close()
+        !*/
+
+        void open (
+            const std::string& filename
+        );
+        /*!
+            ensures
+                - closes any file this object already had open and then maps the file
+                  with the given name into memory.
+                - #is_open() == true
+                - #get_filename() == filename
+                - #size() == the size of the file in bytes.
+                - #data() == a pointer to the first byte of the file.  If the file is
+                  empty then #data() == nullptr.
+            throws
+                - dlib::error
+                  This exception is thrown if the file can't be opened or mapped.  When
+                  this happens #is_open() == false.
+        !*/
+
+        void close (
+        );
+        /*!
+            ensures
+                - unmaps the file, if one is open.  Any pointers into data() become
+                  invalid.
+                - #is_open() == false
+                - #size() == 0
+                - #data() == nullptr
+                - #get_filename() == ""
+        !*/
+
+        bool is_open (
+        ) const;
+        /*!
+            ensures
+                - returns true if this object currently has a file mapped into memory.
+        !*/
+
+        const std::string& get_filename (
+        ) const;
+        /*!
+            ensures
+                - returns the name of the file mapped by this object, or "" if there is
+                  none.
+        !*/
+
+        const char* data (
+        ) const;
+        /*!
+            ensures
+                - returns a pointer to the contents of the mapped file.  The bytes
+                  data()[0] through data()[size()-1] can be read but not written.
+        !*/
+
+        size_t size (
+        ) const;
+        /*!
+            ensures
+                - returns the number of bytes in the mapped file.
+        !*/
+
+        void swap (
+            memory_mapped_file& item
+        );
+        /*!
+            ensures
+                - swaps *this and item
+        !*/
+    };
+
+    void swap (
+        memory_mapped_file& a,
+        memory_mapped_file& b
+    );
+    /*!
+        provides a global swap function
+    !*/
+}
+
+// ----------------------------------------------------------------------------------------
+
+#endif // DLIB_MEMORY_MAPPED_FiLE_ABSTRACT_Hh_
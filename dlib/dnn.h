@@ -26,11 +26,16 @@
 #include "dnn/loss.h"
 #include "dnn/core.h"
 #include "dnn/solvers.h"
+#include "dnn/data_loader.h"
 #include "dnn/trainer.h"
+#include "dnn/inference_server.h"
 #include "dnn/cpu_dlib.h"
 #include "dnn/tensor_tools.h"
 #include "dnn/utilities.h"
+#include "dnn/profiler.h"
+#include "dnn/mmod_cascade.h"
 #include "dnn/validation.h"
+#include "dnn/mapped_model.h"
 
 #endif // DLIB_DNn_
 
@@ -5,6 +5,9 @@
 
 #include "core_abstract.h"
 #include "tensor.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <iterator>
 #include <memory>
 #include <sstream>
@@ -84,6 +87,29 @@ namespace dlib
             - calls obj.clean() if obj has a .clean() method.
     !*/
 
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        template <typename T>
+        auto call_set_recomputing_method_if_exists (
+            T& obj,
+            bool recomputing,
+            special_
+        ) -> typename int_<decltype(&T::set_recomputing)>::type { obj.set_recomputing(recomputing);  return 0;  }
+
+        template <typename T>
+        void call_set_recomputing_method_if_exists (T& , bool, general_) {}
+    }
+    template <typename T>
+    void call_set_recomputing_method_if_exists(T& obj, bool recomputing)
+    { impl::call_set_recomputing_method_if_exists(obj, recomputing, special_()); }
+    /*!
+        ensures
+            - calls obj.set_recomputing(recomputing) if obj has a .set_recomputing()
+              method.
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
     namespace impl
@@ -357,6 +383,168 @@ namespace dlib
             layer.backward_inplace(gradient_input,sub.get_gradient_input(),params_grad);
         }
 
+        inline const std::function<void(tensor&)>*& parameter_gradient_callback (
+        )
+        {
+            thread_local const std::function<void(tensor&)>* callback = nullptr;
+            return callback;
+        }
+
+        class parameter_gradient_callback_scope
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    While one of these objects exists, every add_layer that computes its
+                    parameter gradient in the current thread passes it to the callback as
+                    soon as it is done, i.e. while the layers below it are still back
+                    propagating.  dnn_trainer uses this to start sending gradients to the
+                    other nodes of a distributed training job early.
+            !*/
+        public:
+            explicit parameter_gradient_callback_scope(
+                const std::function<void(tensor&)>& callback
+            ) : prev(parameter_gradient_callback()) { parameter_gradient_callback() = &callback; }
+            ~parameter_gradient_callback_scope() { parameter_gradient_callback() = prev; }
+            parameter_gradient_callback_scope(const parameter_gradient_callback_scope&) = delete;
+            parameter_gradient_callback_scope& operator=(const parameter_gradient_callback_scope&) = delete;
+        private:
+            const std::function<void(tensor&)>* prev;
+        };
+
+        inline void notify_parameter_gradient_ready (
+            tensor& params_grad
+        )
+        {
+            if (params_grad.size() != 0 && parameter_gradient_callback())
+                (*parameter_gradient_callback())(params_grad);
+        }
+
+        enum class profiled_layer_kind
+        {
+            input,
+            computational,
+            loss
+        };
+
+        class layer_call_observer
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    While an object of this type is installed in layer_call_observer_ptr(),
+                    every input layer, add_layer and add_loss_layer in the program tells it
+                    when it starts and finishes its own part of a forward or backward pass,
+                    not counting the layers below it.  dnn_profiler uses this to time the
+                    layers.  Since any thread may call it, implementations must be thread
+                    safe.  After an observer is removed from layer_call_observer_ptr(),
+                    calls that started before may still be using it, so it must not be
+                    destroyed until layer_calls_in_flight() is 0.
+            !*/
+        public:
+            virtual ~layer_call_observer() {}
+
+            virtual std::chrono::steady_clock::time_point begin_layer_call (
+            ) = 0;
+
+            virtual void end_layer_call (
+                const void* layer,
+                profiled_layer_kind kind,
+                bool backward,
+                std::chrono::steady_clock::time_point start,
+                const tensor& input,
+                const tensor& output,
+                size_t allocated_bytes
+            ) = 0;
+        };
+
+        inline std::atomic<layer_call_observer*>& layer_call_observer_ptr (
+        )
+        {
+            static std::atomic<layer_call_observer*> ptr(nullptr);
+            return ptr;
+        }
+
+        inline std::atomic<long>& layer_calls_in_flight (
+        )
+        {
+            // The number of layer calls that are using the observer right now.  Whoever
+            // removes an observer from layer_call_observer_ptr() must wait for this to
+            // reach 0 before destroying it.
+            static std::atomic<long> count(0);
+            return count;
+        }
+
+        class layer_call_start
+        {
+        public:
+            layer_call_start() = default;
+            layer_call_start(const layer_call_start&) = delete;
+            layer_call_start& operator=(const layer_call_start&) = delete;
+
+            layer_call_start(
+                layer_call_start&& item
+            ) : observer(item.observer), time(item.time)
+            {
+                item.observer = nullptr;
+            }
+
+            ~layer_call_start(
+            )
+            {
+                release();
+            }
+
+            explicit operator bool() const { return observer != nullptr; }
+
+            void release (
+            ) const
+            {
+                if (observer)
+                {
+                    observer = nullptr;
+                    layer_calls_in_flight().fetch_sub(1);
+                }
+            }
+
+            mutable layer_call_observer* observer = nullptr;
+            std::chrono::steady_clock::time_point time;
+        };
+
+        inline layer_call_start begin_layer_call (
+        )
+        {
+            layer_call_start start;
+            // When nothing is being profiled this is all the layers pay.
+            if (!layer_call_observer_ptr().load(std::memory_order_acquire))
+                return start;
+
+            // Count the call as in flight before touching the observer, then look it up
+            // again since it may have been removed in between.  Once it's counted the
+            // observer can't be destroyed until the call is released.
+            layer_calls_in_flight().fetch_add(1);
+            start.observer = layer_call_observer_ptr().load();
+            if (!start.observer)
+            {
+                layer_calls_in_flight().fetch_sub(1);
+                return start;
+            }
+            start.time = start.observer->begin_layer_call();
+            return start;
+        }
+
+        inline void end_layer_call (
+            const layer_call_start& start,
+            const void* layer,
+            profiled_layer_kind kind,
+            bool backward,
+            const tensor& input,
+            const tensor& output,
+            size_t allocated_bytes
+        )
+        {
+            start.observer->end_layer_call(layer, kind, backward, start.time, input, output, allocated_bytes);
+            start.release();
+        }
+
 
         template <typename layer_type, typename SUBNET>
         auto call_layer_forward(
@@ -589,6 +777,135 @@ namespace dlib
     template <typename T, typename U>
     struct is_nonloss_layer_type<add_layer<T,U>> : std::true_type {};
 
+    namespace impl
+    {
+        class tensor_pool
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    This object holds the output tensors that add_layer objects have
+                    given up because nothing is going to read them again during the
+                    current forward pass.  Layers that run later in the pass borrow their
+                    output tensors from here.  So a network in inference mode only keeps
+                    as many activation buffers allocated as are alive at the same time,
+                    and after the first forward pass no more memory is allocated.
+            !*/
+        public:
+
+            void acquire (
+                resizable_tensor& t,
+                size_t& capacity,
+                size_t size_needed
+            )
+            /*!
+                ensures
+                    - if (capacity == 0 and there are spare tensors) then
+                        - swaps into t the spare tensor that best fits size_needed.
+                          That is, the smallest one with at least size_needed elements
+                          allocated, or if there are none that big, the biggest one.
+                        - #capacity == the number of elements allocated in #t.
+            !*/
+            {
+                if (capacity != 0 || spares.size() == 0)
+                    return;
+
+                size_t best = 0;
+                for (size_t i = 1; i < spares.size(); ++i)
+                {
+                    const bool fits = spares[i].capacity >= size_needed;
+                    const bool best_fits = spares[best].capacity >= size_needed;
+                    if ((fits && (!best_fits || spares[i].capacity < spares[best].capacity)) ||
+                        (!fits && !best_fits && spares[i].capacity > spares[best].capacity))
+                    {
+                        best = i;
+                    }
+                }
+
+                t.swap(spares[best].t);
+                capacity = spares[best].capacity;
+                spares.erase(spares.begin()+best);
+            }
+
+            void release (
+                resizable_tensor& t,
+                size_t& capacity
+            )
+            /*!
+                ensures
+                    - if (capacity != 0) then
+                        - moves t into this pool and leaves #t empty.
+                        - #capacity == 0
+            !*/
+            {
+                if (capacity == 0)
+                    return;
+                spares.emplace_back();
+                spares.back().t.swap(t);
+                spares.back().capacity = capacity;
+                capacity = 0;
+            }
+
+        private:
+
+            struct spare
+            {
+                resizable_tensor t;
+                size_t capacity = 0;
+            };
+
+            std::vector<spare> spares;
+        };
+
+        class tensor_pool_ptr
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    This is a shared pointer to a tensor_pool, except that copying it
+                    gives a null pointer.  Each add_layer holds one of these and a copy of
+                    a network shouldn't share the pool of the network it was copied from.
+            !*/
+        public:
+            tensor_pool_ptr() = default;
+            tensor_pool_ptr(const tensor_pool_ptr&) {}
+            tensor_pool_ptr& operator=(const tensor_pool_ptr&) { ptr.reset(); return *this; }
+            tensor_pool_ptr(tensor_pool_ptr&& item) : ptr(std::move(item.ptr)) {}
+            tensor_pool_ptr& operator=(tensor_pool_ptr&& item) { ptr = std::move(item.ptr); return *this; }
+
+            explicit operator bool() const { return static_cast<bool>(ptr); }
+            tensor_pool& operator*() const { return *ptr; }
+
+            std::shared_ptr<tensor_pool> ptr;
+        };
+
+        template <unsigned long ID>
+        struct release_previous_tag;
+
+        struct activation_memory;
+
+        struct output_pool_access
+        {
+            template <typename T>
+            static void release_output(T&, tensor_pool&)
+            {
+                // Only add_layer objects own their outputs.  Anything else (tags, skips,
+                // repeats) might have other layers looking at its output, so it's left
+                // alone.
+            }
+
+            template <typename T, typename U, typename E>
+            static void release_output(add_layer<T,U,E>& l, tensor_pool& pool)
+            {
+                l.release_output(pool);
+            }
+
+            template <typename T, typename U, typename E>
+            static void set_output_pool(add_layer<T,U,E>& l, const std::shared_ptr<tensor_pool>& pool)
+            {
+                l.output_pool.ptr = pool;
+            }
+        };
+    }
+
     template <typename LAYER_DETAILS, typename SUBNET>
     class add_layer<LAYER_DETAILS,SUBNET,
             typename std::enable_if<is_nonloss_layer_type<SUBNET>::value>::type>
@@ -637,6 +954,12 @@ namespace dlib
         friend class add_skip_layer;
         template <size_t N, template<typename> class L, typename S>
         friend class repeat;
+        template <template<typename> class B, typename S>
+        friend class checkpoint;
+        friend struct impl::output_pool_access;
+        friend struct impl::activation_memory;
+        template <unsigned long ID>
+        friend struct impl::release_previous_tag;
 
         // Allow copying networks from one to another as long as their corresponding 
         // layers can be constructed from each other.
@@ -790,6 +1113,7 @@ namespace dlib
         const tensor& forward(const tensor& x)
         {
             subnetwork->forward(x);
+            const auto prof = impl::begin_layer_call();
             const dimpl::subnet_wrapper<subnet_type> wsub(*subnetwork);
             if (!this_layer_setup_called)
             {
@@ -797,11 +1121,29 @@ namespace dlib
                 this_layer_setup_called = true;
             }
             if (this_layer_operates_inplace())
+            {
                 impl::call_layer_forward(details, wsub, private_get_output());
+            }
+            else if (output_pool)
+            {
+                (*output_pool).acquire(cached_output, output_capacity, last_output_size);
+                impl::call_layer_forward(details, wsub, cached_output);
+                output_capacity = std::max(output_capacity, cached_output.size());
+                // Nothing above this layer reads the output of the layer below it, so its
+                // memory can go to the layers that run after this one.
+                impl::output_pool_access::release_output(*subnetwork, *output_pool);
+            }
             else
+            {
                 impl::call_layer_forward(details, wsub, cached_output);
+            }
 
             gradient_input_is_stale = true;
+            if (prof)
+            {
+                impl::end_layer_call(prof, this, impl::profiled_layer_kind::computational, false,
+                    subnetwork->private_get_output(), private_get_output(), allocated_bytes());
+            }
             return private_get_output();
         }
 
@@ -855,10 +1197,18 @@ namespace dlib
         }
         void back_propagate_error(const tensor& x, const tensor& gradient_input)
         {
+            DLIB_CASSERT(!output_pool, "You can't back propagate through a network that is in inference mode.");
+            const auto prof = impl::begin_layer_call();
             dimpl::subnet_wrapper<subnet_type> wsub(*subnetwork);
             params_grad.copy_size(details.get_layer_params());
             impl::call_layer_backward(details, private_get_output(),
                 gradient_input, wsub, static_cast<tensor&>(params_grad));
+            if (prof)
+            {
+                impl::end_layer_call(prof, this, impl::profiled_layer_kind::computational, true,
+                    subnetwork->private_get_output(), private_get_output(), allocated_bytes());
+            }
+            impl::notify_parameter_gradient_ready(params_grad);
 
             subnetwork->back_propagate_error(x); 
 
@@ -901,6 +1251,7 @@ namespace dlib
             params_grad.clear();
             temp_tensor.clear();
             gradient_input_is_stale = true;
+            output_capacity = 0;
             subnetwork->clean();
             call_clean_method_if_exists(details);
         }
@@ -975,6 +1326,46 @@ namespace dlib
             std::swap(x_grad, item.x_grad);
             std::swap(cached_output, item.cached_output);
             std::swap(params_grad, item.params_grad);
+            std::swap(output_pool, item.output_pool);
+            std::swap(output_capacity, item.output_capacity);
+            std::swap(last_output_size, item.last_output_size);
+        }
+
+        void release_output(impl::tensor_pool& pool)
+        {
+            if (this_layer_operates_inplace())
+            {
+                impl::output_pool_access::release_output(*subnetwork, pool);
+            }
+            else
+            {
+                last_output_size = cached_output.size();
+                pool.release(cached_output, output_capacity);
+            }
+        }
+
+        size_t allocated_bytes()
+        {
+            size_t num = x_grad.size() + params_grad.size() + details.get_layer_params().size();
+            if (!this_layer_operates_inplace())
+                num += cached_output.size();
+            return num*sizeof(float);
+        }
+
+        size_t release_activations()
+        {
+            // Called by checkpoint on the layers inside it.  params_grad is kept since
+            // the solvers still need it after back_propagate_error().
+            size_t num = x_grad.size();
+            x_grad.clear();
+            if (!this_layer_operates_inplace())
+            {
+                num += cached_output.size();
+                cached_output.clear();
+                output_capacity = 0;
+            }
+            gradient_input_is_stale = true;
+            return num*sizeof(float);
         }
 
 
@@ -995,6 +1386,12 @@ namespace dlib
         // It is here only to prevent it from being reallocated over and over.
         resizable_tensor temp_tensor;
 
+        // These are only used when the network is in inference mode.  output_capacity is
+        // the number of elements allocated in cached_output and last_output_size is how
+        // big the output was the last time it was given back to the pool.
+        impl::tensor_pool_ptr output_pool;
+        size_t output_capacity = 0;
+        size_t last_output_size = 0;
     };
 
     template <typename T, typename U, typename E>
@@ -1043,6 +1440,12 @@ namespace dlib
         friend class add_skip_layer;
         template <size_t N, template<typename> class L, typename S>
         friend class repeat;
+        template <template<typename> class B, typename S>
+        friend class checkpoint;
+        friend struct impl::output_pool_access;
+        friend struct impl::activation_memory;
+        template <unsigned long ID>
+        friend struct impl::release_previous_tag;
 
         // Allow copying networks from one to another as long as their corresponding 
         // layers can be constructed from each other.
@@ -1136,6 +1539,10 @@ namespace dlib
             resizable_tensor& data
         ) const
         {
+            // The input layers inside repeat and checkpoint blocks don't do anything, so
+            // they aren't profiled.
+            const auto prof = is_same_type<subnet_type,impl::repeat_input_layer>::value ?
+                impl::layer_call_start() : impl::begin_layer_call();
             input_layer.to_tensor(ibegin, iend, data);
             // make sure the input layer's to_tensor() function is implemented properly.
             DLIB_CASSERT(data.num_samples() >= std::distance(ibegin,iend), 
@@ -1145,6 +1552,8 @@ namespace dlib
 
             _sample_expansion_factor = data.num_samples()/std::distance(ibegin,iend);
             data.async_copy_to_device();
+            if (prof)
+                impl::end_layer_call(prof, &input_layer, impl::profiled_layer_kind::input, false, data, data, 0);
         }
 
 
@@ -1168,14 +1577,20 @@ namespace dlib
         {
             DLIB_CASSERT(sample_expansion_factor() != 0, "You must call to_tensor() before this function can be used.");
             DLIB_CASSERT(x.num_samples()%sample_expansion_factor() == 0);
+            const auto prof = impl::begin_layer_call();
             subnet_wrapper wsub(x, grad_final, _sample_expansion_factor);
             if (!this_layer_setup_called)
             {
                 details.setup(wsub);
                 this_layer_setup_called = true;
             }
+            if (output_pool)
+                (*output_pool).acquire(cached_output, output_capacity, last_output_size);
             impl::call_layer_forward(details, wsub, cached_output);
+            output_capacity = std::max(output_capacity, cached_output.size());
             gradient_input_is_stale = true;
+            if (prof)
+                impl::end_layer_call(prof, this, impl::profiled_layer_kind::computational, false, x, cached_output, allocated_bytes());
             return private_get_output();
         }
 
@@ -1216,6 +1631,8 @@ namespace dlib
         }
         void back_propagate_error(const tensor& x, const tensor& gradient_input)
         {
+            DLIB_CASSERT(!output_pool, "You can't back propagate through a network that is in inference mode.");
+            const auto prof = impl::begin_layer_call();
             // make sure grad_final is initialized to 0
             if (!have_same_dimensions(x, grad_final))
                 grad_final.copy_size(x);
@@ -1225,6 +1642,9 @@ namespace dlib
             params_grad.copy_size(details.get_layer_params());
             impl::call_layer_backward(details, private_get_output(),
                 gradient_input, wsub, static_cast<tensor&>(params_grad));
+            if (prof)
+                impl::end_layer_call(prof, this, impl::profiled_layer_kind::computational, true, x, cached_output, allocated_bytes());
+            impl::notify_parameter_gradient_ready(params_grad);
 
             // zero out get_gradient_input()
             gradient_input_is_stale = true;
@@ -1265,6 +1685,7 @@ namespace dlib
             params_grad.clear();
             temp_tensor.clear();
             gradient_input_is_stale = true;
+            output_capacity = 0;
             call_clean_method_if_exists(details);
         }
 
@@ -1329,6 +1750,10 @@ namespace dlib
             return impl::backward_requires_forward_output(details, wsub);
         }
 
+        // Layers sitting on the input layer always write to their own cached_output.
+        bool this_layer_operates_inplace(
+        ) const { return false; }
+
         class subnet_wrapper
         {
         public:
@@ -1367,6 +1792,33 @@ namespace dlib
             std::swap(cached_output, item.cached_output); 
             std::swap(grad_final, item.grad_final); 
             std::swap(_sample_expansion_factor, item._sample_expansion_factor); 
+            std::swap(output_pool, item.output_pool);
+            std::swap(output_capacity, item.output_capacity);
+            std::swap(last_output_size, item.last_output_size);
+        }
+
+        void release_output(impl::tensor_pool& pool)
+        {
+            last_output_size = cached_output.size();
+            pool.release(cached_output, output_capacity);
+        }
+
+        size_t allocated_bytes()
+        {
+            const size_t num = x_grad.size() + cached_output.size() + grad_final.size() +
+                params_grad.size() + details.get_layer_params().size();
+            return num*sizeof(float);
+        }
+
+        size_t release_activations()
+        {
+            const size_t num = x_grad.size() + cached_output.size() + grad_final.size();
+            x_grad.clear();
+            cached_output.clear();
+            grad_final.clear();
+            gradient_input_is_stale = true;
+            output_capacity = 0;
+            return num*sizeof(float);
         }
 
         subnet_type input_layer;
@@ -1384,6 +1836,12 @@ namespace dlib
         // member functions.
         resizable_tensor params_grad; 
         resizable_tensor temp_tensor; 
+
+        // These are only used when the network is in inference mode.  See the comments
+        // in the other add_layer specialization.
+        impl::tensor_pool_ptr output_pool;
+        size_t output_capacity = 0;
+        size_t last_output_size = 0;
     };
 
 // ----------------------------------------------------------------------------------------
@@ -1455,7 +1913,11 @@ namespace dlib
 
         const tensor& forward(const tensor& x)
         {
-            return subnetwork.forward(x);
+            subnetwork.forward(x);
+            // Layers above this tag can't see any tag with the same ID further down, so
+            // in inference mode the output that tag points to is no longer needed.
+            impl::release_previous_tag<ID>::below(subnetwork, false, false);
+            return subnetwork.get_output();
         }
 
         const tensor& get_output() const { return subnetwork.get_output(); }
@@ -1540,6 +2002,8 @@ namespace dlib
         friend class add_skip_layer;
         template <size_t N, template<typename> class L, typename S>
         friend class repeat;
+        template <template<typename> class B, typename S>
+        friend class checkpoint;
 
         // You wouldn't put a tag on a layer if you didn't want to access its forward
         // outputs.  So this is always true.
@@ -1839,6 +2303,8 @@ namespace dlib
         friend class add_skip_layer;
         template <size_t N, template<typename> class L, typename S>
         friend class repeat;
+        template <template<typename> class B, typename S>
+        friend class checkpoint;
 
         bool this_layer_requires_forward_output(
         ) 
@@ -1927,6 +2393,10 @@ namespace dlib
             resizable_tensor& data
         ) const
         {
+            // The input layers inside repeat and checkpoint blocks don't do anything, so
+            // they aren't profiled.
+            const auto prof = is_same_type<subnet_type,impl::repeat_input_layer>::value ?
+                impl::layer_call_start() : impl::begin_layer_call();
             input_layer.to_tensor(ibegin,iend,data);
 
             // make sure the input layer's to_tensor() function is implemented properly.
@@ -1937,6 +2407,8 @@ namespace dlib
 
             _sample_expansion_factor = data.num_samples()/std::distance(ibegin,iend);
             data.async_copy_to_device();
+            if (prof)
+                impl::end_layer_call(prof, &input_layer, impl::profiled_layer_kind::input, false, data, data, 0);
         }
 
         unsigned int sample_expansion_factor() const { return _sample_expansion_factor; }
@@ -2076,6 +2548,9 @@ namespace dlib
         friend class add_skip_layer;
         template <size_t N, template<typename> class L, typename S>
         friend class repeat;
+        template <template<typename> class B, typename S>
+        friend class checkpoint;
+        friend struct impl::activation_memory;
 
         // You woudln't put a tag on a layer if you didn't want to access its forward
         // outputs.  So this is always true.
@@ -2098,6 +2573,14 @@ namespace dlib
         tensor& private_get_gradient_input() 
         { return get_gradient_input(); }
 
+        size_t release_activations()
+        {
+            const size_t num = grad_final.size();
+            grad_final.clear();
+            gradient_input_is_stale = true;
+            return num*sizeof(float);
+        }
+
         void swap(add_tag_layer& item)
         {
             std::swap(input_layer, item.input_layer);
@@ -2258,8 +2741,10 @@ namespace dlib
         )
         {
             subnetwork.forward(x);
+            const auto prof = impl::begin_layer_call();
             const dimpl::subnet_wrapper<subnet_type> wsub(subnetwork);
             loss.to_label(x, wsub, obegin);
+            end_loss_call(prof);
         }
 
         template <typename forward_iterator, typename output_iterator>
@@ -2284,8 +2769,10 @@ namespace dlib
         {
             to_tensor(&x,&x+1,temp_tensor);
             subnetwork.forward(temp_tensor);
+            const auto prof = impl::begin_layer_call();
             const dimpl::subnet_wrapper<subnet_type> wsub(subnetwork);
             loss.to_label(temp_tensor, wsub, &temp_label, std::forward<T>(args)...);
+            end_loss_call(prof);
             return temp_label;
         }
 
@@ -2301,8 +2788,10 @@ namespace dlib
                 auto inc = std::min(batch_size, num_remaining);
                 to_tensor(i,i+inc,temp_tensor);
                 subnetwork.forward(temp_tensor);
+                const auto prof = impl::begin_layer_call();
                 const dimpl::subnet_wrapper<subnet_type> wsub(subnetwork);
                 loss.to_label(temp_tensor, wsub, o, std::forward<T>(args)...);
+                end_loss_call(prof);
 
                 i += inc;
                 o += inc;
@@ -2339,8 +2828,11 @@ namespace dlib
         )
         {
             subnetwork.forward(x);
+            const auto prof = impl::begin_layer_call();
             dimpl::subnet_wrapper<subnet_type> wsub(subnetwork);
-            return loss.compute_loss_value_and_gradient(x, lbegin, wsub);
+            const double l = loss.compute_loss_value_and_gradient(x, lbegin, wsub);
+            end_loss_call(prof);
+            return l;
         }
 
         template <typename forward_iterator, typename label_iterator>
@@ -2359,8 +2851,11 @@ namespace dlib
         )
         {
             subnetwork.forward(x);
+            const auto prof = impl::begin_layer_call();
             dimpl::subnet_wrapper<subnet_type> wsub(subnetwork);
-            return loss.compute_loss_value_and_gradient(x, wsub);
+            const double l = loss.compute_loss_value_and_gradient(x, wsub);
+            end_loss_call(prof);
+            return l;
         }
 
         template <typename forward_iterator>
@@ -2380,8 +2875,10 @@ namespace dlib
         )
         {
             subnetwork.forward(x);
+            const auto prof = impl::begin_layer_call();
             dimpl::subnet_wrapper<subnet_type> wsub(subnetwork);
             double l = loss.compute_loss_value_and_gradient(x, lbegin, wsub);
+            end_loss_call(prof);
             subnetwork.back_propagate_error(x);
             return l;
         }
@@ -2400,8 +2897,10 @@ namespace dlib
         )
         {
             subnetwork.forward(x);
+            const auto prof = impl::begin_layer_call();
             dimpl::subnet_wrapper<subnet_type> wsub(subnetwork);
             double l = loss.compute_loss_value_and_gradient(x, wsub);
+            end_loss_call(prof);
             subnetwork.back_propagate_error(x);
             return l;
         }
@@ -2456,6 +2955,18 @@ namespace dlib
 
     private:
 
+        void end_loss_call(
+            const impl::layer_call_start& prof
+        )
+        {
+            // The loss is charged with everything it does, including computing the
+            // gradient of the loss, as a single forward call.
+            if (prof)
+            {
+                impl::end_layer_call(prof, this, impl::profiled_layer_kind::loss, false,
+                    subnetwork.get_output(), subnetwork.get_output(), 0);
+            }
+        }
 
         void swap(add_loss_layer& item)
         {
@@ -2500,6 +3011,9 @@ namespace dlib
 // ----------------------------------------------------------------------------------------
 // ----------------------------------------------------------------------------------------
 
+    template <template<typename> class BLOCK, typename SUBNET>
+    class checkpoint;
+
     namespace impl
     {
         template <unsigned int i, typename T, typename enabled = void>
@@ -2606,6 +3120,63 @@ namespace dlib
 
 
 
+        template <
+            unsigned int i,
+            template<typename> class B, typename S
+        >
+        struct layer_helper<i,checkpoint<B,S>, typename std::enable_if<(i!=0&&i>checkpoint<B,S>::layers_in_block)>::type>
+        {
+            const static size_t layers_in_block = checkpoint<B,S>::layers_in_block;
+            typedef typename checkpoint<B,S>::subnet_type next_type;
+            using type = typename layer_helper<i-1-layers_in_block,next_type>::type;
+            static type& layer(checkpoint<B,S>& n)
+            {
+                return layer_helper<i-1-layers_in_block,next_type>::layer(n.subnet());
+            }
+        };
+        template <
+            unsigned int i,
+            template<typename> class B, typename S
+        >
+        struct layer_helper<i,checkpoint<B,S>, typename std::enable_if<(i!=0&&i<=checkpoint<B,S>::layers_in_block)>::type>
+        {
+            typedef typename checkpoint<B,S>::block_type next_type;
+            using type = typename layer_helper<i-1,next_type>::type;
+            static type& layer(checkpoint<B,S>& n)
+            {
+                return layer_helper<i-1,next_type>::layer(n.get_block());
+            }
+        };
+        template <
+            unsigned int i,
+            template<typename> class B, typename S
+        >
+        struct layer_helper<i,const checkpoint<B,S>, typename std::enable_if<(i!=0&&i>checkpoint<B,S>::layers_in_block)>::type>
+        {
+            const static size_t layers_in_block = checkpoint<B,S>::layers_in_block;
+            typedef const typename checkpoint<B,S>::subnet_type next_type;
+            using type = const typename layer_helper<i-1-layers_in_block,next_type>::type;
+            static type& layer(const checkpoint<B,S>& n)
+            {
+                return layer_helper<i-1-layers_in_block,next_type>::layer(n.subnet());
+            }
+        };
+        template <
+            unsigned int i,
+            template<typename> class B, typename S
+        >
+        struct layer_helper<i,const checkpoint<B,S>, typename std::enable_if<(i!=0&&i<=checkpoint<B,S>::layers_in_block)>::type>
+        {
+            typedef const typename checkpoint<B,S>::block_type next_type;
+            using type = const typename layer_helper<i-1,next_type>::type;
+            static type& layer(const checkpoint<B,S>& n)
+            {
+                return layer_helper<i-1,next_type>::layer(n.get_block());
+            }
+        };
+
+
+
         template <typename T>
         struct layer_helper<0,T,void>
         {
@@ -2880,6 +3451,8 @@ namespace dlib
         friend class add_skip_layer;
         template <size_t N, template<typename> class L, typename S>
         friend class repeat;
+        template <template<typename> class B, typename S>
+        friend class checkpoint;
 
         bool this_layer_requires_forward_output(
         ) { return layer<TAG_TYPE>(subnetwork).this_layer_requires_forward_output(); } 
@@ -2899,6 +3472,62 @@ namespace dlib
         // which have to return something.  So they return this empty tensor.
         resizable_tensor params_grad;
     };
+
+    namespace impl
+    {
+        template <unsigned long ID>
+        struct release_previous_tag
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    below(net, false, false) walks down net until it finds a tag layer
+                    with the given ID and, if the network is in inference mode, gives the
+                    output that tag points at back to the memory pool.  It only does this
+                    when that output belongs to a different layer than the output at the
+                    top of net, which is what the new tag points at, and when no other tag
+                    points at it.  The walk stops at anything that might alias outputs in
+                    a way that isn't visible from the types involved, such as skip layers,
+                    repeat layers, and input layers.
+            !*/
+
+            template <typename T>
+            static void below(T&, bool, bool) {}
+
+            template <typename T, typename U, typename E>
+            static void below(add_layer<T,U,E>& l, bool passed_owner, bool other_tag)
+            {
+                // Everything under a layer that owns its output refers to a different
+                // output, so the record of other tags starts over.
+                if (l.this_layer_operates_inplace())
+                    below(l.subnet(), passed_owner, other_tag);
+                else
+                    below(l.subnet(), true, false);
+            }
+
+            template <unsigned long ID2, typename U, typename E>
+            static void below(add_tag_layer<ID2,U,E>& l, bool passed_owner, bool other_tag)
+            {
+                if (ID2 != ID)
+                    below(l.subnet(), passed_owner, true);
+                else if (passed_owner && !other_tag)
+                    release(l.subnet());
+            }
+
+        private:
+
+            template <typename T>
+            static void release(T&) {}
+
+            template <typename T, typename U, typename E>
+            static void release(add_layer<T,U,E>& l)
+            {
+                // release_output() walks down through in-place layers to the owner of
+                // the output and stops if it hits another tag along the way.
+                if (l.output_pool)
+                    l.release_output(*l.output_pool);
+            }
+        };
+    }
     template <template<typename> class T, typename U>
     struct is_nonloss_layer_type<add_skip_layer<T,U>> : std::true_type {};
 
@@ -2926,16 +3555,416 @@ namespace dlib
 
 // ----------------------------------------------------------------------------------------
 
-    namespace timpl
+    namespace impl
     {
-        inline void fill_with_gassuan_random_numbers (
-            tensor& t,
-            dlib::rand& rnd,
-            double sigma = 1
-        )
+        struct activation_memory
         {
-            float* data = t.host();
-            for (size_t i = 0; i < t.size(); ++i)
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    release(net) frees the outputs and data gradients held by the layers
+                    in net and returns how many bytes that gave back.  Parameter gradients
+                    are left alone since the solvers still need them.  checkpoint calls
+                    this on its block, which is always sitting on a repeat_input_layer.
+            !*/
+
+            template <typename T>
+            static size_t release(T&) { return 0; }
+
+            template <typename T, typename U, typename E>
+            static size_t release(add_layer<T,U,E>& l)
+            {
+                return l.release_activations() + release(l.subnet());
+            }
+
+            template <unsigned long ID, typename U, typename E>
+            static size_t release(add_tag_layer<ID,U,E>& l)
+            {
+                return release(l.subnet());
+            }
+
+            template <unsigned long ID, typename E>
+            static size_t release(add_tag_layer<ID,repeat_input_layer,E>& l)
+            {
+                return l.release_activations();
+            }
+
+            template <template<typename> class T, typename U>
+            static size_t release(add_skip_layer<T,U>& l)
+            {
+                return release(l.subnet());
+            }
+
+            template <size_t N, template<typename> class L, typename S>
+            static size_t release(repeat<N,L,S>& l)
+            {
+                size_t num = 0;
+                for (size_t i = 0; i < l.num_repetitions(); ++i)
+                    num += release(l.get_repeated_layer(i));
+                return num + release(l.subnet());
+            }
+
+            template <template<typename> class B, typename S>
+            static size_t release(checkpoint<B,S>& l)
+            {
+                return l.release_activations();
+            }
+        };
+
+        struct recompute_mode
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    set(net, recomputing) calls set_recomputing(recomputing) on every layer
+                    in net that has that method.  checkpoint turns this on for its block
+                    while it runs the block forward a second time, so that layers like bn_
+                    and dropout_ reproduce the first forward pass instead of updating
+                    their running statistics or drawing a new mask.
+            !*/
+
+            template <typename T>
+            static void set(T&, bool) {}
+
+            template <typename T, typename U, typename E>
+            static void set(add_layer<T,U,E>& l, bool recomputing)
+            {
+                dlib::call_set_recomputing_method_if_exists(l.layer_details(), recomputing);
+                set(l.subnet(), recomputing);
+            }
+
+            template <unsigned long ID, typename U, typename E>
+            static void set(add_tag_layer<ID,U,E>& l, bool recomputing)
+            {
+                set(l.subnet(), recomputing);
+            }
+
+            template <template<typename> class T, typename U>
+            static void set(add_skip_layer<T,U>& l, bool recomputing)
+            {
+                set(l.subnet(), recomputing);
+            }
+
+            template <size_t N, template<typename> class L, typename S>
+            static void set(repeat<N,L,S>& l, bool recomputing)
+            {
+                for (size_t i = 0; i < l.num_repetitions(); ++i)
+                    set(l.get_repeated_layer(i), recomputing);
+                set(l.subnet(), recomputing);
+            }
+
+            template <template<typename> class B, typename S>
+            static void set(checkpoint<B,S>& l, bool recomputing)
+            {
+                set(l.get_block(), recomputing);
+                set(l.subnet(), recomputing);
+            }
+        };
+    }
+
+    template <
+        template<typename> class BLOCK, 
+        typename SUBNET
+        >
+    class checkpoint
+    {
+    public:
+        typedef SUBNET subnet_type;
+        typedef typename SUBNET::input_type input_type;
+        typedef int layer_details_type; // not really used anywhere, but required by subnet_wrapper.
+        typedef BLOCK<impl::repeat_input_layer> block_type;
+
+        const static size_t comp_layers_in_block = BLOCK<SUBNET>::num_computational_layers-SUBNET::num_computational_layers;
+        const static size_t num_computational_layers = BLOCK<SUBNET>::num_computational_layers;
+        const static size_t layers_in_block = BLOCK<SUBNET>::num_layers-SUBNET::num_layers;
+        // The checkpoint itself counts as a layer, like a tag does, so that it can be
+        // found with layer<i>() and visit_layers().
+        const static size_t num_layers = subnet_type::num_layers + layers_in_block + 1;
+
+        checkpoint(
+        ) = default;
+
+        checkpoint(const checkpoint&) = default;
+        checkpoint(checkpoint&&) = default;
+        checkpoint& operator=(checkpoint&&) = default;
+        checkpoint& operator=(const checkpoint&) = default;
+
+        template <template<typename> class T, typename U>
+        checkpoint(
+            const checkpoint<T,U>& item
+        ) : 
+            block(item.block),
+            subnetwork(item.subnetwork)
+        {
+        }
+
+        template <typename T, typename ...U>
+        checkpoint(
+            T arg1,
+            U ...args2
+        ): 
+            block(std::move(arg1)),
+            subnetwork(std::move(args2)...)
+        {
+        }
+
+        template <typename T, typename ...U>
+        checkpoint(
+            std::tuple<>,
+            T arg1,
+            U ...args2
+        ): 
+            block(std::move(arg1)),
+            subnetwork(std::move(args2)...)
+        {
+        }
+
+        const block_type& get_block (
+        ) const { return block; }
+
+        block_type& get_block (
+        ) { return block; }
+
+        size_t get_activation_bytes_released (
+        ) const { return bytes_released; }
+
+        template <typename forward_iterator>
+        void to_tensor (
+            forward_iterator ibegin,
+            forward_iterator iend,
+            resizable_tensor& data
+        ) const
+        {
+            subnetwork.to_tensor(ibegin,iend,data);
+            // This only populates the _sample_expansion_factor values inside the block.
+            block.to_tensor(ibegin, iend, data);
+        }
+
+        template <typename forward_iterator>
+        const tensor& operator() (
+            forward_iterator ibegin,
+            forward_iterator iend
+        )
+        {
+            to_tensor(ibegin,iend,temp_tensor);
+            return forward(temp_tensor);
+        }
+
+        const tensor& operator() (const input_type& x)
+        {
+            return (*this)(&x, &x+1);
+        }
+
+        const tensor& forward(const tensor& x)
+        {
+            subnetwork.forward(x);
+            cached_output = block.forward(subnetwork.get_output());
+            gradient_input_is_stale = true;
+            bytes_released = impl::activation_memory::release(block);
+            return private_get_output();
+        }
+
+    private:
+        tensor& private_get_output() const
+        { 
+            return const_cast<resizable_tensor&>(cached_output);
+        }
+        tensor& private_get_gradient_input() 
+        { 
+            if (gradient_input_is_stale)
+            {
+                gradient_input_is_stale = false;
+                x_grad.copy_size(private_get_output());
+                x_grad = 0;
+            }
+            return x_grad; 
+        }
+    public:
+        const tensor& get_output() const 
+        { 
+            if (get_output_and_gradient_input_disabled)
+                throw dlib::error("Accessing this layer's get_output() is disabled because an in-place layer has been stacked on top of it.");
+            return private_get_output(); 
+        }
+        tensor& get_gradient_input() 
+        { 
+            if (get_output_and_gradient_input_disabled)
+                throw dlib::error("Accessing this layer's get_gradient_input() is disabled because an in-place layer has been stacked on top of it.");
+            return private_get_gradient_input();
+        }
+
+        const tensor& get_final_data_gradient(
+        ) const { return subnetwork.get_final_data_gradient(); }
+
+        const tensor& get_parameter_gradient(
+        ) const { return params_grad; }
+
+        tensor& get_parameter_gradient (
+        ) { return params_grad; }
+
+        void back_propagate_error(const tensor& x)
+        {
+            back_propagate_error(x, private_get_gradient_input());
+        }
+        void back_propagate_error(const tensor& x, const tensor& gradient_input)
+        {
+            // Run the block again to get back the outputs forward() threw away.  This
+            // has to reproduce the first run exactly, so the layers in the block are told
+            // they are recomputing.  E.g. bn_ then leaves its running statistics alone
+            // and dropout_ reuses its mask.
+            impl::recompute_mode::set(block, true);
+            try
+            {
+                block.forward(subnetwork.get_output());
+            }
+            catch (...)
+            {
+                impl::recompute_mode::set(block, false);
+                throw;
+            }
+            impl::recompute_mode::set(block, false);
+            block.back_propagate_error(subnetwork.get_output(), gradient_input);
+
+            // Hand the block's data gradient to the subnetwork the same way add_layer
+            // does, by adding it to the subnetwork's gradient input, so that gradients
+            // coming from skip layers aren't lost.  Then free the block again before
+            // going further down so only one block at a time holds its activations.
+            tensor& sub_grad = subnetwork.private_get_gradient_input();
+            tt::add(1, sub_grad, 1, block.get_final_data_gradient());
+            bytes_released = impl::activation_memory::release(block);
+
+            subnetwork.back_propagate_error(x);
+
+            // zero out get_gradient_input()
+            gradient_input_is_stale = true;
+        }
+
+        template <typename solver_type>
+        void update_parameters(sstack<solver_type> solvers, double learning_rate)
+        {
+            block.update_parameters(solvers, learning_rate);
+            subnetwork.update_parameters(solvers.pop(comp_layers_in_block), learning_rate);
+        }
+
+        const subnet_type& subnet() const { return subnetwork; }
+        subnet_type& subnet() { return subnetwork; }
+
+        unsigned int sample_expansion_factor() const { return subnet().sample_expansion_factor(); }
+
+        void clean()
+        {
+            x_grad.clear();
+            cached_output.clear();
+            temp_tensor.clear();
+            gradient_input_is_stale = true;
+            block.clean();
+            subnetwork.clean();
+        }
+
+        friend void serialize(const checkpoint& item, std::ostream& out)
+        {
+            int version = 1;
+            serialize(version, out);
+            serialize(item.block, out);
+            serialize(item.subnetwork, out);
+        }
+
+        friend void deserialize(checkpoint& item, std::istream& in)
+        {
+            int version = 0;
+            deserialize(version, in);
+            if (version != 1)
+                throw serialization_error("Unexpected version found while deserializing dlib::checkpoint.");
+            deserialize(item.block, in);
+            deserialize(item.subnetwork, in);
+        }
+
+        friend std::ostream& operator<< (std::ostream& out, const checkpoint& item)
+        {
+            int min_length = 0;
+            item.print(out, 0, min_length);
+            return out;
+        }
+
+        void print (std::ostream& out, unsigned long idx, int& min_length) const
+        {
+            out << "layer<" << idx << ">\t" << impl::tensor_to_str(private_get_output(), min_length) << "checkpoint\n";
+            block.print(out, idx+1, min_length);
+            subnet().print(out, idx+1+layers_in_block, min_length);
+        }
+
+    private:
+
+
+        template <typename T, typename U, typename E>
+        friend class add_layer;
+        template <typename T, bool is_first, typename E>
+        friend class dimpl::subnet_wrapper;
+        template <unsigned long T, typename U, typename E>
+        friend class add_tag_layer;
+        template <template<typename> class T, typename U>
+        friend class add_skip_layer;
+        template <size_t N, template<typename> class L, typename S>
+        friend class repeat;
+        template <template<typename> class B, typename S>
+        friend class checkpoint;
+        friend struct impl::activation_memory;
+
+        // The block is recomputed during back_propagate_error(), so the output
+        // held here is never needed again and an in-place layer can overwrite it.
+        bool this_layer_requires_forward_output(
+        ) { return false; } 
+
+        void disable_output_and_gradient_getters (
+        ) { get_output_and_gradient_input_disabled = true; }
+
+        size_t release_activations()
+        {
+            // Only called when this checkpoint is itself inside another checkpoint's
+            // block, in which case its own output can be recomputed too.
+            const size_t num = x_grad.size() + cached_output.size();
+            x_grad.clear();
+            cached_output.clear();
+            gradient_input_is_stale = true;
+            return num*sizeof(float) + impl::activation_memory::release(block) +
+                impl::activation_memory::release(subnetwork);
+        }
+
+        block_type block;
+        subnet_type subnetwork;
+        bool gradient_input_is_stale = true;
+        bool get_output_and_gradient_input_disabled = false;
+        size_t bytes_released = 0;
+        resizable_tensor x_grad;
+        resizable_tensor cached_output;
+
+        // This member doesn't logically contribute to the state of the object since it is
+        // always empty. It's just here so we can have the get_parameter_gradient() methods
+        // which have to return something.  So they return this empty tensor.
+        resizable_tensor params_grad;
+
+        // temp_tensor doesn't logically contribute to the state of this class.
+        // It is here only to void needing to reallocate it over and over.
+        resizable_tensor temp_tensor;
+    };
+
+    template <
+        template<typename> class BLOCK, 
+        typename SUBNET
+        >
+    struct is_nonloss_layer_type<checkpoint<BLOCK,SUBNET>> : std::true_type {};
+
+
+// ----------------------------------------------------------------------------------------
+
+    namespace timpl
+    {
+        inline void fill_with_gassuan_random_numbers (
+            tensor& t,
+            dlib::rand& rnd,
+            double sigma = 1
+        )
+        {
+            float* data = t.host();
+            for (size_t i = 0; i < t.size(); ++i)
                 data[i] = rnd.get_random_gaussian()*sigma;
         }
 
@@ -3493,6 +4522,97 @@ namespace dlib
         impl::vl_loop_backwards<0, net_type::num_layers>::visit(net, v);
     }
 
+    namespace impl
+    {
+        class visitor_set_output_pool
+        {
+        public:
+            visitor_set_output_pool(const std::shared_ptr<tensor_pool>& pool_) : pool(pool_) {}
+
+            template <typename T>
+            void operator()(size_t, T&) const
+            {
+            }
+
+            template <typename T, typename U, typename E>
+            void operator()(size_t, add_layer<T,U,E>& l) const
+            {
+                output_pool_access::set_output_pool(l, pool);
+            }
+
+        private:
+            std::shared_ptr<tensor_pool> pool;
+        };
+    }
+
+    template <typename net_type>
+    void enable_inference_mode (
+        net_type& net
+    )
+    {
+        // Drop any gradients and outputs left over from training so the pool starts
+        // from nothing.
+        net.clean();
+        visit_layers(net, impl::visitor_set_output_pool(std::make_shared<impl::tensor_pool>()));
+    }
+
+    template <typename net_type>
+    void disable_inference_mode (
+        net_type& net
+    )
+    {
+        visit_layers(net, impl::visitor_set_output_pool(nullptr));
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        class visitor_checkpoint_bytes
+        {
+        public:
+            explicit visitor_checkpoint_bytes(size_t& total_) : total(total_) {}
+
+            template <typename T>
+            void operator()(size_t, const T&) const
+            {
+            }
+
+            template <template<typename> class B, typename S>
+            void operator()(size_t, const checkpoint<B,S>& l) const
+            {
+                total += l.get_activation_bytes_released();
+            }
+
+        private:
+            size_t& total;
+        };
+    }
+
+    template <typename net_type>
+    size_t get_checkpointed_activation_bytes (
+        const net_type& net
+    )
+    {
+        size_t total = 0;
+        visit_layers(net, impl::visitor_checkpoint_bytes(total));
+        return total;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <typename net_type>
+    void copy_net_sharing_weights (
+        const net_type& from,
+        net_type& to
+    )
+    {
+        impl::tensor_data_sharing_scope share_tensors;
+        to = from;
+    }
+
+// ----------------------------------------------------------------------------------------
+
     template <
         size_t begin,
         size_t end,
@@ -1240,6 +1240,145 @@ namespace dlib
         provides serialization support  
     !*/
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        template<typename> class BLOCK, 
+        typename SUBNET
+        >
+    class checkpoint 
+    {
+        /*!
+            REQUIREMENTS ON BLOCK
+                - BLOCK must be a template that stacks more layers onto a deep neural
+                  network.  For example, if net_type were a network without a loss layer,
+                  then it should be legal to create a deeper network with a type of
+                  BLOCK<net_type>.
+
+            REQUIREMENTS ON SUBNET
+                - One of the following must be true:
+                    - SUBNET is an add_layer object.
+                    - SUBNET is an add_tag_layer object.
+                    - SUBNET is an add_skip_layer object.
+                    - SUBNET is a repeat object.
+                    - SUBNET is a checkpoint object.
+
+            WHAT THIS OBJECT REPRESENTS
+                This object adds BLOCK on top of SUBNET, so it computes the same function
+                as BLOCK<SUBNET>, but trades compute for memory while doing it.  Normally
+                every layer keeps its output from forward() until back_propagate_error()
+                has used it, so the memory needed to train a network grows with its depth.
+                A checkpoint instead keeps only the output of the whole block.  As soon as
+                forward() has computed it, the outputs and gradients of the layers inside
+                the block are freed.  back_propagate_error() then runs the block forward
+                again to get them back, back propagates through it, and frees them again
+                before continuing into SUBNET.  So at most one checkpointed block at a time
+                holds its activations, at the price of running the block forward twice per
+                training step.  You choose the trade off by choosing which parts of the
+                network to wrap.  E.g. a ResNet might checkpoint each residual block:
+                    template <typename SUBNET> using block = relu<add_prev1<bn_con<con<8,3,3,1,1,relu<bn_con<con<8,3,3,1,1,tag1<SUBNET>>>>>>>>;
+                    template <typename SUBNET> using ckpt_block = checkpoint<block,SUBNET>;
+
+                The checkpoint itself is a layer that performs the identity transform on
+                the output of BLOCK, like a tag layer.  So layer<0>(ckpt) is the checkpoint,
+                layer<1>(ckpt) is the top layer of BLOCK, and SUBNET comes after the last
+                layer of BLOCK.  visit_layers(), visit_layer_parameters(), dnn_trainer,
+                etc. all see the layers inside BLOCK just as they would in BLOCK<SUBNET>.
+
+                The second run of BLOCK reproduces the first.  While recomputing, the
+                layers inside BLOCK are put into a mode (see set_recomputing() in
+                layers_abstract.h) where, e.g., bn_ doesn't update its running statistics
+                again and dropout_ reuses the mask it drew in forward().  So a
+                checkpointed block trains exactly like the same block without a
+                checkpoint.  Also, like with repeat, add_skip_layer objects inside BLOCK
+                can only refer to tags that are also inside BLOCK.
+
+                Also, this object provides an interface identical to the one defined by the
+                add_layer object except that we add the get_block() and
+                get_activation_bytes_released() methods.  These additions are shown below
+                along with some additional explanatory comments.
+        !*/
+
+    public:
+
+        typedef SUBNET subnet_type;
+        typedef typename SUBNET::input_type input_type;
+        const static size_t num_computational_layers = BLOCK<SUBNET>::num_computational_layers;
+        const static size_t num_layers = BLOCK<SUBNET>::num_layers + 1;
+        typedef BLOCK<an_unspecified_input_type> block_type;
+
+        template <typename T, typename ...U>
+        checkpoint(
+            T arg1,
+            U ...args2
+        );
+        /*!
+            ensures
+                - arg1 is used to initialize the BLOCK inside this object.
+                - The rest of the arguments to the constructor, i.e. args2, are passed to
+                  SUBNET's constructor.  
+        !*/
+
+        const block_type& get_block (
+        ) const; 
+        /*!
+            ensures
+                - returns a reference to the layers this object wraps.  Note that, unless
+                  back_propagate_error() is running, their outputs and gradients are
+                  empty.
+        !*/
+
+        block_type& get_block (
+        ); 
+        /*!
+            ensures
+                - returns a reference to the layers this object wraps.  Note that, unless
+                  back_propagate_error() is running, their outputs and gradients are
+                  empty.
+        !*/
+
+        size_t get_activation_bytes_released (
+        ) const;
+        /*!
+            ensures
+                - returns the number of bytes of layer outputs and gradients inside BLOCK
+                  that were freed the last time forward() or back_propagate_error() was
+                  called.  That is, how much less memory training the network needs at
+                  its peak than it would if this block weren't checkpointed.  Returns 0
+                  if neither has been called yet.
+        !*/
+
+        const subnet_type& subnet(
+        ) const; 
+        /*!
+            ensures
+                - returns the SUBNET base network that checkpoint sits on top of.  If you
+                  want to access the BLOCK components then you must use get_block(). 
+        !*/
+
+        subnet_type& subnet(
+        ); 
+        /*!
+            ensures
+                - returns the SUBNET base network that checkpoint sits on top of.  If you
+                  want to access the BLOCK components then you must use get_block(). 
+        !*/
+    };
+
+    template <template<typename> class T, typename U>
+    std::ostream& operator<<(std::ostream& out, const checkpoint<T,U>& item);
+    /*!
+        prints the network architecture to the given output stream.
+    !*/
+
+    template <template<typename> class T, typename U>
+    void serialize(const checkpoint<T,U>& item, std::ostream& out);
+    template <template<typename> class T, typename U>
+    void deserialize(checkpoint<T,U>& item, std::istream& in);
+    /*!
+        provides serialization support  
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
     template <
@@ -1655,6 +1794,108 @@ namespace dlib
                 v(layer<i>(net));  // also visits the tag layer itself at the very end.
     !*/
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename net_type
+        >
+    void enable_inference_mode (
+        net_type& net
+    );
+    /*!
+        requires
+            - net_type is an object of type add_layer, add_loss_layer, add_skip_layer, or
+              add_tag_layer.
+        ensures
+            - Calls net.clean() and then puts net into inference mode.  In inference mode
+              the network only keeps around the layer outputs it still needs while a
+              forward pass is running.  In particular, once a layer has computed its
+              output, the output of the layer below it is handed to a memory pool shared
+              by the whole network, and later layers take their output tensors from that
+              pool rather than allocating their own.  So the peak memory used by a forward
+              pass is only what is alive at the same time, rather than the sum of every
+              layer's output, and after the first forward pass no more memory is
+              allocated as long as the input size doesn't grow.
+            - The output a tag layer points at is kept until a tag layer with the same ID
+              further up the network has been computed, since only then can no other
+              layer read it through the tag.  Outputs sitting below add_skip_layer or
+              repeat layers are always kept, as is the output of the top layer.  After a
+              forward pass in inference mode, get_output() of any other layer returns an
+              empty tensor.
+            - A network in inference mode never allocates gradient buffers.  You must not
+              call back_propagate_error(), or anything else that computes gradients, such
+              as training it with dnn_trainer, on a network in inference mode.
+            - Copies of net are not in inference mode.
+    !*/
+
+    template <
+        typename net_type
+        >
+    void disable_inference_mode (
+        net_type& net
+    );
+    /*!
+        requires
+            - net_type is an object of type add_layer, add_loss_layer, add_skip_layer, or
+              add_tag_layer.
+        ensures
+            - Undoes enable_inference_mode().  That is, every layer goes back to keeping
+              its own output tensor and net can be trained again.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename net_type
+        >
+    size_t get_checkpointed_activation_bytes (
+        const net_type& net
+    );
+    /*!
+        requires
+            - net_type is an object of type add_layer, add_loss_layer, add_skip_layer,
+              add_tag_layer, repeat, or checkpoint.
+        ensures
+            - returns the sum of get_activation_bytes_released() over all the checkpoint
+              layers in net.  So after a training step this is how much memory
+              checkpointing saved at the peak of that step.  dnn_trainer prints this
+              when you print it to an ostream.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename net_type
+        >
+    void copy_net_sharing_weights (
+        const net_type& from,
+        net_type& to
+    );
+    /*!
+        requires
+            - net_type is an object of type add_layer, add_loss_layer, add_skip_layer, or
+              add_tag_layer.
+        ensures
+            - Makes to a copy of from, except that the tensors in to don't get their own
+              memory.  Instead they share the memory of the corresponding tensors in from.
+              So no matter how many copies you make this way, the layer parameters are
+              only stored once.  This is the cheap way to give each of several threads its
+              own network to run.
+            - The shared memory is copy-on-write.  Running a network only reads its
+              parameters, so copies that are just used for inference keep sharing them
+              indefinitely, and only their layer outputs take up new memory.  If you
+              modify the parameters of from or of one of the copies, e.g. by training it,
+              that network first gets its own private copy of the parameters it modifies.
+              So changes to one of the networks are never seen by the others.
+            - It's safe to run from and all its copies at the same time in different
+              threads.  However, you shouldn't call copy_net_sharing_weights() while
+              from is being used by another thread.
+            - If from has any layer outputs or gradients left over from a previous forward
+              or backward pass they are shared too, but since they are overwritten by the
+              next pass to would just end up with its own.  You can call from.clean()
+              first to avoid the wasted work.
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
     struct layer_test_results
@@ -9,6 +9,7 @@
 #include "tensor_tools.h"
 #include "../image_transforms/interpolation.h"
 #include "../threads.h"
+#include "../simd.h"
 
 namespace dlib
 {
@@ -603,6 +604,180 @@ namespace dlib
 
     // -----------------------------------------------------------------------------------
 
+        namespace impl
+        {
+            template <typename F>
+            void for_solver_blocks (
+                size_t begin,
+                size_t end,
+                F&& f
+            )
+            /*!
+                ensures
+                    - calls f(b,e) on consecutive blocks [b,e) that cover [begin,end).  Big
+                      ranges are split into blocks that run in parallel, since the solver
+                      update for a large fc_ layer is bandwidth bound and takes a real
+                      share of the training time.  Each block starts at a multiple of 8
+                      floats from begin so the simd loops stay in step.
+            !*/
+            {
+                const size_t block = 32768;
+                const size_t num = (end-begin+block-1)/block;
+                if (num <= 1)
+                {
+                    f(begin, end);
+                    return;
+                }
+                parallel_for(0, num, [&](long i)
+                {
+                    const size_t b = begin + i*block;
+                    f(b, std::min(b+block, end));
+                });
+            }
+        }
+
+        void compute_sgd_update (
+            size_t begin,
+            size_t end,
+            tensor& v,
+            const float learning_rate,
+            const float weight_decay,
+            const float momentum,
+            const tensor& params,
+            const tensor& params_grad
+        )
+        {
+            DLIB_CASSERT(v.size() == params.size() &&
+                         v.size() == params_grad.size());
+            DLIB_CASSERT(begin <= end && end <= params.size());
+
+            // v = momentum*v - learning_rate*(weight_decay*params + params_grad);
+            float* pv = v.host();
+            const float* pparams = params.host();
+            const float* ppgrad = params_grad.host();
+            const float lwd = learning_rate*weight_decay;
+            impl::for_solver_blocks(begin, end, [&](size_t b, size_t e)
+            {
+                const simd8f mom(momentum), nlwd(-lwd), nlr(-learning_rate);
+                size_t i = b;
+                for (; i + 8 <= e; i += 8)
+                {
+                    simd8f vv, p, g;
+                    vv.load(pv+i);
+                    p.load(pparams+i);
+                    g.load(ppgrad+i);
+                    (mom*vv + nlwd*p + nlr*g).store(pv+i);
+                }
+                for (; i < e; ++i)
+                    pv[i] = momentum*pv[i] - lwd*pparams[i] - learning_rate*ppgrad[i];
+            });
+        }
+
+        void compute_nesterov_update (
+            size_t begin,
+            size_t end,
+            tensor& s,
+            tensor& v,
+            const float learning_rate,
+            const float weight_decay,
+            const float momentum,
+            const tensor& params,
+            const tensor& params_grad
+        )
+        {
+            DLIB_CASSERT(s.size() == v.size() &&
+                         s.size() == params.size() &&
+                         s.size() == params_grad.size());
+            DLIB_CASSERT(begin <= end && end <= params.size());
+
+            // The loop is equivalent to doing this:
+            //   d = -learning_rate*(weight_decay*params + params_grad);
+            //   v = momentum*v + d;
+            //   s = momentum*v + d;
+            float* pv = v.host();
+            float* ps = s.host();
+            const float* pparams = params.host();
+            const float* ppgrad = params_grad.host();
+            const float lwd = learning_rate*weight_decay;
+            impl::for_solver_blocks(begin, end, [&](size_t b, size_t e)
+            {
+                const simd8f mom(momentum), nlwd(-lwd), nlr(-learning_rate);
+                size_t i = b;
+                for (; i + 8 <= e; i += 8)
+                {
+                    simd8f vv, p, g;
+                    vv.load(pv+i);
+                    p.load(pparams+i);
+                    g.load(ppgrad+i);
+                    const simd8f d = nlwd*p + nlr*g;
+                    vv = mom*vv + d;
+                    vv.store(pv+i);
+                    (mom*vv + d).store(ps+i);
+                }
+                for (; i < e; ++i)
+                {
+                    const float d = -lwd*pparams[i] - learning_rate*ppgrad[i];
+                    pv[i] = momentum*pv[i] + d;
+                    ps[i] = momentum*pv[i] + d;
+                }
+            });
+        }
+
+        namespace impl
+        {
+            inline void adam_moments (
+                size_t b,
+                size_t e,
+                float* pm,
+                float* pv,
+                float* ps,
+                const float* pparams,
+                const float* ppgrad,
+                const float alpha,
+                const float gwd,
+                const float swd,
+                const float momentum1,
+                const float momentum2
+            )
+            /*!
+                ensures
+                    - Does the shared part of the Adam and AdamW updates, where gwd is the
+                      weight decay folded into the gradient (Adam) and swd is the weight
+                      decay applied straight to the step (AdamW).  That is:
+                        g = gwd*params + params_grad;
+                        m = momentum1*m + (1-momentum1)*g;
+                        v = momentum2*v + (1-momentum2)*g*g;
+                        s = -alpha*m/(sqrt(v) + eps) - swd*params;
+            !*/
+            {
+                const float eps = 1e-8;
+                const simd8f m1(momentum1), m2(momentum2), om1(1-momentum1), om2(1-momentum2);
+                const simd8f vgwd(gwd), nswd(-swd), nalpha(-alpha), veps(eps);
+                size_t i = b;
+                for (; i + 8 <= e; i += 8)
+                {
+                    simd8f m, v, p, g;
+                    m.load(pm+i);
+                    v.load(pv+i);
+                    p.load(pparams+i);
+                    g.load(ppgrad+i);
+                    g = vgwd*p + g;
+                    m = m1*m + om1*g;
+                    v = m2*v + om2*g*g;
+                    m.store(pm+i);
+                    v.store(pv+i);
+                    (nalpha*m/(sqrt(v) + veps) + nswd*p).store(ps+i);
+                }
+                for (; i < e; ++i)
+                {
+                    const float g = gwd*pparams[i] + ppgrad[i];
+                    pm[i] = momentum1*pm[i] + (1-momentum1)*g;
+                    pv[i] = momentum2*pv[i] + (1-momentum2)*g*g;
+                    ps[i] = -alpha*pm[i]/(std::sqrt(pv[i]) + eps) - swd*pparams[i];
+                }
+            }
+        }
+
         void compute_adam_update (
             size_t begin,
             size_t end,
@@ -623,25 +798,172 @@ namespace dlib
                          s.size() == params.size() &&
                          s.size() == params_grad.size());
             DLIB_CASSERT(begin <= end && end <= params.size());
-            const float eps = 1e-8;
             const float alpha = learning_rate*std::sqrt(1-std::pow(momentum2,t))/(1-std::pow(momentum1, t));
 
             // The loop is equivalent to doing this:
             //   m = momentum1*m + (1-momentum1)    *   (weight_decay*params + params_grad);
             //   v = momentum2*v + (1-momentum2)*squared(weight_decay*params + params_grad);
             //   s = -alpha*m/(sqrt(v) + eps);
-            auto pm = m.host();
-            auto pv = v.host();
-            auto ps = s.host_write_only();
-            auto pparams = params.host();
-            auto ppgrad = params_grad.host();
-            for (size_t i = begin; i < end; ++i)
+            float* pm = m.host();
+            float* pv = v.host();
+            // s is only written in [begin,end), so the rest of it has to be kept.
+            float* ps = s.host();
+            const float* pparams = params.host();
+            const float* ppgrad = params_grad.host();
+            impl::for_solver_blocks(begin, end, [&](size_t b, size_t e)
             {
-                float g = weight_decay*pparams[i] + ppgrad[i];
-                pm[i] = momentum1*pm[i] + (1-momentum1)*g;
-                pv[i] = momentum2*pv[i] + (1-momentum2)*g*g;
-                ps[i] = -alpha*pm[i]/(std::sqrt(pv[i]) + eps);
+                impl::adam_moments(b, e, pm, pv, ps, pparams, ppgrad, alpha,
+                    weight_decay, 0, momentum1, momentum2);
+            });
+        }
+
+        void compute_adamw_update (
+            size_t begin,
+            size_t end,
+            tensor& s,
+            tensor& m,
+            tensor& v,
+            const float t,
+            const float learning_rate,
+            const float weight_decay,
+            const float momentum1,
+            const float momentum2,
+            const tensor& params,
+            const tensor& params_grad
+        )
+        {
+            DLIB_CASSERT(s.size() == m.size() &&
+                         s.size() == v.size() &&
+                         s.size() == params.size() &&
+                         s.size() == params_grad.size());
+            DLIB_CASSERT(begin <= end && end <= params.size());
+            const float alpha = learning_rate*std::sqrt(1-std::pow(momentum2,t))/(1-std::pow(momentum1, t));
+
+            // The loop is equivalent to doing this:
+            //   m = momentum1*m + (1-momentum1)*params_grad;
+            //   v = momentum2*v + (1-momentum2)*squared(params_grad);
+            //   s = -alpha*m/(sqrt(v) + eps) - learning_rate*weight_decay*params;
+            float* pm = m.host();
+            float* pv = v.host();
+            float* ps = s.host();
+            const float* pparams = params.host();
+            const float* ppgrad = params_grad.host();
+            impl::for_solver_blocks(begin, end, [&](size_t b, size_t e)
+            {
+                impl::adam_moments(b, e, pm, pv, ps, pparams, ppgrad, alpha,
+                    0, learning_rate*weight_decay, momentum1, momentum2);
+            });
+        }
+
+        void compute_lamb_update (
+            size_t begin,
+            size_t end,
+            tensor& s,
+            tensor& m,
+            tensor& v,
+            const float t,
+            const float learning_rate,
+            const float weight_decay,
+            const float momentum1,
+            const float momentum2,
+            const tensor& params,
+            const tensor& params_grad
+        )
+        {
+            DLIB_CASSERT(s.size() == m.size() &&
+                         s.size() == v.size() &&
+                         s.size() == params.size() &&
+                         s.size() == params_grad.size());
+            DLIB_CASSERT(begin <= end && end <= params.size());
+            const float eps = 1e-6;
+            const float c1 = 1/(1-std::pow(momentum1, t));
+            const float c2 = 1/(1-std::pow(momentum2, t));
+
+            // The first pass is equivalent to doing this:
+            //   m = momentum1*m + (1-momentum1)*params_grad;
+            //   v = momentum2*v + (1-momentum2)*squared(params_grad);
+            //   s = (m*c1)/(sqrt(v*c2) + eps) + weight_decay*params;
+            // while also summing squared(params) and squared(s).  Then the second pass
+            // scales s by -learning_rate*length(params)/length(s).
+            float* pm = m.host();
+            float* pv = v.host();
+            float* ps = s.host();
+            const float* pparams = params.host();
+            const float* ppgrad = params_grad.host();
+
+            const size_t block = 32768;
+            std::vector<std::pair<double,double>> norms((end-begin+block-1)/block);
+            auto first_pass = [&](long blk)
+            {
+                const size_t b = begin + blk*block;
+                const size_t e = std::min(b+block, end);
+                const simd8f m1(momentum1), m2(momentum2), om1(1-momentum1), om2(1-momentum2);
+                const simd8f vc1(c1), vc2(c2), vwd(weight_decay), veps(eps);
+                simd8f pp_acc = 0, rr_acc = 0;
+                float pp = 0, rr = 0;
+                size_t i = b;
+                for (; i + 8 <= e; i += 8)
+                {
+                    simd8f mm, vv, p, g;
+                    mm.load(pm+i);
+                    vv.load(pv+i);
+                    p.load(pparams+i);
+                    g.load(ppgrad+i);
+                    mm = m1*mm + om1*g;
+                    vv = m2*vv + om2*g*g;
+                    mm.store(pm+i);
+                    vv.store(pv+i);
+                    const simd8f r = vc1*mm/(sqrt(vc2*vv) + veps) + vwd*p;
+                    r.store(ps+i);
+                    pp_acc += p*p;
+                    rr_acc += r*r;
+                }
+                for (; i < e; ++i)
+                {
+                    const float g = ppgrad[i];
+                    pm[i] = momentum1*pm[i] + (1-momentum1)*g;
+                    pv[i] = momentum2*pv[i] + (1-momentum2)*g*g;
+                    ps[i] = c1*pm[i]/(std::sqrt(c2*pv[i]) + eps) + weight_decay*pparams[i];
+                    pp += pparams[i]*pparams[i];
+                    rr += ps[i]*ps[i];
+                }
+                norms[blk] = std::make_pair(sum(pp_acc)+pp, sum(rr_acc)+rr);
+            };
+            if (norms.size() <= 1)
+            {
+                for (size_t blk = 0; blk < norms.size(); ++blk)
+                    first_pass(blk);
             }
+            else
+            {
+                parallel_for(0, norms.size(), first_pass);
+            }
+
+            double pnorm = 0, rnorm = 0;
+            for (auto& n : norms)
+            {
+                pnorm += n.first;
+                rnorm += n.second;
+            }
+            // The trust ratio falls back to 1 for things like freshly zeroed biases.
+            float trust = 1;
+            if (pnorm > 0 && rnorm > 0)
+                trust = std::sqrt(pnorm/rnorm);
+            const float scale = -learning_rate*trust;
+
+            impl::for_solver_blocks(begin, end, [&](size_t b, size_t e)
+            {
+                const simd8f vscale(scale);
+                size_t i = b;
+                for (; i + 8 <= e; i += 8)
+                {
+                    simd8f r;
+                    r.load(ps+i);
+                    (vscale*r).store(ps+i);
+                }
+                for (; i < e; ++i)
+                    ps[i] *= scale;
+            });
         }
 
     // -----------------------------------------------------------------------------------
@@ -1603,6 +1925,128 @@ namespace dlib
             }
         }
 
+    // ------------------------------------------------------------------------------------
+
+        void interleaved_rgb_to_planar (
+            float* dest,
+            long dest_row_stride,
+            long dest_channel_stride,
+            const unsigned char* src,
+            long src_row_stride,
+            long src_pixel_size,
+            long red_offset,
+            long green_offset,
+            long blue_offset,
+            long nr,
+            long nc,
+            float avg_red,
+            float avg_green,
+            float avg_blue
+        )
+        {
+            // Multiplying by 1/256 gives exactly the same floats as dividing by 256, since
+            // it's a power of 2.
+            const float scale = 1.0f/256;
+            const long offsets[3] = {red_offset, green_offset, blue_offset};
+            const float avgs[3] = {avg_red, avg_green, avg_blue};
+
+#if defined(DLIB_HAVE_SSE41)
+            // pshufb gathers one channel of 16 pixels out of the src_pixel_size 16 byte
+            // loads that hold them.  These masks say where each byte goes, with 0x80
+            // meaning it's not part of that load.
+            __m128i masks[3][4];
+            if (src_pixel_size == 3 || src_pixel_size == 4)
+            {
+                for (long ch = 0; ch < 3; ++ch)
+                {
+                    for (long l = 0; l < src_pixel_size; ++l)
+                    {
+                        alignas(16) unsigned char m[16];
+                        for (long i = 0; i < 16; ++i)
+                        {
+                            const long pos = i*src_pixel_size + offsets[ch] - 16*l;
+                            m[i] = (0 <= pos && pos < 16) ? pos : 0x80;
+                        }
+                        masks[ch][l] = _mm_load_si128((const __m128i*)m);
+                    }
+                }
+            }
+#endif
+
+            for (long r = 0; r < nr; ++r)
+            {
+                const unsigned char* s = src + r*src_row_stride;
+                float* d[3] = {dest + r*dest_row_stride,
+                               dest + r*dest_row_stride + dest_channel_stride,
+                               dest + r*dest_row_stride + 2*dest_channel_stride};
+                long c = 0;
+
+#if defined(DLIB_HAVE_SSE41)
+                if (src_pixel_size == 3 || src_pixel_size == 4)
+                {
+                    for (; c + 16 <= nc; c += 16)
+                    {
+                        __m128i in[4];
+                        for (long l = 0; l < src_pixel_size; ++l)
+                            in[l] = _mm_loadu_si128((const __m128i*)(s + c*src_pixel_size + 16*l));
+                        for (long ch = 0; ch < 3; ++ch)
+                        {
+                            __m128i v = _mm_shuffle_epi8(in[0], masks[ch][0]);
+                            for (long l = 1; l < src_pixel_size; ++l)
+                                v = _mm_or_si128(v, _mm_shuffle_epi8(in[l], masks[ch][l]));
+                            const __m128 avg = _mm_set1_ps(avgs[ch]);
+                            const __m128 sc = _mm_set1_ps(scale);
+                            for (long q = 0; q < 4; ++q)
+                            {
+                                const __m128 f = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(v));
+                                _mm_storeu_ps(d[ch] + c + 4*q, _mm_mul_ps(_mm_sub_ps(f, avg), sc));
+                                v = _mm_srli_si128(v, 4);
+                            }
+                        }
+                    }
+                }
+#elif defined(DLIB_HAVE_NEON)
+                // NEON can deinterleave 16 pixels in a single load.
+                if (src_pixel_size == 3 || src_pixel_size == 4)
+                {
+                    for (; c + 16 <= nc; c += 16)
+                    {
+                        uint8x16_t in[4];
+                        if (src_pixel_size == 3)
+                        {
+                            const uint8x16x3_t t = vld3q_u8(s + c*3);
+                            in[0] = t.val[0]; in[1] = t.val[1]; in[2] = t.val[2];
+                        }
+                        else
+                        {
+                            const uint8x16x4_t t = vld4q_u8(s + c*4);
+                            in[0] = t.val[0]; in[1] = t.val[1]; in[2] = t.val[2]; in[3] = t.val[3];
+                        }
+                        for (long ch = 0; ch < 3; ++ch)
+                        {
+                            const uint8x16_t v = in[offsets[ch]];
+                            const uint16x8_t lo = vmovl_u8(vget_low_u8(v));
+                            const uint16x8_t hi = vmovl_u8(vget_high_u8(v));
+                            const uint32x4_t parts[4] = {vmovl_u16(vget_low_u16(lo)), vmovl_u16(vget_high_u16(lo)),
+                                                         vmovl_u16(vget_low_u16(hi)), vmovl_u16(vget_high_u16(hi))};
+                            const float32x4_t avg = vdupq_n_f32(avgs[ch]);
+                            for (long q = 0; q < 4; ++q)
+                                vst1q_f32(d[ch] + c + 4*q, vmulq_n_f32(vsubq_f32(vcvtq_f32_u32(parts[q]), avg), scale));
+                        }
+                    }
+                }
+#endif
+
+                for (; c < nc; ++c)
+                {
+                    const unsigned char* p = s + c*src_pixel_size;
+                    d[0][c] = (p[red_offset]-avg_red)*scale;
+                    d[1][c] = (p[green_offset]-avg_green)*scale;
+                    d[2][c] = (p[blue_offset]-avg_blue)*scale;
+                }
+            }
+        }
+
     // ------------------------------------------------------------------------------------
     // ------------------------------------------------------------------------------------
     // ------------------------------------------------------------------------------------
@@ -1845,52 +2289,66 @@ namespace dlib
     // ------------------------------------------------------------------------------------
     // ------------------------------------------------------------------------------------
 
+        template <typename T>
         void img2col(
-            matrix<float>& output,
+            T* t,
+            const T* d,
             const tensor& data,
-            long n,
+            long data_k,
             long filter_nr,
             long filter_nc,
             long stride_y,
             long stride_x,
             long padding_y,
-            long padding_x
+            long padding_x,
+            long dilation_y,
+            long dilation_x,
+            long out_row_begin,
+            long out_row_end
         )
+        /*!
+            ensures
+                - Fills t with the rows of the Toeplitz matrix for the data_k channels of
+                  data pointed to by d, but only for the rows that produce the output rows
+                  in the range [out_row_begin, out_row_end).  The Toeplitz matrix has one
+                  row for each output pixel and data_k*filter_nr*filter_nc columns.
+        !*/
         {
-            const auto d = data.host() + data.k()*data.nr()*data.nc()*n;
-            const rectangle boundary = get_rect(data);
-
-            const long out_nr = 1+(data.nr()+2*padding_y-filter_nr)/stride_y;
-            const long out_nc = 1+(data.nc()+2*padding_x-filter_nc)/stride_x;
+            const long out_nc = 1+(data.nc()+2*padding_x-(filter_nc-1)*dilation_x-1)/stride_x;
 
-            output.set_size(out_nr*out_nc, 
-                            data.k()*filter_nr*filter_nc);
-            DLIB_CASSERT(output.size() != 0);
-            float* t = &output(0,0);
-
-            // now fill in the Toeplitz output matrix for the n-th sample in data.  
-            size_t cnt = 0;
-            const long max_r = data.nr() + padding_y-(filter_nr-1);
-            const long max_c = data.nc() + padding_x-(filter_nc-1);
-            for (long r = -padding_y; r < max_r; r+=stride_y)
+            for (long ro = out_row_begin; ro < out_row_end; ++ro)
             {
-                for (long c = -padding_x; c < max_c; c+=stride_x)
+                const long r = ro*stride_y - padding_y;
+                for (long co = 0; co < out_nc; ++co)
                 {
-                    for (long k = 0; k < data.k(); ++k)
+                    const long c = co*stride_x - padding_x;
+                    // Most filter windows don't touch the left or right padding, so
+                    // their rows can be copied without checking each column.
+                    const bool inside_x = c >= 0 && c+(filter_nc-1)*dilation_x < data.nc();
+                    for (long k = 0; k < data_k; ++k)
                     {
-                        for (long y = 0; y < filter_nr; ++y)
+                        const T* dk = d + k*data.nr()*data.nc();
+                        for (long y = 0; y < filter_nr; ++y, t += filter_nc)
                         {
-                            for (long x = 0; x < filter_nc; ++x)
+                            const long yy = r+y*dilation_y;
+                            if (yy < 0 || yy >= data.nr())
                             {
-                                DLIB_ASSERT(cnt < output.size());
-                                long xx = c+x;
-                                long yy = r+y;
-                                if (boundary.contains(xx,yy))
-                                    *t = d[(k*data.nr() + yy)*data.nc() + xx];
-                                else
-                                    *t = 0;
-                                ++t;
-                                ++cnt;
+                                std::fill(t, t+filter_nc, T(0));
+                                continue;
+                            }
+                            const T* row = dk + yy*data.nc();
+                            if (inside_x)
+                            {
+                                for (long x = 0; x < filter_nc; ++x)
+                                    t[x] = row[c+x*dilation_x];
+                            }
+                            else
+                            {
+                                for (long x = 0; x < filter_nc; ++x)
+                                {
+                                    const long xx = c+x*dilation_x;
+                                    t[x] = (0 <= xx && xx < data.nc()) ? row[xx] : T(0);
+                                }
                             }
                         }
                     }
@@ -1899,38 +2357,37 @@ namespace dlib
         }
 
         void col2img(
-            const matrix<float>& output,
-            tensor& data,
-            long n,
+            const float* t,
+            float* d,
+            const tensor& data,
+            long data_k,
             long filter_nr,
             long filter_nc,
             long stride_y,
             long stride_x,
             long padding_y,
-            long padding_x
+            long padding_x,
+            long dilation_y,
+            long dilation_x
         )
         {
-            const auto d = data.host() + data.k()*data.nr()*data.nc()*n;
             const rectangle boundary = get_rect(data);
 
-            DLIB_CASSERT(output.size() != 0);
-            const float* t = &output(0,0);
-
             // now fill in the Toeplitz output matrix for the n-th sample in data.  
-            const long max_r = data.nr() + padding_y-(filter_nr-1);
-            const long max_c = data.nc() + padding_x-(filter_nc-1);
+            const long max_r = data.nr() + padding_y-(filter_nr-1)*dilation_y;
+            const long max_c = data.nc() + padding_x-(filter_nc-1)*dilation_x;
             for (long r = -padding_y; r < max_r; r+=stride_y)
             {
                 for (long c = -padding_x; c < max_c; c+=stride_x)
                 {
-                    for (long k = 0; k < data.k(); ++k)
+                    for (long k = 0; k < data_k; ++k)
                     {
                         for (long y = 0; y < filter_nr; ++y)
                         {
                             for (long x = 0; x < filter_nc; ++x)
                             {
-                                long xx = c+x;
-                                long yy = r+y;
+                                long xx = c+x*dilation_x;
+                                long yy = r+y*dilation_y;
                                 if (boundary.contains(xx,yy))
                                     d[(k*data.nr() + yy)*data.nc() + xx] += *t;
                                 ++t;
@@ -1941,6 +2398,341 @@ namespace dlib
             }
         }
 
+    // ------------------------------------------------------------------------------------
+
+        namespace impl
+        {
+            struct conv_scratch
+            {
+                std::vector<float> cols;
+                std::vector<float> result;
+            };
+
+            inline conv_scratch& get_conv_scratch (
+            )
+            {
+                // Each thread keeps its own img2col and GEMM output buffers.  That way
+                // they are allocated once per thread and then reused by every convolution
+                // that thread works on, rather than being resized on each call.
+                thread_local conv_scratch scratch;
+                return scratch;
+            }
+
+            inline long conv_row_bands (
+                long num_samples,
+                long out_nr
+            )
+            /*!
+                ensures
+                    - returns the number of bands of output rows each sample should be
+                      split into so that there are enough independent jobs to keep every
+                      thread in the default thread pool busy, even for small batches.
+            !*/
+            {
+                const long num_threads = default_thread_pool().num_threads_in_pool();
+                const long jobs_wanted = 2*num_threads;
+                const long bands = (jobs_wanted + num_samples - 1)/std::max<long>(num_samples,1);
+                return std::max<long>(1, std::min(bands, out_nr));
+            }
+
+            inline bool use_direct_conv (
+                const tensor& data,
+                const tensor& filters,
+                long stride_x
+            )
+            {
+                // Grouped convolutions with only a few channels per group take the direct
+                // path, since the GEMM path would do one tiny matrix multiply per group,
+                // which is nearly all overhead.  With stride_x != 1 the direct path falls
+                // back to scalar loads though, so then it only wins while each group has
+                // very few filters.  Once there are more, the per group GEMMs are big
+                // enough to pay for themselves and img2col only builds the strided columns.
+                if (filters.k() != data.k() && filters.k() <= 4)
+                {
+                    const long filters_per_group = filters.num_samples()/(data.k()/filters.k());
+                    return stride_x == 1 || filters_per_group <= 2;
+                }
+
+                // The direct path walks the input rows with unit stride vector loads, so
+                // it needs stride_x==1 and rows wide enough to fill a few SIMD registers.
+                // It's also only a win for small filters over a modest number of input
+                // channels.  1x1 filters make img2col a plain copy, while big filters or
+                // deep inputs give the GEMM enough arithmetic per byte of Toeplitz matrix
+                // that it ends up faster, so those cases stay on the GEMM path.
+                return stride_x == 1 && data.nc() >= 16 &&
+                    filters.nr()*filters.nc() > 1 &&
+                    filters.nr() <= 7 && filters.nc() <= 7 &&
+                    filters.k() <= 32;
+            }
+
+            template <long NB>
+            void direct_conv_block (
+                const bool add_to_output,
+                float* out,
+                const float* d,
+                const float* w,
+                const tensor& output,
+                const tensor& data,
+                const tensor& filters,
+                const long stride_y,
+                const long stride_x,
+                const long padding_y,
+                const long padding_x,
+                const long dilation_y,
+                const long dilation_x
+            )
+            /*!
+                requires
+                    - out points to NB consecutive output planes of output.
+                    - d points to the first of the filters.k() input channels the NB
+                      filters are applied to.  For an ungrouped convolution that's just
+                      the start of an input sample.
+                    - w points to NB consecutive filters in filters.
+                ensures
+                    - Computes the convolution of the NB filters with the input channels,
+                      writing (or adding if add_to_output) the results into the NB output
+                      planes.  Results for NB filters are accumulated at once so each
+                      input load is reused NB times.  Only stride_x==1 is vectorized,
+                      other strides use the scalar code.
+            !*/
+            {
+                const long in_k = filters.k();
+                const long in_nr = data.nr();
+                const long in_nc = data.nc();
+                const long out_nr = output.nr();
+                const long out_nc = output.nc();
+                const long filter_nr = filters.nr();
+                const long filter_nc = filters.nc();
+
+                const long out_plane = out_nr*out_nc;
+                const long in_plane = in_nr*in_nc;
+                const long filter_size = in_k*filter_nr*filter_nc;
+
+                // Output columns in [c_lo, c_hi) only touch input pixels that are inside
+                // the image, for every filter column.  So we can run those through the
+                // SIMD loop without any bounds checks.
+                const long c_lo = stride_x == 1 ? std::min(padding_x, out_nc) : 0;
+                const long c_hi = stride_x == 1 ? std::max(c_lo, std::min(out_nc, in_nc - (filter_nc-1)*dilation_x + padding_x)) : 0;
+
+                auto scalar_output = [&](long r, long c)
+                {
+                    float acc[NB];
+                    for (long j = 0; j < NB; ++j)
+                        acc[j] = add_to_output ? out[j*out_plane + r*out_nc + c] : 0;
+                    for (long k = 0; k < in_k; ++k)
+                    {
+                        for (long y = 0; y < filter_nr; ++y)
+                        {
+                            const long iy = r*stride_y + y*dilation_y - padding_y;
+                            if (iy < 0 || iy >= in_nr)
+                                continue;
+                            const float* in_row = d + k*in_plane + iy*in_nc;
+                            const float* w_row = w + (k*filter_nr + y)*filter_nc;
+                            for (long x = 0; x < filter_nc; ++x)
+                            {
+                                const long ix = c*stride_x + x*dilation_x - padding_x;
+                                if (ix < 0 || ix >= in_nc)
+                                    continue;
+                                for (long j = 0; j < NB; ++j)
+                                    acc[j] += w_row[j*filter_size + x]*in_row[ix];
+                            }
+                        }
+                    }
+                    for (long j = 0; j < NB; ++j)
+                        out[j*out_plane + r*out_nc + c] = acc[j];
+                };
+
+                for (long r = 0; r < out_nr; ++r)
+                {
+                    for (long c = 0; c < c_lo; ++c)
+                        scalar_output(r,c);
+
+                    long c = c_lo;
+                    for (; c + 8 <= c_hi; c += 8)
+                    {
+                        simd8f acc[NB];
+                        for (long j = 0; j < NB; ++j)
+                        {
+                            if (add_to_output)
+                                acc[j].load(out + j*out_plane + r*out_nc + c);
+                            else
+                                acc[j] = 0;
+                        }
+
+                        for (long k = 0; k < in_k; ++k)
+                        {
+                            for (long y = 0; y < filter_nr; ++y)
+                            {
+                                const long iy = r*stride_y + y*dilation_y - padding_y;
+                                if (iy < 0 || iy >= in_nr)
+                                    continue;
+                                const float* in_row = d + k*in_plane + iy*in_nc + c - padding_x;
+                                const float* w_row = w + (k*filter_nr + y)*filter_nc;
+                                for (long x = 0; x < filter_nc; ++x)
+                                {
+                                    simd8f v;
+                                    v.load(in_row + x*dilation_x);
+                                    for (long j = 0; j < NB; ++j)
+                                        acc[j] += simd8f(w_row[j*filter_size + x])*v;
+                                }
+                            }
+                        }
+
+                        for (long j = 0; j < NB; ++j)
+                            acc[j].store(out + j*out_plane + r*out_nc + c);
+                    }
+
+                    for (; c < out_nc; ++c)
+                        scalar_output(r,c);
+                }
+            }
+
+            void direct_conv (
+                const bool add_to_output,
+                tensor& output,
+                const tensor& data,
+                const tensor& filters,
+                long stride_y,
+                long stride_x,
+                long padding_y,
+                long padding_x,
+                long dilation_y,
+                long dilation_x
+            )
+            {
+                const float* d = data.host();
+                const float* w = filters.host();
+                float* out = add_to_output ? output.host() : output.host_write_only();
+
+                const long out_plane = output.nr()*output.nc();
+                const long in_plane = data.nr()*data.nc();
+                const long in_sample = data.k()*in_plane;
+                const long filter_size = filters.k()*filters.nr()*filters.nc();
+                const long groups = data.k()/filters.k();
+                const long filters_per_group = filters.num_samples()/groups;
+
+                // Process the filters 4 at a time since that gives each loaded input
+                // vector enough reuse to keep the FMA units busy without running out of
+                // registers.  Blocks never straddle two groups since those read different
+                // input channels.  Each (sample, filter block) pair writes to its own
+                // output planes so they can all run in parallel.
+                const long block = 4;
+                const long blocks_per_group = (filters_per_group + block - 1)/block;
+                const long num_blocks = groups*blocks_per_group;
+                parallel_for(0, data.num_samples()*num_blocks, [&](long i)
+                {
+                    const long n = i/num_blocks;
+                    const long g = (i%num_blocks)/blocks_per_group;
+                    const long o = g*filters_per_group + (i%blocks_per_group)*block;
+                    float* o_ptr = out + (n*output.k() + o)*out_plane;
+                    const float* d_ptr = d + n*in_sample + g*filters.k()*in_plane;
+                    const float* w_ptr = w + o*filter_size;
+                    switch (std::min(block, (g+1)*filters_per_group-o))
+                    {
+                        case 4: direct_conv_block<4>(add_to_output, o_ptr, d_ptr, w_ptr, output, data, filters, stride_y, stride_x, padding_y, padding_x, dilation_y, dilation_x); break;
+                        case 3: direct_conv_block<3>(add_to_output, o_ptr, d_ptr, w_ptr, output, data, filters, stride_y, stride_x, padding_y, padding_x, dilation_y, dilation_x); break;
+                        case 2: direct_conv_block<2>(add_to_output, o_ptr, d_ptr, w_ptr, output, data, filters, stride_y, stride_x, padding_y, padding_x, dilation_y, dilation_x); break;
+                        default: direct_conv_block<1>(add_to_output, o_ptr, d_ptr, w_ptr, output, data, filters, stride_y, stride_x, padding_y, padding_x, dilation_y, dilation_x); break;
+                    }
+                }, 1);
+            }
+
+            void depthwise_conv (
+                const bool add_to_output,
+                tensor& output,
+                const tensor& data,
+                const tensor& filters,
+                long stride_y,
+                long stride_x,
+                long padding_y,
+                long padding_x,
+                long dilation_y,
+                long dilation_x
+            )
+            /*!
+                requires
+                    - filters.k() == 1
+                ensures
+                    - Computes the grouped convolution where every filter looks at a single
+                      input channel.
+            !*/
+            {
+                const float* d = data.host();
+                const float* w = filters.host();
+                float* out = add_to_output ? output.host() : output.host_write_only();
+
+                const long filter_nr = filters.nr();
+                const long filter_nc = filters.nc();
+                const long filters_per_channel = filters.num_samples()/data.k();
+                const long out_plane = output.nr()*output.nc();
+
+                // Each input plane is copied into a zero padded buffer so the inner loop
+                // can run over whole rows with SIMD loads and no bounds checks.  The rows
+                // are computed at stride 1 and then subsampled when stride_x > 1, since
+                // that's still much faster than gathering the strided inputs.
+                const long full_nc = data.nc() + 2*padding_x - (filter_nc-1)*dilation_x;
+                const long vec_nc = (full_nc + 7)/8*8;
+                const long buf_nr = data.nr() + 2*padding_y;
+                const long buf_nc = vec_nc + (filter_nc-1)*dilation_x;
+
+                parallel_for(0, data.num_samples()*data.k(), [&](long i)
+                {
+                    auto& scratch = get_conv_scratch();
+                    scratch.cols.assign(buf_nr*buf_nc, 0);
+                    scratch.result.resize(vec_nc);
+                    float* buf = scratch.cols.data();
+                    float* row = scratch.result.data();
+
+                    const float* plane = d + i*data.nr()*data.nc();
+                    for (long r = 0; r < data.nr(); ++r)
+                        std::memcpy(buf + (r+padding_y)*buf_nc + padding_x, plane + r*data.nc(), data.nc()*sizeof(float));
+
+                    for (long j = 0; j < filters_per_channel; ++j)
+                    {
+                        const long o = (i%data.k())*filters_per_channel + j;
+                        const float* filt = w + o*filter_nr*filter_nc;
+                        float* o_ptr = out + ((i/data.k())*output.k() + o)*out_plane;
+                        for (long r = 0; r < output.nr(); ++r)
+                        {
+                            for (long c = 0; c < vec_nc; c += 8)
+                            {
+                                simd8f acc = 0;
+                                for (long y = 0; y < filter_nr; ++y)
+                                {
+                                    const float* in_row = buf + (r*stride_y + y*dilation_y)*buf_nc + c;
+                                    for (long x = 0; x < filter_nc; ++x)
+                                    {
+                                        simd8f v;
+                                        v.load(in_row + x*dilation_x);
+                                        acc += simd8f(filt[y*filter_nc + x])*v;
+                                    }
+                                }
+                                acc.store(row + c);
+                            }
+
+                            float* o_row = o_ptr + r*output.nc();
+                            if (add_to_output)
+                            {
+                                for (long c = 0; c < output.nc(); ++c)
+                                    o_row[c] += row[c*stride_x];
+                            }
+                            else if (stride_x == 1)
+                            {
+                                std::memcpy(o_row, row, output.nc()*sizeof(float));
+                            }
+                            else
+                            {
+                                for (long c = 0; c < output.nc(); ++c)
+                                    o_row[c] = row[c*stride_x];
+                            }
+                        }
+                    }
+                }, 1);
+            }
+        }
+
+    // ------------------------------------------------------------------------------------
+
         void tensor_conv::operator() (
             const bool add_to_output,
             resizable_tensor& output,
@@ -1951,8 +2743,8 @@ namespace dlib
             DLIB_CASSERT(last_stride_y > 0 && last_stride_x > 0, "You must call setup() before calling this function.");
             output.set_size(data.num_samples(),
                             filters.num_samples(),
-                            1+(data.nr()+2*last_padding_y-filters.nr())/last_stride_y,
-                            1+(data.nc()+2*last_padding_x-filters.nc())/last_stride_x);
+                            1+(data.nr()+2*last_padding_y-dilated_size(filters.nr(),last_dilation_y))/last_stride_y,
+                            1+(data.nc()+2*last_padding_x-dilated_size(filters.nc(),last_dilation_x))/last_stride_x);
             (*this)(add_to_output, static_cast<tensor&>(output),data,filters);
         }
 
@@ -1965,29 +2757,92 @@ namespace dlib
         {
             DLIB_CASSERT(is_same_object(output,data) == false);
             DLIB_CASSERT(is_same_object(output,filters) == false);
-            DLIB_CASSERT(filters.k() == data.k());
+            DLIB_CASSERT(filters.k() > 0 && data.k()%filters.k() == 0);
+            DLIB_CASSERT(filters.num_samples()%(data.k()/filters.k()) == 0);
             DLIB_CASSERT(last_stride_y > 0 && last_stride_x > 0, "You must call setup() before calling this function.");
-            DLIB_CASSERT(filters.nr() <= data.nr() + 2*last_padding_y,
+            DLIB_CASSERT(dilated_size(filters.nr(),last_dilation_y) <= data.nr() + 2*last_padding_y,
                 "Filter windows must be small enough to fit into the padded image.");
-            DLIB_CASSERT(filters.nc() <= data.nc() + 2*last_padding_x,
+            DLIB_CASSERT(dilated_size(filters.nc(),last_dilation_x) <= data.nc() + 2*last_padding_x,
                 "Filter windows must be small enough to fit into the padded image.");
 
             DLIB_CASSERT(output.num_samples() == data.num_samples());
             DLIB_CASSERT(output.k() == filters.num_samples());
-            DLIB_CASSERT(output.nr() == 1+(data.nr()+2*last_padding_y-filters.nr())/last_stride_y);
-            DLIB_CASSERT(output.nc() == 1+(data.nc()+2*last_padding_x-filters.nc())/last_stride_x);
-
+            DLIB_CASSERT(output.nr() == 1+(data.nr()+2*last_padding_y-dilated_size(filters.nr(),last_dilation_y))/last_stride_y);
+            DLIB_CASSERT(output.nc() == 1+(data.nc()+2*last_padding_x-dilated_size(filters.nc(),last_dilation_x))/last_stride_x);
 
-            matrix<float> temp;
-            for (long n = 0; n < data.num_samples(); ++n)
+            if (filters.k() == 1 && data.k() != 1)
             {
-                img2col(temp, data, n, filters.nr(), filters.nc(), last_stride_y, last_stride_x, last_padding_y, last_padding_x);
+                impl::depthwise_conv(add_to_output, output, data, filters, last_stride_y, last_stride_x,
+                    last_padding_y, last_padding_x, last_dilation_y, last_dilation_x);
+                return;
+            }
 
-                if (add_to_output)
-                    output.add_to_sample(n, mat(filters)*trans(temp));
-                else 
-                    output.set_sample(n, mat(filters)*trans(temp));
+            // Small filters over shallow inputs are convolved directly.  This avoids
+            // building the Toeplitz matrix, which is filter_nr*filter_nc times bigger than
+            // the input and so dominates the memory traffic of the GEMM path in that case.
+            if (impl::use_direct_conv(data, filters, last_stride_x))
+            {
+                impl::direct_conv(add_to_output, output, data, filters, last_stride_y, last_stride_x,
+                    last_padding_y, last_padding_x, last_dilation_y, last_dilation_x);
+                return;
             }
+
+            const float* d = data.host();
+            const float* f = filters.host();
+            float* out = add_to_output ? output.host() : output.host_write_only();
+
+            const long in_plane = data.nr()*data.nc();
+            const long in_sample = data.k()*in_plane;
+            const long out_plane = output.nr()*output.nc();
+            const long filter_size = filters.k()*filters.nr()*filters.nc();
+            const long groups = data.k()/filters.k();
+            const long filters_per_group = filters.num_samples()/groups;
+
+            // Each job does img2col and the GEMM for one band of output rows in one
+            // sample.  So the batch and the Toeplitz matrix tiles are spread over the
+            // thread pool together.  A grouped convolution is a separate GEMM for each
+            // group, between that group's filters and its slice of the input channels.
+            const long bands = impl::conv_row_bands(data.num_samples(), output.nr());
+            const long rows_per_band = (output.nr() + bands - 1)/bands;
+            parallel_for(0, data.num_samples()*bands, [&](long i)
+            {
+                const long n = i/bands;
+                const long row_begin = (i%bands)*rows_per_band;
+                const long row_end = std::min(output.nr(), row_begin + rows_per_band);
+                if (row_begin >= row_end)
+                    return;
+                const long num_cols = (row_end-row_begin)*output.nc();
+
+                auto& scratch = impl::get_conv_scratch();
+                scratch.cols.resize(num_cols*filter_size);
+                scratch.result.resize(filters_per_group*num_cols);
+                for (long g = 0; g < groups; ++g)
+                {
+                    img2col(scratch.cols.data(), d + n*in_sample + g*filters.k()*in_plane, data, filters.k(),
+                        filters.nr(), filters.nc(), last_stride_y, last_stride_x, last_padding_y, last_padding_x,
+                        last_dilation_y, last_dilation_x, row_begin, row_end);
+
+                    set_ptrm(scratch.result.data(), filters_per_group, num_cols) =
+                        mat(f + g*filters_per_group*filter_size, filters_per_group, filter_size)*
+                        trans(mat(scratch.cols.data(), num_cols, filter_size));
+
+                    const float* r = scratch.result.data();
+                    for (long k = g*filters_per_group; k < (g+1)*filters_per_group; ++k)
+                    {
+                        float* o = out + (n*output.k() + k)*out_plane + row_begin*output.nc();
+                        if (add_to_output)
+                        {
+                            for (long j = 0; j < num_cols; ++j)
+                                o[j] += r[j];
+                        }
+                        else
+                        {
+                            std::memcpy(o, r, num_cols*sizeof(float));
+                        }
+                        r += num_cols;
+                    }
+                }
+            }, 1);
         }
 
     // ------------------------------------------------------------------------------------
@@ -2000,19 +2855,37 @@ namespace dlib
             tensor& data_gradient
         )
         {
-            matrix<float> temp;
             if (!add_to_output)
                 data_gradient = 0;
-            for (long n = 0; n < gradient_input.num_samples(); ++n)
-            {
-                auto gi = mat(gradient_input.host()+gradient_input.k()*gradient_input.nr()*gradient_input.nc()*n,
-                              gradient_input.k(),
-                              gradient_input.nr()*gradient_input.nc());
-                                    
 
-                temp = trans(gi)*mat(filters);
-                col2img(temp, data_gradient, n, filters.nr(), filters.nc(), last_stride_y, last_stride_x, last_padding_y, last_padding_x);
-            }
+            const float* gi = gradient_input.host();
+            const float* f = filters.host();
+            float* dg = data_gradient.host();
+
+            const long gi_plane = gradient_input.nr()*gradient_input.nc();
+            const long in_plane = data_gradient.nr()*data_gradient.nc();
+            const long in_sample = data_gradient.k()*in_plane;
+            const long filter_size = filters.k()*filters.nr()*filters.nc();
+            const long groups = data_gradient.k()/filters.k();
+            const long filters_per_group = filters.num_samples()/groups;
+
+            // col2img() scatters overlapping windows back into the image, so the work
+            // can't be split within a sample without racing.  But each sample only
+            // touches its own part of data_gradient, so the batch runs in parallel.
+            parallel_for(0, gradient_input.num_samples(), [&](long n)
+            {
+                auto& scratch = impl::get_conv_scratch();
+                scratch.cols.resize(gi_plane*filter_size);
+                for (long g = 0; g < groups; ++g)
+                {
+                    set_ptrm(scratch.cols.data(), gi_plane, filter_size) =
+                        trans(mat(gi + (n*gradient_input.k() + g*filters_per_group)*gi_plane, filters_per_group, gi_plane))*
+                        mat(f + g*filters_per_group*filter_size, filters_per_group, filter_size);
+                    col2img(scratch.cols.data(), dg + n*in_sample + g*filters.k()*in_plane, data_gradient, filters.k(),
+                        filters.nr(), filters.nc(), last_stride_y, last_stride_x, last_padding_y, last_padding_x,
+                        last_dilation_y, last_dilation_x);
+                }
+            }, 1);
         }
 
     // ------------------------------------------------------------------------------------
@@ -2025,29 +2898,526 @@ namespace dlib
             tensor& filters_gradient
         )
         {
-            matrix<float> temp;
-            for (long n = 0; n < gradient_input.num_samples(); ++n)
+            const long num_samples = gradient_input.num_samples();
+            if (num_samples == 0)
+                return;
+
+            const float* gi = gradient_input.host();
+            const float* d = data.host();
+
+            const long gi_plane = gradient_input.nr()*gradient_input.nc();
+            const long in_plane = data.nr()*data.nc();
+            const long in_sample = data.k()*in_plane;
+            const long filter_size = filters_gradient.k()*filters_gradient.nr()*filters_gradient.nc();
+            const long groups = data.k()/filters_gradient.k();
+            const long filters_per_group = filters_gradient.num_samples()/groups;
+
+            // Split the batch into contiguous blocks, one per thread.  Each block sums
+            // its samples' gradients into its own partial result and then the partials
+            // are added up in a fixed order, so the output doesn't depend on how the
+            // thread pool happened to schedule the blocks.
+            const long num_blocks = std::min<long>(num_samples, default_thread_pool().num_threads_in_pool());
+            const long samples_per_block = (num_samples + num_blocks - 1)/num_blocks;
+            filter_gradient_partials.resize(num_blocks);
+            parallel_for(0, num_blocks, [&](long b)
             {
-                auto gi = mat(gradient_input.host()+gradient_input.k()*gradient_input.nr()*gradient_input.nc()*n,
-                              gradient_input.k(),
-                              gradient_input.nr()*gradient_input.nc());
+                const long begin = b*samples_per_block;
+                const long end = std::min(num_samples, begin + samples_per_block);
+                auto& partial = filter_gradient_partials[b];
+                partial.set_size(filters_gradient.num_samples(), filter_size);
+                partial = 0;
+                auto& scratch = impl::get_conv_scratch();
+                scratch.cols.resize(gi_plane*filter_size);
+                for (long n = begin; n < end; ++n)
+                {
+                    for (long g = 0; g < groups; ++g)
+                    {
+                        img2col(scratch.cols.data(), d + n*in_sample + g*filters_gradient.k()*in_plane, data,
+                            filters_gradient.k(), filters_gradient.nr(), filters_gradient.nc(),
+                            last_stride_y, last_stride_x, last_padding_y, last_padding_x,
+                            last_dilation_y, last_dilation_x, 0, gradient_input.nr());
+                        set_ptrm(&partial(g*filters_per_group,0), filters_per_group, filter_size) +=
+                            mat(gi + (n*gradient_input.k() + g*filters_per_group)*gi_plane, filters_per_group, gi_plane)*
+                            mat(scratch.cols.data(), gi_plane, filter_size);
+                    }
+                }
+            }, 1);
 
+            for (long b = 1; b < num_blocks; ++b)
+                filter_gradient_partials[0] += filter_gradient_partials[b];
 
-                img2col(temp, data, n, filters_gradient.nr(), filters_gradient.nc(), last_stride_y, last_stride_x, last_padding_y, last_padding_x);
-                if (n == 0)
+            if (add_to_output)
+                filters_gradient += filter_gradient_partials[0];
+            else
+                filters_gradient = filter_gradient_partials[0];
+        }
+
+     // ------------------------------------------------------------------------------------
+
+        namespace impl
+        {
+            struct int8_scratch
+            {
+                // The quantized inputs are widened to 16 bits before the GEMM since
+                // that's what the multiply-add instructions consume.  The int8 weights
+                // are used as they are and widened in registers, so each call only
+                // streams one byte per weight.
+                std::vector<int16_t> data;
+                std::vector<int16_t> cols;
+            };
+
+            inline int8_scratch& get_int8_scratch (
+            )
+            {
+                thread_local int8_scratch scratch;
+                return scratch;
+            }
+
+            template <typename T>
+            void quantize_values (
+                T* q,
+                const float* v,
+                size_t n,
+                float scale
+            )
+            {
+                const float inv_scale = scale != 0 ? 1/scale : 0;
+                for (size_t i = 0; i < n; ++i)
                 {
-                    if (add_to_output)
-                        filters_gradient += gi*temp;
-                    else
-                        filters_gradient = gi*temp;
+                    const float val = std::min(127.0f, std::max(-127.0f, v[i]*inv_scale));
+                    q[i] = static_cast<T>(val >= 0 ? val+0.5f : val-0.5f);
                 }
-                else
+            }
+
+#if defined(DLIB_HAVE_AVX2)
+            inline __m256i load_epi16 (const int16_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+            inline __m256i load_epi16 (const int8_t* p) { return _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)p)); }
+#elif defined(DLIB_HAVE_SSE2)
+            inline __m128i load_epi16 (const int16_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+            inline __m128i load_epi16 (const int8_t* p)
+            {
+                // Put each byte in the top half of a 16 bit lane and shift it back down
+                // to sign extend it.  SSE2 doesn't have _mm_cvtepi8_epi16().
+                const __m128i v = _mm_loadl_epi64((const __m128i*)p);
+                return _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+            }
+#endif
+
+            template <long NR, long NC, typename TA, typename TB>
+            inline void int16_gemm_tile (
+                int32_t (&sums)[NR][NC],
+                const TA* (&a)[NR],
+                const TB* (&b)[NC],
+                long k
+            )
+            {
+                long i = 0;
+#if defined(DLIB_HAVE_AVX2)
+                __m256i acc[NR][NC];
+                for (long r = 0; r < NR; ++r)
+                    for (long c = 0; c < NC; ++c)
+                        acc[r][c] = _mm256_setzero_si256();
+                for (; i+16 <= k; i += 16)
+                {
+                    __m256i bb[NC];
+                    for (long c = 0; c < NC; ++c)
+                        bb[c] = load_epi16(b[c]+i);
+                    for (long r = 0; r < NR; ++r)
+                    {
+                        const __m256i aa = load_epi16(a[r]+i);
+                        for (long c = 0; c < NC; ++c)
+                            acc[r][c] = _mm256_add_epi32(acc[r][c], _mm256_madd_epi16(aa, bb[c]));
+                    }
+                }
+                for (long r = 0; r < NR; ++r)
                 {
-                    filters_gradient += gi*temp;
+                    for (long c = 0; c < NC; ++c)
+                    {
+                        int32_t temp[8];
+                        _mm256_storeu_si256((__m256i*)temp, acc[r][c]);
+                        sums[r][c] = temp[0]+temp[1]+temp[2]+temp[3]+temp[4]+temp[5]+temp[6]+temp[7];
+                    }
+                }
+#elif defined(DLIB_HAVE_SSE2)
+                __m128i acc[NR][NC];
+                for (long r = 0; r < NR; ++r)
+                    for (long c = 0; c < NC; ++c)
+                        acc[r][c] = _mm_setzero_si128();
+                for (; i+8 <= k; i += 8)
+                {
+                    __m128i bb[NC];
+                    for (long c = 0; c < NC; ++c)
+                        bb[c] = load_epi16(b[c]+i);
+                    for (long r = 0; r < NR; ++r)
+                    {
+                        const __m128i aa = load_epi16(a[r]+i);
+                        for (long c = 0; c < NC; ++c)
+                            acc[r][c] = _mm_add_epi32(acc[r][c], _mm_madd_epi16(aa, bb[c]));
+                    }
+                }
+                for (long r = 0; r < NR; ++r)
+                {
+                    for (long c = 0; c < NC; ++c)
+                    {
+                        int32_t temp[4];
+                        _mm_storeu_si128((__m128i*)temp, acc[r][c]);
+                        sums[r][c] = temp[0]+temp[1]+temp[2]+temp[3];
+                    }
+                }
+#else
+                for (long r = 0; r < NR; ++r)
+                    for (long c = 0; c < NC; ++c)
+                        sums[r][c] = 0;
+#endif
+                for (; i < k; ++i)
+                {
+                    for (long r = 0; r < NR; ++r)
+                        for (long c = 0; c < NC; ++c)
+                            sums[r][c] += static_cast<int32_t>(a[r][i])*b[c][i];
+                }
+            }
+
+            template <typename TA, typename TB>
+            void int16_gemm_nt (
+                float* c,
+                long ldc,
+                const TA* a,
+                const float* a_scales,
+                long m,
+                const TB* b,
+                const float* b_scales,
+                long n,
+                long k
+            )
+            /*!
+                requires
+                    - TA and TB are int8_t or int16_t
+                ensures
+                    - a is an m by k matrix and b is an n by k matrix, both row major.
+                    - for all valid i,j:
+                        - c[i*ldc+j] = a_scales[i]*b_scales[j]*dot(row i of a, row j of b)
+            !*/
+            {
+                // The products are computed 4 rows of a by 2 rows of b at a time, so each
+                // vector load feeds several multiply-adds, and b is walked in blocks small
+                // enough to stay in cache while every row of a is run against them.
+                const long NR = 4, NC = 2;
+                const long block = std::max<long>(NC, 64*1024/std::max<long>(sizeof(TB)*k,1));
+                for (long jb = 0; jb < n; jb += block)
+                {
+                    const long jend = std::min(n, jb+block);
+                    for (long i = 0; i < m; i += NR)
+                    {
+                        for (long j = jb; j < jend; j += NC)
+                        {
+                            // Tiles hanging off the edge just redo the last row, which
+                            // keeps the inner loop fixed size.
+                            const TA* ap[NR];
+                            const TB* bp[NC];
+                            for (long r = 0; r < NR; ++r)
+                                ap[r] = a + std::min(i+r, m-1)*k;
+                            for (long cc = 0; cc < NC; ++cc)
+                                bp[cc] = b + std::min(j+cc, jend-1)*k;
+
+                            int32_t sums[NR][NC];
+                            int16_gemm_tile(sums, ap, bp, k);
+
+                            for (long r = 0; r < NR && i+r < m; ++r)
+                            {
+                                for (long cc = 0; cc < NC && j+cc < jend; ++cc)
+                                    c[(i+r)*ldc + j+cc] = a_scales[i+r]*b_scales[j+cc]*sums[r][cc];
+                            }
+                        }
+                    }
                 }
             }
         }
 
+        void quantize_rows (
+            std::vector<int8_t>& q,
+            std::vector<float>& scales,
+            const tensor& data
+        )
+        {
+            const long nr = data.num_samples();
+            const long nc = data.size()/std::max<long>(nr,1);
+            q.resize(data.size());
+            scales.resize(nr);
+            const float* d = data.host();
+            for (long r = 0; r < nr; ++r)
+            {
+                float max_val = 0;
+                for (long c = 0; c < nc; ++c)
+                    max_val = std::max(max_val, std::abs(d[r*nc+c]));
+                scales[r] = max_val/127;
+                impl::quantize_values(&q[r*nc], d + r*nc, nc, scales[r]);
+            }
+        }
+
+        void quantized_conv (
+            resizable_tensor& output,
+            const tensor& data,
+            float data_scale,
+            const std::vector<int8_t>& filters,
+            const std::vector<float>& filter_scales,
+            long num_filters,
+            long filter_nr,
+            long filter_nc,
+            int stride_y,
+            int stride_x,
+            int padding_y,
+            int padding_x,
+            int dilation_y,
+            int dilation_x
+        )
+        {
+            const long filter_size = data.k()*filter_nr*filter_nc;
+            DLIB_CASSERT(filters.size() == (size_t)(num_filters*filter_size));
+            DLIB_CASSERT(filter_scales.size() == (size_t)num_filters);
+            DLIB_CASSERT(dilation_y > 0 && dilation_x > 0);
+            DLIB_CASSERT(dilated_size(filter_nr,dilation_y) <= data.nr() + 2*padding_y,
+                "Filter windows must be small enough to fit into the padded image.");
+            DLIB_CASSERT(dilated_size(filter_nc,dilation_x) <= data.nc() + 2*padding_x,
+                "Filter windows must be small enough to fit into the padded image.");
+
+            output.set_size(data.num_samples(),
+                            num_filters,
+                            1+(data.nr()+2*padding_y-dilated_size(filter_nr,dilation_y))/stride_y,
+                            1+(data.nc()+2*padding_x-dilated_size(filter_nc,dilation_x))/stride_x);
+
+            auto& scratch = impl::get_int8_scratch();
+            auto& qdata = scratch.data;
+            qdata.resize(data.size());
+            const float* d = data.host();
+            const size_t chunk = 4096;
+            parallel_for(0, (data.size()+chunk-1)/chunk, [&](long i)
+            {
+                const size_t begin = i*chunk;
+                impl::quantize_values(&qdata[begin], d + begin, std::min(chunk, data.size()-begin), data_scale);
+            });
+
+            const std::vector<float> col_scales(output.nr()*output.nc(), data_scale);
+            float* out = output.host_write_only();
+            const long in_sample = data.k()*data.nr()*data.nc();
+            const long out_plane = output.nr()*output.nc();
+            const long bands = impl::conv_row_bands(data.num_samples(), output.nr());
+            const long rows_per_band = (output.nr() + bands - 1)/bands;
+            parallel_for(0, data.num_samples()*bands, [&](long i)
+            {
+                const long n = i/bands;
+                const long row_begin = (i%bands)*rows_per_band;
+                const long row_end = std::min(output.nr(), row_begin + rows_per_band);
+                if (row_begin >= row_end)
+                    return;
+                const long num_cols = (row_end-row_begin)*output.nc();
+
+                auto& cols = impl::get_int8_scratch().cols;
+                cols.resize(num_cols*filter_size);
+                img2col(cols.data(), qdata.data() + n*in_sample, data, data.k(), filter_nr, filter_nc,
+                    stride_y, stride_x, padding_y, padding_x, dilation_y, dilation_x, row_begin, row_end);
+
+                impl::int16_gemm_nt(out + n*num_filters*out_plane + row_begin*output.nc(), out_plane,
+                    filters.data(), filter_scales.data(), num_filters,
+                    cols.data(), col_scales.data(), num_cols, filter_size);
+            }, 1);
+        }
+
+        void quantized_fc (
+            resizable_tensor& output,
+            const tensor& data,
+            float data_scale,
+            const std::vector<int8_t>& weights,
+            const std::vector<float>& weight_scales,
+            long num_outputs
+        )
+        {
+            const long num_inputs = data.k()*data.nr()*data.nc();
+            DLIB_CASSERT(weights.size() == (size_t)(num_outputs*num_inputs));
+            DLIB_CASSERT(weight_scales.size() == (size_t)num_outputs);
+
+            output.set_size(data.num_samples(), num_outputs);
+
+            auto& scratch = impl::get_int8_scratch();
+            auto& qdata = scratch.data;
+            qdata.resize(data.size());
+            impl::quantize_values(qdata.data(), data.host(), data.size(), data_scale);
+
+            const std::vector<float> row_scales(data.num_samples(), data_scale);
+            float* out = output.host_write_only();
+            // Split the outputs into blocks so each thread only streams its own part of
+            // the weight matrix.
+            const long block = 16;
+            parallel_for(0, (num_outputs+block-1)/block, [&](long i)
+            {
+                const long o = i*block;
+                impl::int16_gemm_nt(out + o, num_outputs,
+                    qdata.data(), row_scales.data(), data.num_samples(),
+                    weights.data() + o*num_inputs, &weight_scales[o], std::min(block, num_outputs-o), num_inputs);
+            });
+        }
+
+     // ------------------------------------------------------------------------------------
+
+        namespace impl
+        {
+            inline uint32_t float_bits (float v) { uint32_t u; std::memcpy(&u, &v, sizeof(u)); return u; }
+            inline float bits_to_float (uint32_t u) { float v; std::memcpy(&v, &u, sizeof(v)); return v; }
+
+            inline uint16_t float_to_fp16 (
+                float v
+            )
+            {
+                // Round to nearest even, with overflow going to infinity and values below
+                // the normal range producing fp16 denormals.
+                uint32_t u = float_bits(v);
+                const uint16_t sign = (u >> 16) & 0x8000;
+                u &= 0x7fffffff;
+                if (u >= 0x47800000)
+                {
+                    // Too big for fp16, or already inf/nan.
+                    return sign | (u > 0x7f800000 ? 0x7e00 : 0x7c00);
+                }
+                if (u < 0x38800000)
+                {
+                    // Adding 0.5 lines the fp16 denormal bits up with the bottom of the
+                    // float mantissa and lets the FPU do the rounding.
+                    const uint32_t magic = 0x3f000000;
+                    return sign | (float_bits(bits_to_float(u) + bits_to_float(magic)) - magic);
+                }
+                const uint32_t mant_odd = (u >> 13) & 1;
+                u += 0xc8000fff + mant_odd;
+                return sign | (u >> 13);
+            }
+
+            inline float fp16_to_float (
+                uint16_t h
+            )
+            {
+                uint32_t u = (uint32_t)(h & 0x7fff) << 13;
+                const uint32_t exp = u & 0x0f800000;
+                u += 0x38000000;
+                if (exp == 0x0f800000)
+                {
+                    // inf/nan
+                    u += 0x38000000;
+                }
+                else if (exp == 0)
+                {
+                    // denormal
+                    u += 0x00800000;
+                    u = float_bits(bits_to_float(u) - bits_to_float(0x38800000));
+                }
+                return bits_to_float(u | ((uint32_t)(h & 0x8000) << 16));
+            }
+
+            inline uint16_t float_to_bf16 (
+                float v
+            )
+            {
+                const uint32_t u = float_bits(v);
+                // Keep nans as nans, truncating could otherwise turn them into inf.
+                if ((u & 0x7fffffff) > 0x7f800000)
+                    return (u >> 16) | 0x0040;
+                return (u + 0x7fff + ((u >> 16) & 1)) >> 16;
+            }
+
+            inline float bf16_to_float (
+                uint16_t h
+            )
+            {
+                return bits_to_float((uint32_t)h << 16);
+            }
+        }
+
+        void float_to_fp16 (
+            uint16_t* dest,
+            const float* src,
+            size_t n
+        )
+        {
+            size_t i = 0;
+#if defined(DLIB_HAVE_AVX) && defined(__F16C__)
+            for (; i+8 <= n; i += 8)
+            {
+                const __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src+i), _MM_FROUND_TO_NEAREST_INT);
+                _mm_storeu_si128((__m128i*)(dest+i), h);
+            }
+#endif
+            for (; i < n; ++i)
+                dest[i] = impl::float_to_fp16(src[i]);
+        }
+
+        void fp16_to_float (
+            float* dest,
+            const uint16_t* src,
+            size_t n
+        )
+        {
+            size_t i = 0;
+#if defined(DLIB_HAVE_AVX) && defined(__F16C__)
+            for (; i+8 <= n; i += 8)
+                _mm256_storeu_ps(dest+i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(src+i))));
+#endif
+            for (; i < n; ++i)
+                dest[i] = impl::fp16_to_float(src[i]);
+        }
+
+        void float_to_bf16 (
+            uint16_t* dest,
+            const float* src,
+            size_t n
+        )
+        {
+            size_t i = 0;
+#if defined(__AVX512BF16__)
+            // Note that this instruction flushes float denormals to zero, which the
+            // scalar code below doesn't do.  Those values are far below anything a
+            // network cares about.
+            for (; i+16 <= n; i += 16)
+            {
+                const __m256bh h = _mm512_cvtneps_pbh(_mm512_loadu_ps(src+i));
+                std::memcpy(dest+i, &h, sizeof(h));
+            }
+#elif defined(DLIB_HAVE_AVX2)
+            const __m256i one = _mm256_set1_epi32(1);
+            const __m256i bias = _mm256_set1_epi32(0x7fff);
+            const __m256i quiet = _mm256_set1_epi32(0x0040);
+            for (; i+8 <= n; i += 8)
+            {
+                const __m256 v = _mm256_loadu_ps(src+i);
+                const __m256i u = _mm256_castps_si256(v);
+                const __m256i hi = _mm256_srli_epi32(u, 16);
+                __m256i r = _mm256_add_epi32(u, _mm256_add_epi32(bias, _mm256_and_si256(hi, one)));
+                r = _mm256_srli_epi32(r, 16);
+                const __m256i isnan = _mm256_castps_si256(_mm256_cmp_ps(v, v, _CMP_UNORD_Q));
+                r = _mm256_blendv_epi8(r, _mm256_or_si256(hi, quiet), isnan);
+                // packus works within each 128 bit lane so put the halves back in order.
+                r = _mm256_permute4x64_epi64(_mm256_packus_epi32(r, r), 0xd8);
+                _mm_storeu_si128((__m128i*)(dest+i), _mm256_castsi256_si128(r));
+            }
+#endif
+            for (; i < n; ++i)
+                dest[i] = impl::float_to_bf16(src[i]);
+        }
+
+        void bf16_to_float (
+            float* dest,
+            const uint16_t* src,
+            size_t n
+        )
+        {
+            size_t i = 0;
+#if defined(DLIB_HAVE_AVX2)
+            for (; i+8 <= n; i += 8)
+            {
+                const __m256i h = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(src+i)));
+                _mm256_storeu_si256((__m256i*)(dest+i), _mm256_slli_epi32(h, 16));
+            }
+#endif
+            for (; i < n; ++i)
+                dest[i] = impl::bf16_to_float(src[i]);
+        }
+
      // ------------------------------------------------------------------------------------
 
         void copy_tensor(
@@ -2089,6 +3459,321 @@ namespace dlib
             }
         }
 
+    // ------------------------------------------------------------------------------------
+
+        namespace impl
+        {
+            /*
+                The recurrent cells compute tanh and sigmoid of every gate, so they use a
+                rational approximation of tanh that only needs simd8f arithmetic instead of
+                calling std::exp on each element.  It's accurate to about 3e-7 and is
+                computed the same way for the simd and the scalar part of each row, so
+                every element gets the same value no matter where it is in the tensor.
+            */
+            inline float clamp_tanh_input (float x) { return std::max(-7.90531110763549805f, std::min(7.90531110763549805f, x)); }
+            inline simd8f clamp_tanh_input (const simd8f& x) { return max(simd8f(-7.90531110763549805f), min(simd8f(7.90531110763549805f), x)); }
+
+            template <typename T>
+            inline T fast_tanh (
+                const T& val
+            )
+            {
+                const T x = clamp_tanh_input(val);
+                const T x2 = x*x;
+                T p = T(-2.76076847742355e-16f);
+                p = p*x2 + T(2.00018790482477e-13f);
+                p = p*x2 + T(-8.60467152213735e-11f);
+                p = p*x2 + T(5.12229709037114e-08f);
+                p = p*x2 + T(1.48572235717979e-05f);
+                p = p*x2 + T(6.37261928875436e-04f);
+                p = p*x2 + T(4.89352455891786e-03f);
+                T q = T(1.19825839466702e-06f);
+                q = q*x2 + T(1.18534705686654e-04f);
+                q = q*x2 + T(2.26843463243900e-03f);
+                q = q*x2 + T(4.89352518554385e-03f);
+                return x*p/q;
+            }
+
+            template <typename T>
+            inline T fast_sigmoid (
+                const T& x
+            )
+            {
+                return T(0.5f)*fast_tanh(T(0.5f)*x) + T(0.5f);
+            }
+
+            template <typename T>
+            inline void lstm_cell_forward (
+                float* gi, float* gf, float* gg, float* go,
+                float* c, float* h, const float* c_prev,
+                long j
+            )
+            {
+                T i, f, g, o, cp;
+                i.load(gi+j); f.load(gf+j); g.load(gg+j); o.load(go+j);
+                cp.load(c_prev+j);
+                i = fast_sigmoid(i);
+                f = fast_sigmoid(f);
+                g = fast_tanh(g);
+                o = fast_sigmoid(o);
+                const T cc = f*cp + i*g;
+                i.store(gi+j); f.store(gf+j); g.store(gg+j); o.store(go+j);
+                cc.store(c+j);
+                (o*fast_tanh(cc)).store(h+j);
+            }
+
+            template <typename T>
+            inline void lstm_cell_backward (
+                float* di, float* df, float* dg, float* d_o, float* dc,
+                const float* gi, const float* gf, const float* gg, const float* go,
+                const float* c, const float* c_prev, const float* dh,
+                long j
+            )
+            {
+                T i, f, g, o, cc, cp, dhh, dcc;
+                i.load(gi+j); f.load(gf+j); g.load(gg+j); o.load(go+j);
+                cc.load(c+j); cp.load(c_prev+j); dhh.load(dh+j); dcc.load(dc+j);
+                const T one(1);
+                const T tc = fast_tanh(cc);
+                dcc = dcc + dhh*o*(one - tc*tc);
+                (dcc*g*i*(one-i)).store(di+j);
+                (dcc*cp*f*(one-f)).store(df+j);
+                (dcc*i*(one-g*g)).store(dg+j);
+                (dhh*tc*o*(one-o)).store(d_o+j);
+                (dcc*f).store(dc+j);
+            }
+
+            template <typename T>
+            inline void gru_cell_forward (
+                float* gz, float* gr, float* gn,
+                float* rz, float* rr, float* rn,
+                float* h, const float* h_prev,
+                const float* bz, const float* br, const float* bn,
+                long j
+            )
+            {
+                T z, r, n, hz, hr, hn, b, hp;
+                z.load(gz+j); r.load(gr+j); n.load(gn+j);
+                hz.load(rz+j); hr.load(rr+j); hn.load(rn+j);
+                hp.load(h_prev+j);
+                b.load(bz+j); hz = hz + b;
+                b.load(br+j); hr = hr + b;
+                b.load(bn+j); hn = hn + b;
+                z = fast_sigmoid(z + hz);
+                r = fast_sigmoid(r + hr);
+                n = fast_tanh(n + r*hn);
+                z.store(gz+j); r.store(gr+j); n.store(gn+j);
+                hz.store(rz+j); hr.store(rr+j); hn.store(rn+j);
+                (n + z*(hp - n)).store(h+j);
+            }
+
+            template <typename T>
+            inline void gru_cell_backward (
+                float* dz, float* dr, float* dn,
+                float* drz, float* drr, float* drn,
+                float* dh,
+                const float* gz, const float* gr, const float* gn,
+                const float* rn, const float* h_prev,
+                long j
+            )
+            {
+                T z, r, n, hn, hp, dhh;
+                z.load(gz+j); r.load(gr+j); n.load(gn+j);
+                hn.load(rn+j); hp.load(h_prev+j); dhh.load(dh+j);
+                const T one(1);
+                const T dzz = dhh*(hp - n)*z*(one-z);
+                const T dnn = dhh*(one-z)*(one-n*n);
+                const T drr_ = dnn*hn*r*(one-r);
+                dzz.store(dz+j); drr_.store(dr+j); dnn.store(dn+j);
+                dzz.store(drz+j); drr_.store(drr+j); (dnn*r).store(drn+j);
+                (dhh*z).store(dh+j);
+            }
+
+            /*
+                Lets the scalar tail of each row go through the same templated cell code
+                as the simd part.
+            */
+            struct scalar_lane
+            {
+                scalar_lane() {}
+                scalar_lane(float v) : x(v) {}
+                void load(const float* p) { x = *p; }
+                void store(float* p) const { *p = x; }
+                float x;
+            };
+            inline scalar_lane operator+ (scalar_lane a, scalar_lane b) { return a.x+b.x; }
+            inline scalar_lane operator- (scalar_lane a, scalar_lane b) { return a.x-b.x; }
+            inline scalar_lane operator* (scalar_lane a, scalar_lane b) { return a.x*b.x; }
+            inline scalar_lane operator/ (scalar_lane a, scalar_lane b) { return a.x/b.x; }
+            inline scalar_lane clamp_tanh_input (scalar_lane a) { return clamp_tanh_input(a.x); }
+
+            template <typename F>
+            void for_each_cell_row (
+                long num_samples,
+                long row_size,
+                F&& f
+            )
+            /*!
+                ensures
+                    - calls f(n) for each n in [0,num_samples).  A time step of a big batch
+                      is split over the default thread pool.
+            !*/
+            {
+                if (num_samples*row_size < 16384)
+                {
+                    for (long n = 0; n < num_samples; ++n)
+                        f(n);
+                }
+                else
+                {
+                    parallel_for(0, num_samples, [&](long n){ f(n); });
+                }
+            }
+        }
+
+        void lstm_cell_forward (
+            tensor& gates,
+            tensor& c,
+            tensor& h,
+            const tensor& c_prev
+        )
+        {
+            const long H = c.size()/std::max<long>(c.num_samples(),1);
+            DLIB_CASSERT(c.num_samples() == gates.num_samples() &&
+                         gates.size() == 4*c.size() &&
+                         h.size() == c.size() &&
+                         c_prev.size() == c.size());
+
+            float* pg = gates.host();
+            float* pc = c.host_write_only();
+            float* ph = h.host_write_only();
+            const float* pcp = c_prev.host();
+            impl::for_each_cell_row(c.num_samples(), 4*H, [&](long n)
+            {
+                float* g = pg + n*4*H;
+                float* cc = pc + n*H;
+                float* hh = ph + n*H;
+                const float* cp = pcp + n*H;
+                long j = 0;
+                for (; j + 8 <= H; j += 8)
+                    impl::lstm_cell_forward<simd8f>(g, g+H, g+2*H, g+3*H, cc, hh, cp, j);
+                for (; j < H; ++j)
+                    impl::lstm_cell_forward<impl::scalar_lane>(g, g+H, g+2*H, g+3*H, cc, hh, cp, j);
+            });
+        }
+
+        void lstm_cell_backward (
+            tensor& dgates,
+            tensor& dc,
+            const tensor& gates,
+            const tensor& c,
+            const tensor& c_prev,
+            const tensor& dh
+        )
+        {
+            const long H = c.size()/std::max<long>(c.num_samples(),1);
+            DLIB_CASSERT(have_same_dimensions(dgates, gates) &&
+                         c.num_samples() == gates.num_samples() &&
+                         gates.size() == 4*c.size() &&
+                         dc.size() == c.size() &&
+                         c_prev.size() == c.size() &&
+                         dh.size() == c.size());
+
+            float* pdg = dgates.host_write_only();
+            float* pdc = dc.host();
+            const float* pg = gates.host();
+            const float* pc = c.host();
+            const float* pcp = c_prev.host();
+            const float* pdh = dh.host();
+            impl::for_each_cell_row(c.num_samples(), 4*H, [&](long n)
+            {
+                float* d = pdg + n*4*H;
+                const float* g = pg + n*4*H;
+                float* dcc = pdc + n*H;
+                const float* cc = pc + n*H;
+                const float* cp = pcp + n*H;
+                const float* dhh = pdh + n*H;
+                long j = 0;
+                for (; j + 8 <= H; j += 8)
+                    impl::lstm_cell_backward<simd8f>(d, d+H, d+2*H, d+3*H, dcc, g, g+H, g+2*H, g+3*H, cc, cp, dhh, j);
+                for (; j < H; ++j)
+                    impl::lstm_cell_backward<impl::scalar_lane>(d, d+H, d+2*H, d+3*H, dcc, g, g+H, g+2*H, g+3*H, cc, cp, dhh, j);
+            });
+        }
+
+        void gru_cell_forward (
+            tensor& gates,
+            tensor& rec,
+            tensor& h,
+            const tensor& h_prev,
+            const tensor& rec_bias
+        )
+        {
+            const long H = h.size()/std::max<long>(h.num_samples(),1);
+            DLIB_CASSERT(have_same_dimensions(gates, rec) &&
+                         h.num_samples() == gates.num_samples() &&
+                         gates.size() == 3*h.size() &&
+                         h_prev.size() == h.size() &&
+                         rec_bias.size() == 3*(size_t)H);
+
+            float* pg = gates.host();
+            float* pr = rec.host();
+            float* ph = h.host_write_only();
+            const float* php = h_prev.host();
+            const float* b = rec_bias.host();
+            impl::for_each_cell_row(h.num_samples(), 3*H, [&](long n)
+            {
+                float* g = pg + n*3*H;
+                float* r = pr + n*3*H;
+                float* hh = ph + n*H;
+                const float* hp = php + n*H;
+                long j = 0;
+                for (; j + 8 <= H; j += 8)
+                    impl::gru_cell_forward<simd8f>(g, g+H, g+2*H, r, r+H, r+2*H, hh, hp, b, b+H, b+2*H, j);
+                for (; j < H; ++j)
+                    impl::gru_cell_forward<impl::scalar_lane>(g, g+H, g+2*H, r, r+H, r+2*H, hh, hp, b, b+H, b+2*H, j);
+            });
+        }
+
+        void gru_cell_backward (
+            tensor& dgates,
+            tensor& drec,
+            tensor& dh,
+            const tensor& gates,
+            const tensor& rec,
+            const tensor& h_prev
+        )
+        {
+            const long H = dh.size()/std::max<long>(dh.num_samples(),1);
+            DLIB_CASSERT(have_same_dimensions(dgates, gates) &&
+                         have_same_dimensions(drec, gates) &&
+                         have_same_dimensions(rec, gates) &&
+                         dh.num_samples() == gates.num_samples() &&
+                         gates.size() == 3*dh.size() &&
+                         h_prev.size() == dh.size());
+
+            float* pdg = dgates.host_write_only();
+            float* pdr = drec.host_write_only();
+            float* pdh = dh.host();
+            const float* pg = gates.host();
+            const float* pr = rec.host();
+            const float* php = h_prev.host();
+            impl::for_each_cell_row(dh.num_samples(), 3*H, [&](long n)
+            {
+                float* d = pdg + n*3*H;
+                float* dr = pdr + n*3*H;
+                float* dhh = pdh + n*H;
+                const float* g = pg + n*3*H;
+                const float* rn = pr + n*3*H + 2*H;
+                const float* hp = php + n*H;
+                long j = 0;
+                for (; j + 8 <= H; j += 8)
+                    impl::gru_cell_backward<simd8f>(d, d+H, d+2*H, dr, dr+H, dr+2*H, dhh, g, g+H, g+2*H, rn, hp, j);
+                for (; j < H; ++j)
+                    impl::gru_cell_backward<impl::scalar_lane>(d, d+H, d+2*H, dr, dr+H, dr+2*H, dhh, g, g+H, g+2*H, rn, hp, j);
+            });
+        }
+
     // ------------------------------------------------------------------------------------
     // ------------------------------------------------------------------------------------
     // ------------------------------------------------------------------------------------
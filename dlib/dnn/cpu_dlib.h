@@ -8,6 +8,8 @@
 
 #include "tensor.h"
 #include "../geometry/rectangle.h"
+#include <vector>
+#include <cstdint>
 
 namespace dlib
 {
@@ -134,6 +136,29 @@ namespace dlib
 
     // -----------------------------------------------------------------------------------
 
+        void compute_sgd_update (
+            size_t begin,
+            size_t end,
+            tensor& v,
+            const float learning_rate,
+            const float weight_decay,
+            const float momentum,
+            const tensor& params,
+            const tensor& params_grad
+        );
+
+        void compute_nesterov_update (
+            size_t begin,
+            size_t end,
+            tensor& s,
+            tensor& v,
+            const float learning_rate,
+            const float weight_decay,
+            const float momentum,
+            const tensor& params,
+            const tensor& params_grad
+        );
+
         void compute_adam_update (
             size_t begin,
             size_t end,
@@ -149,6 +174,36 @@ namespace dlib
             const tensor& params_grad
         );
 
+        void compute_adamw_update (
+            size_t begin,
+            size_t end,
+            tensor& s,
+            tensor& m,
+            tensor& v,
+            const float t,
+            const float learning_rate,
+            const float weight_decay,
+            const float momentum1,
+            const float momentum2,
+            const tensor& params,
+            const tensor& params_grad
+        );
+
+        void compute_lamb_update (
+            size_t begin,
+            size_t end,
+            tensor& s,
+            tensor& m,
+            tensor& v,
+            const float t,
+            const float learning_rate,
+            const float weight_decay,
+            const float momentum1,
+            const float momentum2,
+            const tensor& params,
+            const tensor& params_grad
+        );
+
     // -----------------------------------------------------------------------------------
 
         void batch_normalize_inference (
@@ -346,6 +401,25 @@ namespace dlib
             const tensor& gradient_input
         ) { resize_bilinear_gradient(grad, grad.nc(), grad.nr()*grad.nc(), gradient_input, gradient_input.nc(), gradient_input.nr()*gradient_input.nc()); }
 
+    // -----------------------------------------------------------------------------------
+
+        void interleaved_rgb_to_planar (
+            float* dest,
+            long dest_row_stride,
+            long dest_channel_stride,
+            const unsigned char* src,
+            long src_row_stride,
+            long src_pixel_size,
+            long red_offset,
+            long green_offset,
+            long blue_offset,
+            long nr,
+            long nc,
+            float avg_red,
+            float avg_green,
+            float avg_blue
+        );
+
     // -----------------------------------------------------------------------------------
 
         class pooling
@@ -407,6 +481,17 @@ namespace dlib
 
     // -----------------------------------------------------------------------------------
 
+        inline long dilated_size (
+            long size,
+            long dilation
+        ) 
+        /*!
+            ensures
+                - returns the extent covered by a filter with size taps spaced dilation
+                  pixels apart.
+        !*/
+        { return (size-1)*dilation + 1; }
+
         class tensor_conv
         {
         public:
@@ -424,17 +509,22 @@ namespace dlib
                 int stride_y,
                 int stride_x,
                 int padding_y,
-                int padding_x
+                int padding_x,
+                int dilation_y = 1,
+                int dilation_x = 1
             ) 
             {
                 (void)data;    /* silence compiler */
                 DLIB_CASSERT(stride_y > 0 && stride_x > 0);
-                DLIB_CASSERT(0 <= padding_y && padding_y < filters.nr());
-                DLIB_CASSERT(0 <= padding_x && padding_x < filters.nc());
+                DLIB_CASSERT(dilation_y > 0 && dilation_x > 0);
+                DLIB_CASSERT(0 <= padding_y && padding_y < dilated_size(filters.nr(), dilation_y));
+                DLIB_CASSERT(0 <= padding_x && padding_x < dilated_size(filters.nc(), dilation_x));
                 last_stride_y = stride_y;
                 last_stride_x = stride_x;
                 last_padding_y = padding_y;
                 last_padding_x = padding_x;            
+                last_dilation_y = dilation_y;
+                last_dilation_x = dilation_x;
             }
 
              void operator() (
@@ -471,8 +561,74 @@ namespace dlib
             long last_stride_x = 0;
             long last_padding_y = 0;
             long last_padding_x = 0;
+            long last_dilation_y = 1;
+            long last_dilation_x = 1;
+
+            // Per thread partial sums used by get_gradient_for_filters().  They are kept
+            // around so repeated calls don't need to reallocate them.
+            std::vector<matrix<float>> filter_gradient_partials;
         };
 
+    // -----------------------------------------------------------------------------------
+
+        void quantize_rows (
+            std::vector<int8_t>& q,
+            std::vector<float>& scales,
+            const tensor& data
+        );
+
+        void quantized_conv (
+            resizable_tensor& output,
+            const tensor& data,
+            float data_scale,
+            const std::vector<int8_t>& filters,
+            const std::vector<float>& filter_scales,
+            long num_filters,
+            long filter_nr,
+            long filter_nc,
+            int stride_y,
+            int stride_x,
+            int padding_y,
+            int padding_x,
+            int dilation_y = 1,
+            int dilation_x = 1
+        );
+
+        void quantized_fc (
+            resizable_tensor& output,
+            const tensor& data,
+            float data_scale,
+            const std::vector<int8_t>& weights,
+            const std::vector<float>& weight_scales,
+            long num_outputs
+        );
+
+    // -----------------------------------------------------------------------------------
+
+        void float_to_fp16 (
+            uint16_t* dest,
+            const float* src,
+            size_t n
+        );
+
+        void fp16_to_float (
+            float* dest,
+            const uint16_t* src,
+            size_t n
+        );
+
+        void float_to_bf16 (
+            uint16_t* dest,
+            const float* src,
+            size_t n
+        );
+
+        void bf16_to_float (
+            float* dest,
+            const uint16_t* src,
+            size_t n
+        );
+
     // -----------------------------------------------------------------------------------
 
         void copy_tensor(
@@ -484,6 +640,41 @@ namespace dlib
             size_t count_k
         );
 
+    // -----------------------------------------------------------------------------------
+
+        void lstm_cell_forward (
+            tensor& gates,
+            tensor& c,
+            tensor& h,
+            const tensor& c_prev
+        );
+
+        void lstm_cell_backward (
+            tensor& dgates,
+            tensor& dc,
+            const tensor& gates,
+            const tensor& c,
+            const tensor& c_prev,
+            const tensor& dh
+        );
+
+        void gru_cell_forward (
+            tensor& gates,
+            tensor& rec,
+            tensor& h,
+            const tensor& h_prev,
+            const tensor& rec_bias
+        );
+
+        void gru_cell_backward (
+            tensor& dgates,
+            tensor& drec,
+            tensor& dh,
+            const tensor& gates,
+            const tensor& rec,
+            const tensor& h_prev
+        );
+
     // -----------------------------------------------------------------------------------
 
     } 
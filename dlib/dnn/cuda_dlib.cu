@@ -3,6 +3,7 @@
 
 #include "cuda_utils.h"
 #include "cuda_dlib.h"
+#include "cuda_data_ptr.h"
 
 
 namespace dlib 
@@ -1016,6 +1017,87 @@ namespace dlib
             }
         }
 
+    // ----------------------------------------------------------------------------------------
+
+        __global__ void _cuda_compute_sgd_update(
+            size_t begin,
+            size_t end,
+            float* v,
+            const float learning_rate,
+            const float weight_decay,
+            const float momentum,
+            const float* params,
+            const float* params_grad
+        )
+        {
+            for (auto i : grid_stride_range(begin, end))
+                v[i] = momentum*v[i] - learning_rate*(weight_decay*params[i] + params_grad[i]);
+        }
+
+        void compute_sgd_update (
+            size_t begin,
+            size_t end,
+            tensor& v,
+            const float learning_rate,
+            const float weight_decay,
+            const float momentum,
+            const tensor& params,
+            const tensor& params_grad
+        )
+        {
+            DLIB_CASSERT(v.size() == params.size() &&
+                         v.size() == params_grad.size());
+            DLIB_CASSERT(begin <= end && end <= params.size());
+
+            launch_kernel(_cuda_compute_sgd_update,max_jobs(end-begin),
+                    begin, end, v.device(), learning_rate, weight_decay, momentum,
+                    params.device(), params_grad.device());
+        }
+
+    // ----------------------------------------------------------------------------------------
+
+        __global__ void _cuda_compute_nesterov_update(
+            size_t begin,
+            size_t end,
+            float* s,
+            float* v,
+            const float learning_rate,
+            const float weight_decay,
+            const float momentum,
+            const float* params,
+            const float* params_grad
+        )
+        {
+            for (auto i : grid_stride_range(begin, end))
+            {
+                const float d = -learning_rate*(weight_decay*params[i] + params_grad[i]);
+                v[i] = momentum*v[i] + d;
+                s[i] = momentum*v[i] + d;
+            }
+        }
+
+        void compute_nesterov_update (
+            size_t begin,
+            size_t end,
+            tensor& s,
+            tensor& v,
+            const float learning_rate,
+            const float weight_decay,
+            const float momentum,
+            const tensor& params,
+            const tensor& params_grad
+        )
+        {
+            DLIB_CASSERT(s.size() == v.size() &&
+                         s.size() == params.size() &&
+                         s.size() == params_grad.size());
+            DLIB_CASSERT(begin <= end && end <= params.size());
+
+            launch_kernel(_cuda_compute_nesterov_update,max_jobs(end-begin),
+                    begin, end, s.device(), v.device(), learning_rate, weight_decay, momentum,
+                    params.device(), params_grad.device());
+        }
+
     // ----------------------------------------------------------------------------------------
 
         __global__ void _cuda_compute_adam_update(
@@ -1073,6 +1155,161 @@ namespace dlib
                     momentum1, momentum2, params.device(), params_grad.device());
         }
 
+    // ----------------------------------------------------------------------------------------
+
+        __global__ void _cuda_compute_adamw_update(
+            size_t begin,
+            size_t end,
+            float* s,
+            float* m,
+            float* v,
+            const float alpha,
+            const float lr_weight_decay,
+            const float momentum1,
+            const float momentum2,
+            const float* params,
+            const float* params_grad
+        )
+        {
+            const float eps = 1e-8;
+            for (auto i : grid_stride_range(begin, end))
+            {
+                float g = params_grad[i];
+                m[i] = momentum1*m[i] + (1-momentum1)*g;
+                v[i] = momentum2*v[i] + (1-momentum2)*g*g;
+                s[i] = -alpha*m[i]/(std::sqrt(v[i]) + eps) - lr_weight_decay*params[i];
+            }
+        }
+
+        void compute_adamw_update (
+            size_t begin,
+            size_t end,
+            tensor& s,
+            tensor& m,
+            tensor& v,
+            const float t,
+            const float learning_rate,
+            const float weight_decay,
+            const float momentum1,
+            const float momentum2,
+            const tensor& params,
+            const tensor& params_grad
+        )
+        {
+            DLIB_CASSERT(s.size() == m.size() &&
+                         s.size() == v.size() &&
+                         s.size() == params.size() &&
+                         s.size() == params_grad.size());
+            DLIB_CASSERT(begin <= end && end <= params.size());
+            const float alpha = learning_rate*std::sqrt(1-std::pow(momentum2,t))/(1-std::pow(momentum1, t));
+
+            launch_kernel(_cuda_compute_adamw_update,max_jobs(end-begin),
+                    begin, end, s.device(), m.device(), v.device(), alpha,
+                    learning_rate*weight_decay, momentum1, momentum2, params.device(),
+                    params_grad.device());
+        }
+
+    // ----------------------------------------------------------------------------------------
+
+        __global__ void _cuda_compute_lamb_direction(
+            size_t begin,
+            size_t end,
+            float* s,
+            float* m,
+            float* v,
+            const float c1,
+            const float c2,
+            const float weight_decay,
+            const float momentum1,
+            const float momentum2,
+            const float* params,
+            const float* params_grad,
+            float* norms
+        )
+        {
+            const float eps = 1e-6;
+            float pp = 0, rr = 0;
+            for (auto i : grid_stride_range(begin, end))
+            {
+                float g = params_grad[i];
+                m[i] = momentum1*m[i] + (1-momentum1)*g;
+                v[i] = momentum2*v[i] + (1-momentum2)*g*g;
+                s[i] = c1*m[i]/(std::sqrt(c2*v[i]) + eps) + weight_decay*params[i];
+                pp += params[i]*params[i];
+                rr += s[i]*s[i];
+            }
+            warp_reduce_atomic_add(norms[0], pp);
+            warp_reduce_atomic_add(norms[1], rr);
+        }
+
+        __global__ void _cuda_compute_lamb_scale(
+            size_t begin,
+            size_t end,
+            float* s,
+            const float learning_rate,
+            const float* norms
+        )
+        {
+            // Every thread works out the trust ratio itself so the norms never have to
+            // come back to the host.
+            float trust = 1;
+            if (norms[0] > 0 && norms[1] > 0)
+                trust = std::sqrt(norms[0]/norms[1]);
+            const float scale = -learning_rate*trust;
+            for (auto i : grid_stride_range(begin, end))
+                s[i] *= scale;
+        }
+
+        namespace
+        {
+            float* lamb_norms_buffer (
+            )
+            {
+                // Scratch space for the two sums of squares, one per thread and device.
+                thread_local std::vector<cuda_data_ptr<float>> buffers;
+                const int dev = get_device();
+                if (buffers.size() <= static_cast<size_t>(dev))
+                    buffers.resize(dev+1);
+                if (buffers[dev].size() == 0)
+                    buffers[dev] = cuda_data_ptr<float>(2);
+                return buffers[dev];
+            }
+        }
+
+        void compute_lamb_update (
+            size_t begin,
+            size_t end,
+            tensor& s,
+            tensor& m,
+            tensor& v,
+            const float t,
+            const float learning_rate,
+            const float weight_decay,
+            const float momentum1,
+            const float momentum2,
+            const tensor& params,
+            const tensor& params_grad
+        )
+        {
+            DLIB_CASSERT(s.size() == m.size() &&
+                         s.size() == v.size() &&
+                         s.size() == params.size() &&
+                         s.size() == params_grad.size());
+            DLIB_CASSERT(begin <= end && end <= params.size());
+            if (begin == end)
+                return;
+            const float c1 = 1/(1-std::pow(momentum1, t));
+            const float c2 = 1/(1-std::pow(momentum2, t));
+
+            float* norms = lamb_norms_buffer();
+            CHECK_CUDA(cudaMemset(norms, 0, 2*sizeof(float)));
+            launch_kernel(_cuda_compute_lamb_direction,max_jobs(end-begin),
+                    begin, end, s.device(), m.device(), v.device(), c1, c2, weight_decay,
+                    momentum1, momentum2, params.device(), params_grad.device(), norms);
+            launch_kernel(_cuda_compute_lamb_scale,max_jobs(end-begin),
+                    begin, end, s.device(), learning_rate, norms);
+        }
+
     // -----------------------------------------------------------------------------------
 
         __global__ void _cuda_affine_transform_conv(float* d, const float* s, size_t n, const float* A, const float* B, size_t bs, size_t ks)
@@ -1538,6 +1775,193 @@ namespace dlib
             }
         }
 
+    // ----------------------------------------------------------------------------------------
+
+        __inline__ __device__ float cuda_sigmoid(float x) { return 1.0f/(1.0f + ::expf(-x)); }
+
+        __global__ void _cuda_lstm_cell_forward(
+            float* gates,
+            float* c,
+            float* h,
+            const float* c_prev,
+            size_t n,
+            size_t H
+        )
+        {
+            for (auto idx : grid_stride_range(0, n))
+            {
+                float* g = gates + (idx/H)*4*H + idx%H;
+                const float i = cuda_sigmoid(g[0]);
+                const float f = cuda_sigmoid(g[H]);
+                const float gg = ::tanhf(g[2*H]);
+                const float o = cuda_sigmoid(g[3*H]);
+                g[0] = i; g[H] = f; g[2*H] = gg; g[3*H] = o;
+                c[idx] = f*c_prev[idx] + i*gg;
+                h[idx] = o*::tanhf(c[idx]);
+            }
+        }
+
+        void lstm_cell_forward (
+            tensor& gates,
+            tensor& c,
+            tensor& h,
+            const tensor& c_prev
+        )
+        {
+            DLIB_CASSERT(c.num_samples() == gates.num_samples() &&
+                         gates.size() == 4*c.size() &&
+                         h.size() == c.size() &&
+                         c_prev.size() == c.size());
+            if (c.size() == 0)
+                return;
+            launch_kernel(_cuda_lstm_cell_forward, max_jobs(c.size()),
+                gates.device(), c.device(), h.device(), c_prev.device(),
+                c.size(), c.size()/c.num_samples());
+        }
+
+        __global__ void _cuda_lstm_cell_backward(
+            float* dgates,
+            float* dc,
+            const float* gates,
+            const float* c,
+            const float* c_prev,
+            const float* dh,
+            size_t n,
+            size_t H
+        )
+        {
+            for (auto idx : grid_stride_range(0, n))
+            {
+                const size_t off = (idx/H)*4*H + idx%H;
+                const float* g = gates + off;
+                float* d = dgates + off;
+                const float i = g[0], f = g[H], gg = g[2*H], o = g[3*H];
+                const float tc = ::tanhf(c[idx]);
+                const float dcc = dc[idx] + dh[idx]*o*(1-tc*tc);
+                d[0] = dcc*gg*i*(1-i);
+                d[H] = dcc*c_prev[idx]*f*(1-f);
+                d[2*H] = dcc*i*(1-gg*gg);
+                d[3*H] = dh[idx]*tc*o*(1-o);
+                dc[idx] = dcc*f;
+            }
+        }
+
+        void lstm_cell_backward (
+            tensor& dgates,
+            tensor& dc,
+            const tensor& gates,
+            const tensor& c,
+            const tensor& c_prev,
+            const tensor& dh
+        )
+        {
+            DLIB_CASSERT(have_same_dimensions(dgates, gates) &&
+                         c.num_samples() == gates.num_samples() &&
+                         gates.size() == 4*c.size() &&
+                         dc.size() == c.size() &&
+                         c_prev.size() == c.size() &&
+                         dh.size() == c.size());
+            if (c.size() == 0)
+                return;
+            launch_kernel(_cuda_lstm_cell_backward, max_jobs(c.size()),
+                dgates.device(), dc.device(), gates.device(), c.device(), c_prev.device(),
+                dh.device(), c.size(), c.size()/c.num_samples());
+        }
+
+        __global__ void _cuda_gru_cell_forward(
+            float* gates,
+            float* rec,
+            float* h,
+            const float* h_prev,
+            const float* rec_bias,
+            size_t n,
+            size_t H
+        )
+        {
+            for (auto idx : grid_stride_range(0, n))
+            {
+                const size_t j = idx%H;
+                const size_t off = (idx/H)*3*H + j;
+                float* g = gates + off;
+                float* r = rec + off;
+                r[0] += rec_bias[j];
+                r[H] += rec_bias[H+j];
+                r[2*H] += rec_bias[2*H+j];
+                const float z = cuda_sigmoid(g[0] + r[0]);
+                const float rr = cuda_sigmoid(g[H] + r[H]);
+                const float nn = ::tanhf(g[2*H] + rr*r[2*H]);
+                g[0] = z; g[H] = rr; g[2*H] = nn;
+                h[idx] = nn + z*(h_prev[idx] - nn);
+            }
+        }
+
+        void gru_cell_forward (
+            tensor& gates,
+            tensor& rec,
+            tensor& h,
+            const tensor& h_prev,
+            const tensor& rec_bias
+        )
+        {
+            DLIB_CASSERT(have_same_dimensions(gates, rec) &&
+                         h.num_samples() == gates.num_samples() &&
+                         gates.size() == 3*h.size() &&
+                         h_prev.size() == h.size());
+            if (h.size() == 0)
+                return;
+            DLIB_CASSERT(rec_bias.size() == 3*(h.size()/h.num_samples()));
+            launch_kernel(_cuda_gru_cell_forward, max_jobs(h.size()),
+                gates.device(), rec.device(), h.device(), h_prev.device(), rec_bias.device(),
+                h.size(), h.size()/h.num_samples());
+        }
+
+        __global__ void _cuda_gru_cell_backward(
+            float* dgates,
+            float* drec,
+            float* dh,
+            const float* gates,
+            const float* rec,
+            const float* h_prev,
+            size_t n,
+            size_t H
+        )
+        {
+            for (auto idx : grid_stride_range(0, n))
+            {
+                const size_t off = (idx/H)*3*H + idx%H;
+                const float* g = gates + off;
+                const float z = g[0], r = g[H], nn = g[2*H];
+                const float dz = dh[idx]*(h_prev[idx] - nn)*z*(1-z);
+                const float dn = dh[idx]*(1-z)*(1-nn*nn);
+                const float dr = dn*rec[off+2*H]*r*(1-r);
+                dgates[off] = dz; dgates[off+H] = dr; dgates[off+2*H] = dn;
+                drec[off] = dz; drec[off+H] = dr; drec[off+2*H] = dn*r;
+                dh[idx] *= z;
+            }
+        }
+
+        void gru_cell_backward (
+            tensor& dgates,
+            tensor& drec,
+            tensor& dh,
+            const tensor& gates,
+            const tensor& rec,
+            const tensor& h_prev
+        )
+        {
+            DLIB_CASSERT(have_same_dimensions(dgates, gates) &&
+                         have_same_dimensions(drec, gates) &&
+                         have_same_dimensions(rec, gates) &&
+                         dh.num_samples() == gates.num_samples() &&
+                         gates.size() == 3*dh.size() &&
+                         h_prev.size() == dh.size());
+            if (dh.size() == 0)
+                return;
+            launch_kernel(_cuda_gru_cell_backward, max_jobs(dh.size()),
+                dgates.device(), drec.device(), dh.device(), gates.device(), rec.device(),
+                h_prev.device(), dh.size(), dh.size()/dh.num_samples());
+        }
+
     // ----------------------------------------------------------------------------------------
 
     }
@@ -299,6 +299,29 @@ namespace dlib
 
     // ----------------------------------------------------------------------------------------
 
+        void compute_sgd_update (
+            size_t begin,
+            size_t end,
+            tensor& v,
+            const float learning_rate,
+            const float weight_decay,
+            const float momentum,
+            const tensor& params,
+            const tensor& params_grad
+        );
+
+        void compute_nesterov_update (
+            size_t begin,
+            size_t end,
+            tensor& s,
+            tensor& v,
+            const float learning_rate,
+            const float weight_decay,
+            const float momentum,
+            const tensor& params,
+            const tensor& params_grad
+        );
+
         void compute_adam_update (
             size_t begin,
             size_t end,
@@ -314,6 +337,36 @@ namespace dlib
             const tensor& params_grad
         );
 
+        void compute_adamw_update (
+            size_t begin,
+            size_t end,
+            tensor& s,
+            tensor& m,
+            tensor& v,
+            const float t,
+            const float learning_rate,
+            const float weight_decay,
+            const float momentum1,
+            const float momentum2,
+            const tensor& params,
+            const tensor& params_grad
+        );
+
+        void compute_lamb_update (
+            size_t begin,
+            size_t end,
+            tensor& s,
+            tensor& m,
+            tensor& v,
+            const float t,
+            const float learning_rate,
+            const float weight_decay,
+            const float momentum1,
+            const float momentum2,
+            const tensor& params,
+            const tensor& params_grad
+        );
+
     // -----------------------------------------------------------------------------------
 
         void assign_bias_gradient (
@@ -395,6 +448,41 @@ namespace dlib
             size_t count_k
         );
 
+    // ----------------------------------------------------------------------------------------
+
+        void lstm_cell_forward (
+            tensor& gates,
+            tensor& c,
+            tensor& h,
+            const tensor& c_prev
+        );
+
+        void lstm_cell_backward (
+            tensor& dgates,
+            tensor& dc,
+            const tensor& gates,
+            const tensor& c,
+            const tensor& c_prev,
+            const tensor& dh
+        );
+
+        void gru_cell_forward (
+            tensor& gates,
+            tensor& rec,
+            tensor& h,
+            const tensor& h_prev,
+            const tensor& rec_bias
+        );
+
+        void gru_cell_backward (
+            tensor& dgates,
+            tensor& drec,
+            tensor& dh,
+            const tensor& gates,
+            const tensor& rec,
+            const tensor& h_prev
+        );
+
     // ------------------------------------------------------------------------------------
     // ------------------------------------------------------------------------------------
     // ------------------------------------------------------------------------------------
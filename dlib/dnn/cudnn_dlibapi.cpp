@@ -778,6 +778,8 @@ namespace dlib
             stride_x = 0;
             padding_y = 0;
             padding_x = 0;
+            dilation_y = 0;
+            dilation_x = 0;
             data_num_samples = 0;
             data_k = 0;
             data_nr = 0;
@@ -808,10 +810,20 @@ namespace dlib
             int stride_y_,
             int stride_x_,
             int padding_y_,
-            int padding_x_
+            int padding_x_,
+            int dilation_y_,
+            int dilation_x_
         ) 
         {
-            DLIB_CASSERT(data.k() == filters.k());
+            DLIB_CASSERT(filters.k() > 0 && data.k()%filters.k() == 0);
+            DLIB_CASSERT(filters.num_samples()%(data.k()/filters.k()) == 0);
+            DLIB_CASSERT(dilation_y_ > 0 && dilation_x_ > 0);
+#if CUDNN_MAJOR < 7
+            DLIB_CASSERT(data.k() == filters.k(), "Grouped convolutions require cuDNN 7 or newer.");
+#endif
+#if CUDNN_MAJOR < 6
+            DLIB_CASSERT(dilation_y_ == 1 && dilation_x_ == 1, "Dilated convolutions require cuDNN 6 or newer.");
+#endif
 
             // if the last call to setup gave the same exact settings then don't do
             // anything.
@@ -819,6 +831,8 @@ namespace dlib
                 stride_x_ == stride_x &&
                 padding_y_ == padding_y && 
                 padding_x_ == padding_x &&
+                dilation_y_ == dilation_y &&
+                dilation_x_ == dilation_x &&
                 data_num_samples == data.num_samples() &&
                 data_k == data.k() &&
                 data_nr == data.nr() &&
@@ -838,6 +852,8 @@ namespace dlib
                 stride_x = stride_x_;
                 padding_y = padding_y_;
                 padding_x = padding_x_;
+                dilation_y = dilation_y_;
+                dilation_x = dilation_x_;
                 data_num_samples = data.num_samples();
                 data_k = data.k();
                 data_nr = data.nr();
@@ -863,7 +879,8 @@ namespace dlib
                         padding_x, // horizontal padding
                         stride_y,
                         stride_x,
-                        1, 1, // must be 1,1
+                        dilation_y,
+                        dilation_x,
                         CUDNN_CROSS_CORRELATION,
                         CUDNN_DATA_FLOAT)); // could also be CUDNN_CONVOLUTION
 #else
@@ -875,6 +892,12 @@ namespace dlib
                         1, 1, // must be 1,1
                         CUDNN_CROSS_CORRELATION)); // could also be CUDNN_CONVOLUTION
 #endif
+#if CUDNN_MAJOR >= 7
+                // The filter descriptor already has filters.k() == data.k()/groups, which
+                // is the layout cuDNN expects for grouped convolutions.
+                CHECK_CUDNN(cudnnSetConvolutionGroupCount((cudnnConvolutionDescriptor_t)conv_handle,
+                        data.k()/filters.k()));
+#endif
 
                 CHECK_CUDNN(cudnnGetConvolution2dForwardOutputDim(
                         (const cudnnConvolutionDescriptor_t)conv_handle,
@@ -953,7 +976,8 @@ namespace dlib
                 // cudnnGetConvolutionBackwardFilterAlgorithm() by picking a safe
                 // algorithm.
                 if (dnn_prefer_fastest_algorithms() && 
-                    !(stride_x == 1 && stride_y == 1 && ((filters_nr==3&&filters_nc==3) || (filters_nr==5&&filters_nc==5)))
+                    !(stride_x == 1 && stride_y == 1 && dilation_x == 1 && dilation_y == 1 &&
+                      ((filters_nr==3&&filters_nc==3) || (filters_nr==5&&filters_nc==5)))
                     )
                 {
                     backward_filters_best_algo = CUDNN_CONVOLUTION_BWD_FILTER_ALGO_0;
@@ -1007,17 +1031,21 @@ namespace dlib
         {
             DLIB_CASSERT(is_same_object(output,data) == false);
             DLIB_CASSERT(is_same_object(output,filters) == false);
-            DLIB_CASSERT(filters.k() == data.k());
+            DLIB_CASSERT(filters.k() > 0 && data.k()%filters.k() == 0);
             DLIB_CASSERT(stride_y > 0 && stride_x > 0, "You must call setup() before calling this function");
-            DLIB_CASSERT(filters.nc() <= data.nc() + 2*padding_x,
+            const long filters_span_nr = dilation_y*(filters.nr()-1)+1;
+            const long filters_span_nc = dilation_x*(filters.nc()-1)+1;
+            DLIB_CASSERT(filters_span_nc <= data.nc() + 2*padding_x,
                 "Filter windows must be small enough to fit into the padded image."
                 << "\n\t filters.nc(): " << filters.nc() 
+                << "\n\t dilation_x: " << dilation_x 
                 << "\n\t data.nc():  " << data.nc() 
                 << "\n\t padding_x: " << padding_x 
                 );
-            DLIB_CASSERT(filters.nr() <= data.nr() + 2*padding_y,
+            DLIB_CASSERT(filters_span_nr <= data.nr() + 2*padding_y,
                 "Filter windows must be small enough to fit into the padded image."
                 << "\n\t filters.nr(): " << filters.nr() 
+                << "\n\t dilation_y: " << dilation_y 
                 << "\n\t data.nr():  " << data.nr() 
                 << "\n\t padding_y: " << padding_y 
                 );
@@ -1025,8 +1053,8 @@ namespace dlib
 
             DLIB_CASSERT(output.num_samples() == data.num_samples(),out_num_samples << "  " << data.num_samples());
             DLIB_CASSERT(output.k() == filters.num_samples());
-            DLIB_CASSERT(output.nr() == 1+(data.nr()+2*padding_y-filters.nr())/stride_y);
-            DLIB_CASSERT(output.nc() == 1+(data.nc()+2*padding_x-filters.nc())/stride_x);
+            DLIB_CASSERT(output.nr() == 1+(data.nr()+2*padding_y-filters_span_nr)/stride_y);
+            DLIB_CASSERT(output.nc() == 1+(data.nc()+2*padding_x-filters_span_nc)/stride_x);
 
 
 
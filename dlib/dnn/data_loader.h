@@ -0,0 +1,427 @@
+// Copyright (C) 2026  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_DNn_DATA_LOADER_H_
+#define DLIB_DNn_DATA_LOADER_H_
+
+#include "data_loader_abstract.h"
+#include "tensor.h"
+#include "../pipe.h"
+#include "../rand.h"
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        template <typename training_label_type>
+        struct dnn_job_t
+        {
+            dnn_job_t() = default;
+            dnn_job_t(const dnn_job_t&) = delete;
+            dnn_job_t& operator=(const dnn_job_t&) = delete;
+
+            std::vector<std::vector<training_label_type>> labels;
+            std::vector<resizable_tensor> t;
+            std::vector<int> have_data;  // have_data[i] is true if there is data in labels[i] and t[i].
+            bool test_only = false;
+        };
+
+        template <typename training_label_type>
+        void swap(dnn_job_t<training_label_type>& a, dnn_job_t<training_label_type>& b)
+        {
+            a.labels.swap(b.labels);
+            a.t.swap(b.t);
+            a.have_data.swap(b.have_data);
+            std::swap(a.test_only,b.test_only);
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    struct dnn_data_loader_options
+    {
+        size_t num_load_threads = 4;
+        size_t num_augment_threads = 2;
+        size_t num_pack_threads = 1;
+        size_t prefetch_depth = 2;
+        bool shuffle = true;
+        unsigned long seed = 0;
+    };
+
+    struct dnn_data_loader_stage_stats
+    {
+        unsigned long long num_batches = 0;
+        std::chrono::nanoseconds busy_time = std::chrono::nanoseconds(0);
+        std::chrono::nanoseconds input_wait_time = std::chrono::nanoseconds(0);
+        std::chrono::nanoseconds output_wait_time = std::chrono::nanoseconds(0);
+    };
+
+    struct dnn_data_loader_stats
+    {
+        dnn_data_loader_stage_stats load;
+        dnn_data_loader_stage_stats augment;
+        dnn_data_loader_stage_stats pack;
+        unsigned long long num_batches_consumed = 0;
+        std::chrono::nanoseconds consumer_wait_time = std::chrono::nanoseconds(0);
+    };
+
+    inline std::ostream& operator<< (std::ostream& out, const dnn_data_loader_stats& item)
+    {
+        using std::chrono::duration;
+        typedef duration<double> secs;
+        auto print_stage = [&out](const char* name, const dnn_data_loader_stage_stats& s)
+        {
+            out << name << " batches: " << s.num_batches
+                << "  busy: " << secs(s.busy_time).count() << "s"
+                << "  input wait: " << secs(s.input_wait_time).count() << "s"
+                << "  output wait: " << secs(s.output_wait_time).count() << "s\n";
+        };
+        print_stage("load   ", item.load);
+        print_stage("augment", item.augment);
+        print_stage("pack   ", item.pack);
+        out << "trainer batches: " << item.num_batches_consumed
+            << "  waiting for data: " << secs(item.consumer_wait_time).count() << "s\n";
+        return out;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <typename net_type, typename solver_type>
+    class dnn_trainer;
+
+    template <
+        typename net_type
+        >
+    class dnn_data_loader
+    {
+    public:
+
+        typedef typename net_type::input_type input_type;
+        typedef typename net_type::training_label_type training_label_type;
+        typedef std::function<void(size_t, input_type&, training_label_type&)> load_function;
+        typedef std::function<void(input_type&, training_label_type&, dlib::rand&)> augment_function;
+
+        dnn_data_loader(
+            size_t num_samples_,
+            size_t mini_batch_size_,
+            load_function load_,
+            augment_function augment_ = augment_function(),
+            const dnn_data_loader_options& options_ = dnn_data_loader_options()
+        ) :
+            num_samples(num_samples_),
+            mini_batch_size(mini_batch_size_),
+            load(std::move(load_)),
+            augment(std::move(augment_)),
+            options(options_),
+            loaded(options_.prefetch_depth),
+            augmented(options_.prefetch_depth),
+            packed(options_.prefetch_depth),
+            rnd(options_.seed)
+        {
+            DLIB_CASSERT(num_samples > 0);
+            DLIB_CASSERT(mini_batch_size > 0);
+            DLIB_CASSERT(load);
+            DLIB_CASSERT(options.num_load_threads > 0);
+            DLIB_CASSERT(options.num_pack_threads > 0);
+            DLIB_CASSERT(options.prefetch_depth > 0);
+            DLIB_CASSERT(!augment || options.num_augment_threads > 0);
+
+            order.resize(num_samples);
+            for (size_t i = 0; i < order.size(); ++i)
+                order[i] = i;
+            next_pos = num_samples;
+
+            // Without an augment function the loaders feed the packers directly.
+            for (size_t i = 0; i < options.num_load_threads; ++i)
+                threads.emplace_back([this](){ this->load_thread(); });
+            if (augment)
+            {
+                for (size_t i = 0; i < options.num_augment_threads; ++i)
+                    threads.emplace_back([this,i](){ this->augment_thread(options.seed+i+1); });
+            }
+        }
+
+        dnn_data_loader(const dnn_data_loader&) = delete;
+        dnn_data_loader& operator=(const dnn_data_loader&) = delete;
+
+        ~dnn_data_loader(
+        )
+        {
+            stop();
+        }
+
+        size_t size (
+        ) const { return num_samples; }
+
+        size_t get_mini_batch_size (
+        ) const { return mini_batch_size; }
+
+        size_t batches_per_epoch (
+        ) const { return (num_samples + mini_batch_size - 1)/mini_batch_size; }
+
+        const dnn_data_loader_options& get_options (
+        ) const { return options; }
+
+        dnn_data_loader_stats get_stats (
+        ) const
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            return stats;
+        }
+
+        void clear_stats (
+        )
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            stats = dnn_data_loader_stats();
+        }
+
+    private:
+
+        template <typename N, typename S>
+        friend class dnn_trainer;
+
+        typedef impl::dnn_job_t<training_label_type> job_type;
+        typedef std::function<void(const std::vector<input_type>&, const std::vector<training_label_type>&, job_type&)> pack_function;
+        typedef std::chrono::steady_clock clock_type;
+
+        struct batch_type
+        {
+            std::vector<input_type> x;
+            std::vector<training_label_type> y;
+        };
+
+        void start_packing (
+            const void* owner,
+            pack_function pack_
+        )
+        /*!
+            ensures
+                - starts the pack threads, which turn batches into jobs for the dnn_trainer
+                  identified by owner using pack_.  Does nothing if they are already
+                  running for that trainer.
+        !*/
+        {
+            if (pack)
+            {
+                DLIB_CASSERT(owner == pack_owner, "A dnn_data_loader can only feed one dnn_trainer.");
+                return;
+            }
+            pack_owner = owner;
+            pack = std::move(pack_);
+            for (size_t i = 0; i < options.num_pack_threads; ++i)
+                threads.emplace_back([this](){ this->pack_thread(); });
+        }
+
+        bool dequeue (
+            job_type& job
+        )
+        /*!
+            ensures
+                - swaps the next packed job into job, blocking until there is one.  The
+                  old contents of job are recycled by the pack threads.
+                - rethrows any exception thrown by a load or augment function.
+        !*/
+        {
+            const auto start = clock_type::now();
+            const bool ok = packed.dequeue(job);
+            const auto stop = clock_type::now();
+            if (!ok)
+            {
+                std::lock_guard<std::mutex> lock(stats_mutex);
+                if (eptr)
+                    std::rethrow_exception(eptr);
+                return false;
+            }
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            ++stats.num_batches_consumed;
+            stats.consumer_wait_time += stop - start;
+            return true;
+        }
+
+        void stop (
+        )
+        {
+            loaded.disable();
+            augmented.disable();
+            packed.disable();
+            for (auto& t : threads)
+            {
+                if (t.joinable())
+                    t.join();
+            }
+        }
+
+        void fail (
+        )
+        {
+            {
+                std::lock_guard<std::mutex> lock(stats_mutex);
+                if (!eptr)
+                    eptr = std::current_exception();
+            }
+            loaded.disable();
+            augmented.disable();
+            packed.disable();
+        }
+
+        void next_batch_indices (
+            std::vector<size_t>& idx
+        )
+        {
+            std::lock_guard<std::mutex> lock(order_mutex);
+            if (next_pos == num_samples)
+            {
+                if (options.shuffle)
+                {
+                    for (size_t i = order.size()-1; i > 0; --i)
+                        std::swap(order[i], order[rnd.get_random_64bit_number()%(i+1)]);
+                }
+                next_pos = 0;
+            }
+            const size_t n = std::min(mini_batch_size, num_samples-next_pos);
+            idx.assign(order.begin()+next_pos, order.begin()+next_pos+n);
+            next_pos += n;
+        }
+
+        void record (
+            dnn_data_loader_stage_stats& s,
+            clock_type::time_point start,
+            clock_type::time_point got_input,
+            clock_type::time_point done,
+            clock_type::time_point sent
+        )
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            ++s.num_batches;
+            s.input_wait_time += got_input - start;
+            s.busy_time += done - got_input;
+            s.output_wait_time += sent - done;
+        }
+
+        void load_thread (
+        )
+        {
+            try
+            {
+                auto& out = augment ? loaded : augmented;
+                batch_type b;
+                std::vector<size_t> idx;
+                while (true)
+                {
+                    const auto start = clock_type::now();
+                    next_batch_indices(idx);
+                    const auto got_input = clock_type::now();
+                    // b holds whatever batch came back out of the pipe last time, so its
+                    // samples get reused rather than reallocated.
+                    b.x.resize(idx.size());
+                    b.y.resize(idx.size());
+                    for (size_t i = 0; i < idx.size(); ++i)
+                        load(idx[i], b.x[i], b.y[i]);
+                    const auto done = clock_type::now();
+                    if (!out.enqueue(b))
+                        return;
+                    record(stats.load, start, got_input, done, clock_type::now());
+                }
+            }
+            catch (...)
+            {
+                fail();
+            }
+        }
+
+        void augment_thread (
+            unsigned long seed
+        )
+        {
+            try
+            {
+                dlib::rand augment_rnd(seed);
+                batch_type b;
+                while (true)
+                {
+                    const auto start = clock_type::now();
+                    if (!loaded.dequeue(b))
+                        return;
+                    const auto got_input = clock_type::now();
+                    for (size_t i = 0; i < b.x.size(); ++i)
+                        augment(b.x[i], b.y[i], augment_rnd);
+                    const auto done = clock_type::now();
+                    if (!augmented.enqueue(b))
+                        return;
+                    record(stats.augment, start, got_input, done, clock_type::now());
+                }
+            }
+            catch (...)
+            {
+                fail();
+            }
+        }
+
+        void pack_thread (
+        )
+        {
+            try
+            {
+                batch_type b;
+                job_type job;
+                while (true)
+                {
+                    const auto start = clock_type::now();
+                    if (!augmented.dequeue(b))
+                        return;
+                    const auto got_input = clock_type::now();
+                    pack(b.x, b.y, job);
+                    const auto done = clock_type::now();
+                    if (!packed.enqueue(job))
+                        return;
+                    record(stats.pack, start, got_input, done, clock_type::now());
+                }
+            }
+            catch (...)
+            {
+                fail();
+            }
+        }
+
+        const size_t num_samples;
+        const size_t mini_batch_size;
+        const load_function load;
+        const augment_function augment;
+        const dnn_data_loader_options options;
+
+        dlib::pipe<batch_type> loaded;
+        dlib::pipe<batch_type> augmented;
+        dlib::pipe<job_type> packed;
+
+        std::mutex order_mutex;
+        std::vector<size_t> order;
+        size_t next_pos;
+        dlib::rand rnd;
+
+        pack_function pack;
+        const void* pack_owner = nullptr;
+
+        mutable std::mutex stats_mutex;
+        dnn_data_loader_stats stats;
+        std::exception_ptr eptr;
+
+        std::vector<std::thread> threads;
+    };
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_DNn_DATA_LOADER_H_
+
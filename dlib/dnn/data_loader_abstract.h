@@ -0,0 +1,230 @@
+// Copyright (C) 2026  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#undef DLIB_DNn_DATA_LOADER_ABSTRACT_H_
+#ifdef DLIB_DNn_DATA_LOADER_ABSTRACT_H_
+
+#include "core_abstract.h"
+#include "../rand/rand_kernel_abstract.h"
+#include <chrono>
+#include <functional>
+#include <iostream>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    struct dnn_data_loader_options
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object holds the settings for a dnn_data_loader.
+        !*/
+
+        // The number of threads running each stage of the loader.
+        size_t num_load_threads = 4;
+        size_t num_augment_threads = 2;
+        size_t num_pack_threads = 1;
+
+        // The number of mini-batches each stage can get ahead of the next one.  So the
+        // default of 2 lets a mini-batch be prepared while the previous one is waiting
+        // to be trained on.
+        size_t prefetch_depth = 2;
+
+        // If true, the order of the samples is randomly shuffled at the start of each
+        // epoch.  Otherwise they are visited in order 0, 1, 2, ...
+        bool shuffle = true;
+
+        // Seeds the shuffling and the dlib::rand objects given to the augment function.
+        unsigned long seed = 0;
+    };
+
+    struct dnn_data_loader_stage_stats
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object records where the threads of one stage of a dnn_data_loader
+                have been spending their time.  The times are summed over all the threads
+                in the stage.
+        !*/
+
+        // The number of mini-batches this stage has passed on to the next stage.
+        unsigned long long num_batches = 0;
+
+        // Time spent doing the actual work of this stage.
+        std::chrono::nanoseconds busy_time;
+
+        // Time spent waiting for the previous stage to provide a mini-batch.  If this is
+        // large then the previous stage is a bottleneck.
+        std::chrono::nanoseconds input_wait_time;
+
+        // Time spent waiting for the next stage to accept a mini-batch.  If this is
+        // large then a later stage, or the training itself, is the bottleneck.
+        std::chrono::nanoseconds output_wait_time;
+    };
+
+    struct dnn_data_loader_stats
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object records the time spent in each stage of a dnn_data_loader.
+                All times start at 0.
+        !*/
+
+        dnn_data_loader_stage_stats load;
+        dnn_data_loader_stage_stats augment;
+        dnn_data_loader_stage_stats pack;
+
+        // The number of mini-batches the dnn_trainer has taken from the loader and the
+        // total time it spent waiting for them.  While it waits the devices have no work,
+        // so ideally consumer_wait_time stays close to 0.
+        unsigned long long num_batches_consumed = 0;
+        std::chrono::nanoseconds consumer_wait_time;
+    };
+
+    std::ostream& operator<< (
+        std::ostream& out,
+        const dnn_data_loader_stats& item
+    );
+    /*!
+        ensures
+            - prints a human readable summary of item to out.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename net_type
+        >
+    class dnn_data_loader
+    {
+        /*!
+            REQUIREMENTS ON net_type
+                - net_type is an add_loss_layer object.
+
+            WHAT THIS OBJECT REPRESENTS
+                This object feeds training data to a dnn_trainer through a pipeline of
+                worker threads, so that loading, augmenting, and converting the data into
+                tensors all happen in parallel with, and ahead of, the training itself.
+                The stages are:
+                    - load: calls the user supplied load function for each sample in a
+                      mini-batch.  This is where images get read from disk and decoded.
+                    - augment: calls the user supplied augment function on each sample,
+                      for things like random cropping.  This stage is skipped if no
+                      augment function is given.
+                    - pack: converts a mini-batch into tensors with the network's input
+                      layer and splits it across the trainer's devices, just as
+                      dnn_trainer::train_one_step() would.
+                Each stage hands mini-batches to the next through a queue holding at most
+                get_options().prefetch_depth of them, so memory use is bounded.  The
+                samples and tensors of used mini-batches are recycled rather than
+                reallocated.
+
+                The load and augment threads start running as soon as the loader is
+                constructed.  The pack threads start the first time the loader is given to
+                dnn_trainer::train() or dnn_trainer::train_one_step().
+
+                The samples are split into epochs of size() samples.  Each epoch visits
+                every sample exactly once, in an order that is shuffled at the start of
+                each epoch if get_options().shuffle is true.  Since several threads work
+                on each stage, mini-batches can reach the trainer slightly out of order.
+        !*/
+
+    public:
+
+        typedef typename net_type::input_type input_type;
+        typedef typename net_type::training_label_type training_label_type;
+        typedef std::function<void(size_t, input_type&, training_label_type&)> load_function;
+        typedef std::function<void(input_type&, training_label_type&, dlib::rand&)> augment_function;
+
+        dnn_data_loader(
+            size_t num_samples,
+            size_t mini_batch_size,
+            load_function load,
+            augment_function augment = augment_function(),
+            const dnn_data_loader_options& options = dnn_data_loader_options()
+        );
+        /*!
+            requires
+                - num_samples > 0
+                - mini_batch_size > 0
+                - load is a valid function.  load(i, x, y) must set x and y to the i-th
+                  training sample and its label, for all 0 <= i < num_samples.  It is
+                  called from several threads at once so it must be thread safe.
+                - augment is either empty or a function that randomly modifies the sample
+                  and label it is given, using the dlib::rand object for any random
+                  numbers it needs.  It is called from several threads at once, each with
+                  its own dlib::rand, so it must be thread safe.
+                - options.num_load_threads > 0
+                - options.num_pack_threads > 0
+                - options.prefetch_depth > 0
+                - if (augment) then options.num_augment_threads > 0
+            ensures
+                - #size() == num_samples
+                - #get_mini_batch_size() == mini_batch_size
+                - #get_options() == options
+                - Starts the load and augment threads.
+        !*/
+
+        dnn_data_loader(const dnn_data_loader&) = delete;
+        dnn_data_loader& operator=(const dnn_data_loader&) = delete;
+
+        ~dnn_data_loader(
+        );
+        /*!
+            ensures
+                - Stops all the threads.  Any mini-batches still in the queues are thrown
+                  away.
+        !*/
+
+        size_t size (
+        ) const;
+        /*!
+            ensures
+                - returns the number of samples in one epoch.
+        !*/
+
+        size_t get_mini_batch_size (
+        ) const;
+        /*!
+            ensures
+                - returns the number of samples in each mini-batch.  The last mini-batch
+                  of an epoch is smaller if size() isn't a multiple of this number.
+        !*/
+
+        size_t batches_per_epoch (
+        ) const;
+        /*!
+            ensures
+                - returns the number of mini-batches in one epoch.  That is, size()
+                  divided by get_mini_batch_size(), rounded up.
+        !*/
+
+        const dnn_data_loader_options& get_options (
+        ) const;
+        /*!
+            ensures
+                - returns the options this loader was constructed with.
+        !*/
+
+        dnn_data_loader_stats get_stats (
+        ) const;
+        /*!
+            ensures
+                - returns statistics on where each stage of the loader has been spending
+                  its time since construction or the last call to clear_stats().
+        !*/
+
+        void clear_stats (
+        );
+        /*!
+            ensures
+                - Resets all the counts and times in get_stats() to 0.
+        !*/
+    };
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_DNn_DATA_LOADER_ABSTRACT_H_
@@ -155,6 +155,8 @@ namespace dlib
             host_current = true;
             device_current = true;
             device_in_use = false;
+            is_shared = false;
+            is_read_only = false;
             data_host.reset();
             data_device.reset();
         }
@@ -172,6 +174,8 @@ namespace dlib
             host_current = true;
             device_current = true;
             device_in_use = false;
+            is_shared = false;
+            is_read_only = false;
 
             try
             {
@@ -219,6 +223,57 @@ namespace dlib
         }
     }
 
+// ----------------------------------------------------------------------------------------
+
+    void gpu_data::
+    set_read_only_memory(
+        std::shared_ptr<const float> data,
+        size_t new_size
+    )
+    {
+        set_size(0);
+        if (new_size == 0)
+            return;
+
+        try
+        {
+            CHECK_CUDA(cudaGetDevice(&the_device_id));
+
+            // Only the device side needs memory of its own.  It gets filled from the host
+            // memory we were given the first time someone asks for device().
+            void* ptr;
+            CHECK_CUDA(cudaMalloc(&ptr, new_size*sizeof(float)));
+            data_device.reset((float*)ptr, [](float* ptr){
+                auto err = cudaFree(ptr);
+                if(err!=cudaSuccess)
+                    std::cerr << "cudaFree() failed. Reason: " << cudaGetErrorString(err) << std::endl;
+            });
+
+            if (!cuda_stream)
+            {
+                cudaStream_t cstream;
+                CHECK_CUDA(cudaStreamCreateWithFlags(&cstream, cudaStreamNonBlocking));
+                cuda_stream.reset(cstream, [](void* ptr){
+                    auto err = cudaStreamDestroy((cudaStream_t)ptr);
+                    if(err!=cudaSuccess)
+                        std::cerr << "cudaStreamDestroy() failed. Reason: " << cudaGetErrorString(err) << std::endl;
+                });
+            }
+        }
+        catch(...)
+        {
+            set_size(0);
+            throw;
+        }
+
+        data_size = new_size;
+        host_current = true;
+        device_current = false;
+        is_shared = true;
+        is_read_only = true;
+        data_host = std::const_pointer_cast<float>(data);
+    }
+
 // ----------------------------------------------------------------------------------------
 }
 
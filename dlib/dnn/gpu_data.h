@@ -14,6 +14,13 @@ namespace dlib
 
 // ----------------------------------------------------------------------------------------
 
+    class gpu_data;
+#ifdef DLIB_USE_CUDA
+    void memcpy (gpu_data& dest, const gpu_data& src);
+#else
+    inline void memcpy (gpu_data& dest, const gpu_data& src);
+#endif
+
     class gpu_data 
     {
         /*!
@@ -36,11 +43,27 @@ namespace dlib
                   executed.  So if device_in_use==true then there might be a CUDA kernel
                   executing that is using the device memory block contained in this object.
 
+                - if (is_shared) then
+                    - data_host and data_device might also be referenced by other gpu_data
+                      objects (see share_data_with()).  So the memory must not be written
+                      until make_private_copy() has been called.
+                    - Both host_current and device_current were true when the memory
+                      started being shared and, since nobody writes to it, they are
+                      still accurate.
+
+                - if (is_read_only) then
+                    - data_host points to memory we don't own and can't write to (e.g. a
+                      read-only memory mapped file, see set_read_only_memory()).  So
+                      is_shared is also true and make_private_copy() must copy it even
+                      when no other gpu_data object references it.
+                    - The device copy may not have been made yet.  That's fine since the
+                      const device() only writes to data_device, which we do own.
+
         !*/
     public:
 
         gpu_data(
-        ) : data_size(0), host_current(true), device_current(true),have_active_transfer(false),device_in_use(false), the_device_id(0)
+        ) : data_size(0), host_current(true), device_current(true),have_active_transfer(false),device_in_use(false), is_shared(false), is_read_only(false), the_device_id(0)
         {
         }
 
@@ -57,6 +80,7 @@ namespace dlib
 #ifdef DLIB_USE_CUDA
         void async_copy_to_device() const; 
         void set_size(size_t new_size);
+        void set_read_only_memory(std::shared_ptr<const float> data, size_t new_size);
 #else
         // Note that calls to host() or device() will block until any async transfers are complete.
         void async_copy_to_device() const{}
@@ -69,6 +93,8 @@ namespace dlib
                 host_current = true;
                 device_current = true;
                 device_in_use = false;
+                is_shared = false;
+                is_read_only = false;
                 data_host.reset();
                 data_device.reset();
             }
@@ -78,10 +104,26 @@ namespace dlib
                 host_current = true;
                 device_current = true;
                 device_in_use = false;
+                is_shared = false;
+                is_read_only = false;
                 data_host.reset(new float[new_size], std::default_delete<float[]>());
                 data_device.reset();
             }
         }
+
+        void set_read_only_memory(
+            std::shared_ptr<const float> data,
+            size_t new_size
+        )
+        {
+            set_size(0);
+            if (new_size == 0)
+                return;
+            data_size = new_size;
+            is_shared = true;
+            is_read_only = true;
+            data_host = std::const_pointer_cast<float>(data);
+        }
 #endif
 
         const float* host() const 
@@ -92,6 +134,7 @@ namespace dlib
 
         float* host() 
         {
+            make_private_copy(true);
             copy_to_host();
             device_current = false;
             return data_host.get(); 
@@ -99,6 +142,7 @@ namespace dlib
 
         float* host_write_only() 
         {
+            make_private_copy(false);
             host_current = true;
             device_current = false;
             return data_host.get(); 
@@ -119,6 +163,7 @@ namespace dlib
 #ifndef DLIB_USE_CUDA
             DLIB_CASSERT(false, "CUDA NOT ENABLED");
 #endif
+            make_private_copy(true);
             copy_to_device();
             host_current = false;
             device_in_use = true;
@@ -130,6 +175,7 @@ namespace dlib
 #ifndef DLIB_USE_CUDA
             DLIB_CASSERT(false, "CUDA NOT ENABLED");
 #endif
+            make_private_copy(false);
             wait_for_transfer_to_finish();
             host_current = false;
             device_current = true;
@@ -145,12 +191,49 @@ namespace dlib
 
         size_t size() const { return data_size; }
 
+        void share_data_with (
+            const gpu_data& item
+        )
+        {
+            if (this == &item)
+                return;
+
+            // Bring both the host and device copies up to date now.  That way nobody ever
+            // has to write to the shared memory just to read it.
+            item.host();
+#ifdef DLIB_USE_CUDA
+            if (item.size() != 0)
+                item.device();
+#endif
+            item.is_shared = true;
+
+            data_size = item.data_size;
+            host_current = item.host_current;
+            device_current = item.device_current;
+            have_active_transfer = item.have_active_transfer;
+            device_in_use = item.device_in_use;
+            is_shared = true;
+            is_read_only = item.is_read_only;
+            data_host = item.data_host;
+            data_device = item.data_device;
+            cuda_stream = item.cuda_stream;
+            the_device_id = item.the_device_id;
+        }
+
+        bool shares_data (
+        ) const { return is_shared && data_host.use_count() > 1; }
+
+        bool has_read_only_memory (
+        ) const { return is_read_only; }
+
         void swap (gpu_data& item)
         {
             std::swap(data_size, item.data_size);
             std::swap(host_current, item.host_current);
             std::swap(device_current, item.device_current);
             std::swap(have_active_transfer, item.have_active_transfer);
+            std::swap(is_shared, item.is_shared);
+            std::swap(is_read_only, item.is_read_only);
             std::swap(data_host, item.data_host);
             std::swap(data_device, item.data_device);
             std::swap(cuda_stream, item.cuda_stream);
@@ -159,6 +242,27 @@ namespace dlib
 
     private:
 
+        void make_private_copy (
+            bool keep_contents
+        )
+        {
+            if (!is_shared)
+                return;
+            is_shared = false;
+            // If every other object has let go of the memory it's ours again.  Unless we
+            // never owned it in the first place.
+            const bool read_only = is_read_only;
+            is_read_only = false;
+            if (!read_only && data_host.use_count() <= 1)
+                return;
+
+            gpu_data temp;
+            temp.set_size(data_size);
+            if (keep_contents)
+                memcpy(temp, *this);
+            swap(temp);
+        }
+
 #ifdef DLIB_USE_CUDA
         void copy_to_device() const;
         void copy_to_host() const;
@@ -175,6 +279,8 @@ namespace dlib
         mutable bool device_current;
         mutable bool have_active_transfer;
         mutable bool device_in_use;
+        mutable bool is_shared;
+        bool is_read_only;
 
         std::shared_ptr<float> data_host;
         std::shared_ptr<float> data_device;
@@ -32,7 +32,9 @@ namespace dlib
 
             THREAD SAFETY
                 Instances of this object are not thread-safe.  So don't touch one from
-                multiple threads at the same time.
+                multiple threads at the same time.  However, different gpu_data objects
+                that share their memory (see share_data_with()) can be used from
+                different threads at the same time.
         !*/
     public:
 
@@ -201,6 +203,66 @@ namespace dlib
                 - returns the number of floats contained in this object.
         !*/
 
+        void share_data_with (
+            const gpu_data& item
+        );
+        /*!
+            ensures
+                - Makes *this refer to the same memory as item rather than copying it.
+                  So afterwards:
+                    - #size() == item.size()
+                    - #host() == item.host()
+                    - #shares_data() == true
+                    - #item.shares_data() == true
+                - The shared memory is treated as read-only.  Calling a const accessor on
+                  either object just reads the shared memory.  However, the first time a
+                  non-const accessor, i.e. host(), host_write_only(), device(), or
+                  device_write_only(), is called on an object that shares its memory, the
+                  object first switches to its own private copy of the data.  So writing
+                  to one of the objects never changes the values seen by the others.
+        !*/
+
+        bool shares_data (
+        ) const;
+        /*!
+            ensures
+                - returns true if the memory of this object is also referenced by another
+                  gpu_data object because of a call to share_data_with().
+        !*/
+
+        void set_read_only_memory (
+            std::shared_ptr<const float> data,
+            size_t new_size
+        );
+        /*!
+            requires
+                - if (new_size != 0) then
+                    - data points to new_size floats that remain valid for as long as
+                      any copy of data exists.
+            ensures
+                - Makes *this use the memory pointed to by data instead of allocating its
+                  own host memory.  The memory isn't copied or written to, so it can be
+                  something like a read-only memory mapped file.  So afterwards:
+                    - #size() == new_size
+                    - #host() == data.get()
+                    - #has_read_only_memory() == (new_size != 0)
+                - Like memory shared via share_data_with(), the memory is treated as
+                  read-only.  Const accessors just read it, while the first call to a
+                  non-const accessor (or set_size() with a different size) switches *this
+                  to its own private copy of the data.
+                - If DLIB_USE_CUDA is #defined then device memory is allocated but the data
+                  isn't copied to the device until device() is first called.
+        !*/
+
+        bool has_read_only_memory (
+        ) const;
+        /*!
+            ensures
+                - returns true if *this still refers to the memory given to
+                  set_read_only_memory() (or shares it with an object that does), i.e. no
+                  non-const accessor has been called since.
+        !*/
+
         void swap (
             gpu_data& item
         );
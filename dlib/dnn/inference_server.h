@@ -0,0 +1,308 @@
+// Copyright (C) 2026  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_DNn_INFERENCE_SERVER_H_
+#define DLIB_DNn_INFERENCE_SERVER_H_
+
+#include "inference_server_abstract.h"
+#include "core.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    struct dnn_inference_server_stats
+    {
+        unsigned long long num_requests = 0;
+        unsigned long long num_batches = 0;
+        std::vector<unsigned long long> batch_size_histogram;
+        std::vector<unsigned long long> queue_depth_histogram;
+    };
+
+    inline std::ostream& operator<< (std::ostream& out, const dnn_inference_server_stats& item)
+    {
+        out << "requests: " << item.num_requests << "  batches: " << item.num_batches;
+        if (item.num_batches != 0)
+            out << "  average batch size: " << (double)item.num_requests/item.num_batches;
+        out << "\nbatch size histogram:";
+        for (size_t i = 1; i < item.batch_size_histogram.size(); ++i)
+        {
+            if (item.batch_size_histogram[i] != 0)
+                out << " " << i << ":" << item.batch_size_histogram[i];
+        }
+        out << "\nqueue depth histogram:";
+        for (size_t i = 0; i < item.queue_depth_histogram.size(); ++i)
+        {
+            if (item.queue_depth_histogram[i] != 0)
+            {
+                out << " " << i;
+                if (i+1 == item.queue_depth_histogram.size())
+                    out << "+";
+                out << ":" << item.queue_depth_histogram[i];
+            }
+        }
+        out << "\n";
+        return out;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename net_type
+        >
+    class dnn_inference_server
+    {
+    public:
+
+        typedef typename net_type::input_type input_type;
+        typedef typename net_type::output_label_type output_label_type;
+
+        explicit dnn_inference_server(
+            const net_type& net,
+            size_t num_workers = 1,
+            size_t max_batch_size = 32,
+            std::chrono::microseconds max_batch_delay = std::chrono::milliseconds(2)
+        ) :
+            max_batch_size(max_batch_size),
+            max_batch_delay(max_batch_delay)
+        {
+            DLIB_CASSERT(num_workers > 0);
+            DLIB_CASSERT(max_batch_size > 0);
+            DLIB_CASSERT(max_batch_delay.count() >= 0);
+            reset_stats();
+
+            nets.reserve(num_workers);
+            for (size_t i = 0; i < num_workers; ++i)
+            {
+                // The workers only read the parameters so they can all share one copy.
+                impl::tensor_data_sharing_scope share_tensors;
+                nets.emplace_back(new net_type(net));
+                enable_inference_mode(*nets.back());
+            }
+            workers.reserve(num_workers);
+            for (size_t i = 0; i < num_workers; ++i)
+                workers.emplace_back([this,i](){ this->worker(*nets[i]); });
+        }
+
+        dnn_inference_server(const dnn_inference_server&) = delete;
+        dnn_inference_server& operator=(const dnn_inference_server&) = delete;
+
+        ~dnn_inference_server(
+        )
+        {
+            {
+                std::lock_guard<std::mutex> lock(m);
+                stopping = true;
+            }
+            work_ready.notify_all();
+            for (auto& t : workers)
+                t.join();
+        }
+
+        std::future<output_label_type> operator() (
+            const input_type& x
+        )
+        {
+            return enqueue(input_type(x));
+        }
+
+        std::future<output_label_type> operator() (
+            input_type&& x
+        )
+        {
+            return enqueue(std::move(x));
+        }
+
+        size_t num_workers (
+        ) const { return workers.size(); }
+
+        size_t get_max_batch_size (
+        ) const
+        {
+            std::lock_guard<std::mutex> lock(m);
+            return max_batch_size;
+        }
+
+        void set_max_batch_size (
+            size_t size
+        )
+        {
+            DLIB_CASSERT(size > 0);
+            {
+                std::lock_guard<std::mutex> lock(m);
+                max_batch_size = size;
+                stats.batch_size_histogram.resize(std::max(stats.batch_size_histogram.size(), size+1), 0);
+            }
+            work_ready.notify_all();
+        }
+
+        std::chrono::microseconds get_max_batch_delay (
+        ) const
+        {
+            std::lock_guard<std::mutex> lock(m);
+            return max_batch_delay;
+        }
+
+        void set_max_batch_delay (
+            std::chrono::microseconds delay
+        )
+        {
+            DLIB_CASSERT(delay.count() >= 0);
+            {
+                std::lock_guard<std::mutex> lock(m);
+                max_batch_delay = delay;
+            }
+            work_ready.notify_all();
+        }
+
+        size_t queue_depth (
+        ) const
+        {
+            std::lock_guard<std::mutex> lock(m);
+            return requests.size();
+        }
+
+        dnn_inference_server_stats get_stats (
+        ) const
+        {
+            std::lock_guard<std::mutex> lock(m);
+            return stats;
+        }
+
+        void clear_stats (
+        )
+        {
+            std::lock_guard<std::mutex> lock(m);
+            reset_stats();
+        }
+
+    private:
+
+        typedef std::chrono::steady_clock clock_type;
+
+        struct request
+        {
+            input_type x;
+            std::promise<output_label_type> result;
+            clock_type::time_point arrival;
+        };
+
+        // Requests that arrive when there are already this many or more waiting all land
+        // in the last bin of the queue depth histogram.
+        static size_t max_recorded_queue_depth() { return 256; }
+
+        void reset_stats (
+        )
+        {
+            stats = dnn_inference_server_stats();
+            stats.batch_size_histogram.assign(max_batch_size+1, 0);
+            stats.queue_depth_histogram.assign(max_recorded_queue_depth()+1, 0);
+        }
+
+        std::future<output_label_type> enqueue (
+            input_type&& x
+        )
+        {
+            request r;
+            r.x = std::move(x);
+            r.arrival = clock_type::now();
+            auto f = r.result.get_future();
+            {
+                std::lock_guard<std::mutex> lock(m);
+                DLIB_CASSERT(!stopping);
+                ++stats.num_requests;
+                ++stats.queue_depth_histogram[std::min(requests.size(), max_recorded_queue_depth())];
+                requests.push_back(std::move(r));
+            }
+            work_ready.notify_one();
+            return f;
+        }
+
+        void worker (
+            net_type& net
+        )
+        {
+            std::vector<request> batch;
+            std::vector<input_type> inputs;
+            std::vector<output_label_type> outputs;
+            while (true)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(m);
+                    work_ready.wait(lock, [this](){ return stopping || !requests.empty(); });
+                    if (requests.empty())
+                        return;
+
+                    // Hold off until we have a full batch or the oldest request has
+                    // waited as long as we allow.  When shutting down we just flush
+                    // whatever is left.
+                    while (!stopping && !requests.empty() && requests.size() < max_batch_size)
+                    {
+                        const auto deadline = requests.front().arrival + max_batch_delay;
+                        if (work_ready.wait_until(lock, deadline) == std::cv_status::timeout)
+                            break;
+                    }
+                    // Another worker might have taken everything while we were waiting.
+                    if (requests.empty())
+                        continue;
+
+                    const size_t batch_size = std::min(requests.size(), max_batch_size);
+                    batch.clear();
+                    for (size_t i = 0; i < batch_size; ++i)
+                    {
+                        batch.push_back(std::move(requests.front()));
+                        requests.pop_front();
+                    }
+                    ++stats.num_batches;
+                    ++stats.batch_size_histogram[batch_size];
+                }
+                // There might be enough left for another worker to get going.
+                work_ready.notify_one();
+
+                inputs.clear();
+                for (auto& r : batch)
+                    inputs.push_back(std::move(r.x));
+                try
+                {
+                    outputs.resize(inputs.size());
+                    net(inputs.begin(), inputs.end(), outputs.begin());
+                }
+                catch (...)
+                {
+                    for (auto& r : batch)
+                        r.result.set_exception(std::current_exception());
+                    continue;
+                }
+                for (size_t i = 0; i < batch.size(); ++i)
+                    batch[i].result.set_value(std::move(outputs[i]));
+            }
+        }
+
+        std::vector<std::unique_ptr<net_type>> nets;
+        std::vector<std::thread> workers;
+
+        mutable std::mutex m;
+        std::condition_variable work_ready;
+        std::deque<request> requests;
+        bool stopping = false;
+        size_t max_batch_size;
+        std::chrono::microseconds max_batch_delay;
+        dnn_inference_server_stats stats;
+    };
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_DNn_INFERENCE_SERVER_H_
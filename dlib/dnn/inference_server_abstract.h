@@ -0,0 +1,216 @@
+// Copyright (C) 2026  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#undef DLIB_DNn_INFERENCE_SERVER_ABSTRACT_H_
+#ifdef DLIB_DNn_INFERENCE_SERVER_ABSTRACT_H_
+
+#include "core_abstract.h"
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <vector>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    struct dnn_inference_server_stats
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object records how a dnn_inference_server has been batching the
+                requests given to it.
+        !*/
+
+        // The number of requests submitted and the number of batches they were run in.
+        unsigned long long num_requests = 0;
+        unsigned long long num_batches = 0;
+
+        // batch_size_histogram[i] == the number of batches that contained i requests.
+        std::vector<unsigned long long> batch_size_histogram;
+
+        // queue_depth_histogram[i] == the number of requests that found i other requests
+        // waiting in the queue when they were submitted.  The last bin also counts all
+        // the requests that found more than queue_depth_histogram.size()-1 requests
+        // waiting.
+        std::vector<unsigned long long> queue_depth_histogram;
+    };
+
+    std::ostream& operator<< (
+        std::ostream& out,
+        const dnn_inference_server_stats& item
+    );
+    /*!
+        ensures
+            - prints a human readable summary of item to out.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename net_type
+        >
+    class dnn_inference_server
+    {
+        /*!
+            REQUIREMENTS ON net_type
+                - net_type is an add_loss_layer object.
+
+            WHAT THIS OBJECT REPRESENTS
+                This object lets many threads run a network at the same time while still
+                getting the efficiency of running the network on large mini-batches.
+                Each call to operator() just adds the input to a queue and returns a
+                std::future for the network's output.  A set of worker threads, each with
+                its own copy of the network in inference mode (see
+                enable_inference_mode()), take requests off the queue in groups of up to
+                get_max_batch_size() and run each group through their network as a single
+                mini-batch.
+
+                A worker that finds fewer than get_max_batch_size() requests waiting will
+                wait for more to arrive, but never longer than get_max_batch_delay() past
+                the time the oldest waiting request was submitted.  So
+                get_max_batch_delay() bounds how much latency batching adds to a request,
+                and under heavy load the batches fill up and throughput approaches that of
+                running the network on full mini-batches.
+
+            THREAD SAFETY
+                All the member functions of this object can be called concurrently from
+                any number of threads.
+        !*/
+
+    public:
+
+        typedef typename net_type::input_type input_type;
+        typedef typename net_type::output_label_type output_label_type;
+
+        explicit dnn_inference_server(
+            const net_type& net,
+            size_t num_workers = 1,
+            size_t max_batch_size = 32,
+            std::chrono::microseconds max_batch_delay = std::chrono::milliseconds(2)
+        );
+        /*!
+            requires
+                - num_workers > 0
+                - max_batch_size > 0
+                - max_batch_delay.count() >= 0
+            ensures
+                - #num_workers() == num_workers
+                - #get_max_batch_size() == max_batch_size
+                - #get_max_batch_delay() == max_batch_delay
+                - #queue_depth() == 0
+                - Each of the num_workers worker threads gets its own copy of net, so
+                  net can be modified or destroyed once the constructor has returned.
+                  The copies are made like copy_net_sharing_weights() does, so the layer
+                  parameters are stored only once no matter how many workers there are.
+        !*/
+
+        dnn_inference_server(const dnn_inference_server&) = delete;
+        dnn_inference_server& operator=(const dnn_inference_server&) = delete;
+
+        ~dnn_inference_server(
+        );
+        /*!
+            ensures
+                - Finishes all the requests still in the queue, so every future returned
+                  by operator() becomes ready, and then stops the worker threads.
+        !*/
+
+        std::future<output_label_type> operator() (
+            const input_type& x
+        );
+        /*!
+            ensures
+                - Adds a copy of x to the queue of inputs to run through the network and
+                  returns a future that will hold the network's output for x.  That is,
+                  the future will hold what net(x) would have returned, where net is the
+                  network given to the constructor.
+                - If running the network throws an exception then the futures of all the
+                  requests in the same batch rethrow that exception from their get().
+        !*/
+
+        std::future<output_label_type> operator() (
+            input_type&& x
+        );
+        /*!
+            ensures
+                - Same as the above operator(), except x is moved into the queue rather
+                  than copied.
+        !*/
+
+        size_t num_workers (
+        ) const;
+        /*!
+            ensures
+                - returns the number of worker threads, and therefore the number of copies
+                  of the network, this object is using.
+        !*/
+
+        size_t get_max_batch_size (
+        ) const;
+        /*!
+            ensures
+                - returns the largest number of requests that will be run through the
+                  network together.
+        !*/
+
+        void set_max_batch_size (
+            size_t size
+        );
+        /*!
+            requires
+                - size > 0
+            ensures
+                - #get_max_batch_size() == size
+        !*/
+
+        std::chrono::microseconds get_max_batch_delay (
+        ) const;
+        /*!
+            ensures
+                - returns the longest a request will wait in the queue for other requests
+                  to batch it with, once a worker is free to run it.
+        !*/
+
+        void set_max_batch_delay (
+            std::chrono::microseconds delay
+        );
+        /*!
+            requires
+                - delay.count() >= 0
+            ensures
+                - #get_max_batch_delay() == delay
+                - A delay of 0 means requests are never held back.  Workers then just run
+                  whatever is in the queue when they become free.
+        !*/
+
+        size_t queue_depth (
+        ) const;
+        /*!
+            ensures
+                - returns the number of requests that have been submitted but not yet
+                  picked up by a worker.
+        !*/
+
+        dnn_inference_server_stats get_stats (
+        ) const;
+        /*!
+            ensures
+                - returns statistics about all the requests submitted since this object was
+                  constructed or clear_stats() was last called.
+                - #get_stats().batch_size_histogram.size() > get_max_batch_size()
+        !*/
+
+        void clear_stats (
+        );
+        /*!
+            ensures
+                - Resets all the counts in get_stats() to 0.
+        !*/
+    };
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_DNn_INFERENCE_SERVER_ABSTRACT_H_
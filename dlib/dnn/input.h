@@ -11,6 +11,7 @@
 #include <sstream>
 #include <array>
 #include "tensor_tools.h"
+#include "../threads/parallel_for_extension.h"
 
 
 namespace dlib
@@ -26,11 +27,159 @@ namespace dlib
             "dlib::matrix and dlib::array2d objects."); 
     };
 
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        template <typename pixel_type>
+        struct interleaved_rgb_layout
+        {
+            // Pixels that aren't interleaved 8 bit red, green, and blue channels are
+            // converted to rgb_pixel one at a time.
+            const static bool is_interleaved = false;
+        };
+
+        template <>
+        struct interleaved_rgb_layout<rgb_pixel>
+        {
+            const static bool is_interleaved = true;
+            const static long size = 3, red = 0, green = 1, blue = 2;
+        };
+
+        template <>
+        struct interleaved_rgb_layout<bgr_pixel>
+        {
+            const static bool is_interleaved = true;
+            const static long size = 3, red = 2, green = 1, blue = 0;
+        };
+
+        template <>
+        struct interleaved_rgb_layout<rgb_alpha_pixel>
+        {
+            const static bool is_interleaved = true;
+            const static long size = 4, red = 0, green = 1, blue = 2;
+        };
+
+        template <typename image_type>
+        typename enable_if_c<interleaved_rgb_layout<typename image_traits<image_type>::pixel_type>::is_interleaved>::type
+        rgb_image_rows_to_planar (
+            const image_type& img,
+            long row_begin,
+            long row_end,
+            float* dest,
+            long dest_row_stride,
+            long dest_channel_stride,
+            float avg_red,
+            float avg_green,
+            float avg_blue
+        )
+        {
+            typedef interleaved_rgb_layout<typename image_traits<image_type>::pixel_type> layout;
+            const auto src = static_cast<const unsigned char*>(image_data(img)) + row_begin*width_step(img);
+            cpu::interleaved_rgb_to_planar(dest, dest_row_stride, dest_channel_stride,
+                src, width_step(img), layout::size, layout::red, layout::green, layout::blue,
+                row_end-row_begin, num_columns(img), avg_red, avg_green, avg_blue);
+        }
+
+        template <typename image_type>
+        typename disable_if_c<interleaved_rgb_layout<typename image_traits<image_type>::pixel_type>::is_interleaved>::type
+        rgb_image_rows_to_planar (
+            const image_type& img_,
+            long row_begin,
+            long row_end,
+            float* dest,
+            long dest_row_stride,
+            long dest_channel_stride,
+            float avg_red,
+            float avg_green,
+            float avg_blue
+        )
+        {
+            const_image_view<image_type> img(img_);
+            for (long r = row_begin; r < row_end; ++r)
+            {
+                for (long c = 0; c < img.nc(); ++c)
+                {
+                    rgb_pixel temp;
+                    assign_pixel(temp, img[r][c]);
+                    auto p = dest + c;
+                    *p = (temp.red-avg_red)/256.0;
+                    p += dest_channel_stride;
+                    *p = (temp.green-avg_green)/256.0;
+                    p += dest_channel_stride;
+                    *p = (temp.blue-avg_blue)/256.0;
+                }
+                dest += dest_row_stride;
+            }
+        }
+
+        template <typename forward_iterator>
+        void rgb_images_to_tensor (
+            forward_iterator ibegin,
+            forward_iterator iend,
+            float* data,
+            long data_nr,
+            long data_nc,
+            long top,
+            long left,
+            float avg_red,
+            float avg_green,
+            float avg_blue
+        )
+        /*!
+            requires
+                - data points to a tensor with std::distance(ibegin,iend) samples, 3
+                  channels, data_nr rows and data_nc columns.
+                - All the images are the same size and fit in the tensor at (top,left).
+            ensures
+                - Copies each image into its sample of the tensor, one color channel per
+                  plane, with the average color subtracted and scaled by 1/256.
+        !*/
+        {
+            typedef typename std::iterator_traits<forward_iterator>::value_type image_type;
+            std::vector<const image_type*> images;
+            for (auto i = ibegin; i != iend; ++i)
+                images.push_back(&*i);
+            if (images.size() == 0)
+                return;
+
+            const long nr = num_rows(*images[0]);
+            const long nc = num_columns(*images[0]);
+            const long plane_size = data_nr*data_nc;
+            const long rows_per_band = 32;
+            const long bands = (nr+rows_per_band-1)/rows_per_band;
+            auto convert = [&](long i)
+            {
+                const long n = i/bands;
+                const long row_begin = (i%bands)*rows_per_band;
+                const long row_end = std::min(row_begin+rows_per_band, nr);
+                rgb_image_rows_to_planar(*images[n], row_begin, row_end,
+                    data + n*3*plane_size + (top+row_begin)*data_nc + left,
+                    data_nc, plane_size, avg_red, avg_green, avg_blue);
+            };
+
+            // Small inputs aren't worth handing out to other threads.
+            const long num_bands = images.size()*bands;
+            if (images.size()*nr*nc < 256*256)
+            {
+                for (long i = 0; i < num_bands; ++i)
+                    convert(i);
+            }
+            else
+            {
+                parallel_for(0, num_bands, convert);
+            }
+        }
+    }
+
 // ----------------------------------------------------------------------------------------
 
     template <size_t NR, size_t NC=NR>
     class input_rgb_image_sized;
 
+    template <typename image_type>
+    class input_generic_rgb_image;
+
     class input_rgb_image
     {
     public:
@@ -56,6 +205,11 @@ namespace dlib
             const input_rgb_image_sized<NR,NC>& item
         ); 
 
+        template <typename image_type>
+        inline input_rgb_image (
+            const input_generic_rgb_image<image_type>& item
+        ); 
+
         float get_avg_red()   const { return avg_red; }
         float get_avg_green() const { return avg_green; }
         float get_avg_blue()  const { return avg_blue; }
@@ -90,29 +244,7 @@ namespace dlib
             
             // initialize data to the right size to contain the stuff in the iterator range.
             data.set_size(std::distance(ibegin,iend), 3, nr, nc);
-
-
-            const size_t offset = nr*nc;
-            auto ptr = data.host();
-            for (auto i = ibegin; i != iend; ++i)
-            {
-                for (long r = 0; r < nr; ++r)
-                {
-                    for (long c = 0; c < nc; ++c)
-                    {
-                        rgb_pixel temp = (*i)(r,c);
-                        auto p = ptr++;
-                        *p = (temp.red-avg_red)/256.0; 
-                        p += offset;
-                        *p = (temp.green-avg_green)/256.0; 
-                        p += offset;
-                        *p = (temp.blue-avg_blue)/256.0; 
-                        p += offset;
-                    }
-                }
-                ptr += offset*(data.k()-1);
-            }
-
+            impl::rgb_images_to_tensor(ibegin, iend, data.host_write_only(), nr, nc, 0, 0, avg_red, avg_green, avg_blue);
         }
 
         friend void serialize(const input_rgb_image& item, std::ostream& out)
@@ -127,7 +259,7 @@ namespace dlib
         {
             std::string version;
             deserialize(version, in);
-            if (version != "input_rgb_image" && version != "input_rgb_image_sized")
+            if (version != "input_rgb_image" && version != "input_rgb_image_sized" && version != "input_generic_rgb_image")
                 throw serialization_error("Unexpected version found while deserializing dlib::input_rgb_image.");
             deserialize(item.avg_red, in);
             deserialize(item.avg_green, in);
@@ -219,29 +351,7 @@ namespace dlib
             
             // initialize data to the right size to contain the stuff in the iterator range.
             data.set_size(std::distance(ibegin,iend), 3, NR, NC);
-
-
-            const size_t offset = NR*NC;
-            auto ptr = data.host();
-            for (auto i = ibegin; i != iend; ++i)
-            {
-                for (size_t r = 0; r < NR; ++r)
-                {
-                    for (size_t c = 0; c < NC; ++c)
-                    {
-                        rgb_pixel temp = (*i)(r,c);
-                        auto p = ptr++;
-                        *p = (temp.red-avg_red)/256.0; 
-                        p += offset;
-                        *p = (temp.green-avg_green)/256.0; 
-                        p += offset;
-                        *p = (temp.blue-avg_blue)/256.0; 
-                        p += offset;
-                    }
-                }
-                ptr += offset*(data.k()-1);
-            }
-
+            impl::rgb_images_to_tensor(ibegin, iend, data.host_write_only(), NR, NC, 0, 0, avg_red, avg_green, avg_blue);
         }
 
         friend void serialize(const input_rgb_image_sized& item, std::ostream& out)
@@ -303,6 +413,135 @@ namespace dlib
         avg_blue(item.get_avg_blue())
     {}
 
+// ----------------------------------------------------------------------------------------
+
+    template <typename image_type>
+    class input_generic_rgb_image
+    {
+    public:
+        typedef image_type input_type;
+
+        input_generic_rgb_image (
+        ) : 
+            avg_red(122.782), 
+            avg_green(117.001),
+            avg_blue(104.298) 
+        {
+        }
+
+        input_generic_rgb_image (
+            float avg_red_,
+            float avg_green_,
+            float avg_blue_
+        ) : avg_red(avg_red_), avg_green(avg_green_), avg_blue(avg_blue_) 
+        {}
+
+        input_generic_rgb_image (
+            const input_rgb_image& item
+        ) : avg_red(item.get_avg_red()),
+            avg_green(item.get_avg_green()),
+            avg_blue(item.get_avg_blue())
+        {}
+
+        template <size_t NR, size_t NC>
+        input_generic_rgb_image (
+            const input_rgb_image_sized<NR,NC>& item
+        ) : avg_red(item.get_avg_red()),
+            avg_green(item.get_avg_green()),
+            avg_blue(item.get_avg_blue())
+        {}
+
+        float get_avg_red()   const { return avg_red; }
+        float get_avg_green() const { return avg_green; }
+        float get_avg_blue()  const { return avg_blue; }
+
+        bool image_contained_point ( const tensor& data, const point& p) const { return get_rect(data).contains(p); }
+        drectangle tensor_space_to_image_space ( const tensor& /*data*/, drectangle r) const { return r; }
+        drectangle image_space_to_tensor_space ( const tensor& /*data*/, double /*scale*/, drectangle r ) const { return r; }
+
+        template <typename forward_iterator>
+        void to_tensor (
+            forward_iterator ibegin,
+            forward_iterator iend,
+            resizable_tensor& data
+        ) const
+        {
+            DLIB_CASSERT(std::distance(ibegin,iend) > 0);
+            const long nr = num_rows(*ibegin);
+            const long nc = num_columns(*ibegin);
+            // make sure all the input images have the same dimensions
+            for (auto i = ibegin; i != iend; ++i)
+            {
+                DLIB_CASSERT(num_rows(*i)==nr && num_columns(*i)==nc,
+                    "\t input_generic_rgb_image::to_tensor()"
+                    << "\n\t All images given to to_tensor() must have the same dimensions."
+                    << "\n\t nr: " << nr
+                    << "\n\t nc: " << nc
+                    << "\n\t num_rows(*i):    " << num_rows(*i)
+                    << "\n\t num_columns(*i): " << num_columns(*i)
+                );
+            }
+
+            // initialize data to the right size to contain the stuff in the iterator range.
+            data.set_size(std::distance(ibegin,iend), 3, nr, nc);
+            impl::rgb_images_to_tensor(ibegin, iend, data.host_write_only(), nr, nc, 0, 0, avg_red, avg_green, avg_blue);
+        }
+
+        friend void serialize(const input_generic_rgb_image& item, std::ostream& out)
+        {
+            serialize("input_generic_rgb_image", out);
+            serialize(item.avg_red, out);
+            serialize(item.avg_green, out);
+            serialize(item.avg_blue, out);
+        }
+
+        friend void deserialize(input_generic_rgb_image& item, std::istream& in)
+        {
+            std::string version;
+            deserialize(version, in);
+            if (version != "input_generic_rgb_image" && version != "input_rgb_image" && version != "input_rgb_image_sized")
+                throw serialization_error("Unexpected version found while deserializing dlib::input_generic_rgb_image.");
+            deserialize(item.avg_red, in);
+            deserialize(item.avg_green, in);
+            deserialize(item.avg_blue, in);
+
+            // read and discard the sizes if this was really a sized input layer.
+            if (version == "input_rgb_image_sized")
+            {
+                size_t nr, nc;
+                deserialize(nr, in);
+                deserialize(nc, in);
+            }
+        }
+
+        friend std::ostream& operator<<(std::ostream& out, const input_generic_rgb_image& item)
+        {
+            out << "input_generic_rgb_image("<<item.avg_red<<","<<item.avg_green<<","<<item.avg_blue<<")";
+            return out;
+        }
+
+        friend void to_xml(const input_generic_rgb_image& item, std::ostream& out)
+        {
+            out << "<input_generic_rgb_image r='"<<item.avg_red<<"' g='"<<item.avg_green<<"' b='"<<item.avg_blue<<"'/>";
+        }
+
+    private:
+        float avg_red;
+        float avg_green;
+        float avg_blue;
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    template <typename image_type>
+    input_rgb_image::
+    input_rgb_image (
+        const input_generic_rgb_image<image_type>& item
+    ) : avg_red(item.get_avg_red()),
+        avg_green(item.get_avg_green()),
+        avg_blue(item.get_avg_blue())
+    {}
+
 // ----------------------------------------------------------------------------------------
 
     template <typename T, long NR, long NC, typename MM, typename L>
@@ -695,39 +934,8 @@ namespace dlib
 
             // copy the first raw image into the top part of the tiled pyramid.  We need to
             // do this for each of the input images/samples in the tensor.
-            for (auto i = ibegin; i != iend; ++i)
-            {
-                auto& img = *i;
-                ptr += rects[0].top()*data.nc();
-                for (long r = 0; r < img.nr(); ++r)
-                {
-                    auto p = ptr+rects[0].left();
-                    for (long c = 0; c < img.nc(); ++c)
-                        p[c] = (img(r,c).red-avg_red)/256.0;
-                    ptr += data.nc();
-                }
-                ptr += data.nc()*(data.nr()-rects[0].bottom()-1);
-
-                ptr += rects[0].top()*data.nc();
-                for (long r = 0; r < img.nr(); ++r)
-                {
-                    auto p = ptr+rects[0].left();
-                    for (long c = 0; c < img.nc(); ++c)
-                        p[c] = (img(r,c).green-avg_green)/256.0;
-                    ptr += data.nc();
-                }
-                ptr += data.nc()*(data.nr()-rects[0].bottom()-1);
-
-                ptr += rects[0].top()*data.nc();
-                for (long r = 0; r < img.nr(); ++r)
-                {
-                    auto p = ptr+rects[0].left();
-                    for (long c = 0; c < img.nc(); ++c)
-                        p[c] = (img(r,c).blue-avg_blue)/256.0;
-                    ptr += data.nc();
-                }
-                ptr += data.nc()*(data.nr()-rects[0].bottom()-1);
-            }
+            impl::rgb_images_to_tensor(ibegin, iend, ptr, NR, NC, rects[0].top(), rects[0].left(),
+                avg_red, avg_green, avg_blue);
 
             // now build the image pyramid into data.  This does the same thing as
             // create_tiled_pyramid(), except we use the GPU if one is available. 
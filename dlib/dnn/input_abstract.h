@@ -245,6 +245,8 @@ namespace dlib
                   Moreover, each color channel is normalized by having its average value
                   subtracted (according to get_avg_red(), get_avg_green(), or
                   get_avg_blue()) and then is divided by 256.0.
+                - Large batches or images are converted by several threads at once, using
+                  dlib::parallel_for().
         !*/
 
 
@@ -271,6 +273,42 @@ namespace dlib
 
     };
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename image_type
+        >
+    class input_generic_rgb_image 
+    {
+        /*!
+            REQUIREMENTS ON image_type
+                - image_type == an image object that implements the interface defined in
+                  dlib/image_processing/generic_image.h 
+                - pixel_traits<typename image_traits<image_type>::pixel_type> is defined. 
+
+            WHAT THIS OBJECT REPRESENTS
+                This layer has an interface and behavior identical to input_rgb_image
+                except that its input_type is image_type rather than matrix<rgb_pixel>.
+                This lets a network read images straight out of memory it doesn't own,
+                without copying them into a matrix first.  For instance, if you have
+                frames in your own interleaved 8 bit RGB buffers you can use
+                    input_generic_rgb_image<const_sub_image_proxy<matrix<rgb_pixel>>>
+                as the input layer and give the network sub_image(ptr, nr, nc, row_stride)
+                for each frame.  Any row stride is fine.  Similarly, cv_image<bgr_pixel>
+                lets it read OpenCV images directly.
+
+                Images of rgb_pixel, bgr_pixel, and rgb_alpha_pixel are converted with
+                SIMD instructions, when they are enabled.  Other pixel types are converted
+                to rgb_pixel one pixel at a time with assign_pixel().
+
+                You can convert between input_rgb_image, input_rgb_image_sized, and
+                input_generic_rgb_image by copy construction, and deserialize any of them
+                into an input_generic_rgb_image.  So you can train a network with
+                input_rgb_image and then run it with input_generic_rgb_image.
+        !*/
+
+    };
+
 // ----------------------------------------------------------------------------------------
 
     template <
@@ -34,21 +34,30 @@ namespace dlib
         int _stride_y,
         int _stride_x,
         int _padding_y = _stride_y!=1? 0 : _nr/2,
-        int _padding_x = _stride_x!=1? 0 : _nc/2
+        int _padding_x = _stride_x!=1? 0 : _nc/2,
+        long _groups = 1,
+        int _dilation_y = 1,
+        int _dilation_x = 1
         >
     class con_
     {
     public:
 
         static_assert(_num_filters > 0, "The number of filters must be > 0");
+        static_assert(_groups > 0, "The number of groups must be > 0");
+        static_assert(_num_filters%_groups == 0, "The number of filters must be divisible by the number of groups");
         static_assert(_nr >= 0, "The number of rows in a filter must be >= 0");
         static_assert(_nc >= 0, "The number of columns in a filter must be >= 0");
         static_assert(_stride_y > 0, "The filter stride must be > 0");
         static_assert(_stride_x > 0, "The filter stride must be > 0");
-        static_assert(_nr==0 || (0 <= _padding_y && _padding_y < _nr), "The padding must be smaller than the filter size.");
-        static_assert(_nc==0 || (0 <= _padding_x && _padding_x < _nc), "The padding must be smaller than the filter size.");
+        static_assert(_dilation_y > 0, "The filter dilation must be > 0");
+        static_assert(_dilation_x > 0, "The filter dilation must be > 0");
+        static_assert(_nr==0 || (0 <= _padding_y && _padding_y < _dilation_y*(_nr-1)+1), "The padding must be smaller than the dilated filter size.");
+        static_assert(_nc==0 || (0 <= _padding_x && _padding_x < _dilation_x*(_nc-1)+1), "The padding must be smaller than the dilated filter size.");
         static_assert(_nr!=0 || 0 == _padding_y, "If _nr==0 then the padding must be set to 0 as well.");
         static_assert(_nc!=0 || 0 == _padding_x, "If _nr==0 then the padding must be set to 0 as well.");
+        static_assert(_nr!=0 || 1 == _dilation_y, "If _nr==0 then the dilation must be set to 1.");
+        static_assert(_nc!=0 || 1 == _dilation_x, "If _nc==0 then the dilation must be set to 1.");
 
         con_(
             num_con_outputs o
@@ -59,7 +68,9 @@ namespace dlib
             bias_weight_decay_multiplier(0),
             num_filters_(o.num_outputs),
             padding_y_(_padding_y),
-            padding_x_(_padding_x)
+            padding_x_(_padding_x),
+            use_relu(false),
+            input_scale(0)
         {
             DLIB_CASSERT(num_filters_ > 0);
         }
@@ -85,10 +96,14 @@ namespace dlib
         long stride_x() const { return _stride_x; }
         long padding_y() const { return padding_y_; }
         long padding_x() const { return padding_x_; }
+        long groups() const { return _groups; }
+        long dilation_y() const { return _dilation_y; }
+        long dilation_x() const { return _dilation_x; }
 
         void set_num_filters(long num) 
         {
             DLIB_CASSERT(num > 0);
+            DLIB_CASSERT(num%_groups == 0);
             if (num != num_filters_)
             {
                 DLIB_CASSERT(get_layer_params().size() == 0, 
@@ -107,12 +122,56 @@ namespace dlib
         void set_bias_learning_rate_multiplier(double val) { bias_learning_rate_multiplier = val; }
         void set_bias_weight_decay_multiplier(double val)  { bias_weight_decay_multiplier  = val; }
 
+        bool relu_is_enabled() const { return use_relu; }
+        void enable_relu() { use_relu = true; }
+        void disable_relu() { use_relu = false; }
+
+        alias_tensor_instance get_filters()
+        {
+            DLIB_CASSERT(!is_quantized(), "A quantized con_ layer doesn't hold floating point filters.");
+            return filters(params, 0);
+        }
+
+        alias_tensor_const_instance get_filters() const
+        {
+            DLIB_CASSERT(!is_quantized(), "A quantized con_ layer doesn't hold floating point filters.");
+            return filters(params, 0);
+        }
+
+        alias_tensor_instance get_biases()
+        {
+            return biases(params, bias_offset());
+        }
+
+        alias_tensor_const_instance get_biases() const
+        {
+            return biases(params, bias_offset());
+        }
+
+        bool is_quantized() const { return qfilters.size() != 0; }
+        float get_input_scale() const { return input_scale; }
+
+        void quantize (
+            float input_scale_
+        )
+        {
+            DLIB_CASSERT(input_scale_ > 0);
+            DLIB_CASSERT(params.size() != 0 && !is_quantized());
+            DLIB_CASSERT(_groups == 1, "Only ungrouped convolutions can be quantized.");
+            tt::quantize_rows(qfilters, qfilter_scales, filters(params,0));
+            input_scale = input_scale_;
+            // Only the biases are still needed in floating point.
+            resizable_tensor temp;
+            temp = biases(params, filters.size());
+            params = temp;
+        }
+
         inline dpoint map_input_to_output (
             dpoint p
         ) const
         {
-            p.x() = (p.x()+padding_x()-nc()/2)/stride_x();
-            p.y() = (p.y()+padding_y()-nr()/2)/stride_y();
+            p.x() = (p.x()+padding_x()-dilated_nc()/2)/stride_x();
+            p.y() = (p.y()+padding_y()-dilated_nr()/2)/stride_y();
             return p;
         }
 
@@ -120,8 +179,8 @@ namespace dlib
             dpoint p
         ) const
         {
-            p.x() = p.x()*stride_x() - padding_x() + nc()/2;
-            p.y() = p.y()*stride_y() - padding_y() + nr()/2;
+            p.x() = p.x()*stride_x() - padding_x() + dilated_nc()/2;
+            p.y() = p.y()*stride_y() - padding_y() + dilated_nr()/2;
             return p;
         }
 
@@ -137,7 +196,11 @@ namespace dlib
             bias_weight_decay_multiplier(item.bias_weight_decay_multiplier),
             num_filters_(item.num_filters_),
             padding_y_(item.padding_y_),
-            padding_x_(item.padding_x_)
+            padding_x_(item.padding_x_),
+            use_relu(item.use_relu),
+            qfilters(item.qfilters),
+            qfilter_scales(item.qfilter_scales),
+            input_scale(item.input_scale)
         {
             // this->conv is non-copyable and basically stateless, so we have to write our
             // own copy to avoid trying to copy it and getting an error.
@@ -162,6 +225,10 @@ namespace dlib
             bias_learning_rate_multiplier = item.bias_learning_rate_multiplier;
             bias_weight_decay_multiplier = item.bias_weight_decay_multiplier;
             num_filters_ = item.num_filters_;
+            use_relu = item.use_relu;
+            qfilters = item.qfilters;
+            qfilter_scales = item.qfilter_scales;
+            input_scale = item.input_scale;
             return *this;
         }
 
@@ -170,8 +237,14 @@ namespace dlib
         {
             const long filt_nr = _nr!=0 ? _nr : sub.get_output().nr();
             const long filt_nc = _nc!=0 ? _nc : sub.get_output().nc();
-
-            long num_inputs = filt_nr*filt_nc*sub.get_output().k();
+            DLIB_CASSERT(sub.get_output().k()%_groups == 0, 
+                "The number of input channels to a grouped con_ layer must be divisible by the number of groups."
+                << "\n\t input channels: " << sub.get_output().k()
+                << "\n\t groups:         " << _groups);
+            // Each filter only looks at the input channels in its own group.
+            const long filt_k = sub.get_output().k()/_groups;
+
+            long num_inputs = filt_nr*filt_nc*filt_k;
             long num_outputs = num_filters_;
             // allocate params for the filters and also for the filter bias values.
             params.set_size(num_inputs*num_filters_ + num_filters_);
@@ -179,7 +252,7 @@ namespace dlib
             dlib::rand rnd(std::rand());
             randomize_parameters(params, num_inputs+num_outputs, rnd);
 
-            filters = alias_tensor(num_filters_, sub.get_output().k(), filt_nr, filt_nc);
+            filters = alias_tensor(num_filters_, filt_k, filt_nr, filt_nc);
             biases = alias_tensor(1,num_filters_);
 
             // set the initial bias values to zero
@@ -189,22 +262,37 @@ namespace dlib
         template <typename SUBNET>
         void forward(const SUBNET& sub, resizable_tensor& output)
         {
-            conv.setup(sub.get_output(),
-                       filters(params,0),
-                       _stride_y,
-                       _stride_x,
-                       padding_y_,
-                       padding_x_);
-            conv(false, output,
-                sub.get_output(),
-                filters(params,0));
+            if (is_quantized())
+            {
+                tt::quantized_conv(output, sub.get_output(), input_scale, qfilters, qfilter_scales,
+                    filters.num_samples(), filters.nr(), filters.nc(),
+                    _stride_y, _stride_x, padding_y_, padding_x_, _dilation_y, _dilation_x);
+            }
+            else
+            {
+                conv.setup(sub.get_output(),
+                           filters(params,0),
+                           _stride_y,
+                           _stride_x,
+                           padding_y_,
+                           padding_x_,
+                           _dilation_y,
+                           _dilation_x);
+                conv(false, output,
+                    sub.get_output(),
+                    filters(params,0));
+            }
 
-            tt::add(1,output,1,biases(params,filters.size()));
+            tt::add(1,output,1,biases(params,bias_offset()));
+            if (use_relu)
+                tt::relu(output, output);
         } 
 
         template <typename SUBNET>
         void backward(const tensor& gradient_input, SUBNET& sub, tensor& params_grad)
         {
+            DLIB_CASSERT(!use_relu, "A con_ layer with a fused relu can only be used for inference.");
+            DLIB_CASSERT(!is_quantized(), "A quantized con_ layer can only be used for inference.");
             conv.get_gradient_for_data (true, gradient_input, filters(params,0), sub.get_gradient_input());
             // no dpoint computing the parameter gradients if they won't be used.
             if (learning_rate_multiplier != 0)
@@ -221,7 +309,7 @@ namespace dlib
 
         friend void serialize(const con_& item, std::ostream& out)
         {
-            serialize("con_4", out);
+            serialize("con_5", out);
             serialize(item.params, out);
             serialize(item.num_filters_, out);
             serialize(_nr, out);
@@ -236,6 +324,13 @@ namespace dlib
             serialize(item.weight_decay_multiplier, out);
             serialize(item.bias_learning_rate_multiplier, out);
             serialize(item.bias_weight_decay_multiplier, out);
+            serialize(item.use_relu, out);
+            serialize(item.qfilters, out);
+            serialize(item.qfilter_scales, out);
+            serialize(item.input_scale, out);
+            serialize(_groups, out);
+            serialize(_dilation_y, out);
+            serialize(_dilation_x, out);
         }
 
         friend void deserialize(con_& item, std::istream& in)
@@ -246,7 +341,10 @@ namespace dlib
             long nc;
             int stride_y;
             int stride_x;
-            if (version == "con_4")
+            long groups = 1;
+            int dilation_y = 1;
+            int dilation_x = 1;
+            if (version == "con_4" || version == "con_5")
             {
                 deserialize(item.params, in);
                 deserialize(item.num_filters_, in);
@@ -262,12 +360,29 @@ namespace dlib
                 deserialize(item.weight_decay_multiplier, in);
                 deserialize(item.bias_learning_rate_multiplier, in);
                 deserialize(item.bias_weight_decay_multiplier, in);
+                item.use_relu = false;
+                item.qfilters.clear();
+                item.qfilter_scales.clear();
+                item.input_scale = 0;
+                if (version == "con_5")
+                {
+                    deserialize(item.use_relu, in);
+                    deserialize(item.qfilters, in);
+                    deserialize(item.qfilter_scales, in);
+                    deserialize(item.input_scale, in);
+                    deserialize(groups, in);
+                    deserialize(dilation_y, in);
+                    deserialize(dilation_x, in);
+                }
                 if (item.padding_y_ != _padding_y) throw serialization_error("Wrong padding_y found while deserializing dlib::con_");
                 if (item.padding_x_ != _padding_x) throw serialization_error("Wrong padding_x found while deserializing dlib::con_");
                 if (nr != _nr) throw serialization_error("Wrong nr found while deserializing dlib::con_");
                 if (nc != _nc) throw serialization_error("Wrong nc found while deserializing dlib::con_");
                 if (stride_y != _stride_y) throw serialization_error("Wrong stride_y found while deserializing dlib::con_");
                 if (stride_x != _stride_x) throw serialization_error("Wrong stride_x found while deserializing dlib::con_");
+                if (groups != _groups) throw serialization_error("Wrong groups found while deserializing dlib::con_");
+                if (dilation_y != _dilation_y) throw serialization_error("Wrong dilation_y found while deserializing dlib::con_");
+                if (dilation_x != _dilation_x) throw serialization_error("Wrong dilation_x found while deserializing dlib::con_");
             }
             else
             {
@@ -285,12 +400,21 @@ namespace dlib
                 << ", stride_y="<<_stride_y
                 << ", stride_x="<<_stride_x
                 << ", padding_y="<<item.padding_y_
-                << ", padding_x="<<item.padding_x_
-                << ")";
+                << ", padding_x="<<item.padding_x_;
+            if (_groups != 1)
+                out << ", groups="<<_groups;
+            if (_dilation_y != 1 || _dilation_x != 1)
+                out << ", dilation_y="<<_dilation_y
+                    << ", dilation_x="<<_dilation_x;
+            out << ")";
             out << " learning_rate_mult="<<item.learning_rate_multiplier;
             out << " weight_decay_mult="<<item.weight_decay_multiplier;
             out << " bias_learning_rate_mult="<<item.bias_learning_rate_multiplier;
             out << " bias_weight_decay_mult="<<item.bias_weight_decay_multiplier;
+            if (item.use_relu)
+                out << " relu";
+            if (item.is_quantized())
+                out << " int8";
             return out;
         }
 
@@ -304,16 +428,34 @@ namespace dlib
                 << " stride_x='"<<_stride_x<<"'"
                 << " padding_y='"<<item.padding_y_<<"'"
                 << " padding_x='"<<item.padding_x_<<"'"
+                << " groups='"<<_groups<<"'"
+                << " dilation_y='"<<_dilation_y<<"'"
+                << " dilation_x='"<<_dilation_x<<"'"
                 << " learning_rate_mult='"<<item.learning_rate_multiplier<<"'"
                 << " weight_decay_mult='"<<item.weight_decay_multiplier<<"'"
                 << " bias_learning_rate_mult='"<<item.bias_learning_rate_multiplier<<"'"
-                << " bias_weight_decay_mult='"<<item.bias_weight_decay_multiplier<<"'>\n";
+                << " bias_weight_decay_mult='"<<item.bias_weight_decay_multiplier<<"'"
+                << " use_relu='"<<item.use_relu<<"'";
+            if (item.is_quantized())
+                out << " input_scale='"<<item.input_scale<<"'";
+            out << ">\n";
             out << mat(item.params);
+            if (item.is_quantized())
+            {
+                out << "<int8_filters>\n" << matrix_cast<int>(mat(item.qfilters)) << "</int8_filters>\n";
+                out << "<int8_filter_scales>\n" << mat(item.qfilter_scales) << "</int8_filter_scales>\n";
+            }
             out << "</con>";
         }
 
     private:
 
+        size_t bias_offset() const { return is_quantized() ? 0 : filters.size(); }
+
+        // The extent of the input window covered by one filter.
+        long dilated_nr() const { return _dilation_y*(nr()-1)+1; }
+        long dilated_nc() const { return _dilation_x*(nc()-1)+1; }
+
         resizable_tensor params;
         alias_tensor filters, biases;
 
@@ -329,6 +471,14 @@ namespace dlib
         int padding_y_;
         int padding_x_;
 
+        bool use_relu;
+
+        // When the layer is quantized these hold the filters as 8 bit integers, one
+        // scale per filter, and the scale used to quantize the input.  params then only
+        // holds the biases.
+        std::vector<int8_t> qfilters;
+        std::vector<float> qfilter_scales;
+        float input_scale;
     };
 
     template <
@@ -341,6 +491,39 @@ namespace dlib
         >
     using con = add_layer<con_<num_filters,nr,nc,stride_y,stride_x>, SUBNET>;
 
+    template <
+        long num_filters,
+        long groups,
+        long nr,
+        long nc,
+        int stride_y,
+        int stride_x,
+        typename SUBNET
+        >
+    using grouped_con = add_layer<con_<num_filters,nr,nc,stride_y,stride_x,
+                                       stride_y!=1? 0 : nr/2, stride_x!=1? 0 : nc/2, groups>, SUBNET>;
+
+    template <
+        long num_channels,
+        long nr,
+        long nc,
+        int stride_y,
+        int stride_x,
+        typename SUBNET
+        >
+    using depthwise_con = grouped_con<num_channels,num_channels,nr,nc,stride_y,stride_x,SUBNET>;
+
+    template <
+        long num_filters,
+        long nr,
+        long nc,
+        int dilation_y,
+        int dilation_x,
+        typename SUBNET
+        >
+    using dilated_con = add_layer<con_<num_filters,nr,nc,1,1,
+                                       dilation_y*(nr/2), dilation_x*(nc/2), 1, dilation_y, dilation_x>, SUBNET>;
+
 // ----------------------------------------------------------------------------------------
 
     template <
@@ -1216,6 +1399,8 @@ namespace dlib
             num_updates = 0;
         }
 
+        void set_recomputing (bool recomputing_) { recomputing = recomputing_; }
+
         template <typename SUBNET>
         void forward(const SUBNET& sub, resizable_tensor& output)
         {
@@ -1223,10 +1408,16 @@ namespace dlib
             auto b = beta(params,gamma.size());
             if (sub.get_output().num_samples() > 1)
             {
-                const double decay = 1.0 - num_updates/(num_updates+1.0);
-                ++num_updates;
-                if (num_updates > running_stats_window_size)
-                    num_updates = running_stats_window_size;
+                // When recomputing, the running statistics already include this batch, so
+                // we only recompute the batch statistics backward() needs.
+                double decay = 0;
+                if (!recomputing)
+                {
+                    decay = 1.0 - num_updates/(num_updates+1.0);
+                    ++num_updates;
+                    if (num_updates > running_stats_window_size)
+                        num_updates = running_stats_window_size;
+                }
 
                 if (mode == FC_MODE)
                     tt::batch_normalize(eps, output, means, invstds, decay, running_means, running_variances, sub.get_output(), g, b);
@@ -1363,6 +1554,7 @@ namespace dlib
         double bias_learning_rate_multiplier;
         double bias_weight_decay_multiplier;
         double eps;
+        bool recomputing = false;
     };
 
     template <typename SUBNET>
@@ -1447,7 +1639,8 @@ namespace dlib
             learning_rate_multiplier(1),
             weight_decay_multiplier(1),
             bias_learning_rate_multiplier(1),
-            bias_weight_decay_multiplier(0)
+            bias_weight_decay_multiplier(0),
+            input_scale(0)
         {}
 
         fc_() : fc_(num_fc_outputs(num_outputs_)) {}
@@ -1508,11 +1701,18 @@ namespace dlib
                 "The size of the input tensor to this fc layer doesn't match the size the fc layer was trained with.");
             output.set_size(sub.get_output().num_samples(), num_outputs);
 
-            auto w = weights(params, 0);
-            tt::gemm(0,output, 1,sub.get_output(),false, w,false);
+            if (is_quantized())
+            {
+                tt::quantized_fc(output, sub.get_output(), input_scale, qweights, qweight_scales, num_outputs);
+            }
+            else
+            {
+                auto w = weights(params, 0);
+                tt::gemm(0,output, 1,sub.get_output(),false, w,false);
+            }
             if (bias_mode == FC_HAS_BIAS)
             {
-                auto b = biases(params, weights.size());
+                auto b = biases(params, bias_offset());
                 tt::add(1,output,1,b);
             }
         } 
@@ -1520,6 +1720,7 @@ namespace dlib
         template <typename SUBNET>
         void backward(const tensor& gradient_input, SUBNET& sub, tensor& params_grad)
         {
+            DLIB_CASSERT(!is_quantized(), "A quantized fc_ layer can only be used for inference.");
             // no point computing the parameter gradients if they won't be used.
             if (learning_rate_multiplier != 0)
             {
@@ -1542,11 +1743,13 @@ namespace dlib
 
         alias_tensor_instance get_weights()
         {
+            DLIB_CASSERT(!is_quantized(), "A quantized fc_ layer doesn't hold floating point weights.");
             return weights(params, 0);
         }
 
         alias_tensor_const_instance get_weights() const
         {
+            DLIB_CASSERT(!is_quantized(), "A quantized fc_ layer doesn't hold floating point weights.");
             return weights(params, 0);
         }
 
@@ -1554,14 +1757,37 @@ namespace dlib
         {
             static_assert(bias_mode == FC_HAS_BIAS, "This fc_ layer doesn't have a bias vector "
                 "to be retrieved, as per template parameter 'bias_mode'.");
-            return biases(params, weights.size());
+            return biases(params, bias_offset());
         }
 
         alias_tensor_const_instance get_biases() const
         {
             static_assert(bias_mode == FC_HAS_BIAS, "This fc_ layer doesn't have a bias vector "
                 "to be retrieved, as per template parameter 'bias_mode'.");
-            return biases(params, weights.size());
+            return biases(params, bias_offset());
+        }
+
+        bool is_quantized() const { return qweights.size() != 0; }
+        float get_input_scale() const { return input_scale; }
+
+        void quantize (
+            float input_scale_
+        )
+        {
+            DLIB_CASSERT(input_scale_ > 0);
+            DLIB_CASSERT(params.size() != 0 && !is_quantized());
+            // The int8 kernel wants each output's weights contiguous in memory, so they
+            // are quantized from the transpose of the weight matrix.
+            resizable_tensor temp;
+            temp = trans(mat(weights(params, 0)));
+            tt::quantize_rows(qweights, qweight_scales, temp);
+            input_scale = input_scale_;
+            // Only the biases are still needed in floating point.
+            if (bias_mode == FC_HAS_BIAS)
+                temp = biases(params, weights.size());
+            else
+                temp.clear();
+            params = temp;
         }
 
         const tensor& get_layer_params() const { return params; }
@@ -1569,7 +1795,7 @@ namespace dlib
 
         friend void serialize(const fc_& item, std::ostream& out)
         {
-            serialize("fc_2", out);
+            serialize("fc_3", out);
             serialize(item.num_outputs, out);
             serialize(item.num_inputs, out);
             serialize(item.params, out);
@@ -1580,13 +1806,16 @@ namespace dlib
             serialize(item.weight_decay_multiplier, out);
             serialize(item.bias_learning_rate_multiplier, out);
             serialize(item.bias_weight_decay_multiplier, out);
+            serialize(item.qweights, out);
+            serialize(item.qweight_scales, out);
+            serialize(item.input_scale, out);
         }
 
         friend void deserialize(fc_& item, std::istream& in)
         {
             std::string version;
             deserialize(version, in);
-            if (version != "fc_2")
+            if (version != "fc_2" && version != "fc_3")
                 throw serialization_error("Unexpected version '"+version+"' found while deserializing dlib::fc_.");
 
             deserialize(item.num_outputs, in);
@@ -1601,6 +1830,15 @@ namespace dlib
             deserialize(item.weight_decay_multiplier, in);
             deserialize(item.bias_learning_rate_multiplier, in);
             deserialize(item.bias_weight_decay_multiplier, in);
+            item.qweights.clear();
+            item.qweight_scales.clear();
+            item.input_scale = 0;
+            if (version == "fc_3")
+            {
+                deserialize(item.qweights, in);
+                deserialize(item.qweight_scales, in);
+                deserialize(item.input_scale, in);
+            }
         }
 
         friend std::ostream& operator<<(std::ostream& out, const fc_& item)
@@ -1623,6 +1861,8 @@ namespace dlib
                 out << " learning_rate_mult="<<item.learning_rate_multiplier;
                 out << " weight_decay_mult="<<item.weight_decay_multiplier;
             }
+            if (item.is_quantized())
+                out << " int8";
             return out;
         }
 
@@ -1636,8 +1876,11 @@ namespace dlib
                     << " weight_decay_mult='"<<item.weight_decay_multiplier<<"'"
                     << " bias_learning_rate_mult='"<<item.bias_learning_rate_multiplier<<"'"
                     << " bias_weight_decay_mult='"<<item.bias_weight_decay_multiplier<<"'";
+                if (item.is_quantized())
+                    out << " input_scale='"<<item.input_scale<<"'";
                 out << ">\n";
                 out << mat(item.params);
+                item.quantized_weights_to_xml(out);
                 out << "</fc>\n";
             }
             else
@@ -1646,14 +1889,28 @@ namespace dlib
                     << " num_outputs='"<<item.num_outputs<<"'"
                     << " learning_rate_mult='"<<item.learning_rate_multiplier<<"'"
                     << " weight_decay_mult='"<<item.weight_decay_multiplier<<"'";
+                if (item.is_quantized())
+                    out << " input_scale='"<<item.input_scale<<"'";
                 out << ">\n";
                 out << mat(item.params);
+                item.quantized_weights_to_xml(out);
                 out << "</fc_no_bias>\n";
             }
         }
 
     private:
 
+        size_t bias_offset() const { return is_quantized() ? 0 : weights.size(); }
+
+        void quantized_weights_to_xml(std::ostream& out) const
+        {
+            if (is_quantized())
+            {
+                out << "<int8_weights>\n" << matrix_cast<int>(mat(qweights)) << "</int8_weights>\n";
+                out << "<int8_weight_scales>\n" << mat(qweight_scales) << "</int8_weight_scales>\n";
+            }
+        }
+
         unsigned long num_outputs;
         unsigned long num_inputs;
         resizable_tensor params;
@@ -1662,6 +1919,13 @@ namespace dlib
         double weight_decay_multiplier;
         double bias_learning_rate_multiplier;
         double bias_weight_decay_multiplier;
+
+        // When the layer is quantized these hold the transposed weights as 8 bit
+        // integers, one scale per output, and the scale used to quantize the input.
+        // params then only holds the biases.
+        std::vector<int8_t> qweights;
+        std::vector<float> qweight_scales;
+        float input_scale;
     };
 
     template <
@@ -1678,128 +1942,628 @@ namespace dlib
 
 // ----------------------------------------------------------------------------------------
 
-    class dropout_
+    namespace impl
     {
-    public:
-        explicit dropout_(
-            float drop_rate_ = 0.5
-        ) :
-            drop_rate(drop_rate_),
-            rnd(std::rand())
+        inline void sequence_to_time_major (
+            resizable_tensor& dest,
+            const tensor& src
+        )
         {
-            DLIB_CASSERT(0 <= drop_rate && drop_rate <= 1);
+            // src has one time step per channel.  dest gets the steps one after the
+            // other, each a num_samples() by nr()*nc() matrix, so each time step can be
+            // used by gemm() directly.
+            const long N = src.num_samples();
+            const long T = src.k();
+            dest.set_size(T*N, 1, src.nr(), src.nc());
+            alias_tensor step(N, 1, src.nr(), src.nc());
+            for (long t = 0; t < T; ++t)
+            {
+                auto d = step(dest, t*step.size());
+                tt::copy_tensor(false, d, 0, src, t, 1);
+            }
         }
 
-        // We have to add a copy constructor and assignment operator because the rnd object
-        // is non-copyable.
-        dropout_(
-            const dropout_& item
-        ) : drop_rate(item.drop_rate), mask(item.mask), rnd(std::rand())
-        {}
-
-        dropout_& operator= (
-            const dropout_& item
+        inline void add_time_major_to_sequence (
+            tensor& dest,
+            const tensor& src
         )
         {
-            if (this == &item)
-                return *this;
-
-            drop_rate = item.drop_rate;
-            mask = item.mask;
-            return *this;
+            // The inverse of sequence_to_time_major(), but adds src to dest.
+            const long N = dest.num_samples();
+            alias_tensor step(N, 1, dest.nr(), dest.nc());
+            for (long t = 0; t < dest.k(); ++t)
+            {
+                auto s = step(src, t*step.size());
+                tt::copy_tensor(true, dest, t, s, 0, 1);
+            }
         }
+    }
 
-        float get_drop_rate (
-        ) const { return drop_rate; }
+// ----------------------------------------------------------------------------------------
+
+    template <
+        unsigned long num_outputs_
+        >
+    class lstm_
+    {
+        static_assert(num_outputs_ > 0, "The number of outputs from a lstm_ layer must be > 0");
+
+    public:
+        lstm_() : num_outputs(num_outputs_), num_inputs(0),
+            learning_rate_multiplier(1),
+            weight_decay_multiplier(1)
+        {}
+
+        double get_learning_rate_multiplier () const  { return learning_rate_multiplier; }
+        double get_weight_decay_multiplier () const   { return weight_decay_multiplier; }
+        void set_learning_rate_multiplier(double val) { learning_rate_multiplier = val; }
+        void set_weight_decay_multiplier(double val)  { weight_decay_multiplier  = val; }
+
+        unsigned long get_num_outputs (
+        ) const { return num_outputs; }
+
+        void set_num_outputs(long num)
+        {
+            DLIB_CASSERT(num > 0);
+            if (num != (long)num_outputs)
+            {
+                DLIB_CASSERT(get_layer_params().size() == 0,
+                    "You can't change the number of outputs in lstm_ if the parameter tensor has already been allocated.");
+                num_outputs = num;
+            }
+        }
 
         template <typename SUBNET>
-        void setup (const SUBNET& /*sub*/)
+        void setup (const SUBNET& sub)
         {
+            num_inputs = sub.get_output().nr()*sub.get_output().nc();
+            const long H = num_outputs;
+            // The input weights, the recurrent weights, and the biases, each with the
+            // input, forget, cell, and output gates side by side so that all the gates of
+            // a time step are computed by one matrix multiply.
+            params.set_size(num_inputs+H+1, 4*H);
+
+            dlib::rand rnd(std::rand());
+            randomize_parameters(params, num_inputs+H+H, rnd);
+
+            weights = alias_tensor(num_inputs, 4*H);
+            recurrent_weights = alias_tensor(H, 4*H);
+            biases = alias_tensor(1, 4*H);
+            biases(params, bias_offset()) = 0;
+            // Start with the forget gates open, so the cell remembers by default.
+            alias_tensor forget_biases(1, H);
+            forget_biases(params, bias_offset()+H) = 1;
         }
 
-        void forward_inplace(const tensor& input, tensor& output)
+        template <typename SUBNET>
+        void forward(const SUBNET& sub, resizable_tensor& output)
         {
-            // create a random mask and use it to filter the data
-            mask.copy_size(input);
-            rnd.fill_uniform(mask);
-            tt::threshold(mask, drop_rate);
-            tt::multiply(false, output, input, mask);
-        } 
+            const tensor& x = sub.get_output();
+            DLIB_CASSERT((long)num_inputs == x.nr()*x.nc(),
+                "The size of the input tensor to this lstm layer doesn't match the size the lstm layer was trained with.");
+            const long N = x.num_samples();
+            const long T = x.k();
+            const long H = num_outputs;
+            output.set_size(N, T, 1, H);
+
+            impl::sequence_to_time_major(xs, x);
+            // Compute the part of the gates that comes from the input for every time step
+            // at once.
+            gates.set_size(T*N, 4*H);
+            auto w = weights(params, 0);
+            auto b = biases(params, bias_offset());
+            tt::gemm(0,gates, 1,xs,false, w,false);
+            tt::add(1,gates,1,b);
+
+            cells.set_size((T+1)*N, 1, 1, H);
+            hidden.set_size((T+1)*N, 1, 1, H);
+            alias_tensor state(N, 1, 1, H), step(N, 4*H);
+            state(cells, 0) = 0;
+            state(hidden, 0) = 0;
+            auto u = recurrent_weights(params, weights.size());
+            for (long t = 0; t < T; ++t)
+            {
+                auto g = step(gates, t*step.size());
+                auto c_prev = state(cells, t*state.size());
+                auto c = state(cells, (t+1)*state.size());
+                auto h_prev = state(hidden, t*state.size());
+                auto h = state(hidden, (t+1)*state.size());
+                if (t != 0)
+                    tt::gemm(1,g, 1,h_prev,false, u,false);
+                tt::lstm_cell_forward(g, c, h, c_prev);
+                tt::copy_tensor(false, output, t, h, 0, 1);
+            }
+        }
 
-        void backward_inplace(
-            const tensor& gradient_input, 
-            tensor& data_grad, 
-            tensor& /*params_grad*/
-        )
+        template <typename SUBNET>
+        void backward(const tensor& gradient_input, SUBNET& sub, tensor& params_grad)
         {
-            if (is_same_object(gradient_input, data_grad))
-                tt::multiply(false, data_grad, mask, gradient_input);
-            else
-                tt::multiply(true, data_grad, mask, gradient_input);
+            const long N = gradient_input.num_samples();
+            const long T = gradient_input.k();
+            const long H = num_outputs;
+
+            // Back-propagate through time.  dh and dc hold the gradient flowing from time
+            // step t+1 into step t.
+            dgates.set_size(T*N, 4*H);
+            dh.set_size(N, 1, 1, H);
+            dc.set_size(N, 1, 1, H);
+            dh = 0;
+            dc = 0;
+            alias_tensor state(N, 1, 1, H), step(N, 4*H);
+            auto u = recurrent_weights(params, weights.size());
+            for (long t = T-1; t >= 0; --t)
+            {
+                tt::copy_tensor(true, dh, 0, gradient_input, t, 1);
+                auto dg = step(dgates, t*step.size());
+                auto g = step(gates, t*step.size());
+                auto c_prev = state(cells, t*state.size());
+                auto c = state(cells, (t+1)*state.size());
+                tt::lstm_cell_backward(dg, dc, g, c, c_prev, dh);
+                if (t != 0)
+                    tt::gemm(0,dh, 1,dg,false, u,true);
+            }
+
+            // no point computing the parameter gradients if they won't be used.
+            if (learning_rate_multiplier != 0)
+            {
+                auto pw = weights(params_grad, 0);
+                tt::gemm(0,pw, 1,xs,true, dgates,false);
+                alias_tensor prev_states(T*N, 1, 1, H);
+                auto h_prev = prev_states(hidden, 0);
+                auto pu = recurrent_weights(params_grad, weights.size());
+                tt::gemm(0,pu, 1,h_prev,true, dgates,false);
+                auto pb = biases(params_grad, bias_offset());
+                tt::assign_bias_gradient(pb, dgates);
+            }
+
+            // compute the gradient for the data
+            auto w = weights(params, 0);
+            dxs.copy_size(xs);
+            tt::gemm(0,dxs, 1,dgates,false, w,true);
+            impl::add_time_major_to_sequence(sub.get_gradient_input(), dxs);
         }
 
-        inline dpoint map_input_to_output (const dpoint& p) const { return p; }
-        inline dpoint map_output_to_input (const dpoint& p) const { return p; }
+        alias_tensor_instance get_weights() { return weights(params, 0); }
+        alias_tensor_const_instance get_weights() const { return weights(params, 0); }
+        alias_tensor_instance get_recurrent_weights() { return recurrent_weights(params, weights.size()); }
+        alias_tensor_const_instance get_recurrent_weights() const { return recurrent_weights(params, weights.size()); }
+        alias_tensor_instance get_biases() { return biases(params, bias_offset()); }
+        alias_tensor_const_instance get_biases() const { return biases(params, bias_offset()); }
 
         const tensor& get_layer_params() const { return params; }
         tensor& get_layer_params() { return params; }
 
-        friend void serialize(const dropout_& item, std::ostream& out)
+        friend void serialize(const lstm_& item, std::ostream& out)
         {
-            serialize("dropout_", out);
-            serialize(item.drop_rate, out);
-            serialize(item.mask, out);
+            serialize("lstm_", out);
+            serialize(item.num_outputs, out);
+            serialize(item.num_inputs, out);
+            serialize(item.params, out);
+            serialize(item.weights, out);
+            serialize(item.recurrent_weights, out);
+            serialize(item.biases, out);
+            serialize(item.learning_rate_multiplier, out);
+            serialize(item.weight_decay_multiplier, out);
         }
 
-        friend void deserialize(dropout_& item, std::istream& in)
+        friend void deserialize(lstm_& item, std::istream& in)
         {
             std::string version;
             deserialize(version, in);
-            if (version != "dropout_")
-                throw serialization_error("Unexpected version '"+version+"' found while deserializing dlib::dropout_.");
-            deserialize(item.drop_rate, in);
-            deserialize(item.mask, in);
-        }
-
-        void clean(
-        ) 
-        {
-            mask.clear();
+            if (version != "lstm_")
+                throw serialization_error("Unexpected version '"+version+"' found while deserializing dlib::lstm_.");
+            deserialize(item.num_outputs, in);
+            deserialize(item.num_inputs, in);
+            deserialize(item.params, in);
+            deserialize(item.weights, in);
+            deserialize(item.recurrent_weights, in);
+            deserialize(item.biases, in);
+            deserialize(item.learning_rate_multiplier, in);
+            deserialize(item.weight_decay_multiplier, in);
         }
 
-        friend std::ostream& operator<<(std::ostream& out, const dropout_& item)
+        friend std::ostream& operator<<(std::ostream& out, const lstm_& item)
         {
-            out << "dropout\t ("
-                << "drop_rate="<<item.drop_rate
+            out << "lstm\t ("
+                << "num_outputs="<<item.num_outputs
                 << ")";
+            out << " learning_rate_mult="<<item.learning_rate_multiplier;
+            out << " weight_decay_mult="<<item.weight_decay_multiplier;
             return out;
         }
 
-        friend void to_xml(const dropout_& item, std::ostream& out)
+        friend void to_xml(const lstm_& item, std::ostream& out)
         {
-            out << "<dropout"
-                << " drop_rate='"<<item.drop_rate<<"'";
-            out << "/>\n";
+            out << "<lstm"
+                << " num_outputs='"<<item.num_outputs<<"'"
+                << " learning_rate_mult='"<<item.learning_rate_multiplier<<"'"
+                << " weight_decay_mult='"<<item.weight_decay_multiplier<<"'";
+            out << ">\n";
+            out << mat(item.params);
+            out << "</lstm>\n";
         }
 
     private:
-        float drop_rate;
-        resizable_tensor mask;
 
-        tt::tensor_rand rnd;
-        resizable_tensor params; // unused
-    };
+        size_t bias_offset() const { return weights.size() + recurrent_weights.size(); }
+
+        unsigned long num_outputs;
+        unsigned long num_inputs;
+        resizable_tensor params;
+        alias_tensor weights, recurrent_weights, biases;
+        double learning_rate_multiplier;
+        double weight_decay_multiplier;
 
+        // The state saved by forward() for backward(), all laid out one time step
+        // after the other.  cells and hidden start with the all zero initial state.
+        resizable_tensor xs, gates, cells, hidden;
+        resizable_tensor dgates, dxs, dh, dc;
+    };
 
-    template <typename SUBNET>
-    using dropout = add_layer<dropout_, SUBNET>;
+    template <
+        unsigned long num_outputs,
+        typename SUBNET
+        >
+    using lstm = add_layer<lstm_<num_outputs>, SUBNET>;
 
 // ----------------------------------------------------------------------------------------
 
-    class multiply_
+    template <
+        unsigned long num_outputs_
+        >
+    class gru_
     {
+        static_assert(num_outputs_ > 0, "The number of outputs from a gru_ layer must be > 0");
+
     public:
-        explicit multiply_(
+        gru_() : num_outputs(num_outputs_), num_inputs(0),
+            learning_rate_multiplier(1),
+            weight_decay_multiplier(1)
+        {}
+
+        double get_learning_rate_multiplier () const  { return learning_rate_multiplier; }
+        double get_weight_decay_multiplier () const   { return weight_decay_multiplier; }
+        void set_learning_rate_multiplier(double val) { learning_rate_multiplier = val; }
+        void set_weight_decay_multiplier(double val)  { weight_decay_multiplier  = val; }
+
+        unsigned long get_num_outputs (
+        ) const { return num_outputs; }
+
+        void set_num_outputs(long num)
+        {
+            DLIB_CASSERT(num > 0);
+            if (num != (long)num_outputs)
+            {
+                DLIB_CASSERT(get_layer_params().size() == 0,
+                    "You can't change the number of outputs in gru_ if the parameter tensor has already been allocated.");
+                num_outputs = num;
+            }
+        }
+
+        template <typename SUBNET>
+        void setup (const SUBNET& sub)
+        {
+            num_inputs = sub.get_output().nr()*sub.get_output().nc();
+            const long H = num_outputs;
+            // The input weights, the recurrent weights, and the input and recurrent
+            // biases, each with the update, reset, and new gates side by side.
+            params.set_size(num_inputs+H+2, 3*H);
+
+            dlib::rand rnd(std::rand());
+            randomize_parameters(params, num_inputs+H+H, rnd);
+
+            weights = alias_tensor(num_inputs, 3*H);
+            recurrent_weights = alias_tensor(H, 3*H);
+            biases = alias_tensor(1, 3*H);
+            biases(params, bias_offset()) = 0;
+            biases(params, bias_offset()+biases.size()) = 0;
+        }
+
+        template <typename SUBNET>
+        void forward(const SUBNET& sub, resizable_tensor& output)
+        {
+            const tensor& x = sub.get_output();
+            DLIB_CASSERT((long)num_inputs == x.nr()*x.nc(),
+                "The size of the input tensor to this gru layer doesn't match the size the gru layer was trained with.");
+            const long N = x.num_samples();
+            const long T = x.k();
+            const long H = num_outputs;
+            output.set_size(N, T, 1, H);
+
+            impl::sequence_to_time_major(xs, x);
+            gates.set_size(T*N, 3*H);
+            auto w = weights(params, 0);
+            auto b = biases(params, bias_offset());
+            tt::gemm(0,gates, 1,xs,false, w,false);
+            tt::add(1,gates,1,b);
+
+            recs.set_size(T*N, 3*H);
+            hidden.set_size((T+1)*N, 1, 1, H);
+            alias_tensor state(N, 1, 1, H), step(N, 3*H);
+            state(hidden, 0) = 0;
+            auto u = recurrent_weights(params, weights.size());
+            auto rb = biases(params, bias_offset()+biases.size());
+            for (long t = 0; t < T; ++t)
+            {
+                auto g = step(gates, t*step.size());
+                auto r = step(recs, t*step.size());
+                auto h_prev = state(hidden, t*state.size());
+                auto h = state(hidden, (t+1)*state.size());
+                if (t != 0)
+                    tt::gemm(0,r, 1,h_prev,false, u,false);
+                else
+                    r = 0;
+                tt::gru_cell_forward(g, r, h, h_prev, rb);
+                tt::copy_tensor(false, output, t, h, 0, 1);
+            }
+        }
+
+        template <typename SUBNET>
+        void backward(const tensor& gradient_input, SUBNET& sub, tensor& params_grad)
+        {
+            const long N = gradient_input.num_samples();
+            const long T = gradient_input.k();
+            const long H = num_outputs;
+
+            // Back-propagate through time.  dh holds the gradient flowing from time step
+            // t+1 into step t.
+            dgates.set_size(T*N, 3*H);
+            drecs.set_size(T*N, 3*H);
+            dh.set_size(N, 1, 1, H);
+            dh = 0;
+            alias_tensor state(N, 1, 1, H), step(N, 3*H);
+            auto u = recurrent_weights(params, weights.size());
+            for (long t = T-1; t >= 0; --t)
+            {
+                tt::copy_tensor(true, dh, 0, gradient_input, t, 1);
+                auto dg = step(dgates, t*step.size());
+                auto dr = step(drecs, t*step.size());
+                auto g = step(gates, t*step.size());
+                auto r = step(recs, t*step.size());
+                auto h_prev = state(hidden, t*state.size());
+                tt::gru_cell_backward(dg, dr, dh, g, r, h_prev);
+                if (t != 0)
+                    tt::gemm(1,dh, 1,dr,false, u,true);
+            }
+
+            // no point computing the parameter gradients if they won't be used.
+            if (learning_rate_multiplier != 0)
+            {
+                auto pw = weights(params_grad, 0);
+                tt::gemm(0,pw, 1,xs,true, dgates,false);
+                alias_tensor prev_states(T*N, 1, 1, H);
+                auto h_prev = prev_states(hidden, 0);
+                auto pu = recurrent_weights(params_grad, weights.size());
+                tt::gemm(0,pu, 1,h_prev,true, drecs,false);
+                auto pb = biases(params_grad, bias_offset());
+                tt::assign_bias_gradient(pb, dgates);
+                auto prb = biases(params_grad, bias_offset()+biases.size());
+                tt::assign_bias_gradient(prb, drecs);
+            }
+
+            // compute the gradient for the data
+            auto w = weights(params, 0);
+            dxs.copy_size(xs);
+            tt::gemm(0,dxs, 1,dgates,false, w,true);
+            impl::add_time_major_to_sequence(sub.get_gradient_input(), dxs);
+        }
+
+        alias_tensor_instance get_weights() { return weights(params, 0); }
+        alias_tensor_const_instance get_weights() const { return weights(params, 0); }
+        alias_tensor_instance get_recurrent_weights() { return recurrent_weights(params, weights.size()); }
+        alias_tensor_const_instance get_recurrent_weights() const { return recurrent_weights(params, weights.size()); }
+        alias_tensor_instance get_biases() { return biases(params, bias_offset()); }
+        alias_tensor_const_instance get_biases() const { return biases(params, bias_offset()); }
+        alias_tensor_instance get_recurrent_biases() { return biases(params, bias_offset()+biases.size()); }
+        alias_tensor_const_instance get_recurrent_biases() const { return biases(params, bias_offset()+biases.size()); }
+
+        const tensor& get_layer_params() const { return params; }
+        tensor& get_layer_params() { return params; }
+
+        friend void serialize(const gru_& item, std::ostream& out)
+        {
+            serialize("gru_", out);
+            serialize(item.num_outputs, out);
+            serialize(item.num_inputs, out);
+            serialize(item.params, out);
+            serialize(item.weights, out);
+            serialize(item.recurrent_weights, out);
+            serialize(item.biases, out);
+            serialize(item.learning_rate_multiplier, out);
+            serialize(item.weight_decay_multiplier, out);
+        }
+
+        friend void deserialize(gru_& item, std::istream& in)
+        {
+            std::string version;
+            deserialize(version, in);
+            if (version != "gru_")
+                throw serialization_error("Unexpected version '"+version+"' found while deserializing dlib::gru_.");
+            deserialize(item.num_outputs, in);
+            deserialize(item.num_inputs, in);
+            deserialize(item.params, in);
+            deserialize(item.weights, in);
+            deserialize(item.recurrent_weights, in);
+            deserialize(item.biases, in);
+            deserialize(item.learning_rate_multiplier, in);
+            deserialize(item.weight_decay_multiplier, in);
+        }
+
+        friend std::ostream& operator<<(std::ostream& out, const gru_& item)
+        {
+            out << "gru\t ("
+                << "num_outputs="<<item.num_outputs
+                << ")";
+            out << " learning_rate_mult="<<item.learning_rate_multiplier;
+            out << " weight_decay_mult="<<item.weight_decay_multiplier;
+            return out;
+        }
+
+        friend void to_xml(const gru_& item, std::ostream& out)
+        {
+            out << "<gru"
+                << " num_outputs='"<<item.num_outputs<<"'"
+                << " learning_rate_mult='"<<item.learning_rate_multiplier<<"'"
+                << " weight_decay_mult='"<<item.weight_decay_multiplier<<"'";
+            out << ">\n";
+            out << mat(item.params);
+            out << "</gru>\n";
+        }
+
+    private:
+
+        size_t bias_offset() const { return weights.size() + recurrent_weights.size(); }
+
+        unsigned long num_outputs;
+        unsigned long num_inputs;
+        resizable_tensor params;
+        alias_tensor weights, recurrent_weights, biases;
+        double learning_rate_multiplier;
+        double weight_decay_multiplier;
+
+        // The state saved by forward() for backward(), all laid out one time step
+        // after the other.  hidden starts with the all zero initial state.
+        resizable_tensor xs, gates, recs, hidden;
+        resizable_tensor dgates, drecs, dxs, dh;
+    };
+
+    template <
+        unsigned long num_outputs,
+        typename SUBNET
+        >
+    using gru = add_layer<gru_<num_outputs>, SUBNET>;
+
+// ----------------------------------------------------------------------------------------
+
+    class dropout_
+    {
+    public:
+        explicit dropout_(
+            float drop_rate_ = 0.5
+        ) :
+            drop_rate(drop_rate_),
+            rnd(std::rand())
+        {
+            DLIB_CASSERT(0 <= drop_rate && drop_rate <= 1);
+        }
+
+        // We have to add a copy constructor and assignment operator because the rnd object
+        // is non-copyable.
+        dropout_(
+            const dropout_& item
+        ) : drop_rate(item.drop_rate), mask(item.mask), rnd(std::rand())
+        {}
+
+        dropout_& operator= (
+            const dropout_& item
+        )
+        {
+            if (this == &item)
+                return *this;
+
+            drop_rate = item.drop_rate;
+            mask = item.mask;
+            return *this;
+        }
+
+        float get_drop_rate (
+        ) const { return drop_rate; }
+
+        template <typename SUBNET>
+        void setup (const SUBNET& /*sub*/)
+        {
+        }
+
+        void set_recomputing (bool recomputing_) { recomputing = recomputing_; }
+
+        void forward_inplace(const tensor& input, tensor& output)
+        {
+            // create a random mask and use it to filter the data.  When recomputing,
+            // reuse the mask from the previous call so the output comes out the same.
+            if (!recomputing || !have_same_dimensions(mask, input))
+            {
+                mask.copy_size(input);
+                rnd.fill_uniform(mask);
+                tt::threshold(mask, drop_rate);
+            }
+            tt::multiply(false, output, input, mask);
+        } 
+
+        void backward_inplace(
+            const tensor& gradient_input, 
+            tensor& data_grad, 
+            tensor& /*params_grad*/
+        )
+        {
+            if (is_same_object(gradient_input, data_grad))
+                tt::multiply(false, data_grad, mask, gradient_input);
+            else
+                tt::multiply(true, data_grad, mask, gradient_input);
+        }
+
+        inline dpoint map_input_to_output (const dpoint& p) const { return p; }
+        inline dpoint map_output_to_input (const dpoint& p) const { return p; }
+
+        const tensor& get_layer_params() const { return params; }
+        tensor& get_layer_params() { return params; }
+
+        friend void serialize(const dropout_& item, std::ostream& out)
+        {
+            serialize("dropout_", out);
+            serialize(item.drop_rate, out);
+            serialize(item.mask, out);
+        }
+
+        friend void deserialize(dropout_& item, std::istream& in)
+        {
+            std::string version;
+            deserialize(version, in);
+            if (version != "dropout_")
+                throw serialization_error("Unexpected version '"+version+"' found while deserializing dlib::dropout_.");
+            deserialize(item.drop_rate, in);
+            deserialize(item.mask, in);
+        }
+
+        void clean(
+        ) 
+        {
+            mask.clear();
+        }
+
+        friend std::ostream& operator<<(std::ostream& out, const dropout_& item)
+        {
+            out << "dropout\t ("
+                << "drop_rate="<<item.drop_rate
+                << ")";
+            return out;
+        }
+
+        friend void to_xml(const dropout_& item, std::ostream& out)
+        {
+            out << "<dropout"
+                << " drop_rate='"<<item.drop_rate<<"'";
+            out << "/>\n";
+        }
+
+    private:
+        float drop_rate;
+        resizable_tensor mask;
+        bool recomputing = false;
+
+        tt::tensor_rand rnd;
+        resizable_tensor params; // unused
+    };
+
+
+    template <typename SUBNET>
+    using dropout = add_layer<dropout_, SUBNET>;
+
+// ----------------------------------------------------------------------------------------
+
+    class multiply_
+    {
+    public:
+        explicit multiply_(
             float val_ = 0.5
         ) :
             val(val_)
@@ -1895,13 +2659,13 @@ namespace dlib
     {
     public:
         affine_(
-        ) : mode(FC_MODE)
+        ) : mode(FC_MODE), disabled(false)
         {
         }
 
         affine_(
             layer_mode mode_
-        ) : mode(mode_)
+        ) : mode(mode_), disabled(false)
         {
         }
 
@@ -1910,7 +2674,7 @@ namespace dlib
             >
         affine_(
             const bn_<bnmode>& item
-        )
+        ) : disabled(false)
         {
             gamma = item.gamma;
             beta = item.beta;
@@ -1931,12 +2695,27 @@ namespace dlib
 
         layer_mode get_mode() const { return mode; }
 
+        alias_tensor_const_instance get_gamma() const { return gamma(params,0); }
+        alias_tensor_const_instance get_beta() const { return beta(params,gamma.size()); }
+
+        bool is_disabled() const { return disabled; }
+        void disable()
+        {
+            params.clear();
+            gamma = alias_tensor();
+            beta = alias_tensor();
+            disabled = true;
+        }
+
         inline dpoint map_input_to_output (const dpoint& p) const { return p; }
         inline dpoint map_output_to_input (const dpoint& p) const { return p; }
 
         template <typename SUBNET>
         void setup (const SUBNET& sub)
         {
+            if (disabled)
+                return;
+
             if (mode == FC_MODE)
             {
                 gamma = alias_tensor(1,
@@ -1958,6 +2737,13 @@ namespace dlib
 
         void forward_inplace(const tensor& input, tensor& output)
         {
+            if (disabled)
+            {
+                if (!is_same_object(input, output))
+                    memcpy(output, input);
+                return;
+            }
+
             auto g = gamma(params,0);
             auto b = beta(params,gamma.size());
             if (mode == FC_MODE)
@@ -1972,6 +2758,13 @@ namespace dlib
             tensor& /*params_grad*/
         )
         {
+            if (disabled)
+            {
+                if (!is_same_object(gradient_input, data_grad))
+                    tt::add(data_grad, data_grad, gradient_input);
+                return;
+            }
+
             auto g = gamma(params,0);
             auto b = beta(params,gamma.size());
 
@@ -1997,11 +2790,15 @@ namespace dlib
 
         friend void serialize(const affine_& item, std::ostream& out)
         {
-            serialize("affine_", out);
+            // Only layers disabled by fuse_layers() need the new version, so everything
+            // else stays readable by older versions of dlib.
+            serialize(std::string(item.disabled ? "affine_2" : "affine_"), out);
             serialize(item.params, out);
             serialize(item.gamma, out);
             serialize(item.beta, out);
             serialize((int)item.mode, out);
+            if (item.disabled)
+                serialize(item.disabled, out);
         }
 
         friend void deserialize(affine_& item, std::istream& in)
@@ -2029,7 +2826,7 @@ namespace dlib
                 return;
             }
 
-            if (version != "affine_")
+            if (version != "affine_" && version != "affine_2")
                 throw serialization_error("Unexpected version '"+version+"' found while deserializing dlib::affine_.");
             deserialize(item.params, in);
             deserialize(item.gamma, in);
@@ -2037,16 +2834,27 @@ namespace dlib
             int mode;
             deserialize(mode, in);
             item.mode = (layer_mode)mode;
+            item.disabled = false;
+            if (version == "affine_2")
+                deserialize(item.disabled, in);
         }
 
-        friend std::ostream& operator<<(std::ostream& out, const affine_& )
+        friend std::ostream& operator<<(std::ostream& out, const affine_& item)
         {
             out << "affine";
+            if (item.disabled)
+                out << "\t (disabled)";
             return out;
         }
 
         friend void to_xml(const affine_& item, std::ostream& out)
         {
+            if (item.disabled)
+            {
+                out << "<affine_disabled/>\n";
+                return;
+            }
+
             if (item.mode==CONV_MODE)
                 out << "<affine_con>\n";
             else
@@ -2064,6 +2872,7 @@ namespace dlib
         resizable_tensor params, empty_params; 
         alias_tensor gamma, beta;
         layer_mode mode;
+        bool disabled;
     };
 
     template <typename SUBNET>
@@ -2277,10 +3086,13 @@ namespace dlib
     class relu_
     {
     public:
-        relu_() 
+        relu_() : disabled(false)
         {
         }
 
+        bool is_disabled() const { return disabled; }
+        void disable() { disabled = true; }
+
         template <typename SUBNET>
         void setup (const SUBNET& /*sub*/)
         {
@@ -2288,6 +3100,13 @@ namespace dlib
 
         void forward_inplace(const tensor& input, tensor& output)
         {
+            if (disabled)
+            {
+                if (!is_same_object(input, output))
+                    memcpy(output, input);
+                return;
+            }
+
             tt::relu(output, input);
         } 
 
@@ -2298,6 +3117,14 @@ namespace dlib
             tensor& 
         )
         {
+            if (disabled)
+            {
+                if (is_same_object(gradient_input, data_grad))
+                    return;
+                tt::add(data_grad, data_grad, gradient_input);
+                return;
+            }
+
             tt::relu_gradient(data_grad, computed_output, gradient_input);
         }
 
@@ -2307,32 +3134,57 @@ namespace dlib
         const tensor& get_layer_params() const { return params; }
         tensor& get_layer_params() { return params; }
 
-        friend void serialize(const relu_& , std::ostream& out)
+        friend void serialize(const relu_& item, std::ostream& out)
         {
-            serialize("relu_", out);
+            // As with affine_, only a disabled relu_ needs the new version.
+            if (item.disabled)
+            {
+                serialize("relu_2", out);
+                serialize(item.disabled, out);
+            }
+            else
+            {
+                serialize("relu_", out);
+            }
         }
 
-        friend void deserialize(relu_& , std::istream& in)
+        friend void deserialize(relu_& item, std::istream& in)
         {
             std::string version;
             deserialize(version, in);
-            if (version != "relu_")
+            if (version == "relu_")
+            {
+                item.disabled = false;
+            }
+            else if (version == "relu_2")
+            {
+                deserialize(item.disabled, in);
+            }
+            else
+            {
                 throw serialization_error("Unexpected version '"+version+"' found while deserializing dlib::relu_.");
+            }
         }
 
-        friend std::ostream& operator<<(std::ostream& out, const relu_& )
+        friend std::ostream& operator<<(std::ostream& out, const relu_& item)
         {
             out << "relu";
+            if (item.disabled)
+                out << "\t (disabled)";
             return out;
         }
 
-        friend void to_xml(const relu_& /*item*/, std::ostream& out)
+        friend void to_xml(const relu_& item, std::ostream& out)
         {
-            out << "<relu/>\n";
+            if (item.disabled)
+                out << "<relu_disabled/>\n";
+            else
+                out << "<relu/>\n";
         }
 
     private:
         resizable_tensor params;
+        bool disabled;
     };
 
 
@@ -3114,6 +3966,342 @@ namespace dlib
         >
     using extract = add_layer<extract_<offset,k,nr,nc>, SUBNET>;
 
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        class visitor_fuse_affine
+        {
+        public:
+
+            template <typename T>
+            void operator()(size_t , T& ) const
+            {
+                // Only affine_ layers sitting directly on top of something they can be
+                // folded into are interesting.  Everything else is left alone.
+            }
+
+            template <typename U, typename E>
+            void operator()(size_t , add_layer<affine_,U,E>& l) const
+            {
+                affine_& a = l.layer_details();
+                if (a.is_disabled() || a.get_gamma().get().size() == 0)
+                    return;
+                if (fuse(a, l.subnet()))
+                    a.disable();
+            }
+
+        private:
+
+            template <typename T>
+            static bool fuse (const affine_&, T&) { return false; }
+
+            template <long nf, long nr, long nc, int sy, int sx, int py, int px, long ng, int dy, int dx, typename U, typename E>
+            static bool fuse (
+                const affine_& a,
+                add_layer<con_<nf,nr,nc,sy,sx,py,px,ng,dy,dx>,U,E>& l
+            )
+            {
+                auto& c = l.layer_details();
+                // The affine_ has to be applied to the convolution's output before the
+                // relu, so if a relu has already been fused into c we can't do anything.
+                if (a.get_mode() != CONV_MODE || c.get_layer_params().size() == 0 ||
+                    c.relu_is_enabled() || c.is_quantized())
+                    return false;
+
+                auto filters = c.get_filters();
+                auto biases = c.get_biases();
+                // get() refers into the alias instance so keep the instances alive.
+                const auto gamma = a.get_gamma();
+                const auto beta = a.get_beta();
+                const tensor& g = gamma.get();
+                const tensor& b = beta.get();
+                DLIB_CASSERT(g.size() == (size_t)filters.num_samples());
+
+                // out = g*(conv(x,f)+bias)+b == conv(x,g*f) + (g*bias+b)
+                const long filter_size = filters.k()*filters.nr()*filters.nc();
+                float* f = filters.host();
+                float* bias = biases.host();
+                const float* gg = g.host();
+                const float* bb = b.host();
+                for (long n = 0; n < filters.num_samples(); ++n)
+                {
+                    for (long i = 0; i < filter_size; ++i)
+                        f[n*filter_size + i] *= gg[n];
+                    bias[n] = gg[n]*bias[n] + bb[n];
+                }
+                return true;
+            }
+
+            template <unsigned long no, typename U, typename E>
+            static bool fuse (
+                const affine_& a,
+                add_layer<fc_<no,FC_HAS_BIAS>,U,E>& l
+            )
+            {
+                auto& fc = l.layer_details();
+                if (fc.get_layer_params().size() == 0 || fc.is_quantized())
+                    return false;
+
+                auto weights = fc.get_weights();
+                auto biases = fc.get_biases();
+                // get() refers into the alias instance so keep the instances alive.
+                const auto gamma = a.get_gamma();
+                const auto beta = a.get_beta();
+                const tensor& g = gamma.get();
+                const tensor& b = beta.get();
+                // The fc_ output is a num_samples by num_outputs matrix, so both affine_
+                // modes scale each output independently.
+                DLIB_CASSERT(g.size() == (size_t)weights.k());
+
+                const long num_outputs = weights.k();
+                float* w = weights.host();
+                float* bias = biases.host();
+                const float* gg = g.host();
+                const float* bb = b.host();
+                for (long i = 0; i < weights.num_samples(); ++i)
+                {
+                    for (long j = 0; j < num_outputs; ++j)
+                        w[i*num_outputs + j] *= gg[j];
+                }
+                for (long j = 0; j < num_outputs; ++j)
+                    bias[j] = gg[j]*bias[j] + bb[j];
+                return true;
+            }
+        };
+
+        class visitor_fuse_relu
+        {
+        public:
+
+            template <typename T>
+            void operator()(size_t , T& ) const
+            {
+            }
+
+            template <typename U, typename E>
+            void operator()(size_t , add_layer<relu_,U,E>& l) const
+            {
+                if (!l.layer_details().is_disabled() && fuse(l.subnet()))
+                    l.layer_details().disable();
+            }
+
+        private:
+
+            template <typename T>
+            static bool fuse (T&) { return false; }
+
+            template <long nf, long nr, long nc, int sy, int sx, int py, int px, long ng, int dy, int dx, typename U, typename E>
+            static bool fuse (
+                add_layer<con_<nf,nr,nc,sy,sx,py,px,ng,dy,dx>,U,E>& l
+            )
+            {
+                if (l.layer_details().get_layer_params().size() == 0)
+                    return false;
+                l.layer_details().enable_relu();
+                return true;
+            }
+
+            template <typename U, typename E>
+            static bool fuse (
+                add_layer<affine_,U,E>& l
+            )
+            {
+                // A disabled affine_ is the identity, so look through it.
+                if (l.layer_details().is_disabled())
+                    return fuse(l.subnet());
+                return false;
+            }
+        };
+    }
+
+    template <typename net_type>
+    void fuse_layers (
+        net_type& net
+    )
+    {
+        // Fold the affine_ layers first since a relu can only be merged into a con_ once
+        // there is no longer an enabled affine_ between them.
+        visit_layers(net, impl::visitor_fuse_affine());
+        visit_layers(net, impl::visitor_fuse_relu());
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        class visitor_record_input_range
+        {
+        public:
+
+            visitor_record_input_range(
+                std::vector<float>& ranges_,
+                const tensor& net_input_
+            ) : ranges(ranges_), net_input(net_input_) {}
+
+            template <typename T>
+            void operator()(size_t , T& ) const
+            {
+            }
+
+            template <long nf, long nr, long nc, int sy, int sx, int py, int px, long ng, int dy, int dx, typename U, typename E>
+            void operator()(size_t i, add_layer<con_<nf,nr,nc,sy,sx,py,px,ng,dy,dx>,U,E>& l) const
+            {
+                record(i, layer_input(l, std::integral_constant<bool,is_nonloss_layer_type<U>::value>()));
+            }
+
+            template <unsigned long no, fc_bias_mode bm, typename U, typename E>
+            void operator()(size_t i, add_layer<fc_<no,bm>,U,E>& l) const
+            {
+                record(i, layer_input(l, std::integral_constant<bool,is_nonloss_layer_type<U>::value>()));
+            }
+
+        private:
+
+            template <typename T>
+            static const tensor& layer_input(T& l, std::true_type) { return l.subnet().get_output(); }
+
+            // Layers sitting directly on the input layer don't keep their input around,
+            // but it's just the tensor that was given to the network.
+            template <typename T>
+            const tensor& layer_input(T& , std::false_type) const { return net_input; }
+
+            void record(size_t i, const tensor& t) const
+            {
+                if (ranges.size() <= i)
+                    ranges.resize(i+1, 0);
+                ranges[i] = std::max(ranges[i], max(abs(mat(t))));
+            }
+
+            std::vector<float>& ranges;
+            const tensor& net_input;
+        };
+
+        class visitor_quantize
+        {
+        public:
+
+            visitor_quantize(const std::vector<float>& ranges_) : ranges(ranges_) {}
+
+            template <typename T>
+            void operator()(size_t , T& ) const
+            {
+            }
+
+            template <long nf, long nr, long nc, int sy, int sx, int py, int px, long ng, int dy, int dx, typename U, typename E>
+            void operator()(size_t i, add_layer<con_<nf,nr,nc,sy,sx,py,px,ng,dy,dx>,U,E>& l) const
+            {
+                // The int8 kernels don't do grouped convolutions, so those layers stay in
+                // floating point.
+                if (ng == 1)
+                    quantize(i, l.layer_details());
+            }
+
+            template <unsigned long no, fc_bias_mode bm, typename U, typename E>
+            void operator()(size_t i, add_layer<fc_<no,bm>,U,E>& l) const
+            {
+                quantize(i, l.layer_details());
+            }
+
+        private:
+
+            template <typename layer_type>
+            void quantize(size_t i, layer_type& l) const
+            {
+                // Layers that never saw any non-zero input during calibration are left in
+                // floating point since there is nothing to pick a scale from.
+                if (i < ranges.size() && ranges[i] > 0 && !l.is_quantized() && l.get_layer_params().size() != 0)
+                    l.quantize(ranges[i]/127);
+            }
+
+            const std::vector<float>& ranges;
+        };
+
+        // The part of a network that produces its output tensor.  That's everything
+        // below the loss layer, or the whole network if it doesn't have one.
+        template <typename net_type>
+        typename std::enable_if<is_loss_layer_type<net_type>::value, typename net_type::subnet_type&>::type
+        output_layer (
+            net_type& net
+        ) { return net.subnet(); }
+
+        template <typename net_type>
+        typename std::enable_if<!is_loss_layer_type<net_type>::value, net_type&>::type
+        output_layer (
+            net_type& net
+        ) { return net; }
+    }
+
+    template <
+        typename net_type,
+        typename forward_iterator
+        >
+    void quantize_layers (
+        net_type& net,
+        forward_iterator ibegin,
+        forward_iterator iend,
+        size_t mini_batch_size = 32
+    )
+    {
+        DLIB_CASSERT(std::distance(ibegin,iend) > 0 && mini_batch_size > 0);
+
+        // Run the calibration samples through the network and record, for each con_ and
+        // fc_ layer, the largest input magnitude it sees.  That becomes the range the
+        // layer's input is quantized over.
+        std::vector<float> ranges;
+        resizable_tensor temp;
+        while (ibegin != iend)
+        {
+            auto end = ibegin;
+            std::advance(end, std::min<size_t>(mini_batch_size, std::distance(ibegin,iend)));
+            net.to_tensor(ibegin, end, temp);
+            impl::output_layer(net).forward(temp);
+            visit_layers(net, impl::visitor_record_input_range(ranges, temp));
+            ibegin = end;
+        }
+
+        visit_layers(net, impl::visitor_quantize(ranges));
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename net_type1,
+        typename net_type2,
+        typename forward_iterator
+        >
+    matrix<double,1,3> test_output_drift (
+        net_type1& reference_net,
+        net_type2& net,
+        forward_iterator ibegin,
+        forward_iterator iend
+    )
+    {
+        running_stats<double> rs_diff, rs_ref;
+        double max_diff = 0;
+        resizable_tensor temp;
+        for (; ibegin != iend; ++ibegin)
+        {
+            reference_net.to_tensor(ibegin, std::next(ibegin), temp);
+            const matrix<float> ref = mat(impl::output_layer(reference_net).forward(temp));
+            net.to_tensor(ibegin, std::next(ibegin), temp);
+            const matrix<float> out = mat(impl::output_layer(net).forward(temp));
+            DLIB_CASSERT(ref.size() == out.size(), "The two networks must produce outputs of the same size.");
+
+            for (long i = 0; i < ref.size(); ++i)
+            {
+                const double diff = std::abs(ref(i)-out(i));
+                rs_diff.add(diff);
+                rs_ref.add(std::abs(ref(i)));
+                max_diff = std::max(max_diff, diff);
+            }
+        }
+
+        matrix<double,1,3> res;
+        res = rs_diff.mean(), max_diff, rs_diff.mean()/std::max(rs_ref.mean(), 1e-30);
+        return res;
+    }
+
 // ----------------------------------------------------------------------------------------
 
 }
@@ -372,6 +372,24 @@ namespace dlib
                   information before saving the network to disk.  
         !*/
 
+        void set_recomputing (
+            bool recomputing
+        );
+        /*!
+            Implementing this function is optional.  If you don't need it then you don't
+            have to provide a set_recomputing().  But if you do provide it then it must
+            behave as follows:
+
+            ensures
+                - While recomputing is true, forward() (or forward_inplace()) is only
+                  being called again on the same input as the previous call, to get back
+                  the values backward() needs.  checkpoint does this during
+                  back_propagate_error().  So in this mode forward() must produce the same
+                  output as that previous call and must not change any state backward()
+                  doesn't need.  E.g. bn_ doesn't update its running statistics and
+                  dropout_ reuses its last mask.
+        !*/
+
     };
 
     std::ostream& operator<<(std::ostream& out, const EXAMPLE_COMPUTATIONAL_LAYER_& item);
@@ -449,6 +467,7 @@ namespace dlib
                 - #get_weight_decay_multiplier()       == 1
                 - #get_bias_learning_rate_multiplier() == 1
                 - #get_bias_weight_decay_multiplier()  == 0
+                - #is_quantized() == false
         !*/
 
         fc_(
@@ -462,6 +481,7 @@ namespace dlib
                 - #get_weight_decay_multiplier()       == 1
                 - #get_bias_learning_rate_multiplier() == 1
                 - #get_bias_weight_decay_multiplier()  == 0
+                - #is_quantized() == false
         !*/
 
         unsigned long get_num_outputs (
@@ -576,6 +596,8 @@ namespace dlib
         alias_tensor_const_instance get_weights(
         ) const;
         /*!
+            requires
+                - is_quantized() == false
             ensures
                 - returns an alias of get_layer_params(), containing the weights matrix of
                   the fully connected layer.
@@ -591,6 +613,8 @@ namespace dlib
         alias_tensor_instance get_weights(
         );
         /*!
+            requires
+                - is_quantized() == false
             ensures
                 - returns an alias of get_layer_params(), containing the weights matrix of
                   the fully connected layer.
@@ -629,6 +653,49 @@ namespace dlib
                 - #get_layer_params().size() == (#get_weights().size() + #get_biases().size())
         !*/
 
+        bool is_quantized(
+        ) const;
+        /*!
+            ensures
+                - returns true if quantize() has been called on this layer.  A quantized
+                  layer does its matrix multiply with 8 bit integer arithmetic and no longer
+                  stores its weights in floating point.  So in that case
+                  get_layer_params() only contains the biases.
+        !*/
+
+        float get_input_scale(
+        ) const;
+        /*!
+            ensures
+                - if (is_quantized()) then
+                    - returns the scale used to quantize the input of this layer.  That
+                      is, inputs are mapped to the integers in [-127,127] by dividing them
+                      by get_input_scale(), so inputs outside the range
+                      [-127,127]*get_input_scale() are clipped.
+                - else
+                    - returns 0
+        !*/
+
+        void quantize (
+            float input_scale
+        );
+        /*!
+            requires
+                - input_scale > 0
+                - get_layer_params().size() != 0
+                - is_quantized() == false
+            ensures
+                - Converts the weights of this layer to 8 bit integers, using a separate
+                  scale for each output, and makes forward() quantize its input using
+                  input_scale and then compute the layer with integer arithmetic.  This
+                  shrinks the memory needed for the weights by a factor of 4 and is
+                  usually faster.  The quantized layer can only be used for inference,
+                  backward() must not be called on it.  The quantized computation always
+                  runs on the CPU, even when dlib is built with CUDA.
+                - #is_quantized() == true
+                - #get_input_scale() == input_scale
+        !*/
+
         template <typename SUBNET> void setup (const SUBNET& sub);
         template <typename SUBNET> void forward(const SUBNET& sub, resizable_tensor& output);
         template <typename SUBNET> void backward(const tensor& gradient_input, SUBNET& sub, tensor& params_grad);
@@ -652,6 +719,303 @@ namespace dlib
         >
     using fc_no_bias = add_layer<fc_<num_outputs,FC_NO_BIAS>, SUBNET>;
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        unsigned long num_outputs
+        >
+    class lstm_
+    {
+        /*!
+            REQUIREMENTS ON num_outputs
+                num_outputs > 0
+
+            WHAT THIS OBJECT REPRESENTS
+                This is an implementation of the EXAMPLE_COMPUTATIONAL_LAYER_ interface
+                defined above.  In particular, it defines a long short-term memory
+                recurrent layer.  It treats each input sample as a sequence with one time
+                step per channel.  That is, the input vector at time step t is the
+                nr()*nc() values in channel t of the sample.  The layer runs an LSTM with
+                get_num_outputs() units over the sequence, starting from an all zero state,
+                and outputs the hidden state of every time step.
+
+                Each time step computes all four gates with a single matrix multiply and
+                then applies the non-linearities in one fused pass (see
+                tt::lstm_cell_forward()).  The part of the gates that only depends on the
+                input is computed for all the time steps with one matrix multiply before
+                stepping through time.  backward() does full back-propagation through time.
+
+                The dimensions of the tensors output by this layer are as follows (letting
+                IN be the input tensor and OUT the output tensor):
+                    - OUT.num_samples() == IN.num_samples()
+                    - OUT.k()  == IN.k()    (the number of time steps)
+                    - OUT.nr() == 1
+                    - OUT.nc() == get_num_outputs()
+                So lstm layers can be stacked, and a fc layer on top of the last one sees
+                the whole output sequence.  To only use the last time step's output, put
+                an extract layer that picks out its get_num_outputs() values, i.e.
+                extract<(T-1)*num_outputs,1,1,num_outputs> where T is the number of time
+                steps.
+        !*/
+
+    public:
+
+        lstm_(
+        );
+        /*!
+            ensures
+                - #get_num_outputs() == num_outputs
+                - #get_learning_rate_multiplier() == 1
+                - #get_weight_decay_multiplier()  == 1
+        !*/
+
+        unsigned long get_num_outputs (
+        ) const; 
+        /*!
+            ensures
+                - returns the number of units in the LSTM, i.e. the size of its hidden
+                  state.
+        !*/
+
+        void set_num_outputs(
+            long num
+        );
+        /*!
+            requires
+                - num > 0
+                - get_layer_params().size() == 0 || get_num_outputs() == num
+                  (i.e. You can't change the number of outputs in lstm_ if the parameter
+                  tensor has already been allocated.)
+            ensures
+                - #get_num_outputs() == num
+        !*/
+
+        double get_learning_rate_multiplier(
+        ) const;  
+        /*!
+            ensures
+                - returns a multiplier number.  The interpretation is that this object is
+                  requesting that the learning rate used to optimize its parameters be
+                  multiplied by get_learning_rate_multiplier().
+        !*/
+
+        double get_weight_decay_multiplier(
+        ) const; 
+        /*!
+            ensures
+                - returns a multiplier number.  The interpretation is that this object is
+                  requesting that the weight decay used to optimize its parameters be
+                  multiplied by get_weight_decay_multiplier().
+        !*/
+
+        void set_learning_rate_multiplier(
+            double val
+        );
+        /*!
+            requires
+                - val >= 0
+            ensures
+                - #get_learning_rate_multiplier() == val
+        !*/
+
+        void set_weight_decay_multiplier(
+            double val
+        ); 
+        /*!
+            requires
+                - val >= 0
+            ensures
+                - #get_weight_decay_multiplier() == val
+        !*/
+
+        alias_tensor_const_instance get_weights(
+        ) const;
+        alias_tensor_instance get_weights(
+        );
+        /*!
+            ensures
+                - returns an alias of get_layer_params() containing the matrix that
+                  multiplies the input of each time step.  It has one row for each of the
+                  nr()*nc() input values and 4*get_num_outputs() columns, holding the input,
+                  forget, cell, and output gates in that order.
+        !*/
+
+        alias_tensor_const_instance get_recurrent_weights(
+        ) const;
+        alias_tensor_instance get_recurrent_weights(
+        );
+        /*!
+            ensures
+                - returns an alias of get_layer_params() containing the get_num_outputs()
+                  by 4*get_num_outputs() matrix that multiplies the previous hidden state.
+                  Its columns are ordered like those of get_weights().
+        !*/
+
+        alias_tensor_const_instance get_biases(
+        ) const;
+        alias_tensor_instance get_biases(
+        );
+        /*!
+            ensures
+                - returns an alias of get_layer_params() containing the 4*get_num_outputs()
+                  gate biases, ordered like the columns of get_weights().  setup()
+                  initializes the forget gate biases to 1 and the others to 0.
+                - get_layer_params().size() == get_weights().size() +
+                  get_recurrent_weights().size() + get_biases().size()
+        !*/
+
+        template <typename SUBNET> void setup (const SUBNET& sub);
+        template <typename SUBNET> void forward(const SUBNET& sub, resizable_tensor& output);
+        template <typename SUBNET> void backward(const tensor& gradient_input, SUBNET& sub, tensor& params_grad);
+        const tensor& get_layer_params() const; 
+        tensor& get_layer_params(); 
+        /*!
+            These functions are implemented as described in the EXAMPLE_COMPUTATIONAL_LAYER_ interface.
+        !*/
+
+    };
+
+    template <
+        unsigned long num_outputs,
+        typename SUBNET
+        >
+    using lstm = add_layer<lstm_<num_outputs>, SUBNET>;
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        unsigned long num_outputs
+        >
+    class gru_
+    {
+        /*!
+            REQUIREMENTS ON num_outputs
+                num_outputs > 0
+
+            WHAT THIS OBJECT REPRESENTS
+                This is an implementation of the EXAMPLE_COMPUTATIONAL_LAYER_ interface
+                defined above.  In particular, it defines a gated recurrent unit layer.  It
+                works on sequences laid out the same way as lstm_ and its output has the
+                same dimensions.  For each time step it computes:
+                    - z == sigmoid(Wz*x + bz + Uz*h_prev + cz)
+                    - r == sigmoid(Wr*x + br + Ur*h_prev + cr)
+                    - n == tanh(Wn*x + bn + r*(Un*h_prev + cn))
+                    - h == (1-z)*n + z*h_prev
+                where x is the input at the time step and h_prev is the previous hidden
+                state, which is all zeros at the first time step.  The W matrices and b
+                vectors are get_weights() and get_biases() and the U matrices and c vectors
+                are get_recurrent_weights() and get_recurrent_biases().
+
+                Like lstm_, all the gates of a time step are computed with one matrix
+                multiply followed by one fused pass (see tt::gru_cell_forward()) and
+                backward() does full back-propagation through time.
+        !*/
+
+    public:
+
+        gru_(
+        );
+        /*!
+            ensures
+                - #get_num_outputs() == num_outputs
+                - #get_learning_rate_multiplier() == 1
+                - #get_weight_decay_multiplier()  == 1
+        !*/
+
+        unsigned long get_num_outputs (
+        ) const; 
+        /*!
+            ensures
+                - returns the number of units in the GRU, i.e. the size of its hidden
+                  state.
+        !*/
+
+        void set_num_outputs(
+            long num
+        );
+        /*!
+            requires
+                - num > 0
+                - get_layer_params().size() == 0 || get_num_outputs() == num
+                  (i.e. You can't change the number of outputs in gru_ if the parameter
+                  tensor has already been allocated.)
+            ensures
+                - #get_num_outputs() == num
+        !*/
+
+        double get_learning_rate_multiplier(
+        ) const;  
+        double get_weight_decay_multiplier(
+        ) const; 
+        void set_learning_rate_multiplier(
+            double val
+        );
+        void set_weight_decay_multiplier(
+            double val
+        ); 
+        /*!
+            These functions behave the same as the ones in lstm_.
+        !*/
+
+        alias_tensor_const_instance get_weights(
+        ) const;
+        alias_tensor_instance get_weights(
+        );
+        /*!
+            ensures
+                - returns an alias of get_layer_params() containing the matrix that
+                  multiplies the input of each time step.  It has one row for each of the
+                  nr()*nc() input values and 3*get_num_outputs() columns, holding the
+                  update, reset, and new gates in that order.
+        !*/
+
+        alias_tensor_const_instance get_recurrent_weights(
+        ) const;
+        alias_tensor_instance get_recurrent_weights(
+        );
+        /*!
+            ensures
+                - returns an alias of get_layer_params() containing the get_num_outputs()
+                  by 3*get_num_outputs() matrix that multiplies the previous hidden state.
+                  Its columns are ordered like those of get_weights().
+        !*/
+
+        alias_tensor_const_instance get_biases(
+        ) const;
+        alias_tensor_instance get_biases(
+        );
+        alias_tensor_const_instance get_recurrent_biases(
+        ) const;
+        alias_tensor_instance get_recurrent_biases(
+        );
+        /*!
+            ensures
+                - return aliases of get_layer_params() containing the 3*get_num_outputs()
+                  biases added to the input and to the recurrent parts of the gates.  They
+                  are ordered like the columns of get_weights() and setup() initializes
+                  them to 0.
+                - get_layer_params().size() == get_weights().size() +
+                  get_recurrent_weights().size() + get_biases().size() +
+                  get_recurrent_biases().size()
+        !*/
+
+        template <typename SUBNET> void setup (const SUBNET& sub);
+        template <typename SUBNET> void forward(const SUBNET& sub, resizable_tensor& output);
+        template <typename SUBNET> void backward(const tensor& gradient_input, SUBNET& sub, tensor& params_grad);
+        const tensor& get_layer_params() const; 
+        tensor& get_layer_params(); 
+        /*!
+            These functions are implemented as described in the EXAMPLE_COMPUTATIONAL_LAYER_ interface.
+        !*/
+
+    };
+
+    template <
+        unsigned long num_outputs,
+        typename SUBNET
+        >
+    using gru = add_layer<gru_<num_outputs>, SUBNET>;
+
 // ----------------------------------------------------------------------------------------
 
     struct num_con_outputs
@@ -667,7 +1031,10 @@ namespace dlib
         int _stride_y,
         int _stride_x,
         int _padding_y = _stride_y!=1? 0 : _nr/2,
-        int _padding_x = _stride_x!=1? 0 : _nc/2
+        int _padding_x = _stride_x!=1? 0 : _nc/2,
+        long _groups = 1,
+        int _dilation_y = 1,
+        int _dilation_x = 1
         >
     class con_
     {
@@ -680,15 +1047,21 @@ namespace dlib
                 - _stride_x > 0
                 - _padding_y >= 0
                 - _padding_x >= 0
+                - _groups > 0
+                - _num_filters % _groups == 0
+                - _dilation_y > 0
+                - _dilation_x > 0
                 - Also, we require that:
                     - if (_nr == 0) then
                         - _padding_y == 0
+                        - _dilation_y == 1
                     - else
-                        - _padding_y < _nr
+                        - _padding_y < _dilation_y*(_nr-1)+1
                     - if (_nc == 0) then
                         - _padding_x == 0
+                        - _dilation_x == 1
                     - else
-                        - _padding_x < _nc
+                        - _padding_x < _dilation_x*(_nc-1)+1
 
             WHAT THIS OBJECT REPRESENTS
                 This is an implementation of the EXAMPLE_COMPUTATIONAL_LAYER_ interface
@@ -700,8 +1073,8 @@ namespace dlib
                 IN be the input tensor and OUT the output tensor):
                     - OUT.num_samples() == IN.num_samples()
                     - OUT.k()  == num_filters()
-                    - OUT.nr() == 1+(IN.nr() + 2*padding_y() - nr())/stride_y()
-                    - OUT.nc() == 1+(IN.nc() + 2*padding_x() - nc())/stride_x()
+                    - OUT.nr() == 1+(IN.nr() + 2*padding_y() - (dilation_y()*(nr()-1)+1))/stride_y()
+                    - OUT.nc() == 1+(IN.nc() + 2*padding_x() - (dilation_x()*(nc()-1)+1))/stride_x()
 
                 Note also that setting _nr or _nc to 0 has a special meaning of "set the
                 filter size equal to the input image size".  Specifically, it means: 
@@ -711,6 +1084,20 @@ namespace dlib
                     - if (_nc == 0) then
                         - nc() == IN.nc()
                         - OUT.nc() == 1
+
+                If _groups > 1 this is a grouped convolution.  The input channels and the
+                filters are split into _groups equally sized consecutive groups and each
+                filter only looks at the input channels in its own group, so IN.k() must
+                be divisible by _groups.  Setting _groups equal to both IN.k() and
+                num_filters() gives a depthwise convolution, where each channel is
+                convolved with its own filter.  These are much cheaper than ordinary
+                convolutions and are the building blocks of MobileNet style networks.
+
+                If _dilation_y or _dilation_x are > 1 this is a dilated (or atrous)
+                convolution.  The filter taps are then spread out so that neighboring taps
+                are applied to input pixels _dilation_y rows and _dilation_x columns apart.
+                This grows the receptive field of the layer without adding parameters or
+                reducing the output resolution.
         !*/
 
     public:
@@ -725,10 +1112,15 @@ namespace dlib
                 - #stride_x() == _stride_x
                 - #padding_y() == _padding_y
                 - #padding_x() == _padding_x
+                - #groups() == _groups
+                - #dilation_y() == _dilation_y
+                - #dilation_x() == _dilation_x
                 - #get_learning_rate_multiplier()      == 1
                 - #get_weight_decay_multiplier()       == 1
                 - #get_bias_learning_rate_multiplier() == 1
                 - #get_bias_weight_decay_multiplier()  == 0
+                - #relu_is_enabled() == false
+                - #is_quantized() == false
         !*/
 
         con_(
@@ -743,10 +1135,15 @@ namespace dlib
                 - #stride_x() == _stride_x
                 - #padding_y() == _padding_y
                 - #padding_x() == _padding_x
+                - #groups() == _groups
+                - #dilation_y() == _dilation_y
+                - #dilation_x() == _dilation_x
                 - #get_learning_rate_multiplier()      == 1
                 - #get_weight_decay_multiplier()       == 1
                 - #get_bias_learning_rate_multiplier() == 1
                 - #get_bias_weight_decay_multiplier()  == 0
+                - #relu_is_enabled() == false
+                - #is_quantized() == false
         !*/
 
         long num_filters(
@@ -827,6 +1224,30 @@ namespace dlib
                   sides of the image.
         !*/
 
+        long groups(
+        ) const;
+        /*!
+            ensures
+                - returns _groups, the number of groups the input channels and filters are
+                  split into.  Each filter has IN.k()/groups() channels.
+        !*/
+
+        long dilation_y(
+        ) const;
+        /*!
+            ensures
+                - returns the vertical distance, in input pixels, between adjacent filter
+                  taps.  A value of 1 means the filter is applied densely.
+        !*/
+
+        long dilation_x(
+        ) const;
+        /*!
+            ensures
+                - returns the horizontal distance, in input pixels, between adjacent filter
+                  taps.  A value of 1 means the filter is applied densely.
+        !*/
+
         double get_learning_rate_multiplier(
         ) const;  
         /*!
@@ -903,6 +1324,113 @@ namespace dlib
                 - #get_bias_weight_decay_multiplier() == val
         !*/
 
+        bool relu_is_enabled(
+        ) const;
+        /*!
+            ensures
+                - returns true if a relu is applied to the output of this layer.  That is,
+                  if this layer outputs max(0, conv(input)+bias) rather than just
+                  conv(input)+bias.  This is normally only turned on by fuse_layers() since
+                  a con_ with a fused relu can't be used for training.
+        !*/
+
+        void enable_relu(
+        );
+        /*!
+            ensures
+                - #relu_is_enabled() == true
+        !*/
+
+        void disable_relu(
+        );
+        /*!
+            ensures
+                - #relu_is_enabled() == false
+                - #is_quantized() == false
+        !*/
+
+        alias_tensor_const_instance get_filters(
+        ) const;
+        /*!
+            requires
+                - is_quantized() == false
+            ensures
+                - returns an alias of get_layer_params() containing the filters.  It has
+                  num_filters() samples, each with the same k() as the input tensor and
+                  nr() rows and nc() columns.
+        !*/
+
+        alias_tensor_instance get_filters(
+        );
+        /*!
+            requires
+                - is_quantized() == false
+            ensures
+                - returns an alias of get_layer_params() containing the filters.  It has
+                  num_filters() samples, each with the same k() as the input tensor and
+                  nr() rows and nc() columns.
+        !*/
+
+        alias_tensor_const_instance get_biases(
+        ) const;
+        /*!
+            ensures
+                - returns an alias of get_layer_params() containing the num_filters() bias
+                  values.
+        !*/
+
+        alias_tensor_instance get_biases(
+        );
+        /*!
+            ensures
+                - returns an alias of get_layer_params() containing the num_filters() bias
+                  values.
+        !*/
+
+        bool is_quantized(
+        ) const;
+        /*!
+            ensures
+                - returns true if quantize() has been called on this layer.  A quantized
+                  layer does its convolution with 8 bit integer arithmetic and no longer
+                  stores its filters in floating point.  So in that case
+                  get_layer_params() only contains the biases.
+        !*/
+
+        float get_input_scale(
+        ) const;
+        /*!
+            ensures
+                - if (is_quantized()) then
+                    - returns the scale used to quantize the input of this layer.  That
+                      is, inputs are mapped to the integers in [-127,127] by dividing them
+                      by get_input_scale(), so inputs outside the range
+                      [-127,127]*get_input_scale() are clipped.
+                - else
+                    - returns 0
+        !*/
+
+        void quantize (
+            float input_scale
+        );
+        /*!
+            requires
+                - input_scale > 0
+                - get_layer_params().size() != 0
+                - is_quantized() == false
+                - groups() == 1
+            ensures
+                - Converts the filters of this layer to 8 bit integers, using a separate
+                  scale for each filter, and makes forward() quantize its input using
+                  input_scale and then compute the layer with integer arithmetic.  This
+                  shrinks the memory needed for the filters by a factor of 4 and is
+                  usually faster.  The quantized layer can only be used for inference,
+                  backward() must not be called on it.  The quantized computation always
+                  runs on the CPU, even when dlib is built with CUDA.
+                - #is_quantized() == true
+                - #get_input_scale() == input_scale
+        !*/
+
         template <typename SUBNET> void setup (const SUBNET& sub);
         template <typename SUBNET> void forward(const SUBNET& sub, resizable_tensor& output);
         template <typename SUBNET> void backward(const tensor& gradient_input, SUBNET& sub, tensor& params_grad);
@@ -926,6 +1454,48 @@ namespace dlib
         >
     using con = add_layer<con_<num_filters,nr,nc,stride_y,stride_x>, SUBNET>;
 
+    template <
+        long num_filters,
+        long groups,
+        long nr,
+        long nc,
+        int stride_y,
+        int stride_x,
+        typename SUBNET
+        >
+    using grouped_con = add_layer<con_<num_filters,nr,nc,stride_y,stride_x,
+                                       stride_y!=1? 0 : nr/2, stride_x!=1? 0 : nc/2, groups>, SUBNET>;
+
+    template <
+        long num_channels,
+        long nr,
+        long nc,
+        int stride_y,
+        int stride_x,
+        typename SUBNET
+        >
+    using depthwise_con = grouped_con<num_channels,num_channels,nr,nc,stride_y,stride_x,SUBNET>;
+    /*!
+        depthwise_con convolves each of the num_channels input channels with its own
+        filter.  The input to it must have exactly num_channels channels.
+    !*/
+
+    template <
+        long num_filters,
+        long nr,
+        long nc,
+        int dilation_y,
+        int dilation_x,
+        typename SUBNET
+        >
+    using dilated_con = add_layer<con_<num_filters,nr,nc,1,1,
+                                       dilation_y*(nr/2), dilation_x*(nc/2), 1, dilation_y, dilation_x>, SUBNET>;
+    /*!
+        dilated_con is a stride 1 convolution whose filter taps are dilation_y rows and
+        dilation_x columns apart.  It's padded so that, for odd nr and nc, the output has
+        the same number of rows and columns as the input.
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
     template <
@@ -1604,6 +2174,7 @@ namespace dlib
         /*!
             ensures
                 - #get_mode() == FC_MODE 
+                - #is_disabled() == false
         !*/
 
         affine_(
@@ -1612,6 +2183,7 @@ namespace dlib
         /*!
             ensures
                 - #get_mode() == mode
+                - #is_disabled() == false
         !*/
 
         template <
@@ -1627,6 +2199,7 @@ namespace dlib
                   finish training a network with bn_ layers because the affine_ layer will
                   execute faster.  
                 - #get_mode() == layer.get_mode()
+                - #is_disabled() == false
         !*/
 
         layer_mode get_mode(
@@ -1636,6 +2209,37 @@ namespace dlib
                 - returns the mode of this layer, either CONV_MODE or FC_MODE.  
         !*/
 
+        alias_tensor_const_instance get_gamma(
+        ) const;
+        /*!
+            ensures
+                - returns the A parameter tensor described above.
+        !*/
+
+        alias_tensor_const_instance get_beta(
+        ) const;
+        /*!
+            ensures
+                - returns the B parameter tensor described above.
+        !*/
+
+        bool is_disabled(
+        ) const;
+        /*!
+            ensures
+                - returns true if this layer has been disabled, in which case it performs
+                  the identity transformation and holds no parameters.
+        !*/
+
+        void disable(
+        );
+        /*!
+            ensures
+                - #is_disabled() == true
+                - #get_gamma().get().size() == 0
+                - #get_beta().get().size() == 0
+        !*/
+
         template <typename SUBNET> void setup (const SUBNET& sub);
         void forward_inplace(const tensor& input, tensor& output);
         void backward_inplace(const tensor& computed_output, const tensor& gradient_input, tensor& data_grad, tensor& params_grad);
@@ -1963,6 +2567,25 @@ namespace dlib
 
         relu_(
         );
+        /*!
+            ensures
+                - #is_disabled() == false
+        !*/
+
+        bool is_disabled(
+        ) const;
+        /*!
+            ensures
+                - returns true if this layer has been disabled, in which case it performs
+                  the identity transformation instead of f(x)=max(x,0).
+        !*/
+
+        void disable(
+        );
+        /*!
+            ensures
+                - #is_disabled() == true
+        !*/
 
         template <typename SUBNET> void setup (const SUBNET& sub);
         void forward_inplace(const tensor& input, tensor& output);
@@ -2553,6 +3176,101 @@ namespace dlib
         >
     using extract = add_layer<extract_<offset,k,nr,nc>, SUBNET>;
 
+// ----------------------------------------------------------------------------------------
+
+    template <typename net_type>
+    void fuse_layers (
+        net_type& net
+    );
+    /*!
+        requires
+            - net_type is an object of type add_layer, add_loss_layer, add_skip_layer, or
+              add_tag_layer.
+        ensures
+            - Rewrites net into an equivalent network that is cheaper to evaluate.  That
+              is, net's output for any input is the same (up to floating point rounding)
+              before and after this call, but it makes fewer passes over memory.  In
+              particular:
+                - Each affine_ layer sitting directly on top of a con_ layer (when the
+                  affine_ is in CONV_MODE) or an fc_ layer with a bias is folded into that
+                  layer's filters and biases and then disabled.
+                - Each relu_ layer sitting directly on top of a con_ layer, possibly with
+                  disabled affine_ layers in between, is merged into the con_ via
+                  enable_relu() and then disabled.
+            - Layers whose parameters haven't been allocated yet are left alone.  So you
+              should call this function on a network that has been trained or loaded from
+              disk.
+            - Since a con_ with a fused relu can't be back propagated through, the
+              resulting network is only suitable for inference.  Networks trained with bn_
+              layers should first be converted to their affine_ equivalent, by assigning
+              them to a network type that uses affine_ in place of bn_, before calling
+              fuse_layers().
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename net_type,
+        typename forward_iterator
+        >
+    void quantize_layers (
+        net_type& net,
+        forward_iterator ibegin,
+        forward_iterator iend,
+        size_t mini_batch_size = 32
+    );
+    /*!
+        requires
+            - net_type is an add_loss_layer or add_layer object.
+            - [ibegin, iend) is an iterator range over input samples that can be given to
+              net.to_tensor().  These are the calibration samples and should be
+              representative of the data the network will be used on.
+            - std::distance(ibegin, iend) > 0
+            - mini_batch_size > 0
+        ensures
+            - Performs post training quantization of the con_ and fc_ layers in net.  That
+              is, the calibration samples are run through net, mini_batch_size at a time,
+              and for each con_ and fc_ layer the largest absolute value of its input is
+              recorded.  Then each of those layers is quantized by calling
+              quantize(largest_input/127) on it.  See con_::quantize() and
+              fc_::quantize() for details.
+            - Layers that are already quantized, whose parameters haven't been allocated,
+              or which only saw zero valued inputs are left as they are.  So are grouped
+              con_ layers, since there is no int8 grouped convolution kernel.
+            - The resulting network can only be used for inference.  If you are going to
+              call fuse_layers() on net you should do so before calling quantize_layers()
+              since quantized layers can't be fused.
+    !*/
+
+    template <
+        typename net_type1,
+        typename net_type2,
+        typename forward_iterator
+        >
+    matrix<double,1,3> test_output_drift (
+        net_type1& reference_net,
+        net_type2& net,
+        forward_iterator ibegin,
+        forward_iterator iend
+    );
+    /*!
+        requires
+            - net_type1 and net_type2 are add_loss_layer or add_layer objects which take
+              the same kind of input and produce outputs of the same size.
+            - [ibegin, iend) is an iterator range over input samples.
+        ensures
+            - Runs each sample in [ibegin, iend) through reference_net and net and compares
+              their outputs.  For networks with a loss layer that's the output of the
+              layer just below the loss layer.  This is useful for
+              measuring how much a network changed due to something like
+              quantize_layers() or fuse_layers().
+            - returns a matrix M summarizing the differences between the outputs:
+                - M(0) == the mean absolute difference.
+                - M(1) == the maximum absolute difference.
+                - M(2) == M(0) divided by the mean absolute value of reference_net's
+                  outputs.  That is, the relative drift.
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
 }
@@ -9,8 +9,11 @@
 #include "tensor_tools.h"
 #include "../geometry.h"
 #include "../image_processing/box_overlap_testing.h"
+#include "../image_processing/non_max_suppression.h"
 #include "../image_processing/full_object_detection.h"
 #include "../svm/ranking_tools.h"
+#include "../threads/parallel_for_extension.h"
+#include "../simd.h"
 #include <sstream>
 
 namespace dlib
@@ -418,6 +421,7 @@ namespace dlib
         double loss_per_missed_target = 1;
         double truth_match_iou_threshold = 0.5;
         test_box_overlap overlaps_nms = test_box_overlap(0.4);
+        double soft_nms_sigma = 0;
         test_box_overlap overlaps_ignore;
 
         use_image_pyramid assume_image_pyramid = use_image_pyramid::yes;
@@ -654,7 +658,9 @@ namespace dlib
 
     inline void serialize(const mmod_options& item, std::ostream& out)
     {
-        int version = 3;
+        // Version 3 files are still written when the new fields are at their defaults
+        // so older code can read them.
+        int version = item.soft_nms_sigma != 0 ? 4 : 3;
 
         serialize(version, out);
         serialize(item.detector_windows, out);
@@ -664,13 +670,15 @@ namespace dlib
         serialize(item.overlaps_nms, out);
         serialize(item.overlaps_ignore, out);
         serialize(static_cast<uint8_t>(item.assume_image_pyramid), out);
+        if (version >= 4)
+            serialize(item.soft_nms_sigma, out);
     }
 
     inline void deserialize(mmod_options& item, std::istream& in)
     {
         int version = 0;
         deserialize(version, in);
-        if (version != 3 && version != 2 && version != 1)
+        if (version < 1 || version > 4)
             throw serialization_error("Unexpected version found while deserializing dlib::mmod_options");
         if (version == 1)
         {
@@ -696,6 +704,9 @@ namespace dlib
             deserialize(assume_image_pyramid, in);
             item.assume_image_pyramid = static_cast<use_image_pyramid>(assume_image_pyramid);
         }
+        item.soft_nms_sigma = 0;
+        if (version >= 4)
+            deserialize(item.soft_nms_sigma, in);
     }
 
 // ----------------------------------------------------------------------------------------
@@ -748,7 +759,21 @@ namespace dlib
             double adjust_threshold = 0
         ) const
         {
-            const tensor& output_tensor = sub.get_output();
+            to_label(input_tensor, sub.get_output(), sub, iter, adjust_threshold);
+        }
+
+        template <
+            typename SUB_TYPE,
+            typename label_iterator
+            >
+        void to_label (
+            const tensor& input_tensor,
+            const tensor& output_tensor,
+            const SUB_TYPE& sub,
+            label_iterator iter,
+            double adjust_threshold = 0
+        ) const
+        {
             DLIB_CASSERT(output_tensor.k() == (long)options.detector_windows.size());
             DLIB_CASSERT(input_tensor.num_samples() == output_tensor.num_samples());
             DLIB_CASSERT(sub.sample_expansion_factor() == 1,  sub.sample_expansion_factor());
@@ -760,15 +785,16 @@ namespace dlib
                 tensor_to_dets(input_tensor, output_tensor, i, dets_accum, adjust_threshold, sub);
 
                 // Do non-max suppression
+                if (options.soft_nms_sigma > 0)
+                    soft_non_max_suppression(dets_accum, options.overlaps_nms, options.soft_nms_sigma, adjust_threshold);
+                else
+                    non_max_suppression(dets_accum, options.overlaps_nms);
+
                 final_dets.clear();
-                for (unsigned long i = 0; i < dets_accum.size(); ++i)
+                for (auto&& d : dets_accum)
                 {
-                    if (overlaps_any_box_nms(final_dets, dets_accum[i].rect))
-                        continue;
-
-                    final_dets.push_back(mmod_rect(dets_accum[i].rect,
-                                                   dets_accum[i].detection_confidence,
-                                                   options.detector_windows[dets_accum[i].tensor_channel].label));
+                    final_dets.push_back(mmod_rect(d.rect, d.detection_confidence,
+                                                   options.detector_windows[d.tensor_channel].label));
                 }
 
                 *iter++ = std::move(final_dets);
@@ -809,18 +835,22 @@ namespace dlib
 
             std::vector<size_t> truth_idxs;  truth_idxs.reserve(truth->size());
             std::vector<intermediate_detection> dets;
+            nms_grid grid(options.overlaps_nms);
             for (long i = 0; i < output_tensor.num_samples(); ++i)
             {
-                tensor_to_dets(input_tensor, output_tensor, i, dets, -options.loss_per_false_alarm + det_thresh_speed_adjust, sub);
-
                 const unsigned long max_num_dets = 50 + truth->size()*5;
                 // Prevent calls to tensor_to_dets() from running for a really long time
-                // due to the production of an obscene number of detections.
+                // due to the production of an obscene number of detections.  Only the
+                // best max_num_initial_dets detections are kept, plus one more to tell us
+                // how much to raise the threshold for the next image.
                 const unsigned long max_num_initial_dets = max_num_dets*100;
-                if (dets.size() >= max_num_initial_dets)
+                tensor_to_dets(input_tensor, output_tensor, i, dets, -options.loss_per_false_alarm + det_thresh_speed_adjust, sub, max_num_initial_dets+1);
+                if (dets.size() > max_num_initial_dets)
                 {
                     det_thresh_speed_adjust = std::max(det_thresh_speed_adjust,dets[max_num_initial_dets].detection_confidence + options.loss_per_false_alarm);
+                    dets.pop_back();
                 }
+                grid.reset(dets);
 
 
                 // The loss will measure the number of incorrect detections.  A detection is
@@ -863,7 +893,7 @@ namespace dlib
                 // The point of this loop is to fill out the truth_score_hits array. 
                 for (unsigned long i = 0; i < dets.size() && final_dets.size() < max_num_dets; ++i)
                 {
-                    if (overlaps_any_box_nms(final_dets, dets[i].rect))
+                    if (grid.overlaps_any_box(dets[i].rect))
                         continue;
 
                     const auto& det_label = options.detector_windows[dets[i].tensor_channel].label;
@@ -871,6 +901,7 @@ namespace dlib
                     const std::pair<double,unsigned int> hittruth = find_best_match(*truth, dets[i].rect, det_label);
 
                     final_dets.push_back(dets[i].rect);
+                    grid.add_box(dets[i].rect);
 
                     const double truth_match = hittruth.first;
                     // if hit truth rect
@@ -922,6 +953,7 @@ namespace dlib
 
                 hit_truth_table.assign(hit_truth_table.size(), false);
                 final_dets.clear();
+                grid.clear();
 
 
                 // Now figure out which detections jointly maximize the loss and detection score sum.  We
@@ -930,7 +962,7 @@ namespace dlib
                 // detections.
                 for (unsigned long i = 0; i < dets.size() && final_dets.size() < max_num_dets; ++i)
                 {
-                    if (overlaps_any_box_nms(final_dets, dets[i].rect))
+                    if (grid.overlaps_any_box(dets[i].rect))
                         continue;
 
                     const auto& det_label = options.detector_windows[dets[i].tensor_channel].label;
@@ -946,11 +978,13 @@ namespace dlib
                             {
                                 hit_truth_table[hittruth.second] = true;
                                 final_dets.push_back(dets[i]);
+                                grid.add_box(dets[i].rect);
                                 loss -= options.loss_per_missed_target;
                             }
                             else
                             {
                                 final_dets.push_back(dets[i]);
+                                grid.add_box(dets[i].rect);
                                 loss += options.loss_per_false_alarm;
                             }
                         }
@@ -959,6 +993,7 @@ namespace dlib
                     {
                         // didn't hit anything
                         final_dets.push_back(dets[i]);
+                        grid.add_box(dets[i].rect);
                         loss += options.loss_per_false_alarm;
                     }
                 }
@@ -1017,6 +1052,8 @@ namespace dlib
             out << ", loss per miss:" << opts.loss_per_missed_target;
             out << ", truth match IOU thresh:" << opts.truth_match_iou_threshold;
             out << ", overlaps_nms:("<<opts.overlaps_nms.get_iou_thresh()<<","<<opts.overlaps_nms.get_percent_covered_thresh()<<")";
+            if (opts.soft_nms_sigma > 0)
+                out << ", soft_nms_sigma:" << opts.soft_nms_sigma;
             out << ", overlaps_ignore:("<<opts.overlaps_ignore.get_iou_thresh()<<","<<opts.overlaps_ignore.get_percent_covered_thresh()<<")";
 
             out << ")";
@@ -1038,33 +1075,74 @@ namespace dlib
             long i,
             std::vector<intermediate_detection>& dets_accum,
             double adjust_threshold,
-            const net_type& net 
+            const net_type& net,
+            size_t max_dets = std::numeric_limits<size_t>::max()
         ) const
         {
             DLIB_CASSERT(net.sample_expansion_factor() == 1,net.sample_expansion_factor());
             DLIB_CASSERT(output_tensor.k() == (long)options.detector_windows.size());
-            const float* out_data = output_tensor.host() + output_tensor.k()*output_tensor.nr()*output_tensor.nc()*i;
-            // scan the final layer and output the positive scoring locations
-            dets_accum.clear();
-            for (long k = 0; k < output_tensor.k(); ++k)
+            const long plane_size = output_tensor.nr()*output_tensor.nc();
+            const float* out_data = output_tensor.host() + output_tensor.k()*plane_size*i;
+            const long size = output_tensor.k()*plane_size;
+
+            // Scan the final layer for the positive scoring locations.  Almost all of the
+            // output is usually below the threshold, so we look at the maximum of 16 values
+            // at a time and only check them one by one if it's above the threshold.
+            std::vector<std::pair<float,long>> hits;
+            long j = 0;
+            float temp[4];
+            for (; j + 16 <= size; j += 16)
             {
-                for (long r = 0; r < output_tensor.nr(); ++r)
+                simd8f a, b;
+                a.load(out_data + j);
+                b.load(out_data + j + 8);
+                const simd8f m = max(a, b);
+                max(m.low(), m.high()).store(temp);
+                if (std::max(std::max(temp[0], temp[1]), std::max(temp[2], temp[3])) > adjust_threshold)
                 {
-                    for (long c = 0; c < output_tensor.nc(); ++c)
+                    for (long jj = j; jj < j + 16; ++jj)
                     {
-                        double score = out_data[(k*output_tensor.nr() + r)*output_tensor.nc() + c];
-                        if (score > adjust_threshold)
-                        {
-                            dpoint p = output_tensor_to_input_tensor(net, point(c,r));
-                            drectangle rect = centered_drect(p, options.detector_windows[k].width, options.detector_windows[k].height);
-                            rect = input_layer(net).tensor_space_to_image_space(input_tensor,rect);
-
-                            dets_accum.push_back(intermediate_detection(rect, score, (k*output_tensor.nr() + r)*output_tensor.nc() + c, k));
-                        }
+                        if (out_data[jj] > adjust_threshold)
+                            hits.push_back(std::make_pair(out_data[jj], jj));
                     }
                 }
             }
-            std::sort(dets_accum.rbegin(), dets_accum.rend());
+            for (; j < size; ++j)
+            {
+                if (out_data[j] > adjust_threshold)
+                    hits.push_back(std::make_pair(out_data[j], j));
+            }
+
+            // Only sort as many of the hits as the caller wants, and break ties by
+            // location so the output doesn't depend on the sorting algorithm.
+            const auto better = [](const std::pair<float,long>& a, const std::pair<float,long>& b)
+            {
+                return a.first > b.first || (a.first == b.first && a.second < b.second);
+            };
+            if (hits.size() > max_dets)
+            {
+                std::partial_sort(hits.begin(), hits.begin()+max_dets, hits.end(), better);
+                hits.resize(max_dets);
+            }
+            else
+            {
+                std::sort(hits.begin(), hits.end(), better);
+            }
+
+            // Now map just the hits we kept back to boxes in the image.
+            dets_accum.clear();
+            dets_accum.reserve(hits.size());
+            for (auto& h : hits)
+            {
+                const long k = h.second/plane_size;
+                const long r = (h.second%plane_size)/output_tensor.nc();
+                const long c = h.second%output_tensor.nc();
+                dpoint p = output_tensor_to_input_tensor(net, point(c,r));
+                drectangle rect = centered_drect(p, options.detector_windows[k].width, options.detector_windows[k].height);
+                rect = input_layer(net).tensor_space_to_image_space(input_tensor,rect);
+
+                dets_accum.push_back(intermediate_detection(rect, h.first, h.second, k));
+            }
         }
 
         size_t find_best_detection_window (
@@ -1255,21 +1333,6 @@ namespace dlib
             return std::make_pair(match,best_idx);
         }
 
-        template <typename T>
-        inline bool overlaps_any_box_nms (
-            const std::vector<T>& rects,
-            const rectangle& rect
-        ) const
-        {
-            for (auto&& r : rects)
-            {
-                if (options.overlaps_nms(r.rect, rect))
-                    return true;
-            }
-            return false;
-        }
-
-
         mmod_options options;
 
     };
@@ -1354,96 +1417,127 @@ namespace dlib
 
 
 
-            temp.set_size(output_tensor.num_samples(), output_tensor.num_samples());
+            const long num = output_tensor.num_samples();
+            temp.set_size(num, num);
             grad_mul.copy_size(temp);
 
+            // All the pairwise squared distances come from one GEMM, since
+            // length_squared(x-y) == x*x + y*y - 2*x*y.
             tt::gemm(0, temp, 1, output_tensor, false, output_tensor, true);
 
+            labels.resize(num);
+            norms.resize(num);
+            float* d = temp.host();
+            for (long r = 0; r < num; ++r)
+            {
+                labels[r] = *(truth + r);
+                norms[r] = d[r*num + r];
+            }
 
-            std::vector<double> temp_threshs;
-            const float* d = temp.host();
-            double loss = 0;
-            double num_pos_samps = 0.0001;
-            double num_neg_samps = 0.0001;
-            for (long r = 0; r < temp.num_samples(); ++r)
+            // Turn temp into the matrix of distances, one row per job.  While we are at
+            // it, count the matching pairs and the non-matching pairs (r,c) with r < c in
+            // each row.
+            row_counts.resize(num);
+            parallel_for(0, num, [&](long r)
             {
-                auto xx = d[r*temp.num_samples() + r];
-                const auto x_label = *(truth + r);
-                for (long c = r+1; c < temp.num_samples(); ++c)
+                float* row = d + r*num;
+                const simd8f xx(norms[r]), zero(0), two(2);
+                long c = 0;
+                for (; c + 8 <= num; c += 8)
                 {
-                    const auto y_label = *(truth + c);
-                    if (x_label == y_label)
-                    {
-                        ++num_pos_samps;
-                    }
-                    else
-                    {
-                        ++num_neg_samps;
-
-                        // Figure out what distance threshold, when applied to the negative pairs,
-                        // causes there to be an equal number of positive and negative pairs.
-                        auto yy = d[c*temp.num_samples() + c];
-                        auto xy = d[r*temp.num_samples() + c];
-                        // compute the distance between x and y samples.
-                        auto d2 = xx + yy - 2*xy;
-                        if (d2 < 0)
-                            d2 = 0;
-                        temp_threshs.push_back(d2);
-                    }
+                    simd8f xy, yy;
+                    xy.load(row+c);
+                    yy.load(&norms[c]);
+                    sqrt(max(xx + yy - two*xy, zero)).store(row+c);
+                }
+                for (; c < num; ++c)
+                    row[c] = std::sqrt(std::max(norms[r] + norms[c] - 2*row[c], 0.0f));
+
+                long pos = 0;
+                for (c = r+1; c < num; ++c)
+                {
+                    if (labels[r] == labels[c])
+                        ++pos;
                 }
+                row_counts[r] = std::make_pair(pos, num-1-r-pos);
+            });
+
+            long total_pos = 0;
+            long total_neg = 0;
+            for (auto& n : row_counts)
+            {
+                total_pos += n.first;
+                total_neg += n.second;
             }
+            const double num_pos_samps = 0.0001 + total_pos;
+            const double num_neg_samps = 0.0001 + total_neg;
             // The whole objective function is multiplied by this to scale the loss
             // relative to the number of things in the mini-batch.
             const double scale = 0.5/num_pos_samps;
             DLIB_CASSERT(num_pos_samps>=1, "Make sure each mini-batch contains both positive pairs and negative pairs");
             DLIB_CASSERT(num_neg_samps>=1, "Make sure each mini-batch contains both positive pairs and negative pairs");
 
-            std::sort(temp_threshs.begin(), temp_threshs.end());
-            const float neg_thresh = std::sqrt(temp_threshs[std::min(num_pos_samps,num_neg_samps)-1]);
+            // Figure out what distance threshold, when applied to the negative pairs,
+            // causes there to be an equal number of positive and negative pairs.  That's
+            // just the k-th smallest negative distance, so we gather them up in parallel
+            // and select it with nth_element() rather than sorting them all.
+            neg_dists.resize(total_neg);
+            std::vector<size_t> offsets(num+1, 0);
+            for (long r = 0; r < num; ++r)
+                offsets[r+1] = offsets[r] + row_counts[r].second;
+            parallel_for(0, num, [&](long r)
+            {
+                const float* row = d + r*num;
+                float* out = &neg_dists[0] + offsets[r];
+                for (long c = r+1; c < num; ++c)
+                {
+                    if (labels[r] != labels[c])
+                        *out++ = row[c];
+                }
+            });
+            const size_t k = std::min(total_pos,total_neg)-1;
+            std::nth_element(neg_dists.begin(), neg_dists.begin()+k, neg_dists.end());
+            const float neg_thresh = neg_dists[k];
 
             // loop over all the pairs of training samples and compute the loss and
             // gradients.  Note that we only use the hardest negative pairs and that in
             // particular we pick the number of negative pairs equal to the number of
-            // positive pairs so everything is balanced.
+            // positive pairs so everything is balanced.  Each row is independent, so
+            // they are done in parallel and their losses added up afterwards, in order,
+            // so the result doesn't depend on the number of threads.
             float* gm = grad_mul.host();
-            for (long r = 0; r < temp.num_samples(); ++r)
+            row_losses.resize(num);
+            parallel_for(0, num, [&](long r)
             {
-                gm[r*temp.num_samples() + r] = 0;
-                const auto x_label = *(truth + r);
-                auto xx = d[r*temp.num_samples() + r];
-                for (long c = 0; c < temp.num_samples(); ++c)
+                const float* row = d + r*num;
+                float* gm_row = gm + r*num;
+                double row_loss = 0;
+                float gm_rr = 0;
+                const auto x_label = labels[r];
+                for (long c = 0; c < num; ++c)
                 {
                     if (r==c)
                         continue;
-                    const auto y_label = *(truth + c);
-                    auto yy = d[c*temp.num_samples() + c];
-                    auto xy = d[r*temp.num_samples() + c];
-
-                    // compute the distance between x and y samples.
-                    auto d2 = xx + yy - 2*xy;
-                    if (d2 <= 0)
-                        d2 = 0;
-                    else 
-                        d2 = std::sqrt(d2);
+                    float d2 = row[c];
 
                     // It should be noted that the derivative of length(x-y) with respect
                     // to the x vector is the unit vector (x-y)/length(x-y).  If you stare
                     // at the code below long enough you will see that it's just an
                     // application of this formula.
 
-                    if (x_label == y_label)
+                    if (x_label == labels[c])
                     {
                         // Things with the same label should have distances < dist_thresh between
                         // them.  If not then we experience non-zero loss.
                         if (d2 < dist_thresh-margin)
                         {
-                            gm[r*temp.num_samples() + c] = 0;
+                            gm_row[c] = 0;
                         }
                         else
                         {
-                            loss += scale*(d2 - (dist_thresh-margin));
-                            gm[r*temp.num_samples() + r] += scale/d2;
-                            gm[r*temp.num_samples() + c] = -scale/d2;
+                            row_loss += scale*(d2 - (dist_thresh-margin));
+                            gm_rr += scale/d2;
+                            gm_row[c] = -scale/d2;
                         }
                     }
                     else
@@ -1452,20 +1546,25 @@ namespace dlib
                         // them.  If not then we experience non-zero loss.
                         if (d2 > dist_thresh+margin || d2 > neg_thresh)
                         {
-                            gm[r*temp.num_samples() + c] = 0;
+                            gm_row[c] = 0;
                         }
                         else
                         {
-                            loss += scale*((dist_thresh+margin) - d2);
+                            row_loss += scale*((dist_thresh+margin) - d2);
                             // don't divide by zero (or a really small number)
                             d2 = std::max(d2, 0.001f);
-                            gm[r*temp.num_samples() + r] -= scale/d2;
-                            gm[r*temp.num_samples() + c] = scale/d2;
+                            gm_rr -= scale/d2;
+                            gm_row[c] = scale/d2;
                         }
                     }
                 }
-            }
+                gm_row[r] = gm_rr;
+                row_losses[r] = row_loss;
+            });
 
+            double loss = 0;
+            for (auto l : row_losses)
+                loss += l;
 
             tt::gemm(0, grad, 1, grad_mul, false, output_tensor, false); 
 
@@ -1521,6 +1620,10 @@ namespace dlib
         // These variables are only here to avoid being reallocated over and over in
         // compute_loss_value_and_gradient()
         mutable resizable_tensor temp, grad_mul;
+        mutable std::vector<unsigned long> labels;
+        mutable std::vector<float> norms, neg_dists;
+        mutable std::vector<std::pair<long,long>> row_counts;
+        mutable std::vector<double> row_losses;
 
     };
 
@@ -418,6 +418,13 @@ namespace dlib
         // an already output detection and should therefore be thrown out.
         test_box_overlap overlaps_nms = test_box_overlap(0.4);
 
+        // If this is > 0 then loss_mmod_::to_label() uses soft non-max suppression with
+        // this sigma instead of throwing out the overlapping detections (see
+        // soft_non_max_suppression()).  The confidences of overlapping detections are
+        // lowered toward the adjust_threshold given to to_label().  Training always uses
+        // ordinary non-max suppression.
+        double soft_nms_sigma = 0;
+
         // Any mmod_rect in the training data that has its ignore field set to true defines
         // an "ignore zone" in an image.  Any detection from that area is totally ignored
         // by the optimizer.  Therefore, this overlaps_ignore field defines how we decide
@@ -584,6 +591,30 @@ namespace dlib
                 - R.ignore == false (this value is unused by to_label()).
         !*/
 
+        template <
+            typename SUB_TYPE,
+            typename label_iterator
+            >
+        void to_label (
+            const tensor& input_tensor,
+            const tensor& output_tensor,
+            const SUB_TYPE& sub,
+            label_iterator iter,
+            double adjust_threshold = 0
+        ) const;
+        /*!
+            requires
+                - output_tensor has the same dimensions as the output sub would produce if
+                  given input_tensor.
+            ensures
+                - This function is identical to to_label(input_tensor,sub,iter,adjust_threshold)
+                  except that the detections are read out of output_tensor rather than
+                  sub.get_output().  sub is only used to map output_tensor back into the
+                  image.  This lets you compute the network's output some other way, e.g.
+                  piece by piece like mmod_cascade does, and still get the same
+                  detections.
+        !*/
+
         template <
             typename const_label_iterator,
             typename SUBNET
@@ -645,6 +676,12 @@ namespace dlib
                 negative mining on the non-matching pairs.  This is important since there
                 are in general way more non-matching pairs than matching pairs.  So to
                 avoid imbalance in the loss this kind of hard negative mining is useful.
+
+                All the pairwise distances come from a single matrix multiply and the
+                rest of the work is split by rows over the threads in
+                default_thread_pool(), so mini-batches of a few thousand samples are
+                practical.  Keep in mind that it still needs two num_samples by
+                num_samples matrices of floats, e.g. 128MB for 4000 samples.
         !*/
     public:
 
@@ -0,0 +1,163 @@
+// Copyright (C) 2026  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_DNn_MAPPED_MODEL_H_
+#define DLIB_DNn_MAPPED_MODEL_H_
+
+#include "mapped_model_abstract.h"
+#include "tensor.h"
+#include "../data_io/memory_mapped_file.h"
+#include "../byte_orderer.h"
+#include "../serialize.h"
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        /*
+            A mapped model file is laid out like this:
+                - A 64 byte header.  It starts with mapped_model_magic, followed by the
+                  format version, the offset of the metadata and its size, all stored as
+                  little endian integers.
+                - The values of every tensor in the model, each in a raw block of little
+                  endian floats aligned to tensor_block_writer::block_alignment bytes.
+                - The metadata, i.e. the ordinary dlib serialization of the saved objects
+                  except that each tensor is written as the offset of its block.
+            Since the blocks come first they can be streamed straight to disk while the
+            (small) metadata is built up in memory.
+        */
+        const char mapped_model_magic[8] = {'D','L','I','B','M','M','A','P'};
+        const uint32 mapped_model_version = 1;
+        const uint64 mapped_model_header_size = 64;
+
+        inline void serialize_mapped_items (
+            std::ostream&
+        ) {}
+
+        template <typename T, typename... Ts>
+        void serialize_mapped_items (
+            std::ostream& out,
+            const T& item,
+            const Ts&... rest
+        )
+        {
+            serialize(item, out);
+            serialize_mapped_items(out, rest...);
+        }
+
+        inline void deserialize_mapped_items (
+            std::istream&
+        ) {}
+
+        template <typename T, typename... Ts>
+        void deserialize_mapped_items (
+            std::istream& in,
+            T& item,
+            Ts&... rest
+        )
+        {
+            deserialize(item, in);
+            deserialize_mapped_items(in, rest...);
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <typename... T>
+    void save_mapped_model (
+        const std::string& filename,
+        const T&... items
+    )
+    {
+        std::ofstream fout(filename, std::ios::binary);
+        if (!fout)
+            throw serialization_error("Unable to open " + filename + " for writing.");
+
+        char header[impl::mapped_model_header_size] = {};
+        fout.write(header, sizeof(header));
+
+        std::ostringstream sout;
+        uint64 metadata_offset;
+        {
+            impl::tensor_block_writer writer(sout, fout, impl::mapped_model_header_size);
+            impl::serialize_mapped_items(sout, items...);
+            metadata_offset = writer.end_offset();
+        }
+        const std::string metadata = sout.str();
+        fout.write(metadata.data(), metadata.size());
+
+        byte_orderer bo;
+        uint32 version = impl::mapped_model_version;
+        uint64 metadata_size = metadata.size();
+        bo.host_to_little(version);
+        bo.host_to_little(metadata_offset);
+        bo.host_to_little(metadata_size);
+        std::memcpy(header, impl::mapped_model_magic, sizeof(impl::mapped_model_magic));
+        std::memcpy(header+8, &version, sizeof(version));
+        std::memcpy(header+16, &metadata_offset, sizeof(metadata_offset));
+        std::memcpy(header+24, &metadata_size, sizeof(metadata_size));
+        fout.seekp(0);
+        fout.write(header, sizeof(header));
+
+        fout.flush();
+        if (!fout)
+            throw serialization_error("Error writing to " + filename + ".");
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <typename... T>
+    void load_mapped_model (
+        const std::string& filename,
+        T&... items
+    )
+    {
+        auto file = std::make_shared<memory_mapped_file>(filename);
+
+        const char* data = file->data();
+        if (file->size() < impl::mapped_model_header_size ||
+            std::memcmp(data, impl::mapped_model_magic, sizeof(impl::mapped_model_magic)) != 0)
+            throw serialization_error(filename + " is not a file written by save_mapped_model().");
+
+        byte_orderer bo;
+        uint32 version;
+        uint64 metadata_offset, metadata_size;
+        std::memcpy(&version, data+8, sizeof(version));
+        std::memcpy(&metadata_offset, data+16, sizeof(metadata_offset));
+        std::memcpy(&metadata_size, data+24, sizeof(metadata_size));
+        bo.little_to_host(version);
+        bo.little_to_host(metadata_offset);
+        bo.little_to_host(metadata_size);
+        if (version != impl::mapped_model_version)
+            throw serialization_error("Unexpected version found in " + filename + ".");
+        if (metadata_offset > file->size() || metadata_size > file->size() - metadata_offset)
+            throw serialization_error(filename + " is truncated or corrupt.");
+
+        std::istringstream sin(std::string(data + metadata_offset, metadata_size));
+        try
+        {
+            // Only the metadata is copied.  The tensors keep file alive and share the
+            // mapped pages, through the page cache, with every other process that maps
+            // the same file.
+            impl::tensor_block_reader reader(sin, data, metadata_offset, file);
+            impl::deserialize_mapped_items(sin, items...);
+        }
+        catch (serialization_error& e)
+        {
+            throw serialization_error(e.info + "\n   while loading the file " + filename);
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_DNn_MAPPED_MODEL_H_
+
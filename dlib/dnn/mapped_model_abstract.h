@@ -0,0 +1,74 @@
+// Copyright (C) 2026  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#undef DLIB_DNn_MAPPED_MODEL_ABSTRACT_H_
+#ifdef DLIB_DNn_MAPPED_MODEL_ABSTRACT_H_
+
+#include "tensor_abstract.h"
+#include <string>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    template <typename... T>
+    void save_mapped_model (
+        const std::string& filename,
+        const T&... items
+    );
+    /*!
+        requires
+            - items are serializable with dlib's serialize(), e.g. dnn networks, loss
+              details, label vectors, etc.
+        ensures
+            - Saves items, in order, to the file with the given name so that they can be
+              loaded with load_mapped_model().  Every tensor inside the items is written
+              as a raw block of 4 byte little endian floats, aligned to 64 bytes within
+              the file.  The rest of the items is written using their ordinary
+              serialization.
+            - The tensor values are always stored as 32 bit floats, regardless of
+              set_tensor_serialization_format().
+        throws
+            - serialization_error if the file can't be written.
+    !*/
+
+    template <typename... T>
+    void load_mapped_model (
+        const std::string& filename,
+        T&... items
+    );
+    /*!
+        requires
+            - filename was written by save_mapped_model() with items of the same types,
+              in the same order.
+        ensures
+            - Loads items from the given file.  Rather than reading the tensor values,
+              the file is memory mapped and the tensors point directly at their blocks
+              (see gpu_data::set_read_only_memory()).  So:
+                - Loading takes about as long as it takes to map the file, however big
+                  the model is.  The pages of a tensor are only read from disk when the
+                  tensor is first used.
+                - The memory is shared through the OS page cache.  Therefore, any number
+                  of processes that load the same file share one copy of the weights in
+                  RAM.  Combined with copy_net_sharing_weights(), so do any number of
+                  network copies within a process.
+                - The mapping is copy-on-write.  Running a network only reads its
+                  parameters so they stay mapped.  The first time a tensor is modified,
+                  e.g. by training, it quietly switches to a private copy of its values.
+                  The file itself is never written to.
+                - The file stays mapped until every tensor that points into it has been
+                  destroyed or given its own memory.
+            - On hosts that aren't little endian the tensor values are copied, and
+              converted, rather than mapped.
+        throws
+            - serialization_error if the file isn't a valid save_mapped_model() file or
+              if the items can't be deserialized from it.
+            - dlib::error if the file can't be opened or memory mapped.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_DNn_MAPPED_MODEL_ABSTRACT_H_
+
@@ -0,0 +1,471 @@
+// Copyright (C) 2026  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_DNn_MMOD_CASCADE_H_
+#define DLIB_DNn_MMOD_CASCADE_H_
+
+#include "mmod_cascade_abstract.h"
+#include "core.h"
+#include "layers.h"
+#include "loss.h"
+#include "utilities.h"
+#include "../image_processing/non_max_suppression.h"
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <vector>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        struct cascade_layer_window
+        {
+            // The window of the layer's input each output location is computed from, in
+            // the form used by con_ and the pooling layers.  Layers that work on each
+            // location separately, like relu_ or affine_, have a 1x1 window.
+            long nr = 1;
+            long nc = 1;
+            long stride_y = 1;
+            long stride_x = 1;
+            long padding_y = 0;
+            long padding_x = 0;
+        };
+
+        inline void throw_unsupported_cascade_layer (
+            const char* name
+        )
+        {
+            throw dlib::error(std::string("mmod_cascade can't evaluate a network containing a ") + name +
+                " layer one piece at a time.  The network must be a simple chain of con, max_pool, "
+                "avg_pool, and layers that work on each location separately.");
+        }
+
+        template <typename LAYER_DETAILS>
+        cascade_layer_window get_cascade_layer_window (
+            const LAYER_DETAILS&
+        )
+        {
+            return cascade_layer_window();
+        }
+
+        template <long a, long b, long c, int d, int e, int f, int g, long h, int i, int j>
+        cascade_layer_window get_cascade_layer_window (
+            const con_<a,b,c,d,e,f,g,h,i,j>& l
+        )
+        {
+            if (l.nr() == 0 || l.nc() == 0)
+                throw_unsupported_cascade_layer("con with filters as big as its input");
+            cascade_layer_window w;
+            w.nr = l.dilation_y()*(l.nr()-1)+1;
+            w.nc = l.dilation_x()*(l.nc()-1)+1;
+            w.stride_y = l.stride_y();
+            w.stride_x = l.stride_x();
+            w.padding_y = l.padding_y();
+            w.padding_x = l.padding_x();
+            return w;
+        }
+
+        template <typename pool_type>
+        cascade_layer_window get_pool_window (
+            const pool_type& l
+        )
+        {
+            if (l.nr() == 0 || l.nc() == 0)
+                throw_unsupported_cascade_layer("global pooling");
+            cascade_layer_window w;
+            w.nr = l.nr();
+            w.nc = l.nc();
+            w.stride_y = l.stride_y();
+            w.stride_x = l.stride_x();
+            w.padding_y = l.padding_y();
+            w.padding_x = l.padding_x();
+            return w;
+        }
+
+        template <long a, long b, int c, int d, int e, int f>
+        cascade_layer_window get_cascade_layer_window (const max_pool_<a,b,c,d,e,f>& l) { return get_pool_window(l); }
+        template <long a, long b, int c, int d, int e, int f>
+        cascade_layer_window get_cascade_layer_window (const avg_pool_<a,b,c,d,e,f>& l) { return get_pool_window(l); }
+
+        template <long a, long b, long c, int d, int e, int f, int g>
+        cascade_layer_window get_cascade_layer_window (const cont_<a,b,c,d,e,f,g>&) { throw_unsupported_cascade_layer("cont"); return cascade_layer_window(); }
+        template <int a, int b>
+        cascade_layer_window get_cascade_layer_window (const upsample_<a,b>&) { throw_unsupported_cascade_layer("upsample"); return cascade_layer_window(); }
+        template <unsigned long a, fc_bias_mode b>
+        cascade_layer_window get_cascade_layer_window (const fc_<a,b>&) { throw_unsupported_cascade_layer("fc"); return cascade_layer_window(); }
+        template <template<typename> class tag>
+        cascade_layer_window get_cascade_layer_window (const add_prev_<tag>&) { throw_unsupported_cascade_layer("add_prev"); return cascade_layer_window(); }
+        template <template<typename> class tag>
+        cascade_layer_window get_cascade_layer_window (const mult_prev_<tag>&) { throw_unsupported_cascade_layer("mult_prev"); return cascade_layer_window(); }
+        template <template<typename> class... tags>
+        cascade_layer_window get_cascade_layer_window (const concat_<tags...>&) { throw_unsupported_cascade_layer("concat"); return cascade_layer_window(); }
+        template <long a, long b, long c, long d>
+        cascade_layer_window get_cascade_layer_window (const extract_<a,b,c,d>&) { throw_unsupported_cascade_layer("extract"); return cascade_layer_window(); }
+        inline cascade_layer_window get_cascade_layer_window (const bn_<FC_MODE>&) { throw_unsupported_cascade_layer("bn_fc"); return cascade_layer_window(); }
+        inline cascade_layer_window get_cascade_layer_window (
+            const affine_& l
+        )
+        {
+            // In FC_MODE each location has its own parameters, so it only works on inputs
+            // of one size.
+            if (l.get_mode() == FC_MODE)
+                throw_unsupported_cascade_layer("fc mode affine");
+            return cascade_layer_window();
+        }
+        inline cascade_layer_window get_cascade_layer_window (const softmax_all_&) { throw_unsupported_cascade_layer("softmax_all"); return cascade_layer_window(); }
+        inline cascade_layer_window get_cascade_layer_window (const l2normalize_&) { throw_unsupported_cascade_layer("l2normalize"); return cascade_layer_window(); }
+        template <unsigned long a>
+        cascade_layer_window get_cascade_layer_window (const lstm_<a>&) { throw_unsupported_cascade_layer("lstm"); return cascade_layer_window(); }
+        template <unsigned long a>
+        cascade_layer_window get_cascade_layer_window (const gru_<a>&) { throw_unsupported_cascade_layer("gru"); return cascade_layer_window(); }
+
+        class visitor_cascade_layer_windows
+        {
+        public:
+            // The windows of all the layers, from the output of the network down to its
+            // input.
+            std::vector<cascade_layer_window> windows;
+
+            template <typename input_layer_type>
+            void operator()(const input_layer_type& )
+            {
+            }
+
+            template <typename T, typename U, typename E>
+            void operator()(const add_layer<T,U,E>& net)
+            {
+                windows.push_back(get_cascade_layer_window(net.layer_details()));
+                (*this)(net.subnet());
+            }
+
+            template <unsigned long ID, typename U, typename E>
+            void operator()(const add_tag_layer<ID,U,E>& net)
+            {
+                // tag layers are an identity transform, so do nothing
+                (*this)(net.subnet());
+            }
+
+            template <template<typename> class TAG_TYPE, typename U>
+            void operator()(const add_skip_layer<TAG_TYPE,U>& )
+            {
+                throw_unsupported_cascade_layer("skip");
+            }
+
+            template <size_t num, template<typename> class REPEATED_LAYER, typename U>
+            void operator()(const repeat<num,REPEATED_LAYER,U>& )
+            {
+                throw_unsupported_cascade_layer("repeat");
+            }
+
+            template <template<typename> class BLOCK, typename U>
+            void operator()(const checkpoint<BLOCK,U>& )
+            {
+                throw_unsupported_cascade_layer("checkpoint");
+            }
+        };
+
+        struct cascade_axis
+        {
+            // Along one axis of the network, output location j is computed from the
+            // input locations in [j*stride - padding, j*stride - padding + size).
+            long stride = 1;
+            long padding = 0;
+            long size = 1;
+
+            // The layer windows along this axis, from the input of the network up to its
+            // output, as (window size, stride, padding).
+            std::vector<std::array<long,3>> layers;
+
+            void append (
+                long nr,
+                long stride_,
+                long padding_
+            )
+            {
+                padding += padding_*stride;
+                size += (nr-1)*stride;
+                stride *= stride_;
+                layers.push_back({{nr, stride_, padding_}});
+            }
+
+            long output_size (
+                long input_size
+            ) const
+            {
+                // This is the output size formula used by con_ and the pooling layers.
+                for (auto& l : layers)
+                    input_size = 1 + (input_size + 2*l[2] - l[0])/l[1];
+                return input_size;
+            }
+
+            long crop_begin (
+                long first_output
+            ) const
+            {
+                // The crop has to start on a multiple of the stride so that the outputs
+                // computed from it line up with the outputs of the whole input.
+                const long begin = std::max(0L, first_output*stride - padding);
+                return begin/stride*stride;
+            }
+
+            long crop_end (
+                long last_output,
+                long input_size
+            ) const
+            {
+                return std::min(input_size, last_output*stride - padding + size);
+            }
+        };
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename SUBNET
+        >
+    class mmod_cascade
+    {
+    public:
+
+        typedef loss_mmod<SUBNET> net_type;
+        typedef typename net_type::input_type input_type;
+
+        explicit mmod_cascade (
+            net_type& net_,
+            unsigned long tile_size_ = 16
+        ) : net(net_), tile_size(tile_size_)
+        {
+            DLIB_CASSERT(tile_size > 0);
+
+            impl::visitor_cascade_layer_windows visitor;
+            visitor(net.subnet());
+            for (auto i = visitor.windows.rbegin(); i != visitor.windows.rend(); ++i)
+            {
+                rows.append(i->nr, i->stride_y, i->padding_y);
+                cols.append(i->nc, i->stride_x, i->padding_x);
+            }
+        }
+
+        net_type& get_net (
+        ) const { return net; }
+
+        unsigned long get_tile_size (
+        ) const { return tile_size; }
+
+        void set_tile_size (
+            unsigned long size
+        )
+        {
+            DLIB_CASSERT(size > 0);
+            tile_size = size;
+        }
+
+        double get_fraction_of_tiles_evaluated (
+        ) const { return fraction_evaluated; }
+
+        template <typename first_stage_type>
+        std::vector<mmod_rect> operator() (
+            const input_type& img,
+            first_stage_type&& first_stage,
+            double adjust_threshold = 0
+        )
+        {
+            net.to_tensor(&img, &img+1, x);
+            const long out_nr = rows.output_size(x.nr());
+            const long out_nc = cols.output_size(x.nc());
+            const long out_k = net.loss_details().get_options().detector_windows.size();
+            out.set_size(1, out_k, out_nr, out_nc);
+            out = -std::numeric_limits<float>::infinity();
+
+            // Ask the first stage which tiles of the output might contain an object.
+            const long tile = tile_size;
+            const long tiles_nr = std::max(0L, (out_nr+tile-1)/tile);
+            const long tiles_nc = std::max(0L, (out_nc+tile-1)/tile);
+            areas.clear();
+            for (long tr = 0; tr < tiles_nr; ++tr)
+            {
+                for (long tc = 0; tc < tiles_nc; ++tc)
+                {
+                    const point tl = output_tensor_to_input_tensor(net, point(tc*tile, tr*tile));
+                    const point br = output_tensor_to_input_tensor(net, point(std::min((tc+1)*tile, out_nc)-1,
+                                                                              std::min((tr+1)*tile, out_nr)-1));
+                    areas.push_back(rectangle(tl, br));
+                }
+            }
+            keep.assign(areas.size(), true);
+            first_stage(x, areas, keep);
+            DLIB_CASSERT(keep.size() == areas.size());
+
+            // Now run the network on each horizontal run of tiles that passed and copy its
+            // output into out.  Everything else is left at -infinity, so the loss layer
+            // never reports a detection there.
+            size_t num_evaluated = 0;
+            for (long tr = 0; tr < tiles_nr; ++tr)
+            {
+                for (long tc = 0; tc < tiles_nc; )
+                {
+                    if (!keep[tr*tiles_nc + tc])
+                    {
+                        ++tc;
+                        continue;
+                    }
+                    const long tc_begin = tc;
+                    while (tc < tiles_nc && keep[tr*tiles_nc + tc])
+                        ++tc;
+                    num_evaluated += tc - tc_begin;
+                    evaluate(tr*tile, std::min((tr+1)*tile, out_nr)-1,
+                             tc_begin*tile, std::min(tc*tile, out_nc)-1);
+                }
+            }
+            fraction_evaluated = areas.size() == 0 ? 0 : num_evaluated/(double)areas.size();
+
+            std::vector<mmod_rect> dets;
+            net.loss_details().to_label(x, out, net.subnet(), &dets, adjust_threshold);
+            return dets;
+        }
+
+    private:
+
+        void evaluate (
+            long r0,
+            long r1,
+            long c0,
+            long c1
+        )
+        {
+            const long top = rows.crop_begin(r0);
+            const long bottom = rows.crop_end(r1, x.nr());
+            const long left = cols.crop_begin(c0);
+            const long right = cols.crop_end(c1, x.nc());
+
+            crop.set_size(1, x.k(), bottom-top, right-left);
+            const float* src = x.host();
+            float* dest = crop.host_write_only();
+            for (long k = 0; k < x.k(); ++k)
+            {
+                for (long r = top; r < bottom; ++r)
+                {
+                    const float* s = src + (k*x.nr() + r)*x.nc() + left;
+                    std::copy(s, s + crop.nc(), dest);
+                    dest += crop.nc();
+                }
+            }
+
+            // Each crop is a single sample, so any bn_ layers use their running statistics
+            // just like they do when the network is run on a single image.
+            const tensor& o = net.subnet().forward(crop);
+            const long row_offset = top/rows.stride;
+            const long col_offset = left/cols.stride;
+            DLIB_CASSERT(o.k() == out.k());
+            DLIB_CASSERT(r1 - row_offset < o.nr() && c1 - col_offset < o.nc());
+            DLIB_CASSERT(bottom != x.nr() || o.nr() + row_offset == out.nr());
+            DLIB_CASSERT(right != x.nc() || o.nc() + col_offset == out.nc());
+
+            const float* o_data = o.host();
+            float* out_data = out.host();
+            for (long k = 0; k < out.k(); ++k)
+            {
+                for (long r = r0; r <= r1; ++r)
+                {
+                    const float* s = o_data + (k*o.nr() + r - row_offset)*o.nc() + c0 - col_offset;
+                    std::copy(s, s + (c1-c0+1), out_data + (k*out.nr() + r)*out.nc() + c0);
+                }
+            }
+        }
+
+        net_type& net;
+        unsigned long tile_size;
+        impl::cascade_axis rows;
+        impl::cascade_axis cols;
+        double fraction_evaluated = 0;
+
+        resizable_tensor x;
+        resizable_tensor crop;
+        resizable_tensor out;
+        std::vector<rectangle> areas;
+        std::vector<bool> keep;
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename SUBNET
+        >
+    class mmod_prefilter
+    {
+    public:
+
+        typedef loss_mmod<SUBNET> net_type;
+
+        explicit mmod_prefilter (
+            net_type& net_,
+            double threshold_ = 0,
+            long padding_ = 0
+        ) : net(net_), threshold(threshold_), padding(padding_)
+        {
+            DLIB_CASSERT(padding >= 0);
+        }
+
+        net_type& get_net (
+        ) const { return net; }
+
+        double get_threshold (
+        ) const { return threshold; }
+
+        long get_padding (
+        ) const { return padding; }
+
+        void operator() (
+            const tensor& x,
+            const std::vector<rectangle>& areas,
+            std::vector<bool>& keep
+        )
+        {
+            keep.assign(areas.size(), false);
+            grown.clear();
+            for (auto& a : areas)
+                grown.push_back(grow_rect(a, padding));
+            grid.reset(grown);
+            for (auto& a : grown)
+                grid.add_box(a);
+
+            const tensor& output = net.subnet().forward(x);
+            DLIB_CASSERT(output.num_samples() == 1);
+            const float* out_data = output.host();
+            for (long k = 0; k < output.k(); ++k)
+            {
+                for (long r = 0; r < output.nr(); ++r)
+                {
+                    for (long c = 0; c < output.nc(); ++c)
+                    {
+                        if (*out_data++ <= threshold)
+                            continue;
+                        const point p = output_tensor_to_input_tensor(net, point(c,r));
+                        grid.find_intersecting_boxes(rectangle(p,p), idxs);
+                        for (auto i : idxs)
+                            keep[i] = true;
+                    }
+                }
+            }
+        }
+
+    private:
+
+        net_type& net;
+        double threshold;
+        long padding;
+
+        nms_grid grid;
+        std::vector<rectangle> grown;
+        std::vector<size_t> idxs;
+    };
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_DNn_MMOD_CASCADE_H_
+
@@ -0,0 +1,233 @@
+// Copyright (C) 2026  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#undef DLIB_DNn_MMOD_CASCADE_ABSTRACT_H_
+#ifdef DLIB_DNn_MMOD_CASCADE_ABSTRACT_H_
+
+#include "core_abstract.h"
+#include "loss_abstract.h"
+#include "../image_processing/non_max_suppression_abstract.h"
+#include <vector>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename SUBNET
+        >
+    class mmod_cascade
+    {
+        /*!
+            REQUIREMENTS ON SUBNET
+                - loss_mmod<SUBNET> is a valid network type.
+                - The network is a simple chain of con, max_pool, and avg_pool layers and
+                  layers that work on each location of their input separately, like relu,
+                  bn_con, or affine layers in CONV_MODE.  That is, it doesn't contain skip
+                  layers, layers that read tagged layers like add_prev or concat, fc or
+                  bn_fc layers, repeat or checkpoint blocks, or anything else that mixes
+                  together distant parts of the image.  This is true of the usual MMOD
+                  detectors, e.g. the one in dnn_mmod_face_detection_ex.cpp.
+
+            WHAT THIS OBJECT REPRESENTS
+                This object runs a loss_mmod detector as a two stage cascade.  The MMOD
+                network normally processes every pixel of the image pyramid made by its
+                input layer, even though most of the pyramid is background, or the padding
+                between pyramid levels.  A cascade instead splits the network's output into
+                square tiles and asks a cheap first stage which tiles might contain an
+                object.  The expensive network is then only run on the parts of the input
+                tensor needed to compute the tiles that passed.
+
+                The network's output at each location only depends on a small window of
+                its input, so the tiles that are computed have exactly the same values they
+                would have if the whole network was run.  Therefore, as long as the first
+                stage doesn't reject a tile holding a location whose score is above the
+                detection threshold, the cascade outputs the same detections as
+                net(img, adjust_threshold).
+
+                The first stage can be anything that's much cheaper than the network, e.g.
+                a small MMOD network trained to find the same objects (see mmod_prefilter
+                below), or an FHOG object_detector run over the image with its detections
+                mapped into the input tensor with input_layer(net).image_space_to_tensor_space().
+
+                This object keeps its working memory between calls, so reusing it, e.g. for
+                all the frames of a video, avoids allocating it again for each frame.
+        !*/
+
+    public:
+
+        typedef loss_mmod<SUBNET> net_type;
+        typedef typename net_type::input_type input_type;
+
+        explicit mmod_cascade (
+            net_type& net,
+            unsigned long tile_size = 16
+        );
+        /*!
+            requires
+                - tile_size > 0
+            ensures
+                - #get_net() == net
+                - #get_tile_size() == tile_size
+                - #get_fraction_of_tiles_evaluated() == 0
+            throws
+                - dlib::error
+                    This is thrown if net isn't made of layers mmod_cascade can evaluate
+                    one piece at a time, as described in REQUIREMENTS ON SUBNET.
+        !*/
+
+        net_type& get_net (
+        ) const;
+        /*!
+            ensures
+                - returns the network this object runs.  The cascade holds a reference to
+                  it, so it must outlive this object.
+        !*/
+
+        unsigned long get_tile_size (
+        ) const;
+        /*!
+            ensures
+                - returns the width and height of the tiles, measured in locations of the
+                  network's output tensor.  Smaller tiles let the cascade skip more of the
+                  background, but each run of tiles also has to compute a border the size
+                  of the network's receptive field, which is wasted work.
+        !*/
+
+        void set_tile_size (
+            unsigned long size
+        );
+        /*!
+            requires
+                - size > 0
+            ensures
+                - #get_tile_size() == size
+        !*/
+
+        template <typename first_stage_type>
+        std::vector<mmod_rect> operator() (
+            const input_type& img,
+            first_stage_type&& first_stage,
+            double adjust_threshold = 0
+        );
+        /*!
+            requires
+                - first_stage is a function object that can be called as:
+                    first_stage(const tensor& x, const std::vector<rectangle>& areas, std::vector<bool>& keep)
+                  where x is the input tensor get_net() makes from img and areas[i] is the
+                  part of x holding the centers of the detection windows of the i-th tile.
+                  It must set keep to a vector of areas.size() elements, with keep[i] ==
+                  false only for tiles that can't contain an object.  keep is given to
+                  first_stage with every element set to true.
+            ensures
+                - Runs the cascade on img and returns the detections.  That is, it returns
+                  what get_net()(img, adjust_threshold) would return if the network's
+                  output was -infinity outside the tiles first_stage keeps.  So if
+                  first_stage keeps every tile with a location scoring above
+                  adjust_threshold, the output is the same as
+                  get_net()(img, adjust_threshold).
+                - #get_fraction_of_tiles_evaluated() == the fraction of the tiles
+                  first_stage kept.
+        !*/
+
+        double get_fraction_of_tiles_evaluated (
+        ) const;
+        /*!
+            ensures
+                - returns the fraction of the tiles the network was run on during the last
+                  call to operator().  This is roughly the fraction of the full network's
+                  work the cascade did.
+        !*/
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename SUBNET
+        >
+    class mmod_prefilter
+    {
+        /*!
+            REQUIREMENTS ON SUBNET
+                - loss_mmod<SUBNET> is a valid network type.
+                - Its input layer makes the same input tensors as the input layer of the
+                  network it's the first stage for.  E.g. they are both
+                  input_rgb_image_pyramid<pyramid_down<6>> with the same settings.
+
+            WHAT THIS OBJECT REPRESENTS
+                This object is a first stage for mmod_cascade that uses a cheap MMOD
+                network, e.g. one with fewer or smaller layers trained on the same data as
+                the expensive one.  It keeps the tiles holding a location where the cheap
+                network's score is above a threshold.
+
+                To avoid losing detections, the threshold should be low enough that the
+                cheap network fires on every object the expensive one finds.  A good way
+                to pick it is to run both networks over a validation set.
+        !*/
+
+    public:
+
+        typedef loss_mmod<SUBNET> net_type;
+
+        explicit mmod_prefilter (
+            net_type& net,
+            double threshold = 0,
+            long padding = 0
+        );
+        /*!
+            requires
+                - padding >= 0
+            ensures
+                - #get_net() == net
+                - #get_threshold() == threshold
+                - #get_padding() == padding
+        !*/
+
+        net_type& get_net (
+        ) const;
+        /*!
+            ensures
+                - returns the cheap network this object runs.
+        !*/
+
+        double get_threshold (
+        ) const;
+        /*!
+            ensures
+                - returns the score a location of get_net()'s output has to be above to
+                  keep the tile it falls in.
+        !*/
+
+        long get_padding (
+        ) const;
+        /*!
+            ensures
+                - returns how many pixels of the input tensor the areas of the tiles are
+                  grown by before checking if they contain a location of the cheap
+                  network's output that scores above get_threshold().  Use this if the
+                  cheap network doesn't locate objects as precisely as the expensive one.
+        !*/
+
+        void operator() (
+            const tensor& x,
+            const std::vector<rectangle>& areas,
+            std::vector<bool>& keep
+        );
+        /*!
+            requires
+                - x.num_samples() == 1
+            ensures
+                - Runs get_net() on x.
+                - #keep.size() == areas.size()
+                - #keep[i] == true if and only if some location of get_net()'s output with
+                  a score > get_threshold() maps, via output_tensor_to_input_tensor(), into
+                  grow_rect(areas[i], get_padding()).
+        !*/
+    };
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_DNn_MMOD_CASCADE_ABSTRACT_H_
+
@@ -0,0 +1,573 @@
+// Copyright (C) 2026  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_DNn_PROFILER_H_
+#define DLIB_DNn_PROFILER_H_
+
+#include "profiler_abstract.h"
+#include "core.h"
+#include "layers.h"
+#include "cuda_dlib.h"
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    struct layer_profile
+    {
+        size_t layer_index = 0;
+        std::string layer_type;
+        unsigned long forward_calls = 0;
+        unsigned long backward_calls = 0;
+        std::chrono::nanoseconds forward_time = std::chrono::nanoseconds(0);
+        std::chrono::nanoseconds backward_time = std::chrono::nanoseconds(0);
+        double forward_flops = 0;
+        double backward_flops = 0;
+        double bytes_moved = 0;
+        size_t allocated_bytes = 0;
+
+        std::chrono::nanoseconds total_time (
+        ) const { return forward_time + backward_time; }
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        struct profiled_shape
+        {
+            profiled_shape() = default;
+            explicit profiled_shape(const tensor& t) :
+                num_samples(t.num_samples()), k(t.k()), nr(t.nr()), nc(t.nc()) {}
+
+            double size() const { return (double)num_samples*k*nr*nc; }
+            double sample_size() const { return (double)k*nr*nc; }
+
+            bool operator< (
+                const profiled_shape& item
+            ) const
+            {
+                return std::tie(num_samples, k, nr, nc) < std::tie(item.num_samples, item.k, item.nr, item.nc);
+            }
+
+            long long num_samples = 0;
+            long long k = 0;
+            long long nr = 0;
+            long long nc = 0;
+        };
+
+        // These estimate the floating point operations a layer does in a forward pass,
+        // counting a multiply-add as 2.  Layers without a more specific overload are
+        // assumed to do about one operation per output element.
+        template <typename LAYER_DETAILS>
+        double forward_flops (
+            const LAYER_DETAILS&,
+            const profiled_shape& ,
+            const profiled_shape& out
+        ) { return out.size(); }
+
+        template <long nf, long nr, long nc, int sy, int sx, int py, int px, long groups, int dy, int dx>
+        double forward_flops (
+            const con_<nf,nr,nc,sy,sx,py,px,groups,dy,dx>& l,
+            const profiled_shape& in,
+            const profiled_shape& out
+        ) { return out.size()*(2.0*in.k/groups*l.nr()*l.nc() + 1); }
+
+        template <long nf, long nr, long nc, int sy, int sx, int py, int px>
+        double forward_flops (
+            const cont_<nf,nr,nc,sy,sx,py,px>& l,
+            const profiled_shape& in,
+            const profiled_shape& out
+        ) { return in.size()*2.0*l.num_filters()*l.nr()*l.nc() + out.size(); }
+
+        template <unsigned long num_outputs, fc_bias_mode bias_mode>
+        double forward_flops (
+            const fc_<num_outputs,bias_mode>& ,
+            const profiled_shape& in,
+            const profiled_shape& out
+        ) { return out.size()*(2.0*in.sample_size() + 1); }
+
+        // Each output of a recurrent layer needs a row of the input and recurrent weights
+        // for each gate, plus the gate non-linearities.
+        template <unsigned long num_outputs>
+        double forward_flops (
+            const lstm_<num_outputs>& ,
+            const profiled_shape& in,
+            const profiled_shape& out
+        ) { return out.size()*(4*2.0*(in.nr*in.nc + out.nc) + 10); }
+
+        template <unsigned long num_outputs>
+        double forward_flops (
+            const gru_<num_outputs>& ,
+            const profiled_shape& in,
+            const profiled_shape& out
+        ) { return out.size()*(3*2.0*(in.nr*in.nc + out.nc) + 10); }
+
+        template <typename LAYER_DETAILS>
+        double backward_flops (
+            const LAYER_DETAILS& l,
+            const profiled_shape& in,
+            const profiled_shape& out
+        )
+        {
+            // Layers with parameters compute both the data and the parameter gradients,
+            // each of which costs about as much as the forward pass.
+            if (l.get_layer_params().size() != 0)
+                return 2*forward_flops(l, in, out);
+            return forward_flops(l, in, out);
+        }
+
+        template <typename T>
+        std::string layer_type_name (
+            const T& item
+        )
+        {
+            std::ostringstream sout;
+            sout << item;
+            std::string name = sout.str();
+            const auto end = name.find_first_of(" \t\n(");
+            if (end != std::string::npos)
+                name.resize(end);
+            return name;
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    class dnn_profiler : private impl::layer_call_observer
+    {
+    public:
+
+        dnn_profiler(
+        ) = default;
+
+        dnn_profiler(const dnn_profiler&) = delete;
+        dnn_profiler& operator=(const dnn_profiler&) = delete;
+
+        ~dnn_profiler(
+        )
+        {
+            stop();
+        }
+
+        void start (
+        )
+        {
+            if (is_running())
+                return;
+            impl::layer_call_observer* expected = nullptr;
+            const bool ok = impl::layer_call_observer_ptr().compare_exchange_strong(expected, this);
+            DLIB_CASSERT(ok, "Only one dnn_profiler can be running at a time.");
+            std::lock_guard<std::mutex> lock(m);
+            if (num_calls == 0)
+                epoch = std::chrono::steady_clock::now();
+            running = true;
+        }
+
+        void stop (
+        )
+        {
+            impl::layer_call_observer* expected = this;
+            if (impl::layer_call_observer_ptr().compare_exchange_strong(expected, nullptr))
+            {
+                // Layers that already started a call still hold a pointer to this object,
+                // so wait for them to finish with it.
+                while (impl::layer_calls_in_flight().load() != 0)
+                    std::this_thread::yield();
+            }
+            std::lock_guard<std::mutex> lock(m);
+            running = false;
+        }
+
+        bool is_running (
+        ) const
+        {
+            std::lock_guard<std::mutex> lock(m);
+            return running;
+        }
+
+        void clear (
+        )
+        {
+            std::lock_guard<std::mutex> lock(m);
+            totals.clear();
+            trace.clear();
+            thread_ids.clear();
+            num_calls = 0;
+            epoch = std::chrono::steady_clock::now();
+        }
+
+        size_t num_calls_recorded (
+        ) const
+        {
+            std::lock_guard<std::mutex> lock(m);
+            return num_calls;
+        }
+
+        size_t get_max_trace_events (
+        ) const
+        {
+            std::lock_guard<std::mutex> lock(m);
+            return max_trace_events;
+        }
+
+        void set_max_trace_events (
+            size_t num
+        )
+        {
+            std::lock_guard<std::mutex> lock(m);
+            max_trace_events = num;
+            while (trace.size() > max_trace_events)
+                trace.pop_front();
+        }
+
+        size_t num_trace_events (
+        ) const
+        {
+            std::lock_guard<std::mutex> lock(m);
+            return trace.size();
+        }
+
+        template <typename net_type>
+        std::vector<layer_profile> get_layer_profiles (
+            const net_type& net
+        ) const
+        {
+            std::lock_guard<std::mutex> lock(m);
+            std::vector<layer_profile> profiles;
+            visit_layers(net, profile_visitor(totals, profiles, nullptr));
+            return profiles;
+        }
+
+        template <typename net_type>
+        void print_report (
+            const net_type& net,
+            std::ostream& out
+        ) const
+        {
+            auto profiles = get_layer_profiles(net);
+            std::stable_sort(profiles.begin(), profiles.end(),
+                [](const layer_profile& a, const layer_profile& b) { return a.total_time() > b.total_time(); });
+
+            typedef std::chrono::duration<double,std::milli> ms;
+            ms total(0);
+            double total_flops = 0;
+            for (auto& p : profiles)
+            {
+                total += p.total_time();
+                total_flops += p.forward_flops + p.backward_flops;
+            }
+
+            std::ostringstream sout;
+            sout << std::fixed;
+            sout << "layer   type                        fwd calls   fwd ms   bwd calls   bwd ms  time %    GFLOP  GFLOP/s  MB moved  MB alloc\n";
+            for (auto& p : profiles)
+            {
+                const ms t = p.total_time();
+                const double flops = p.forward_flops + p.backward_flops;
+                sout << std::left << std::setw(7) << ("<"+std::to_string(p.layer_index)+">") << " "
+                     << std::setw(26) << p.layer_type.substr(0,26) << std::right
+                     << std::setw(11) << p.forward_calls
+                     << std::setw(9) << std::setprecision(3) << ms(p.forward_time).count()
+                     << std::setw(12) << p.backward_calls
+                     << std::setw(9) << std::setprecision(3) << ms(p.backward_time).count()
+                     << std::setw(8) << std::setprecision(1) << (total.count() > 0 ? 100*t.count()/total.count() : 0)
+                     << std::setw(9) << std::setprecision(3) << flops/1e9
+                     << std::setw(9) << std::setprecision(2) << (t.count() > 0 ? flops/1e9/(t.count()/1000) : 0)
+                     << std::setw(10) << std::setprecision(2) << p.bytes_moved/1024/1024
+                     << std::setw(10) << std::setprecision(2) << p.allocated_bytes/1024.0/1024.0
+                     << "\n";
+            }
+            sout << "total " << std::setprecision(3) << total.count() << " ms, " << total_flops/1e9 << " GFLOP\n";
+            out << sout.str();
+        }
+
+        template <typename net_type>
+        void write_chrome_trace (
+            const net_type& net,
+            std::ostream& out
+        ) const
+        {
+            std::lock_guard<std::mutex> lock(m);
+            std::vector<layer_profile> profiles;
+            std::map<layer_key, trace_info> info;
+            visit_layers(net, profile_visitor(totals, profiles, &info));
+
+            typedef std::chrono::duration<double,std::micro> us;
+            std::ostringstream sout;
+            sout << std::fixed << std::setprecision(3);
+            sout << "{\"traceEvents\":[";
+            bool first = true;
+            for (auto& e : trace)
+            {
+                if (!first)
+                    sout << ",";
+                first = false;
+                auto i = info.find(layer_key(e.layer,e.kind));
+                sout << "\n{\"name\":\"";
+                if (i != info.end())
+                    sout << "layer<" << i->second.layer_index << "> " << i->second.layer_type;
+                else
+                    sout << "unknown layer";
+                sout << "\",\"cat\":\"" << (e.call.backward ? "backward" : "forward") << "\""
+                     << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << e.thread
+                     << ",\"ts\":" << us(e.start - epoch).count()
+                     << ",\"dur\":" << us(e.duration).count()
+                     << ",\"args\":{\"input\":\"" << e.call.in.num_samples << "x" << e.call.in.k << "x" << e.call.in.nr << "x" << e.call.in.nc << "\""
+                     << ",\"output\":\"" << e.call.out.num_samples << "x" << e.call.out.k << "x" << e.call.out.nr << "x" << e.call.out.nc << "\"";
+                if (i != info.end())
+                {
+                    const auto& cost = i->second.costs.at(e.call);
+                    sout << ",\"flops\":" << cost.first << ",\"bytes_moved\":" << cost.second;
+                }
+                sout << ",\"allocated_bytes\":" << e.allocated_bytes << "}}";
+            }
+            sout << "\n],\"displayTimeUnit\":\"ms\"}\n";
+            out << sout.str();
+        }
+
+        template <typename net_type>
+        void write_chrome_trace (
+            const net_type& net,
+            const std::string& filename
+        ) const
+        {
+            std::ofstream fout(filename);
+            if (!fout)
+                throw dlib::error("Unable to open " + filename + " for writing.");
+            write_chrome_trace(net, fout);
+        }
+
+    private:
+
+        typedef std::pair<const void*, impl::profiled_layer_kind> layer_key;
+
+        // The calls to a layer are summed up separately for each direction and pair of
+        // tensor shapes, since the FLOP and byte estimates depend on them.
+        struct call_shape
+        {
+            bool backward;
+            impl::profiled_shape in;
+            impl::profiled_shape out;
+
+            bool operator< (
+                const call_shape& item
+            ) const
+            {
+                return std::tie(backward, in, out) < std::tie(item.backward, item.in, item.out);
+            }
+        };
+
+        struct call_totals
+        {
+            unsigned long calls = 0;
+            std::chrono::nanoseconds duration = std::chrono::nanoseconds(0);
+            size_t allocated_bytes = 0;
+        };
+
+        typedef std::map<layer_key, std::map<call_shape, call_totals>> totals_map;
+
+        struct event
+        {
+            const void* layer;
+            impl::profiled_layer_kind kind;
+            call_shape call;
+            int thread;
+            std::chrono::steady_clock::time_point start;
+            std::chrono::nanoseconds duration;
+            size_t allocated_bytes;
+        };
+
+        struct trace_info
+        {
+            size_t layer_index;
+            std::string layer_type;
+            // The FLOPs and bytes moved by one call with the given shapes.
+            std::map<call_shape, std::pair<double,double>> costs;
+        };
+
+        class profile_visitor
+        {
+        public:
+            profile_visitor(
+                const totals_map& totals_,
+                std::vector<layer_profile>& profiles_,
+                std::map<layer_key, trace_info>* info_
+            ) : totals(totals_), profiles(profiles_), info(info_) {}
+
+            template <typename T>
+            void operator()(size_t idx, const T& l) const
+            {
+                // The input layer, which is only charged with to_tensor().
+                add(idx, &l, impl::profiled_layer_kind::input, impl::layer_type_name(l),
+                    [](const call_shape&) { return 0.0; });
+            }
+
+            // These don't do any work of their own.  They often share an address with
+            // the layer they contain, so they must not be looked up at all.
+            template <unsigned long ID, typename U, typename E>
+            void operator()(size_t, const add_tag_layer<ID,U,E>&) const {}
+            template <template<typename> class T, typename U>
+            void operator()(size_t, const add_skip_layer<T,U>&) const {}
+            template <template<typename> class T, typename U>
+            void operator()(size_t, const checkpoint<T,U>&) const {}
+
+            template <typename T, typename U, typename E>
+            void operator()(size_t idx, const add_layer<T,U,E>& l) const
+            {
+                const auto& details = l.layer_details();
+                const double num_params = details.get_layer_params().size();
+                add(idx, &l, impl::profiled_layer_kind::computational, impl::layer_type_name(details),
+                    [&details](const call_shape& c) {
+                        return c.backward ? impl::backward_flops(details, c.in, c.out) : impl::forward_flops(details, c.in, c.out);
+                    },
+                    num_params);
+            }
+
+            template <typename T, typename U>
+            void operator()(size_t idx, const add_loss_layer<T,U>& l) const
+            {
+                add(idx, &l, impl::profiled_layer_kind::loss, impl::layer_type_name(l.loss_details()),
+                    [](const call_shape& c) { return c.out.size(); });
+            }
+
+        private:
+
+            template <typename flops_function>
+            void add (
+                size_t idx,
+                const void* layer,
+                impl::profiled_layer_kind kind,
+                const std::string& type,
+                flops_function flops_of,
+                double num_params = 0
+            ) const
+            {
+                auto i = totals.find(layer_key(layer,kind));
+                if (i == totals.end())
+                    return;
+
+                layer_profile p;
+                p.layer_index = idx;
+                p.layer_type = type;
+                trace_info ti;
+                ti.layer_index = idx;
+                ti.layer_type = type;
+                for (auto& c : i->second)
+                {
+                    const call_shape& call = c.first;
+                    const call_totals& t = c.second;
+                    const double flops = flops_of(call);
+                    // A rough count of the bytes read and written: the input, the
+                    // output, and the parameters, plus their gradients when going
+                    // backward.
+                    const double bytes = (call.in.size() + call.out.size() + num_params)*sizeof(float)*(call.backward ? 2 : 1);
+                    if (call.backward)
+                    {
+                        p.backward_calls += t.calls;
+                        p.backward_time += t.duration;
+                        p.backward_flops += t.calls*flops;
+                    }
+                    else
+                    {
+                        p.forward_calls += t.calls;
+                        p.forward_time += t.duration;
+                        p.forward_flops += t.calls*flops;
+                    }
+                    p.bytes_moved += t.calls*bytes;
+                    p.allocated_bytes = std::max(p.allocated_bytes, t.allocated_bytes);
+                    ti.costs[call] = std::make_pair(flops, bytes);
+                }
+                profiles.push_back(p);
+                if (info)
+                    (*info)[layer_key(layer,kind)] = std::move(ti);
+            }
+
+            const totals_map& totals;
+            std::vector<layer_profile>& profiles;
+            std::map<layer_key, trace_info>* info;
+        };
+
+        std::chrono::steady_clock::time_point begin_layer_call (
+        ) override
+        {
+            // Wait for any work the layer below queued on the GPU so that it isn't
+            // charged to this layer.
+#ifdef DLIB_USE_CUDA
+            cuda::device_synchronize(cuda::get_device());
+#endif
+            return std::chrono::steady_clock::now();
+        }
+
+        void end_layer_call (
+            const void* layer,
+            impl::profiled_layer_kind kind,
+            bool backward,
+            std::chrono::steady_clock::time_point start,
+            const tensor& input,
+            const tensor& output,
+            size_t allocated_bytes
+        ) override
+        {
+#ifdef DLIB_USE_CUDA
+            cuda::device_synchronize(cuda::get_device());
+#endif
+            const auto stop_time = std::chrono::steady_clock::now();
+            event e;
+            e.layer = layer;
+            e.kind = kind;
+            e.call.backward = backward;
+            e.call.in = impl::profiled_shape(input);
+            e.call.out = impl::profiled_shape(output);
+            e.start = start;
+            e.duration = stop_time - start;
+            e.allocated_bytes = allocated_bytes;
+
+            std::lock_guard<std::mutex> lock(m);
+            if (!running)
+                return;
+            call_totals& t = totals[layer_key(layer,kind)][e.call];
+            ++t.calls;
+            t.duration += e.duration;
+            t.allocated_bytes = std::max(t.allocated_bytes, allocated_bytes);
+            ++num_calls;
+
+            if (max_trace_events == 0)
+                return;
+            auto i = thread_ids.find(std::this_thread::get_id());
+            if (i == thread_ids.end())
+                i = thread_ids.insert(std::make_pair(std::this_thread::get_id(), (int)thread_ids.size())).first;
+            e.thread = i->second;
+            if (trace.size() >= max_trace_events)
+                trace.pop_front();
+            trace.push_back(e);
+        }
+
+        mutable std::mutex m;
+        bool running = false;
+        totals_map totals;
+        size_t num_calls = 0;
+        std::deque<event> trace;
+        size_t max_trace_events = 100000;
+        std::map<std::thread::id,int> thread_ids;
+        std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    };
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_DNn_PROFILER_H_
+
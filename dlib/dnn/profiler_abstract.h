@@ -0,0 +1,274 @@
+// Copyright (C) 2026  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#undef DLIB_DNn_PROFILER_ABSTRACT_H_
+#ifdef DLIB_DNn_PROFILER_ABSTRACT_H_
+
+#include "core_abstract.h"
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    struct layer_profile
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object summarizes the calls a dnn_profiler recorded for one layer of
+                a network.
+        !*/
+
+        // The index of the layer, the same index used by layer<i>(net), net_to_xml(),
+        // and when printing the network with operator<<.
+        size_t layer_index = 0;
+        // The name of the layer, e.g. "con", "relu", or "loss_multiclass_log".
+        std::string layer_type;
+
+        unsigned long forward_calls = 0;
+        unsigned long backward_calls = 0;
+        std::chrono::nanoseconds forward_time = std::chrono::nanoseconds(0);
+        std::chrono::nanoseconds backward_time = std::chrono::nanoseconds(0);
+
+        // Estimates of the floating point operations done, summed over all the calls.
+        // A multiply-add counts as 2.
+        double forward_flops = 0;
+        double backward_flops = 0;
+
+        // An estimate of the bytes read and written, summed over all the calls.  This
+        // counts the input, output, and parameter tensors, and their gradients in the
+        // backward pass.
+        double bytes_moved = 0;
+
+        // The largest number of bytes held by the layer's output, gradient, and
+        // parameter tensors that was seen after any of its calls.
+        size_t allocated_bytes = 0;
+
+        std::chrono::nanoseconds total_time (
+        ) const { return forward_time + backward_time; }
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    class dnn_profiler
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object measures where a deep neural network spends its time.  While
+                it is running, every forward and backward call of every layer, as well as
+                the to_tensor() call of the input layer and the loss computation, is
+                timed and recorded.  Afterwards you can get a per-layer summary, print it
+                as a table sorted by time, or write out the individual calls in the
+                Chrome trace event format, which can be viewed in chrome://tracing or
+                Perfetto.  For example:
+                    dnn_profiler prof;
+                    prof.start();
+                    trainer.train_one_step(samples, labels);
+                    prof.stop();
+                    prof.print_report(net, std::cout);
+                    prof.write_chrome_trace(net, "trace.json");
+
+                The recording is not tied to any particular network.  Any network used
+                in any thread while the profiler is running is recorded, which includes
+                the threads inside dnn_trainer.  The network given to the reporting
+                functions picks out which of the recorded calls are reported.  So if
+                you run several networks while profiling, report each one separately.
+                A network must not be moved or destroyed between running it and making
+                the report, since the calls are matched to the layers by their address.
+
+                So that a long training run can be profiled, the calls aren't all kept.
+                Each layer keeps running totals for each distinct pair of input and
+                output shapes it was called with, which is what the per-layer summary
+                is made from.  Only the most recent get_max_trace_events() calls are
+                kept individually for write_chrome_trace().
+
+                Some things to keep in mind when reading the results:
+                    - The FLOP and byte counts are estimates worked out from the tensor
+                      shapes.  Layers that dlib doesn't have a specific formula for are
+                      counted as doing one operation per output element.
+                    - The time charged to a loss layer includes computing the gradient
+                      of the loss, if one was computed.
+                    - Layers inside a checkpoint block are run forward twice during
+                      training, and both runs are counted.
+                    - When using CUDA, the profiler waits for the GPU to finish after
+                      each call so the time is charged to the right layer.  This makes
+                      the network run somewhat slower while it is being profiled.
+                    - There is a little overhead per call even when no profiler is
+                      running, the same as checking one atomic pointer.
+
+            THREAD SAFETY
+                Only one dnn_profiler can be running at a time.  Its member functions
+                can be called from any thread.
+        !*/
+
+    public:
+
+        dnn_profiler(
+        );
+        /*!
+            ensures
+                - #is_running() == false
+                - #num_calls_recorded() == 0
+                - #num_trace_events() == 0
+                - #get_max_trace_events() == 100000
+        !*/
+
+        ~dnn_profiler(
+        );
+        /*!
+            ensures
+                - performs stop()
+        !*/
+
+        void start (
+        );
+        /*!
+            requires
+                - No other dnn_profiler is running.
+            ensures
+                - #is_running() == true
+                - Starts recording layer calls.  Calls recorded earlier are kept, so
+                  start() and stop() can be used to profile just some parts of a
+                  program.
+        !*/
+
+        void stop (
+        );
+        /*!
+            requires
+                - This function is not called from inside a layer's forward or backward
+                  pass.
+            ensures
+                - #is_running() == false
+                - The calls recorded so far are kept.
+                - Waits for the layer calls that were already being recorded, in any
+                  thread, to finish before returning.  So once stop() returns, no layer
+                  is using this object anymore.
+        !*/
+
+        bool is_running (
+        ) const;
+        /*!
+            ensures
+                - returns true if this object is recording layer calls.
+        !*/
+
+        void clear (
+        );
+        /*!
+            ensures
+                - #num_calls_recorded() == 0
+                - #num_trace_events() == 0
+                - #is_running() == is_running()
+        !*/
+
+        size_t num_calls_recorded (
+        ) const;
+        /*!
+            ensures
+                - returns the number of layer calls recorded, from all networks.
+        !*/
+
+        size_t get_max_trace_events (
+        ) const;
+        /*!
+            ensures
+                - returns the largest number of calls that are kept individually for
+                  write_chrome_trace().  Once that many are held, each new call pushes
+                  out the oldest one.
+        !*/
+
+        void set_max_trace_events (
+            size_t num
+        );
+        /*!
+            ensures
+                - #get_max_trace_events() == num
+                - #num_trace_events() == min(num, num_trace_events()), keeping the most
+                  recent calls.
+                - Setting num to 0 turns off the trace.  The per-layer totals are still
+                  recorded.
+        !*/
+
+        size_t num_trace_events (
+        ) const;
+        /*!
+            ensures
+                - returns the number of calls currently held for write_chrome_trace().
+                - num_trace_events() <= get_max_trace_events()
+                - num_trace_events() <= num_calls_recorded()
+        !*/
+
+        template <typename net_type>
+        std::vector<layer_profile> get_layer_profiles (
+            const net_type& net
+        ) const;
+        /*!
+            requires
+                - net_type is an object of type add_layer, add_loss_layer, add_skip_layer,
+                  or add_tag_layer.
+            ensures
+                - returns a layer_profile for each layer of net with at least one
+                  recorded call, in order of layer index.  Layers that don't do any work
+                  themselves, like tags, skips, and the inputs inside repeat blocks,
+                  never appear.
+        !*/
+
+        template <typename net_type>
+        void print_report (
+            const net_type& net,
+            std::ostream& out
+        ) const;
+        /*!
+            requires
+                - net_type is an object of type add_layer, add_loss_layer, add_skip_layer,
+                  or add_tag_layer.
+            ensures
+                - prints get_layer_profiles(net) to out as a table, sorted with the layers
+                  that took the most time first.  The layers are labeled with the same
+                  indices net_to_xml() and operator<< use, so the table can be read next
+                  to those.
+        !*/
+
+        template <typename net_type>
+        void write_chrome_trace (
+            const net_type& net,
+            std::ostream& out
+        ) const;
+        /*!
+            requires
+                - net_type is an object of type add_layer, add_loss_layer, add_skip_layer,
+                  or add_tag_layer.
+            ensures
+                - writes the num_trace_events() most recent calls to out as JSON in the
+                  Chrome trace event format.  Each call is a complete ("X") event on a track for the thread
+                  that made it, with the tensor shapes, FLOPs, bytes moved, and
+                  allocated bytes in its args.  Calls that don't belong to net are
+                  written as "unknown layer".
+        !*/
+
+        template <typename net_type>
+        void write_chrome_trace (
+            const net_type& net,
+            const std::string& filename
+        ) const;
+        /*!
+            requires
+                - net_type is an object of type add_layer, add_loss_layer, add_skip_layer,
+                  or add_tag_layer.
+            ensures
+                - performs write_chrome_trace(net, out) where out writes to the file with
+                  the given name.
+            throws
+                - dlib::error if the file can't be opened.
+        !*/
+    };
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_DNn_PROFILER_ABSTRACT_H_
@@ -0,0 +1,515 @@
+// Copyright (C) 2026  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_DNn_RING_ALL_REDUCE_H_
+#define DLIB_DNn_RING_ALL_REDUCE_H_
+
+#include "ring_all_reduce_abstract.h"
+#include "../sockets.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    class ring_all_reducer
+    {
+    public:
+
+        ring_all_reducer(
+            const std::vector<network_address>& nodes_,
+            size_t rank_,
+            unsigned long timeout = 60000
+        ) : nodes(nodes_), my_rank(rank_)
+        {
+            DLIB_CASSERT(rank_ < nodes_.size());
+
+            if (nodes.size() > 1)
+                connect_ring(timeout);
+
+            worker = std::thread([this](){ this->worker_thread(); });
+            if (nodes.size() > 1)
+                sender = std::thread([this](){ this->sender_thread(); });
+        }
+
+        ring_all_reducer(const ring_all_reducer&) = delete;
+        ring_all_reducer& operator=(const ring_all_reducer&) = delete;
+
+        ~ring_all_reducer(
+        )
+        {
+            {
+                std::lock_guard<std::mutex> lock(m);
+                stopping = true;
+            }
+            // Make sure the sender isn't between checking stopping and going to sleep.
+            { std::lock_guard<std::mutex> lock(send_m); }
+            // Unblock any reads or writes that are waiting on a peer.
+            if (next_con)
+                next_con->shutdown();
+            if (prev_con)
+                prev_con->shutdown();
+            work_cv.notify_all();
+            send_cv.notify_all();
+            if (worker.joinable())
+                worker.join();
+            if (sender.joinable())
+                sender.join();
+        }
+
+        size_t num_nodes (
+        ) const { return nodes.size(); }
+
+        size_t rank (
+        ) const { return my_rank; }
+
+        const std::vector<network_address>& get_nodes (
+        ) const { return nodes; }
+
+        void start_average (
+            float* data,
+            size_t size
+        )
+        {
+            post(op_type::average, data, size, 0);
+        }
+
+        void start_sum (
+            float* data,
+            size_t size
+        )
+        {
+            post(op_type::sum, data, size, 0);
+        }
+
+        void start_broadcast (
+            float* data,
+            size_t size,
+            size_t root
+        )
+        {
+            DLIB_CASSERT(root < num_nodes());
+            post(op_type::broadcast, data, size, root);
+        }
+
+        void wait (
+        )
+        {
+            std::unique_lock<std::mutex> lock(m);
+            done_cv.wait(lock, [this](){ return outstanding == 0 || error; });
+            if (error)
+                std::rethrow_exception(error);
+        }
+
+        void average (
+            float* data,
+            size_t size
+        )
+        {
+            start_average(data, size);
+            wait();
+        }
+
+        void sum (
+            float* data,
+            size_t size
+        )
+        {
+            start_sum(data, size);
+            wait();
+        }
+
+        void broadcast (
+            float* data,
+            size_t size,
+            size_t root
+        )
+        {
+            start_broadcast(data, size, root);
+            wait();
+        }
+
+    private:
+
+        enum class op_type { sum, average, broadcast };
+
+        struct op
+        {
+            op_type type;
+            float* data;
+            size_t size;
+            size_t root;
+        };
+
+        static void encode (
+            uint64_t val,
+            char* buf
+        )
+        {
+            for (int i = 0; i < 8; ++i)
+                buf[i] = static_cast<char>((val >> (8*(7-i)))&0xFF);
+        }
+
+        static uint64_t decode (
+            const char* buf
+        )
+        {
+            uint64_t val = 0;
+            for (int i = 0; i < 8; ++i)
+                val = (val << 8) | static_cast<unsigned char>(buf[i]);
+            return val;
+        }
+
+        void connect_ring (
+            unsigned long timeout
+        )
+        {
+            using namespace std::chrono;
+            const auto deadline = steady_clock::now() + milliseconds(timeout);
+            auto ms_left = [&deadline]() -> unsigned long {
+                const auto left = duration_cast<milliseconds>(deadline - steady_clock::now()).count();
+                return static_cast<unsigned long>(std::max<long long>(1, std::min<long long>(left, 1000000)));
+            };
+
+            // Listen before connecting so the node before us in the ring can get through
+            // to us however the nodes happen to be started.
+            std::unique_ptr<listener> list;
+            if (create_listener(list, nodes[my_rank].port))
+            {
+                std::ostringstream sout;
+                sout << "ring_all_reducer: unable to listen on port " << nodes[my_rank].port;
+                throw socket_error(sout.str());
+            }
+
+            // The next node may not be up yet, so keep trying until the timeout.
+            const network_address& next = nodes[(my_rank+1)%nodes.size()];
+            while (!next_con)
+            {
+                try
+                {
+                    next_con.reset(connect(next.host_address, next.port, ms_left()));
+                }
+                catch (socket_error&)
+                {
+                    if (steady_clock::now() >= deadline)
+                    {
+                        std::ostringstream sout;
+                        sout << "ring_all_reducer: unable to connect to node " << (my_rank+1)%nodes.size()
+                             << " at " << next;
+                        throw socket_error(sout.str());
+                    }
+                    std::this_thread::sleep_for(milliseconds(50));
+                }
+            }
+            next_con->disable_nagle();
+            char hello[24];
+            encode(magic, hello);
+            encode(my_rank, hello+8);
+            encode(nodes.size(), hello+16);
+            write_all(*next_con, hello, sizeof(hello));
+
+            const size_t prev_rank = (my_rank+nodes.size()-1)%nodes.size();
+            if (list->accept(prev_con, ms_left()))
+            {
+                std::ostringstream sout;
+                sout << "ring_all_reducer: node " << prev_rank << " never connected to node " << my_rank;
+                throw socket_error(sout.str());
+            }
+            prev_con->disable_nagle();
+            read_all(*prev_con, hello, sizeof(hello));
+            if (decode(hello) != magic || decode(hello+8) != prev_rank || decode(hello+16) != nodes.size())
+            {
+                std::ostringstream sout;
+                sout << "ring_all_reducer: node " << my_rank << " expected node " << prev_rank
+                     << " of a " << nodes.size() << " node ring to connect to it, but got "
+                     << prev_con->get_foreign_ip() << ":" << prev_con->get_foreign_port() << " instead.";
+                throw socket_error(sout.str());
+            }
+        }
+
+        static void write_all (
+            connection& con,
+            const char* buf,
+            size_t num
+        )
+        {
+            while (num != 0)
+            {
+                const long n = static_cast<long>(std::min<size_t>(num, 1<<30));
+                if (con.write(buf, n) != n)
+                    throw socket_error("ring_all_reducer: lost the connection to the next node in the ring.");
+                buf += n;
+                num -= n;
+            }
+        }
+
+        static void read_all (
+            connection& con,
+            char* buf,
+            size_t num
+        )
+        {
+            while (num != 0)
+            {
+                const long n = con.read(buf, static_cast<long>(std::min<size_t>(num, 1<<30)));
+                if (n <= 0)
+                    throw socket_error("ring_all_reducer: lost the connection to the previous node in the ring.");
+                buf += n;
+                num -= n;
+            }
+        }
+
+        void post (
+            op_type type,
+            float* data,
+            size_t size,
+            size_t root
+        )
+        {
+            {
+                std::lock_guard<std::mutex> lock(m);
+                if (error)
+                    std::rethrow_exception(error);
+                if (nodes.size() == 1 || size == 0)
+                    return;
+                op o;
+                o.type = type;
+                o.data = data;
+                o.size = size;
+                o.root = root;
+                ops.push_back(o);
+                ++outstanding;
+            }
+            work_cv.notify_one();
+        }
+
+        void worker_thread (
+        )
+        {
+            while (true)
+            {
+                op o;
+                {
+                    std::unique_lock<std::mutex> lock(m);
+                    work_cv.wait(lock, [this](){ return stopping || !ops.empty(); });
+                    if (stopping)
+                        return;
+                    o = ops.front();
+                    ops.pop_front();
+                }
+
+                try
+                {
+                    if (o.type == op_type::broadcast)
+                    {
+                        ring_broadcast(o.data, o.size, o.root);
+                    }
+                    else
+                    {
+                        ring_sum(o.data, o.size);
+                        if (o.type == op_type::average)
+                        {
+                            const float scale = 1.0f/nodes.size();
+                            for (size_t i = 0; i < o.size; ++i)
+                                o.data[i] *= scale;
+                        }
+                    }
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(m);
+                    if (!error)
+                        error = std::current_exception();
+                    ops.clear();
+                    outstanding = 0;
+                    // The ring is now out of step, so tear it down.  That way the other
+                    // nodes get an error too rather than waiting on us forever.
+                    next_con->shutdown();
+                    prev_con->shutdown();
+                    done_cv.notify_all();
+                    continue;
+                }
+
+                std::lock_guard<std::mutex> lock(m);
+                if (--outstanding == 0)
+                    done_cv.notify_all();
+            }
+        }
+
+        // The sender thread writes to the next node while the worker reads from the
+        // previous one.  Doing both from one thread would deadlock as soon as a chunk is
+        // bigger than the socket buffers, since every node would be blocked in write().
+        void sender_thread (
+        )
+        {
+            while (true)
+            {
+                const char* buf;
+                size_t num;
+                {
+                    std::unique_lock<std::mutex> lock(send_m);
+                    send_cv.wait(lock, [this](){ return send_buf != nullptr || stopping_sender(); });
+                    if (send_buf == nullptr)
+                        return;
+                    buf = send_buf;
+                    num = send_num;
+                }
+
+                bool ok = true;
+                try { write_all(*next_con, buf, num); }
+                catch (...) { ok = false; }
+
+                {
+                    std::lock_guard<std::mutex> lock(send_m);
+                    send_buf = nullptr;
+                    send_ok = ok;
+                }
+                send_cv.notify_all();
+            }
+        }
+
+        bool stopping_sender (
+        )
+        {
+            std::lock_guard<std::mutex> lock(m);
+            return stopping;
+        }
+
+        void post_send (
+            const float* data,
+            size_t size
+        )
+        {
+            if (size == 0)
+                return;
+            {
+                std::lock_guard<std::mutex> lock(send_m);
+                send_buf = reinterpret_cast<const char*>(data);
+                send_num = size*sizeof(float);
+            }
+            send_cv.notify_all();
+        }
+
+        void wait_for_send (
+        )
+        {
+            std::unique_lock<std::mutex> lock(send_m);
+            send_cv.wait(lock, [this](){ return send_buf == nullptr; });
+            if (!send_ok)
+                throw socket_error("ring_all_reducer: lost the connection to the next node in the ring.");
+        }
+
+        void receive (
+            float* data,
+            size_t size
+        )
+        {
+            if (size != 0)
+                read_all(*prev_con, reinterpret_cast<char*>(data), size*sizeof(float));
+        }
+
+        void ring_sum (
+            float* data,
+            size_t size
+        )
+        {
+            // Split the buffer into one chunk per node.  During the first N-1 steps each
+            // node adds the chunk it gets from the previous node to its own copy and
+            // passes the result on, so that at the end node r holds the complete sum for
+            // chunk r+1.  During the last N-1 steps those finished chunks travel around
+            // the ring once more so every node ends up with all of them.  Each node sends
+            // and receives 2*(N-1)/N times the buffer size no matter how many nodes
+            // there are.
+            const size_t N = nodes.size();
+            auto chunk_begin = [size,N](size_t i) { return size*i/N; };
+            auto chunk_size = [size,N](size_t i) { return size*(i+1)/N - size*i/N; };
+
+            for (size_t s = 0; s+1 < N; ++s)
+            {
+                const size_t send_idx = (my_rank + N - s)%N;
+                const size_t recv_idx = (my_rank + 2*N - s - 1)%N;
+                post_send(data+chunk_begin(send_idx), chunk_size(send_idx));
+                scratch.resize(chunk_size(recv_idx));
+                receive(scratch.data(), scratch.size());
+                wait_for_send();
+                float* dest = data+chunk_begin(recv_idx);
+                for (size_t i = 0; i < scratch.size(); ++i)
+                    dest[i] += scratch[i];
+            }
+
+            for (size_t s = 0; s+1 < N; ++s)
+            {
+                const size_t send_idx = (my_rank + N + 1 - s)%N;
+                const size_t recv_idx = (my_rank + N - s)%N;
+                post_send(data+chunk_begin(send_idx), chunk_size(send_idx));
+                receive(data+chunk_begin(recv_idx), chunk_size(recv_idx));
+                wait_for_send();
+            }
+        }
+
+        void ring_broadcast (
+            float* data,
+            size_t size,
+            size_t root
+        )
+        {
+            // The data is passed along the ring in pieces so that every node can forward
+            // one piece while it receives the next.
+            const size_t N = nodes.size();
+            const size_t piece = 1<<18;
+            const bool forward = (my_rank+1)%N != root;
+            for (size_t pos = 0; pos < size; pos += piece)
+            {
+                const size_t n = std::min(piece, size-pos);
+                if (my_rank != root)
+                    receive(data+pos, n);
+                if (my_rank == root || forward)
+                {
+                    wait_for_send();
+                    post_send(data+pos, n);
+                }
+            }
+            wait_for_send();
+        }
+
+        static const uint64_t magic = 0x646c6962524e4731ULL;
+
+        const std::vector<network_address> nodes;
+        const size_t my_rank;
+        std::unique_ptr<connection> next_con;
+        std::unique_ptr<connection> prev_con;
+
+        std::mutex m;
+        std::condition_variable work_cv;
+        std::condition_variable done_cv;
+        std::deque<op> ops;
+        size_t outstanding = 0;
+        std::exception_ptr error;
+        bool stopping = false;
+        std::vector<float> scratch;
+        std::thread worker;
+
+        std::mutex send_m;
+        std::condition_variable send_cv;
+        const char* send_buf = nullptr;
+        size_t send_num = 0;
+        bool send_ok = true;
+        std::thread sender;
+    };
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_DNn_RING_ALL_REDUCE_H_
+
@@ -0,0 +1,195 @@
+// Copyright (C) 2026  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#undef DLIB_DNn_RING_ALL_REDUCE_ABSTRACT_H_
+#ifdef DLIB_DNn_RING_ALL_REDUCE_ABSTRACT_H_
+
+#include "../sockets/sockets_extensions_abstract.h"
+#include <vector>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    class ring_all_reducer
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object connects a group of processes, usually running on different
+                machines, into a ring over TCP and then lets them sum, average, or
+                broadcast arrays of floats.  It uses the ring all-reduce algorithm, so
+                each process sends and receives about twice the size of the array per
+                reduction regardless of how many processes there are.
+
+                Every process creates one of these objects with the same list of nodes
+                and its own position (rank) in that list.  After that, every operation is
+                collective: all the processes must start the same operations, on arrays of
+                the same sizes, in the same order.  The results are bit for bit identical
+                on every node.
+
+                The data is sent in the native float format of each machine, so all the
+                nodes must have the same byte order.
+
+                dnn_trainer uses this object to do data-parallel training over several
+                machines (see dnn_trainer::set_distributed_training()), but it can be
+                used on its own as well.
+
+            THREAD SAFETY
+                The operations are carried out in order by a background thread.  All the
+                member functions of one object must be called from one thread at a time.
+        !*/
+
+    public:
+
+        ring_all_reducer(
+            const std::vector<network_address>& nodes,
+            size_t rank,
+            unsigned long timeout = 60000
+        );
+        /*!
+            requires
+                - rank < nodes.size()
+            ensures
+                - #num_nodes() == nodes.size()
+                - #rank() == rank
+                - #get_nodes() == nodes
+                - Listens on port nodes[rank].port, on all interfaces, and connects to the
+                  next node in the ring, nodes[(rank+1)%nodes.size()].  The nodes can be
+                  started in any order.  This constructor keeps retrying for up to
+                  timeout milliseconds until the next node accepts its connection and
+                  the previous node connects to it.
+                - If nodes.size() == 1 then no connections are made and all the
+                  operations below are no-ops.
+            throws
+                - socket_error
+                  The ring couldn't be set up before the timeout, e.g. because a node
+                  never started or the port was in use.
+        !*/
+
+        ~ring_all_reducer(
+        );
+        /*!
+            ensures
+                - closes the connections.  Operations that haven't finished are
+                  abandoned, so the other nodes will get an error if they try to finish
+                  them.
+        !*/
+
+        size_t num_nodes (
+        ) const;
+        /*!
+            ensures
+                - returns the number of processes in the ring.
+        !*/
+
+        size_t rank (
+        ) const;
+        /*!
+            ensures
+                - returns the position of this process in get_nodes().
+        !*/
+
+        const std::vector<network_address>& get_nodes (
+        ) const;
+        /*!
+            ensures
+                - returns the addresses of all the nodes in the ring.
+        !*/
+
+        void start_sum (
+            float* data,
+            size_t size
+        );
+        /*!
+            requires
+                - data points to an array of size floats that stays valid and isn't
+                  touched by the caller until wait() returns.
+            ensures
+                - Queues an operation that replaces each data[i] with the sum of data[i]
+                  over all the nodes and returns right away.  Use wait() to wait for it.
+            throws
+                - socket_error
+                  An earlier operation failed.
+        !*/
+
+        void start_average (
+            float* data,
+            size_t size
+        );
+        /*!
+            requires
+                - data points to an array of size floats that stays valid and isn't
+                  touched by the caller until wait() returns.
+            ensures
+                - Like start_sum() except that the sums are then divided by num_nodes().
+            throws
+                - socket_error
+                  An earlier operation failed.
+        !*/
+
+        void start_broadcast (
+            float* data,
+            size_t size,
+            size_t root
+        );
+        /*!
+            requires
+                - root < num_nodes()
+                - data points to an array of size floats that stays valid and isn't
+                  touched by the caller until wait() returns.
+            ensures
+                - Queues an operation that copies the contents of data on node root into
+                  data on every other node and returns right away.  Use wait() to wait
+                  for it.
+            throws
+                - socket_error
+                  An earlier operation failed.
+        !*/
+
+        void wait (
+        );
+        /*!
+            ensures
+                - blocks until all the operations started so far are done.
+            throws
+                - socket_error
+                  An operation failed, usually because another node died or lost its
+                  connection.  Once this happens the ring is closed and every later
+                  call throws too.
+        !*/
+
+        void sum (
+            float* data,
+            size_t size
+        );
+        /*!
+            ensures
+                - performs start_sum(data,size) followed by wait()
+        !*/
+
+        void average (
+            float* data,
+            size_t size
+        );
+        /*!
+            ensures
+                - performs start_average(data,size) followed by wait()
+        !*/
+
+        void broadcast (
+            float* data,
+            size_t size,
+            size_t root
+        );
+        /*!
+            ensures
+                - performs start_broadcast(data,size,root) followed by wait()
+        !*/
+    };
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_DNn_RING_ALL_REDUCE_ABSTRACT_H_
+
@@ -131,6 +131,74 @@ namespace dlib
         Prints the solver's name and parameters to out.
     !*/
 
+// ----------------------------------------------------------------------------------------
+
+    class nesterov_sgd
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object implements the EXAMPLE_SOLVER interface defined above.  It is
+                the same as sgd except that it uses Nesterov momentum, in the form given
+                in:
+                    Sutskever, Ilya, et al. "On the importance of initialization and
+                    momentum in deep learning." International Conference on Machine
+                    Learning. 2013.
+                In particular, it computes the update vector S according to:
+                    D = -weight_decay*learning_rate*l.get_layer_params() - learning_rate*params_grad;
+                    V = momentum*V + D;
+                    S = momentum*V + D;
+                Here V is a momentum term that is remembered by the solver from one
+                invocation of operator() to the next.  That is, the step looks ahead along
+                the momentum direction, which usually converges a little faster than sgd
+                with the same settings.
+
+
+                Note that the actual learning rate and weight decay used by the solver are
+                multiplied by the per layer multipliers.  That is, the solver will call
+                get_learning_rate_multiplier(l) and get_weight_decay_multiplier(l) and
+                multiply these values with the nominal learning rate and weight decay,
+                respectively, to determine the values it will use during each step.  It is
+                also overloaded to allow additional learning rate multipliers to be applied
+                to fc_ and con_ bias parameters.
+        !*/
+    public:
+
+        nesterov_sgd(
+        ); 
+        /*!
+            ensures
+                - #get_weight_decay()  == 0.0005 
+                - #get_momentum()      == 0.9 
+        !*/
+
+        nesterov_sgd(
+            float weight_decay,
+            float momentum 
+        ); 
+        /*!
+            requires
+                - weight_decay >= 0
+                - momentum >= 0
+            ensures
+                - #get_weight_decay()  == weight_decay 
+                - #get_momentum()      == momentum 
+        !*/
+
+        float get_weight_decay () const;
+        float get_momentum () const; 
+    };
+
+    void serialize(const nesterov_sgd& item, std::ostream& out);
+    void deserialize(nesterov_sgd& item, std::istream& in);
+    /*!
+        provides serialization support  
+    !*/
+
+    std::ostream& operator<< (std::ostream& out, const nesterov_sgd& item);
+    /*!
+        Prints the solver's name and parameters to out.
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
     class adam
@@ -196,6 +264,146 @@ namespace dlib
         Prints the solver's name and parameters to out.
     !*/
 
+    class adamw
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object implements the EXAMPLE_SOLVER interface defined above.  In
+                particular, it implements the AdamW parameter update method described in
+                the paper:
+                    Loshchilov, Ilya, and Frank Hutter. "Decoupled weight decay
+                    regularization." International Conference on Learning
+                    Representations. 2019.
+                It is the same as adam except that the weight decay is not added to the
+                gradient, where adam's per parameter scaling would weaken it for
+                parameters with large gradients.  Instead every step also shrinks the
+                parameters by learning_rate*weight_decay*l.get_layer_params().  So the
+                weight decay values that work well with adamw are a lot bigger than
+                those used with adam or sgd.
+
+                Note that the actual learning rate and weight decay used by the solver are
+                multiplied by the per layer multipliers.  That is, the solver will call
+                get_learning_rate_multiplier(l) and get_weight_decay_multiplier(l) and
+                multiply these values with the nominal learning rate and weight decay,
+                respectively, to determine the values it will use during each step.  It is
+                also overloaded to allow additional learning rate multipliers to be applied
+                to fc_ and con_ bias parameters.
+        !*/
+
+    public:
+
+        adamw(
+        ); 
+        /*!
+            ensures
+                - #get_weight_decay()  == 0.01 
+                - #get_momentum1()     == 0.9 
+                - #get_momentum2()     == 0.999 
+        !*/
+
+        adamw(
+            float weight_decay,
+            float momentum1, 
+            float momentum2 
+        ); 
+        /*!
+            requires
+                - weight_decay >= 0
+                - 0 <= momentum1 < 1
+                - 0 <= momentum2 < 1
+            ensures
+                - #get_weight_decay()  == weight_decay 
+                - #get_momentum1()     == momentum1
+                - #get_momentum2()     == momentum2
+        !*/
+
+        float get_weight_decay () const;
+        float get_momentum1 () const; 
+        float get_momentum2 () const; 
+    };
+
+    void serialize(const adamw& item, std::ostream& out);
+    void deserialize(adamw& item, std::istream& in);
+    /*!
+        provides serialization support  
+    !*/
+
+    std::ostream& operator<< (std::ostream& out, const adamw& item);
+    /*!
+        Prints the solver's name and parameters to out.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    class lamb
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object implements the EXAMPLE_SOLVER interface defined above.  In
+                particular, it implements the LAMB parameter update method described in
+                the paper:
+                    You, Yang, et al. "Large batch optimization for deep learning:
+                    Training BERT in 76 minutes." International Conference on Learning
+                    Representations. 2020.
+                It computes the adamw step direction and then rescales it so that its
+                length is learning_rate times the length of the layer's parameters.  This
+                "trust ratio" is computed separately for the weights and the biases of
+                fc_, con_, cont_ and bn_ layers.  It is meant for training with very
+                large mini-batches, where it tolerates much bigger learning rates than
+                adam does.
+
+                Note that the actual learning rate and weight decay used by the solver are
+                multiplied by the per layer multipliers.  That is, the solver will call
+                get_learning_rate_multiplier(l) and get_weight_decay_multiplier(l) and
+                multiply these values with the nominal learning rate and weight decay,
+                respectively, to determine the values it will use during each step.  It is
+                also overloaded to allow additional learning rate multipliers to be applied
+                to fc_ and con_ bias parameters.
+        !*/
+
+    public:
+
+        lamb(
+        ); 
+        /*!
+            ensures
+                - #get_weight_decay()  == 0.01 
+                - #get_momentum1()     == 0.9 
+                - #get_momentum2()     == 0.999 
+        !*/
+
+        lamb(
+            float weight_decay,
+            float momentum1, 
+            float momentum2 
+        ); 
+        /*!
+            requires
+                - weight_decay >= 0
+                - 0 <= momentum1 < 1
+                - 0 <= momentum2 < 1
+            ensures
+                - #get_weight_decay()  == weight_decay 
+                - #get_momentum1()     == momentum1
+                - #get_momentum2()     == momentum2
+        !*/
+
+        float get_weight_decay () const;
+        float get_momentum1 () const; 
+        float get_momentum2 () const; 
+    };
+
+    void serialize(const lamb& item, std::ostream& out);
+    void deserialize(lamb& item, std::istream& in);
+    /*!
+        provides serialization support  
+    !*/
+
+    std::ostream& operator<< (std::ostream& out, const lamb& item);
+    /*!
+        Prints the solver's name and parameters to out.
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
 }
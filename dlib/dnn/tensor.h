@@ -10,6 +10,8 @@
 #include "gpu_data.h"
 #include "../byte_orderer.h"
 #include <memory>
+#include <cstdint>
+#include <ios>
 #include "../any.h"
 
 namespace dlib
@@ -31,6 +33,16 @@ namespace dlib
         );
     }
 
+    namespace cpu
+    {
+        // These are defined in cpu_dlib.cpp and used by the 16 bit tensor serialization
+        // formats.
+        void float_to_fp16 (uint16_t* dest, const float* src, size_t n);
+        void fp16_to_float (float* dest, const uint16_t* src, size_t n);
+        void float_to_bf16 (uint16_t* dest, const float* src, size_t n);
+        void bf16_to_float (float* dest, const uint16_t* src, size_t n);
+    }
+
 // ----------------------------------------------------------------------------------------
 
     class tensor
@@ -292,6 +304,38 @@ namespace dlib
                a.nc() == b.nc();
     }
 
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        inline bool& share_tensor_data_on_copy (
+        )
+        {
+            thread_local bool share = false;
+            return share;
+        }
+
+        class tensor_data_sharing_scope
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    While one of these objects exists, resizable_tensors copied by the
+                    current thread share their memory with the tensor they were copied
+                    from instead of getting their own copy of it (see
+                    gpu_data::share_data_with()).
+            !*/
+        public:
+            tensor_data_sharing_scope() : prev(share_tensor_data_on_copy()) { share_tensor_data_on_copy() = true; }
+            ~tensor_data_sharing_scope() { share_tensor_data_on_copy() = prev; }
+            tensor_data_sharing_scope(const tensor_data_sharing_scope&) = delete;
+            tensor_data_sharing_scope& operator=(const tensor_data_sharing_scope&) = delete;
+        private:
+            bool prev;
+        };
+
+        class tensor_block_reader;
+    }
+
 // ----------------------------------------------------------------------------------------
 
     class resizable_tensor : public tensor
@@ -321,8 +365,17 @@ namespace dlib
 
         resizable_tensor(const resizable_tensor& item) : _annotation(item.annotation()) 
         {
-            copy_size(item);
-            memcpy(*this, item);
+            if (impl::share_tensor_data_on_copy())
+            {
+                data_instance.share_data_with(item.data_instance);
+                // data_instance is already big enough so this doesn't allocate anything.
+                copy_size(item);
+            }
+            else
+            {
+                copy_size(item);
+                memcpy(*this, item);
+            }
         }
         resizable_tensor(const tensor& item) : _annotation(item.annotation()) 
         {
@@ -431,6 +484,8 @@ namespace dlib
 
     private:
 
+        friend class impl::tensor_block_reader;
+
 #ifdef DLIB_USE_CUDA
         cuda::tensor_descriptor cudnn_descriptor;
 #endif 
@@ -441,9 +496,206 @@ namespace dlib
         virtual const gpu_data& data() const { return data_instance; }
     };
 
+    enum class tensor_serialization_format
+    {
+        fp32,
+        fp16,
+        bf16
+    };
+
+    namespace impl
+    {
+        inline int tensor_serialization_format_index (
+        )
+        {
+            static const int index = std::ios_base::xalloc();
+            return index;
+        }
+    }
+
+    inline void set_tensor_serialization_format (
+        std::ostream& out,
+        tensor_serialization_format format
+    )
+    {
+        out.iword(impl::tensor_serialization_format_index()) = static_cast<long>(format);
+    }
+
+    inline tensor_serialization_format get_tensor_serialization_format (
+        std::ostream& out
+    )
+    {
+        return static_cast<tensor_serialization_format>(out.iword(impl::tensor_serialization_format_index()));
+    }
+
+    namespace impl
+    {
+        inline int tensor_block_stream_index (
+        )
+        {
+            static const int index = std::ios_base::xalloc();
+            return index;
+        }
+
+        class tensor_block_writer
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    While one of these objects exists, tensors serialized to the stream it
+                    was attached to don't write their values inline.  Instead, the values
+                    are appended to a separate stream of raw blocks, each one aligned to
+                    block_alignment bytes and holding 4 byte little endian floats.  The
+                    serialized tensor only records the offset of its block.  This is what
+                    lets load_mapped_model() use the blocks without copying them.
+            !*/
+        public:
+            static const uint64 block_alignment = 64;
+
+            tensor_block_writer (
+                std::ostream& out_,
+                std::ostream& blocks_,
+                uint64 blocks_offset
+            ) : out(out_), blocks(blocks_), pos(blocks_offset)
+            {
+                out.pword(tensor_block_stream_index()) = this;
+            }
+
+            ~tensor_block_writer() { out.pword(tensor_block_stream_index()) = nullptr; }
+            tensor_block_writer(const tensor_block_writer&) = delete;
+            tensor_block_writer& operator=(const tensor_block_writer&) = delete;
+
+            static tensor_block_writer* get (
+                std::ostream& out
+            ) { return static_cast<tensor_block_writer*>(out.pword(tensor_block_stream_index())); }
+
+            uint64 end_offset (
+            ) const { return pos; }
+
+            uint64 write (
+                const tensor& item
+            )
+            {
+                const char zeros[block_alignment] = {};
+                const uint64 padding = (block_alignment - pos%block_alignment)%block_alignment;
+                blocks.write(zeros, padding);
+                pos += padding;
+                const uint64 offset = pos;
+
+                byte_orderer bo;
+                const float* data = item.host();
+                float buf[1024];
+                for (size_t i = 0; i < item.size(); i += 1024)
+                {
+                    const size_t n = std::min<size_t>(1024, item.size()-i);
+                    for (size_t j = 0; j < n; ++j)
+                    {
+                        buf[j] = data[i+j];
+                        bo.host_to_little(buf[j]);
+                    }
+                    blocks.write((const char*)buf, n*sizeof(float));
+                }
+                pos += item.size()*sizeof(float);
+                if (!blocks)
+                    throw serialization_error("Error writing the data of a dlib::tensor to its block.");
+                return offset;
+            }
+
+        private:
+            std::ostream& out;
+            std::ostream& blocks;
+            uint64 pos;
+        };
+
+        class tensor_block_reader
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    The reading side of tensor_block_writer.  While one of these objects
+                    exists, tensors deserialized from the stream it was attached to take
+                    their values from the size bytes at data, which owner keeps alive.
+                    When the blocks are suitably laid out for this machine the tensors
+                    point directly at them (see gpu_data::set_read_only_memory()) rather
+                    than copying them.
+            !*/
+        public:
+            tensor_block_reader (
+                std::istream& in_,
+                const char* data_,
+                size_t size_,
+                std::shared_ptr<const void> owner_
+            ) : in(in_), data(data_), size(size_), owner(std::move(owner_))
+            {
+                in.pword(tensor_block_stream_index()) = this;
+            }
+
+            ~tensor_block_reader() { in.pword(tensor_block_stream_index()) = nullptr; }
+            tensor_block_reader(const tensor_block_reader&) = delete;
+            tensor_block_reader& operator=(const tensor_block_reader&) = delete;
+
+            static tensor_block_reader* get (
+                std::istream& in
+            ) { return static_cast<tensor_block_reader*>(in.pword(tensor_block_stream_index())); }
+
+            void read (
+                resizable_tensor& item,
+                uint64 offset,
+                long num_samples,
+                long k,
+                long nr,
+                long nc
+            ) const
+            {
+                const uint64 num = static_cast<uint64>(num_samples)*k*nr*nc;
+                if (offset > size || num > (size-offset)/sizeof(float))
+                    throw serialization_error("The data block of a dlib::resizable_tensor is outside the file it was loaded from.");
+                const char* block = data + offset;
+
+                byte_orderer bo;
+                if (bo.host_is_little_endian() && reinterpret_cast<std::uintptr_t>(block)%alignof(float) == 0)
+                {
+                    item.data_instance.set_read_only_memory(
+                        std::shared_ptr<const float>(owner, reinterpret_cast<const float*>(block)), num);
+                    // The gpu_data is already exactly the right size so this doesn't
+                    // allocate anything.
+                    item.set_size(num_samples, k, nr, nc);
+                }
+                else
+                {
+                    item.set_size(num_samples, k, nr, nc);
+                    float* dest = item.host_write_only();
+                    std::memcpy(dest, block, num*sizeof(float));
+                    for (uint64 i = 0; i < num; ++i)
+                        bo.little_to_host(dest[i]);
+                }
+            }
+
+        private:
+            std::istream& in;
+            const char* data;
+            size_t size;
+            std::shared_ptr<const void> owner;
+        };
+    }
+
     inline void serialize(const tensor& item, std::ostream& out)
     {
-        int version = 2;
+        if (auto writer = impl::tensor_block_writer::get(out))
+        {
+            // Version 4 keeps the values in a separately written raw block.
+            int version = 4;
+            serialize(version, out);
+            serialize(item.num_samples(), out);
+            serialize(item.k(), out);
+            serialize(item.nr(), out);
+            serialize(item.nc(), out);
+            serialize(writer->write(item), out);
+            return;
+        }
+
+        const tensor_serialization_format format = get_tensor_serialization_format(out);
+        // Plain float tensors keep using version 2 so files that don't ask for a 16 bit
+        // format can still be read by older versions of dlib.
+        int version = format == tensor_serialization_format::fp32 ? 2 : 3;
         serialize(version, out);
         serialize(item.num_samples(), out);
         serialize(item.k(), out);
@@ -451,6 +703,24 @@ namespace dlib
         serialize(item.nc(), out);
         byte_orderer bo;
         auto sbuf = out.rdbuf();
+        if (version == 3)
+        {
+            serialize(static_cast<int>(format), out);
+            const float* data = item.host();
+            uint16_t buf[1024];
+            for (size_t i = 0; i < item.size(); i += 1024)
+            {
+                const size_t n = std::min<size_t>(1024, item.size()-i);
+                if (format == tensor_serialization_format::fp16)
+                    cpu::float_to_fp16(buf, data+i, n);
+                else
+                    cpu::float_to_bf16(buf, data+i, n);
+                for (size_t j = 0; j < n; ++j)
+                    bo.host_to_little(buf[j]);
+                sbuf->sputn((char*)buf, n*sizeof(uint16_t));
+            }
+            return;
+        }
         for (auto d : item)
         {
             // Write out our data as 4byte little endian IEEE floats rather than using
@@ -469,7 +739,7 @@ namespace dlib
     {
         int version;
         deserialize(version, in);
-        if (version != 2)
+        if (version != 2 && version != 3 && version != 4)
             throw serialization_error("Unexpected version found while deserializing dlib::resizable_tensor.");
 
         long num_samples=0, k=0, nr=0, nc=0;
@@ -477,9 +747,48 @@ namespace dlib
         deserialize(k, in);
         deserialize(nr, in);
         deserialize(nc, in);
+        if (version == 4)
+        {
+            if (num_samples < 0 || k < 0 || nr < 0 || nc < 0)
+                throw serialization_error("Invalid dimensions found while deserializing dlib::resizable_tensor.");
+            uint64 offset;
+            deserialize(offset, in);
+            auto reader = impl::tensor_block_reader::get(in);
+            if (!reader)
+                throw serialization_error("This dlib::resizable_tensor was saved by save_mapped_model() and can only be loaded with load_mapped_model().");
+            reader->read(item, offset, num_samples, k, nr, nc);
+            return;
+        }
         item.set_size(num_samples, k, nr, nc);
         byte_orderer bo;
         auto sbuf = in.rdbuf();
+        if (version == 3)
+        {
+            int format;
+            deserialize(format, in);
+            if (format != static_cast<int>(tensor_serialization_format::fp16) && 
+                format != static_cast<int>(tensor_serialization_format::bf16))
+                throw serialization_error("Unknown tensor format found while deserializing dlib::resizable_tensor.");
+
+            float* data = item.host_write_only();
+            uint16_t buf[1024];
+            for (size_t i = 0; i < item.size(); i += 1024)
+            {
+                const size_t n = std::min<size_t>(1024, item.size()-i);
+                if (sbuf->sgetn((char*)buf, n*sizeof(uint16_t)) != (std::streamsize)(n*sizeof(uint16_t)))
+                {
+                    in.setstate(std::ios::badbit);
+                    throw serialization_error("Error reading data while deserializing dlib::resizable_tensor.");
+                }
+                for (size_t j = 0; j < n; ++j)
+                    bo.little_to_host(buf[j]);
+                if (format == static_cast<int>(tensor_serialization_format::fp16))
+                    cpu::fp16_to_float(data+i, buf, n);
+                else
+                    cpu::bf16_to_float(data+i, buf, n);
+            }
+            return;
+        }
         for (auto& d : item)
         {
             static_assert(sizeof(d)==4, "This serialization code assumes we are writing 4 byte floats");
@@ -533,10 +842,11 @@ namespace dlib
             return *this;
         }
 
-        virtual const float* host() const { return data_instance->host()+data_offset; }
+        // Go through a const gpu_data so that reading doesn't look like writing to it.
+        virtual const float* host() const { return static_cast<const gpu_data*>(data_instance)->host()+data_offset; }
         virtual float*       host()       { return data_instance->host()+data_offset; }
         virtual float*       host_write_only()    { return data_instance->host()+data_offset; }
-        virtual const float* device() const { return data_instance->device()+data_offset; }
+        virtual const float* device() const { return static_cast<const gpu_data*>(data_instance)->device()+data_offset; }
         virtual float*       device()       { return data_instance->device()+data_offset; }
         virtual float*       device_write_only()  { return data_instance->device()+data_offset; }
 
@@ -567,6 +567,60 @@ namespace dlib
     /*!
         provides serialization support for tensor and resizable_tensor.  Note that you can
         serialize to/from any combination of tenor and resizable_tensor objects.
+
+        By default tensors are written as 4 byte IEEE floats.  If
+        set_tensor_serialization_format() has been called on out then the tensor is
+        instead written using the requested 16 bit format.  deserialize() reads any of
+        these formats, converting the values back to float.
+
+        Tensors inside a file written by save_mapped_model() keep their values in
+        separate raw blocks (see dlib/dnn/mapped_model_abstract.h).  Those can only be
+        read back by load_mapped_model(), in which case the tensors point directly at
+        the memory mapped file rather than holding a copy of it.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    enum class tensor_serialization_format
+    {
+        fp32, // 4 byte IEEE floats
+        fp16, // IEEE half precision floats
+        bf16  // bfloat16, the top 16 bits of an IEEE float
+    };
+
+    void set_tensor_serialization_format (
+        std::ostream& out,
+        tensor_serialization_format format
+    );
+    /*!
+        ensures
+            - Every tensor subsequently serialized to out is written in the given file
+              format.  Values are rounded to the nearest representable value, ties to
+              even.  This setting is attached to the stream itself, so it applies to every
+              tensor inside anything written to out.  E.g. to save a network with 16 bit
+              weights you can do:
+                std::ofstream fout("net.dat", std::ios::binary);
+                set_tensor_serialization_format(fout, tensor_serialization_format::bf16);
+                serialize(net, fout);
+              This halves the size of the resulting file, and the network is loaded with
+              the usual deserialize() call.
+            - This only affects the file.  Tensors always hold 32 bit floats in memory,
+              so a network loaded from a 16 bit file uses as much RAM, and runs at the
+              same speed, as one loaded from a 32 bit file.
+            - #get_tensor_serialization_format(out) == format
+            - fp16 has more mantissa bits but a limited range (values with magnitude
+              larger than 65504 become infinity), while bf16 has the range of a float but
+              only about 3 significant decimal digits.
+    !*/
+
+    tensor_serialization_format get_tensor_serialization_format (
+        std::ostream& out
+    );
+    /*!
+        ensures
+            - returns the format tensors written to out will be stored in.  This is
+              tensor_serialization_format::fp32 unless set_tensor_serialization_format()
+              was called on out.
     !*/
 
 // ----------------------------------------------------------------------------------------
@@ -482,6 +482,51 @@ namespace dlib { namespace tt
 #endif
     }
 
+// ----------------------------------------------------------------------------------------
+
+    void compute_sgd_update (
+        size_t begin,
+        size_t end,
+        tensor& v,
+        const float learning_rate,
+        const float weight_decay,
+        const float momentum,
+        const tensor& params,
+        const tensor& params_grad
+    )
+    {
+#ifdef DLIB_USE_CUDA
+        cuda::compute_sgd_update(begin, end, v, learning_rate, weight_decay, momentum,
+            params, params_grad);
+#else
+        cpu::compute_sgd_update(begin, end, v, learning_rate, weight_decay, momentum,
+            params, params_grad);
+#endif
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void compute_nesterov_update (
+        size_t begin,
+        size_t end,
+        tensor& s,
+        tensor& v,
+        const float learning_rate,
+        const float weight_decay,
+        const float momentum,
+        const tensor& params,
+        const tensor& params_grad
+    )
+    {
+#ifdef DLIB_USE_CUDA
+        cuda::compute_nesterov_update(begin, end, s, v, learning_rate, weight_decay, momentum,
+            params, params_grad);
+#else
+        cpu::compute_nesterov_update(begin, end, s, v, learning_rate, weight_decay, momentum,
+            params, params_grad);
+#endif
+    }
+
 // ----------------------------------------------------------------------------------------
 
     void compute_adam_update (
@@ -508,6 +553,58 @@ namespace dlib { namespace tt
 #endif
     }
 
+// ----------------------------------------------------------------------------------------
+
+    void compute_adamw_update (
+        size_t begin,
+        size_t end,
+        tensor& s,
+        tensor& m,
+        tensor& v,
+        const float t,
+        const float learning_rate,
+        const float weight_decay,
+        const float momentum1,
+        const float momentum2,
+        const tensor& params,
+        const tensor& params_grad
+    )
+    {
+#ifdef DLIB_USE_CUDA
+        cuda::compute_adamw_update(begin, end, s, m, v, t, learning_rate, weight_decay, momentum1,
+            momentum2, params, params_grad);
+#else
+        cpu::compute_adamw_update(begin, end, s, m, v, t, learning_rate, weight_decay, momentum1,
+            momentum2, params, params_grad);
+#endif
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void compute_lamb_update (
+        size_t begin,
+        size_t end,
+        tensor& s,
+        tensor& m,
+        tensor& v,
+        const float t,
+        const float learning_rate,
+        const float weight_decay,
+        const float momentum1,
+        const float momentum2,
+        const tensor& params,
+        const tensor& params_grad
+    )
+    {
+#ifdef DLIB_USE_CUDA
+        cuda::compute_lamb_update(begin, end, s, m, v, t, learning_rate, weight_decay, momentum1,
+            momentum2, params, params_grad);
+#else
+        cpu::compute_lamb_update(begin, end, s, m, v, t, learning_rate, weight_decay, momentum1,
+            momentum2, params, params_grad);
+#endif
+    }
+
 // ----------------------------------------------------------------------------------------
 
     void batch_normalize_inference (
@@ -931,6 +1028,113 @@ namespace dlib { namespace tt
 #endif
     }
 
+// ----------------------------------------------------------------------------------------
+
+    void lstm_cell_forward (
+        tensor& gates,
+        tensor& c,
+        tensor& h,
+        const tensor& c_prev
+    )
+    {
+#ifdef DLIB_USE_CUDA
+        cuda::lstm_cell_forward(gates, c, h, c_prev);
+#else
+        cpu::lstm_cell_forward(gates, c, h, c_prev);
+#endif
+    }
+
+    void lstm_cell_backward (
+        tensor& dgates,
+        tensor& dc,
+        const tensor& gates,
+        const tensor& c,
+        const tensor& c_prev,
+        const tensor& dh
+    )
+    {
+#ifdef DLIB_USE_CUDA
+        cuda::lstm_cell_backward(dgates, dc, gates, c, c_prev, dh);
+#else
+        cpu::lstm_cell_backward(dgates, dc, gates, c, c_prev, dh);
+#endif
+    }
+
+    void gru_cell_forward (
+        tensor& gates,
+        tensor& rec,
+        tensor& h,
+        const tensor& h_prev,
+        const tensor& rec_bias
+    )
+    {
+#ifdef DLIB_USE_CUDA
+        cuda::gru_cell_forward(gates, rec, h, h_prev, rec_bias);
+#else
+        cpu::gru_cell_forward(gates, rec, h, h_prev, rec_bias);
+#endif
+    }
+
+    void gru_cell_backward (
+        tensor& dgates,
+        tensor& drec,
+        tensor& dh,
+        const tensor& gates,
+        const tensor& rec,
+        const tensor& h_prev
+    )
+    {
+#ifdef DLIB_USE_CUDA
+        cuda::gru_cell_backward(dgates, drec, dh, gates, rec, h_prev);
+#else
+        cpu::gru_cell_backward(dgates, drec, dh, gates, rec, h_prev);
+#endif
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void quantize_rows (
+        std::vector<int8_t>& q,
+        std::vector<float>& scales,
+        const tensor& data
+    )
+    {
+        cpu::quantize_rows(q, scales, data);
+    }
+
+    void quantized_conv (
+        resizable_tensor& output,
+        const tensor& data,
+        float data_scale,
+        const std::vector<int8_t>& filters,
+        const std::vector<float>& filter_scales,
+        long num_filters,
+        long filter_nr,
+        long filter_nc,
+        int stride_y,
+        int stride_x,
+        int padding_y,
+        int padding_x,
+        int dilation_y,
+        int dilation_x
+    )
+    {
+        cpu::quantized_conv(output, data, data_scale, filters, filter_scales, num_filters,
+            filter_nr, filter_nc, stride_y, stride_x, padding_y, padding_x, dilation_y, dilation_x);
+    }
+
+    void quantized_fc (
+        resizable_tensor& output,
+        const tensor& data,
+        float data_scale,
+        const std::vector<int8_t>& weights,
+        const std::vector<float>& weight_scales,
+        long num_outputs
+    )
+    {
+        cpu::quantized_fc(output, data, data_scale, weights, weight_scales, num_outputs);
+    }
+
 // ----------------------------------------------------------------------------------------
 
     void inv::
@@ -523,6 +523,71 @@ namespace dlib { namespace tt
                 #dest(n,k,r,c) == A(k)*src(n,k,r,c) + B(k).
     !*/
 
+// ----------------------------------------------------------------------------------------
+
+    void compute_sgd_update (
+        size_t begin,
+        size_t end,
+        tensor& v,
+        const float learning_rate,
+        const float weight_decay,
+        const float momentum,
+        const tensor& params,
+        const tensor& params_grad
+    );
+    /*!
+        requires
+            - v.size() == params.size() == params_grad.size()
+            - learning_rate > 0
+            - weight_decay >= 0
+            - 0 <= momentum < 1
+            - begin <= end <= params.size()
+        ensures
+            - This function implements the stochastic gradient descent with momentum
+              update used by the sgd solver, in one pass over the data.  That is, it
+              performs:
+                #v = momentum*v - learning_rate*(weight_decay*params + params_grad)
+              and #v is the update vector that should be added to the parameters.
+            - The function only operates in the half open range [begin,end) of the memory
+              blocks of each tensor.  E.g. to make this function run on the entire tensor
+              set begin to 0 and end to params.size().
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    void compute_nesterov_update (
+        size_t begin,
+        size_t end,
+        tensor& s,
+        tensor& v,
+        const float learning_rate,
+        const float weight_decay,
+        const float momentum,
+        const tensor& params,
+        const tensor& params_grad
+    );
+    /*!
+        requires
+            - s.size() == v.size() == params.size() == params_grad.size()
+            - learning_rate > 0
+            - weight_decay >= 0
+            - 0 <= momentum < 1
+            - begin <= end <= params.size()
+        ensures
+            - This function implements the Nesterov accelerated gradient update, in the
+              form given in:
+                Sutskever, Ilya, et al. "On the importance of initialization and momentum
+                in deep learning." International Conference on Machine Learning. 2013.
+              Specifically, with d == -learning_rate*(weight_decay*params + params_grad),
+              it performs:
+                #v = momentum*v + d
+                #s = momentum*#v + d
+            - #s is the update vector that should be added to the parameters.
+            - The function only operates in the half open range [begin,end) of the memory
+              blocks of each tensor.  E.g. to make this function run on the entire tensor
+              set begin to 0 and end to params.size().
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
     void compute_adam_update (
@@ -559,6 +624,91 @@ namespace dlib { namespace tt
               set begin to 0 and end to params.size().
     !*/
 
+
+// ----------------------------------------------------------------------------------------
+
+    void compute_adamw_update (
+        size_t begin,
+        size_t end,
+        tensor& s,
+        tensor& m,
+        tensor& v,
+        const float t,
+        const float learning_rate,
+        const float weight_decay,
+        const float momentum1,
+        const float momentum2,
+        const tensor& params,
+        const tensor& params_grad
+    );
+    /*!
+        requires
+            - s.size() == m.size() = v.size() == params.size() == params_grad.size()
+            - t > 0
+            - learning_rate > 0
+            - weight_decay >= 0
+            - 0 <= momentum1 < 1
+            - 0 <= momentum2 < 1
+            - begin <= end <= params.size()
+        ensures
+            - This function implements the AdamW parameter update method described in the
+              paper:
+                Loshchilov, Ilya, and Frank Hutter. "Decoupled weight decay
+                regularization." International Conference on Learning Representations.
+                2019.
+              That is, it is the same as compute_adam_update() except that the weight
+              decay isn't folded into the gradient.  Instead,
+              learning_rate*weight_decay*params is subtracted from #s directly.
+            - #s is the update vector that should be added to the parameters.
+            - The function only operates in the half open range [begin,end) of the memory
+              blocks of each tensor.  E.g. to make this function run on the entire tensor
+              set begin to 0 and end to params.size().
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    void compute_lamb_update (
+        size_t begin,
+        size_t end,
+        tensor& s,
+        tensor& m,
+        tensor& v,
+        const float t,
+        const float learning_rate,
+        const float weight_decay,
+        const float momentum1,
+        const float momentum2,
+        const tensor& params,
+        const tensor& params_grad
+    );
+    /*!
+        requires
+            - s.size() == m.size() = v.size() == params.size() == params_grad.size()
+            - t > 0
+            - learning_rate > 0
+            - weight_decay >= 0
+            - 0 <= momentum1 < 1
+            - 0 <= momentum2 < 1
+            - begin <= end <= params.size()
+        ensures
+            - This function implements the LAMB parameter update method described in the
+              paper:
+                You, Yang, et al. "Large batch optimization for deep learning: Training
+                BERT in 76 minutes." International Conference on Learning
+                Representations. 2020.
+              Specifically, it updates m and v like compute_adamw_update() and then
+              computes the direction
+                r == (m/(1-pow(momentum1,t)))/(sqrt(v/(1-pow(momentum2,t))) + 1e-6) + weight_decay*params
+              over the range [begin,end).  The update is then
+                #s == -learning_rate*trust*r
+              where trust == length(params)/length(r) over [begin,end), or 1 if either
+              length is 0.  So the range should cover exactly one layer's weights (or
+              biases) for the trust ratio to mean what the paper intends.
+            - The function only operates in the half open range [begin,end) of the memory
+              blocks of each tensor.  E.g. to make this function run on the entire tensor
+              set begin to 0 and end to params.size().
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
     void batch_normalize_inference (
@@ -902,16 +1052,17 @@ namespace dlib { namespace tt
         /*!
             requires
                 - setup() has been called.  Specifically, setup() has been called like this:
-                    this->setup(data, filters, stride_y, stride_x, padding_y, padding_x);
+                    this->setup(data, filters, stride_y, stride_x, padding_y, padding_x, dilation_y, dilation_x);
                 - is_same_object(output,data) == false
                 - is_same_object(output,filters) == false
-                - filters.k() == data.k()
-                - filters.nr() <= src.nr() + 2*padding_y
-                - filters.nc() <= src.nc() + 2*padding_x
+                - data.k()%filters.k() == 0
+                - filters.num_samples()%(data.k()/filters.k()) == 0
+                - FNR <= data.nr() + 2*padding_y
+                - FNC <= data.nc() + 2*padding_x
                 - #output.num_samples() == data.num_samples()
                 - #output.k() == filters.num_samples()
-                - #output.nr() == 1+(data.nr() + 2*padding_y - filters.nr())/stride_y
-                - #output.nc() == 1+(data.nc() + 2*padding_x - filters.nc())/stride_x
+                - #output.nr() == 1+(data.nr() + 2*padding_y - FNR)/stride_y
+                - #output.nc() == 1+(data.nc() + 2*padding_x - FNC)/stride_x
             ensures
                 - Convolves filters over data.  If add_to_output==true then we add the
                   results to output, otherwise we assign to output, overwriting the
@@ -928,12 +1079,13 @@ namespace dlib { namespace tt
         /*!
             requires
                 - setup() has been called.  Specifically, setup() has been called like this:
-                    this->setup(data, filters, stride_y, stride_x, padding_y, padding_x);
+                    this->setup(data, filters, stride_y, stride_x, padding_y, padding_x, dilation_y, dilation_x);
                 - is_same_object(output,data) == false
                 - is_same_object(output,filters) == false
-                - filters.k() == data.k()
-                - filters.nr() <= src.nr() + 2*padding_y
-                - filters.nc() <= src.nc() + 2*padding_x
+                - data.k()%filters.k() == 0
+                - filters.num_samples()%(data.k()/filters.k()) == 0
+                - FNR <= data.nr() + 2*padding_y
+                - FNC <= data.nc() + 2*padding_x
             ensures
                 - Convolves filters over data.  If add_to_output==true then we add the
                   results to output, otherwise we assign to output, overwriting the
@@ -941,8 +1093,8 @@ namespace dlib { namespace tt
                 - filters contains filters.num_samples() filters. 
                 - #output.num_samples() == data.num_samples()
                 - #output.k() == filters.num_samples()
-                - #output.nr() == 1+(data.nr() + 2*padding_y - filters.nr())/stride_y
-                - #output.nc() == 1+(data.nc() + 2*padding_x - filters.nc())/stride_x
+                - #output.nr() == 1+(data.nr() + 2*padding_y - FNR)/stride_y
+                - #output.nc() == 1+(data.nc() + 2*padding_x - FNC)/stride_x
         !*/
 
         void get_gradient_for_data (
@@ -958,12 +1110,12 @@ namespace dlib { namespace tt
                       last call to operator().  Also, data_gradient has the same dimensions
                       as the data object given to the last call to operator().
                     - setup() has been called.  Specifically, setup() has been called like this:
-                      this->setup(data_gradient, filters, stride_y, stride_x, padding_y, padding_x);
+                      this->setup(data_gradient, filters, stride_y, stride_x, padding_y, padding_x, dilation_y, dilation_x);
                 - gradient_input has the following dimensions:
                     - gradient_input.num_samples() == data_gradient.num_samples()
                     - gradient_input.k() == filters.num_samples()
-                    - gradient_input.nr() == 1+(data_gradient.nr() + 2*padding_y - filters.nr())/stride_y
-                    - gradient_input.nc() == 1+(data_gradient.nc() + 2*padding_x - filters.nc())/stride_x
+                    - gradient_input.nr() == 1+(data_gradient.nr() + 2*padding_y - FNR)/stride_y
+                    - gradient_input.nc() == 1+(data_gradient.nc() + 2*padding_x - FNC)/stride_x
                     - NOTE, these dimensions are what you would obtain if gradient_input
                       has the same dimensions as the last output of operator().  
                 - is_same_object(data_gradient,filters) == false
@@ -993,12 +1145,12 @@ namespace dlib { namespace tt
                       to the last call to operator().  Also, data has the same dimensions
                       as the data object given to the last call to operator().
                     - setup() has been called.  Specifically, setup() has been called like this:
-                      this->setup(data, filters_gradient, stride_y, stride_x, padding_y, padding_x);
+                      this->setup(data, filters_gradient, stride_y, stride_x, padding_y, padding_x, dilation_y, dilation_x);
                 - gradient_input has the following dimensions:
                     - gradient_input.num_samples() == data.num_samples()
                     - gradient_input.k() == filters.num_samples()
-                    - gradient_input.nr() == 1+(data.nr() + 2*padding_y - filters.nr())/stride_y
-                    - gradient_input.nc() == 1+(data.nc() + 2*padding_x - filters.nc())/stride_x
+                    - gradient_input.nr() == 1+(data.nr() + 2*padding_y - FNR)/stride_y
+                    - gradient_input.nc() == 1+(data.nc() + 2*padding_x - FNC)/stride_x
                     - NOTE, these dimensions are what you would obtain if gradient_input
                       has the same dimensions as the last output of operator().  
                 - is_same_object(filters_gradient,data) == false
@@ -1022,21 +1174,38 @@ namespace dlib { namespace tt
             int stride_y,
             int stride_x,
             int padding_y,
-            int padding_x
-        ) {impl.setup(data,filters,stride_y,stride_x,padding_y,padding_x); }
+            int padding_x,
+            int dilation_y = 1,
+            int dilation_x = 1
+        ) {impl.setup(data,filters,stride_y,stride_x,padding_y,padding_x,dilation_y,dilation_x); }
         /*!
             requires
-                - filters.k() == data.k()
+                - data.k()%filters.k() == 0
+                - filters.num_samples()%(data.k()/filters.k()) == 0
                 - stride_y > 0
                 - stride_x > 0
-                - 0 <= padding_y < filters.nr()
-                - 0 <= padding_x < filters.nc()
+                - dilation_y > 0
+                - dilation_x > 0
+                - 0 <= padding_y < FNR
+                - 0 <= padding_x < FNC
+                  (see below for the definitions of FNR and FNC)
             ensures
+                - The filter taps are spaced dilation_y rows and dilation_x columns apart
+                  when they are applied to data, so a filter covers a window of FNR rows
+                  and FNC columns, where:
+                    - FNR == dilation_y*(filters.nr()-1)+1
+                    - FNC == dilation_x*(filters.nc()-1)+1
+                  A dilation of 1 gives an ordinary dense filter and FNR == filters.nr().
                 - When operator() is called, the output tensor will have these dimensions:
-                    - output.nr() == 1+(data.nr() + 2*padding_y - filters.nr())/stride_y
-                    - output.nc() == 1+(data.nc() + 2*padding_x - filters.nc())/stride_x
+                    - output.nr() == 1+(data.nr() + 2*padding_y - FNR)/stride_y
+                    - output.nc() == 1+(data.nc() + 2*padding_x - FNC)/stride_x
                     - output.num_samples() == data.num_samples()
                     - output.k() == filters.num_samples()
+                - Let G == data.k()/filters.k().  If G == 1 this is an ordinary
+                  convolution.  Otherwise it's a grouped convolution: the input channels
+                  and the filters are split into G equally sized consecutive groups and the
+                  i-th group of filters only looks at the i-th group of input channels.
+                  G == data.k() gives a depthwise convolution.
                 - The point of setup() is to allow this object to gather information about
                   all the tensor sizes and filter layouts involved in the computation.  In
                   particular, the reason the tensors are input into setup() is just to
@@ -1658,6 +1827,205 @@ namespace dlib { namespace tt
                   i.e., copies content of each sample from src in to corresponding place of sample at dest.
     !*/
 
+// ----------------------------------------------------------------------------------------
+
+    void lstm_cell_forward (
+        tensor& gates,
+        tensor& c,
+        tensor& h,
+        const tensor& c_prev
+    );
+    /*!
+        requires
+            - Let H == c.size()/c.num_samples(), the number of units in the cell.
+            - gates.num_samples() == c.num_samples()
+            - gates.size() == 4*c.size()
+            - h.size() == c.size()
+            - c_prev.size() == c.size()
+        ensures
+            - Computes one time step of an LSTM for each sample.  Row n of gates holds
+              the pre-activations of the input, forget, cell and output gates of sample n,
+              in that order, as 4 consecutive blocks of H values.  That is, this function
+              performs:
+                - #gates == the gates after applying the non-linearities.  So the input,
+                  forget and output blocks are replaced with sigmoid() of themselves and
+                  the cell block is replaced with tanh() of itself.
+                - #c == f*c_prev + i*g
+                - #h == o*tanh(#c)
+              where i, f, g and o are the 4 blocks of #gates and the products are
+              pointwise.
+            - The CPU version uses an approximation of tanh and sigmoid that is accurate
+              to about 3e-7.
+    !*/
+
+    void lstm_cell_backward (
+        tensor& dgates,
+        tensor& dc,
+        const tensor& gates,
+        const tensor& c,
+        const tensor& c_prev,
+        const tensor& dh
+    );
+    /*!
+        requires
+            - gates, c, and c_prev are the outputs and input of a call to
+              lstm_cell_forward(gates, c, h, c_prev).
+            - have_same_dimensions(dgates, gates) == true
+            - dc.size() == c.size()
+            - dh.size() == c.size()
+        ensures
+            - Back-propagates through the LSTM time step.  dh is the gradient of the loss
+              with respect to h and dc is the gradient with respect to c coming from the
+              later time steps, not counting the part that flows through h.  Then:
+                - #dgates == the gradient with respect to the pre-activations of the
+                  gates, i.e. the input gates had before lstm_cell_forward() was called.
+                - #dc == the gradient with respect to c_prev.
+    !*/
+
+    void gru_cell_forward (
+        tensor& gates,
+        tensor& rec,
+        tensor& h,
+        const tensor& h_prev,
+        const tensor& rec_bias
+    );
+    /*!
+        requires
+            - Let H == h.size()/h.num_samples(), the number of units in the cell.
+            - have_same_dimensions(gates, rec) == true
+            - gates.num_samples() == h.num_samples()
+            - gates.size() == 3*h.size()
+            - h_prev.size() == h.size()
+            - rec_bias.size() == 3*H
+        ensures
+            - Computes one time step of a GRU for each sample.  Row n of gates holds the
+              parts of the update, reset and new gates of sample n computed from the
+              input, and row n of rec holds the parts computed from h_prev, both as 3
+              consecutive blocks of H values.  rec_bias is added to each row of rec.  Let
+              xz, xr, xn be the blocks of gates and hz, hr, hn the blocks of rec +
+              rec_bias.  Then this function performs:
+                - z == sigmoid(xz + hz)
+                - r == sigmoid(xr + hr)
+                - n == tanh(xn + r*hn)
+                - #gates == the blocks z, r, n
+                - #rec == the blocks hz, hr, hn.  I.e. rec + rec_bias.
+                - #h == (1-z)*n + z*h_prev
+              where the products are pointwise.
+            - The CPU version uses an approximation of tanh and sigmoid that is accurate
+              to about 3e-7.
+    !*/
+
+    void gru_cell_backward (
+        tensor& dgates,
+        tensor& drec,
+        tensor& dh,
+        const tensor& gates,
+        const tensor& rec,
+        const tensor& h_prev
+    );
+    /*!
+        requires
+            - gates, rec, and h_prev are the outputs and input of a call to
+              gru_cell_forward(gates, rec, h, h_prev, rec_bias).
+            - have_same_dimensions(dgates, gates) == true
+            - have_same_dimensions(drec, gates) == true
+            - dh.size() == h_prev.size()
+        ensures
+            - Back-propagates through the GRU time step.  dh is the gradient of the loss
+              with respect to h.  Then:
+                - #dgates == the gradient with respect to the gates input, i.e. the
+                  values gates had before gru_cell_forward() was called.
+                - #drec == the gradient with respect to the rec input.  This is also the
+                  gradient with respect to rec_bias, for each sample.
+                - #dh == the part of the gradient with respect to h_prev that doesn't
+                  flow through rec.  The rest is drec times the transpose of the matrix
+                  used to compute rec from h_prev.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    void quantize_rows (
+        std::vector<int8_t>& q,
+        std::vector<float>& scales,
+        const tensor& data
+    );
+    /*!
+        ensures
+            - Quantizes data to 8 bit integers.  data is interpreted as a matrix with
+              data.num_samples() rows and data.k()*data.nr()*data.nc() columns and each row
+              gets its own symmetric scale.  That is:
+                - #q.size() == data.size()
+                - #scales.size() == data.num_samples()
+                - #scales[r] == max(abs(row r of data))/127
+                - #q[i] == round(data.host()[i]/#scales[r]), where r is the row of element i.
+            - This function always runs on the CPU.
+    !*/
+
+    void quantized_conv (
+        resizable_tensor& output,
+        const tensor& data,
+        float data_scale,
+        const std::vector<int8_t>& filters,
+        const std::vector<float>& filter_scales,
+        long num_filters,
+        long filter_nr,
+        long filter_nc,
+        int stride_y,
+        int stride_x,
+        int padding_y,
+        int padding_x,
+        int dilation_y = 1,
+        int dilation_x = 1
+    );
+    /*!
+        requires
+            - filters and filter_scales were output by quantize_rows() when called on a
+              filter tensor with num_filters samples, data.k() channels, filter_nr rows
+              and filter_nc columns.
+            - data_scale > 0
+            - stride_y > 0
+            - stride_x > 0
+            - dilation_y > 0
+            - dilation_x > 0
+            - 0 <= padding_y < dilation_y*(filter_nr-1)+1
+            - 0 <= padding_x < dilation_x*(filter_nc-1)+1
+            - dilation_y*(filter_nr-1)+1 <= data.nr() + 2*padding_y
+            - dilation_x*(filter_nc-1)+1 <= data.nc() + 2*padding_x
+        ensures
+            - Does the same thing as tensor_conv, except data is first quantized to 8 bit
+              integers with the single scale data_scale, the convolution is done with
+              integer arithmetic against the quantized filters, and the result is scaled
+              back to floating point.  Values of data outside [-127,127]*data_scale are
+              clipped.
+            - This function always runs on the CPU.
+    !*/
+
+    void quantized_fc (
+        resizable_tensor& output,
+        const tensor& data,
+        float data_scale,
+        const std::vector<int8_t>& weights,
+        const std::vector<float>& weight_scales,
+        long num_outputs
+    );
+    /*!
+        requires
+            - weights and weight_scales were output by quantize_rows() when called on a
+              tensor with num_outputs rows and data.k()*data.nr()*data.nc() columns.
+              That is, the weights are stored one output per row.
+            - data_scale > 0
+        ensures
+            - #output.num_samples() == data.num_samples()
+            - #output.k() == num_outputs
+            - #output.nr() == 1
+            - #output.nc() == 1
+            - Performs #output == mat(data)*trans(W), where W is the float matrix
+              represented by weights and weight_scales, using integer arithmetic on a
+              quantized copy of data.  data is quantized with the single scale data_scale
+              and values outside [-127,127]*data_scale are clipped.
+            - This function always runs on the CPU.
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
 }}
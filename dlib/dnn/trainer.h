@@ -6,11 +6,14 @@
 #include "trainer_abstract.h"
 #include "core.h"
 #include "solvers.h"
+#include "data_loader.h"
+#include "ring_all_reduce.h"
 #include "../statistics.h"
 #include <chrono>
 #include <fstream>
 #include <sstream>
 #include "../serialize.h"
+#include "../vectorstream.h"
 
 #include "../pipe.h"
 #include "../threads.h"
@@ -19,11 +22,25 @@
 #include <atomic>
 #include <cstdio>
 #include <set>
+#include <vector>
+#include <functional>
 #include <future>
+#include <unordered_map>
+#include <condition_variable>
+#include <deque>
+#include <thread>
 #include <exception>
 #include <mutex>
 #include "../dir_nav.h"
 #include "../md5.h"
+#ifdef _WIN32
+#include <io.h>
+#include "../windows_magic.h"
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace dlib
 {
@@ -32,27 +49,182 @@ namespace dlib
 
     namespace impl
     {
-        template <typename training_label_type>
-        struct dnn_job_t
+        inline void write_file_durably (
+            const std::string& filename,
+            const std::vector<char>& data
+        )
+        {
+            // Write everything to a temporary file and make sure it has really hit the disk
+            // before renaming it over filename.  That way filename always holds either the
+            // old or the new contents, never a partially written file.
+            const std::string temp_filename = filename + ".tmp";
+            FILE* fout = std::fopen(temp_filename.c_str(), "wb");
+            if (!fout)
+                throw error("Unable to open " + temp_filename + " for writing.");
+            bool ok = std::fwrite(data.data(), 1, data.size(), fout) == data.size();
+            ok = std::fflush(fout) == 0 && ok;
+#ifdef _WIN32
+            ok = _commit(_fileno(fout)) == 0 && ok;
+#else
+            ok = fsync(fileno(fout)) == 0 && ok;
+#endif
+            ok = std::fclose(fout) == 0 && ok;
+            if (!ok)
+            {
+                std::remove(temp_filename.c_str());
+                throw error("Error writing to " + temp_filename + ".");
+            }
+
+#ifdef _WIN32
+            // rename() won't replace an existing file on windows, but MoveFileEx() will,
+            // atomically.
+            if (!MoveFileExA(temp_filename.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+#else
+            if (std::rename(temp_filename.c_str(), filename.c_str()) != 0)
+#endif
+                throw error("Unable to rename " + temp_filename + " to " + filename + ".");
+
+#ifndef _WIN32
+            // Also flush the directory entry so the rename itself survives a crash.
+            const auto pos = filename.find_last_of('/');
+            const std::string dir = pos == std::string::npos ? "." : filename.substr(0, pos+1);
+            const int fd = open(dir.c_str(), O_RDONLY);
+            if (fd >= 0)
+            {
+                fsync(fd);
+                close(fd);
+            }
+#endif
+        }
+
+        template <typename solver_type>
+        class layer_updater_builder
         {
-            dnn_job_t() = default;
-            dnn_job_t(const dnn_job_t&) = delete;
-            dnn_job_t& operator=(const dnn_job_t&) = delete;
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    A visitor for visit_layers() that appends to updaters, for each
+                    computational layer in turn, a function that applies a solver to just
+                    that layer, the same way add_layer::update_parameters() does.
+            !*/
+        public:
+            typedef std::function<void(solver_type&, double)> layer_updater;
+
+            explicit layer_updater_builder(std::vector<layer_updater>& updaters_) : updaters(updaters_) {}
+
+            template <typename T>
+            void operator()(size_t, T&) const
+            {
+            }
+
+            template <typename T, typename U, typename E>
+            void operator()(size_t, add_layer<T,U,E>& l) const
+            {
+                updaters.push_back([&l](solver_type& solver, double learning_rate) {
+                    const tensor& params_grad = l.get_parameter_gradient();
+                    if (params_grad.size() != 0 && get_learning_rate_multiplier(l.layer_details()) != 0)
+                    {
+                        const tensor& step = solver(learning_rate, l.layer_details(), params_grad);
+                        tt::add(l.layer_details().get_layer_params(), l.layer_details().get_layer_params(), step);
+                    }
+                });
+            }
 
-            std::vector<std::vector<training_label_type>> labels;
-            std::vector<resizable_tensor> t;
-            std::vector<int> have_data;  // have_data[i] is true if there is data in labels[i] and t[i].
-            bool test_only = false;
+        private:
+            std::vector<layer_updater>& updaters;
         };
 
-        template <typename training_label_type>
-        void swap(dnn_job_t<training_label_type>& a, dnn_job_t<training_label_type>& b)
+        class serial_task_queue
         {
-            a.labels.swap(b.labels);
-            a.t.swap(b.t);
-            a.have_data.swap(b.have_data);
-            std::swap(a.test_only,b.test_only);
-        }
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    Runs tasks on one background thread, strictly in the order they were
+                    added.  Unlike thread_pool, which makes no promises about order, this
+                    is suitable for tasks that talk to other processes, like the layer by
+                    layer gradient averaging in dnn_trainer, which every node must do in
+                    the same order.
+            !*/
+        public:
+            serial_task_queue() : worker([this](){ this->run(); }) {}
+
+            ~serial_task_queue()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m);
+                    stopping = true;
+                }
+                cv.notify_all();
+                worker.join();
+            }
+
+            serial_task_queue(const serial_task_queue&) = delete;
+            serial_task_queue& operator=(const serial_task_queue&) = delete;
+
+            void add_task (
+                std::function<void()> task
+            )
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m);
+                    tasks.push_back(std::move(task));
+                }
+                cv.notify_all();
+            }
+
+            void wait_for_all_tasks (
+            )
+            /*!
+                ensures
+                    - blocks until all the tasks added so far have run.  If any of them
+                      threw, rethrows the first exception.
+            !*/
+            {
+                std::unique_lock<std::mutex> lock(m);
+                cv.wait(lock, [this](){ return tasks.empty() && !busy; });
+                if (eptr)
+                {
+                    std::exception_ptr e = eptr;
+                    eptr = nullptr;
+                    std::rethrow_exception(e);
+                }
+            }
+
+        private:
+            void run()
+            {
+                std::unique_lock<std::mutex> lock(m);
+                while (true)
+                {
+                    cv.wait(lock, [this](){ return stopping || !tasks.empty(); });
+                    if (tasks.empty())
+                        return;
+                    std::function<void()> task = std::move(tasks.front());
+                    tasks.pop_front();
+                    busy = true;
+                    lock.unlock();
+                    try
+                    {
+                        task();
+                    }
+                    catch (...)
+                    {
+                        std::lock_guard<std::mutex> elock(m);
+                        if (!eptr)
+                            eptr = std::current_exception();
+                    }
+                    lock.lock();
+                    busy = false;
+                    cv.notify_all();
+                }
+            }
+
+            std::mutex m;
+            std::condition_variable cv;
+            std::deque<std::function<void()>> tasks;
+            bool busy = false;
+            bool stopping = false;
+            std::exception_ptr eptr;
+            std::thread worker;
+        };
     }
 
     enum class force_flush_to_disk {
@@ -136,6 +308,7 @@ namespace dlib
             job_pipe.disable();
             stop();
             wait();
+            try { wait_for_pending_sync(); } catch (...) {}
         }
 
         net_type& get_net (
@@ -221,6 +394,16 @@ namespace dlib
             ++train_one_step_calls;
         }
 
+        void train_one_step (
+            dnn_data_loader<net_type>& loader
+        )
+        {
+            print_periodic_verbose_status();
+            sync_to_disk();
+            send_job(loader);
+            ++train_one_step_calls;
+        }
+
         void train_one_step (
             const std::vector<input_type>& data
         )
@@ -349,6 +532,53 @@ namespace dlib
             sync_to_disk(true);
         }
 
+        void train (
+            dnn_data_loader<net_type>& loader
+        ) 
+        {
+            // This is the same loop as in train(data,labels), except the mini-batches
+            // come already packed from the loader.
+            for (; 
+                epoch_iteration < max_num_epochs && learning_rate >= min_learning_rate; 
+                ++epoch_iteration)
+            {
+                using namespace std::chrono;
+                last_time = system_clock::now();
+                clear_average_loss();
+                for (; epoch_pos < loader.size() && learning_rate >= min_learning_rate; epoch_pos += loader.get_mini_batch_size())
+                {
+                    if (verbose)
+                    {
+                        auto now_time = system_clock::now();
+                        if (now_time-last_time > seconds(20))
+                        {
+                            last_time = now_time;
+                            auto iter = epoch_iteration + epoch_pos/(double)loader.size();
+                            std::cout << "epoch: " << rpad(cast_to_string(iter),epoch_string_pad) << "  " 
+                                      << "learning rate: " << rpad(cast_to_string(learning_rate),lr_string_pad) << "  "
+                                      << "average loss: " << rpad(cast_to_string(get_average_loss()),string_pad) << "  ";
+                            print_progress();
+                        }
+                    }
+
+                    sync_to_disk();
+                    send_job(loader);
+                }
+                epoch_pos = 0;
+
+                if (verbose)
+                {
+                    std::cout << "Epoch: " << rpad(cast_to_string(epoch_iteration+1),epoch_string_pad) << "  " 
+                              << "learning rate: " << rpad(cast_to_string(learning_rate),lr_string_pad) << "  "
+                              << "average loss: " << rpad(cast_to_string(get_average_loss()),string_pad) << "  ";
+                    print_progress();
+                }
+            }
+            wait_for_thread_to_pause();
+            // if we modified the network at all then be sure to sync the final result.
+            sync_to_disk(true);
+        }
+
         void train (
             const std::vector<input_type>& data
         ) 
@@ -411,6 +641,7 @@ namespace dlib
             std::chrono::seconds time_between_syncs_ = std::chrono::minutes(15)
         )
         {
+            wait_for_pending_sync();
             last_sync_time = std::chrono::system_clock::now();
             sync_filename = filename;
             time_between_syncs = time_between_syncs_;
@@ -427,6 +658,59 @@ namespace dlib
             return sync_filename;
         }
 
+        void set_asynchronous_sync (
+            bool enabled
+        )
+        {
+            wait_for_pending_sync();
+            async_sync = enabled;
+        }
+
+        bool get_asynchronous_sync (
+        ) const { return async_sync; }
+
+        void wait_for_sync_to_disk (
+        )
+        {
+            wait_for_pending_sync();
+        }
+
+        void set_gradient_accumulation_steps (
+            unsigned long steps
+        )
+        {
+            DLIB_CASSERT(steps > 0);
+            wait_for_thread_to_pause();
+            gradient_accumulation_steps = steps;
+            // Drop any partly accumulated gradient.
+            micro_batch_counter = 0;
+            accumulated_loss = 0;
+        }
+
+        unsigned long get_gradient_accumulation_steps (
+        ) const { return gradient_accumulation_steps; }
+
+        void set_distributed_training (
+            const std::vector<network_address>& nodes,
+            size_t rank,
+            unsigned long timeout = 60000
+        )
+        {
+            DLIB_CASSERT(nodes.size() <= 1 || rank < nodes.size());
+            wait_for_thread_to_pause();
+            // Close any old ring first since the new one may want the same ports.
+            reducer.reset();
+            if (nodes.size() > 1)
+                reducer.reset(new ring_all_reducer(nodes, rank, timeout));
+            broadcast_parameters = true;
+        }
+
+        size_t get_num_nodes (
+        ) const { return reducer ? reducer->num_nodes() : 1; }
+
+        size_t get_node_rank (
+        ) const { return reducer ? reducer->rank() : 0; }
+
         double get_average_loss (
         ) const 
         { 
@@ -643,6 +927,68 @@ namespace dlib
             }
         }
 
+        typedef typename impl::layer_updater_builder<solver_type>::layer_updater layer_updater;
+
+        bool accumulate_gradient(
+            size_t device,
+            size_t j,
+            tensor& params_grad
+        )
+        /*!
+            ensures
+                - folds params_grad, the gradient of the j-th computational layer of the
+                  given device for the current micro-batch, into the gradient accumulated
+                  over the earlier micro-batches.
+                - returns true, with params_grad holding the gradient averaged over all
+                  the micro-batches, if this is the last micro-batch before an update.
+                  Returns false otherwise.
+        !*/
+        {
+            if (gradient_accumulation_steps == 1)
+                return true;
+            auto& acc = devices[device]->accumulated_gradients[j];
+            if (micro_batch_counter == 0)
+            {
+                acc.copy_size(params_grad);
+                memcpy(acc, params_grad);
+                return false;
+            }
+            else if (micro_batch_counter+1 < gradient_accumulation_steps)
+            {
+                tt::add(acc, acc, params_grad);
+                return false;
+            }
+            const float scale = 1.0f/gradient_accumulation_steps;
+            tt::affine_transform(params_grad, acc, params_grad, scale, scale);
+            return true;
+        }
+
+        void finish_layer_gradient(
+            size_t j,
+            tensor& params_grad,
+            tensor& params,
+            const layer_updater& update,
+            bool broadcast
+        )
+        /*!
+            ensures
+                - does everything that comes after back propagation to the j-th
+                  computational layer of the first device: accumulates its gradient,
+                  and on the last micro-batch before an update averages the gradient over
+                  the other nodes and applies the solver to the layer.
+        !*/
+        {
+            if (params_grad.size() == 0 || !accumulate_gradient(0, j, params_grad))
+                return;
+            if (reducer)
+            {
+                reducer->average(params_grad.host(), params_grad.size());
+                if (broadcast)
+                    reducer->broadcast(params.host(), params.size(), 0);
+            }
+            update(devices[0]->solvers[j], learning_rate);
+        }
+
         void update_parameters(size_t device)
         {
             auto&& dev = *devices[device];
@@ -663,6 +1009,38 @@ namespace dlib
             // different GPUs don't go out of sync.
             std::vector<tensor*> reference_params;
             visit_layer_parameters(devices[0]->net, [&](size_t, tensor& t) { reference_params.push_back(&t); });
+            std::vector<tensor*> reference_grads;
+            visit_layer_parameter_gradients(devices[0]->net, [&](size_t, tensor& t) { reference_grads.push_back(&t); });
+
+            // In CPU builds with one device, each layer's gradient is finished off on a
+            // separate thread as soon as back propagation produces it, while the layers
+            // below it are still back propagating.  That is, it's added to the gradient
+            // from the earlier micro-batches, averaged over the other nodes, and handed
+            // to the layer's solver.  With several devices the gradients have to be
+            // averaged over the devices first, and on a GPU copying each gradient to the
+            // host as soon as it's ready would stall the device, so in those cases it's
+            // all done once back propagation is finished.
+#ifdef DLIB_USE_CUDA
+            const bool overlap_updates = false;
+#else
+            const bool overlap_updates = devices.size() == 1;
+#endif
+            std::vector<layer_updater> updaters;
+            visit_layers(devices[0]->net, impl::layer_updater_builder<solver_type>(updaters));
+            std::unordered_map<const tensor*, size_t> layer_of_gradient;
+            for (size_t j = 0; j < reference_grads.size(); ++j)
+                layer_of_gradient[reference_grads[j]] = j;
+            std::vector<char> layer_finished(reference_grads.size());
+            bool broadcast = false;
+            impl::serial_task_queue finisher;
+            const std::function<void(tensor&)> gradient_ready = [&](tensor& t) {
+                auto i = layer_of_gradient.find(&t);
+                if (i == layer_of_gradient.end())
+                    return;
+                const size_t j = i->second;
+                layer_finished[j] = true;
+                finisher.add_task([&,j](){ finish_layer_gradient(j, *reference_grads[j], *reference_params[j], updaters[j], broadcast); });
+            };
 
             // We make separate thread pools with just one thread in them because we want
             // to make sure each device is always executed on the same thread.  We care
@@ -688,7 +1066,14 @@ namespace dlib
                     double theloss = 0;
                     for (auto&& loss : losses)
                         theloss += loss.get();
-                    record_test_loss(theloss/losses.size());
+                    theloss /= losses.size();
+                    if (reducer)
+                    {
+                        float node_loss = theloss;
+                        reducer->average(&node_loss, 1);
+                        theloss = node_loss;
+                    }
+                    record_test_loss(theloss);
 
                     // Check if we should shrink the learning rate based on how the test
                     // error has been doing lately.
@@ -713,18 +1098,83 @@ namespace dlib
                     continue;
                 }
 
-                updated_net_since_last_sync = true;
-                ++main_iteration_counter;
+                // With gradient accumulation each job is a micro-batch and the network is
+                // only updated after the last of every gradient_accumulation_steps of them.
+                const bool final_micro_batch = micro_batch_counter+1 >= gradient_accumulation_steps;
+                if (final_micro_batch)
+                {
+                    updated_net_since_last_sync = true;
+                    ++main_iteration_counter;
+                }
+                // The other nodes, if there are any, keep in step the same way the devices
+                // do below, by taking the parameters of the first node now and then.  This
+                // happens before the update so that the solvers on every node see the
+                // same parameters from the very first step.
+                broadcast = reducer && final_micro_batch && (main_iteration_counter%2000 == 1 || broadcast_parameters);
+                if (broadcast)
+                    broadcast_parameters = false;
+                std::fill(layer_finished.begin(), layer_finished.end(), 0);
+
                 // Call compute_parameter_gradients() and update_parameters() but pick the
                 // right version for unsupervised or supervised training based on the type
                 // of training_label_type.
                 for (size_t i = 0; i < devices.size(); ++i)
-                    tp[i]->add_task_by_value([&,i](double& loss){ loss = compute_parameter_gradients(i, next_job, pick_which_run_update); }, losses[i]);
+                {
+                    tp[i]->add_task_by_value([&,i](double& loss){
+                        if (overlap_updates)
+                        {
+                            impl::parameter_gradient_callback_scope scope(gradient_ready);
+                            loss = compute_parameter_gradients(i, next_job, pick_which_run_update);
+                        }
+                        else
+                        {
+                            loss = compute_parameter_gradients(i, next_job, pick_which_run_update);
+                        }
+                    }, losses[i]);
+                }
                 // aggregate loss values from all the network computations.
                 double theloss = 0;
                 for (auto&& loss : losses)
                     theloss += loss.get();
-                record_loss(theloss/losses.size());
+                accumulated_loss += theloss/losses.size();
+
+                if (overlap_updates)
+                {
+                    // Most layers were handed to the finisher during back propagation.
+                    // Once it's done, finish any the network didn't report, in the same
+                    // order on every node.
+                    finisher.wait_for_all_tasks();
+                    for (size_t j = 0; j < layer_finished.size(); ++j)
+                    {
+                        if (!layer_finished[j])
+                            finish_layer_gradient(j, *reference_grads[j], *reference_params[j], updaters[j], broadcast);
+                    }
+                }
+                else if (gradient_accumulation_steps > 1)
+                {
+                    for (size_t i = 0; i < devices.size(); ++i)
+                    {
+                        tp[i]->add_task_by_value([&,i](){
+                            auto&& dev = *devices[i];
+                            dlib::cuda::set_device(dev.device_id);
+                            visit_layer_parameter_gradients(dev.net, [&](size_t j, tensor& t) {
+                                if (t.size() != 0)
+                                    accumulate_gradient(i, j, t);
+                            });
+                        });
+                    }
+                    for (size_t i = 0; i < devices.size(); ++i)
+                        tp[i]->wait_for_all_tasks();
+                }
+
+                if (!final_micro_batch)
+                {
+                    ++micro_batch_counter;
+                    continue;
+                }
+                micro_batch_counter = 0;
+                theloss = accumulated_loss/gradient_accumulation_steps;
+                accumulated_loss = 0;
 
                 // Now, if there is more than one active device we need to synchronize the
                 // gradient updates between devices.  So we do that now.
@@ -769,13 +1219,52 @@ namespace dlib
                         avg.average();
                 }
 
+                // If we are one of several nodes training the same network then average
+                // the gradients over all the nodes too, unless the finisher already did.
+                if (reducer && !overlap_updates)
+                {
+                    for (auto t : reference_grads)
+                        reducer->start_average(t->host(), t->size());
+                    if (broadcast)
+                    {
+                        for (auto t : reference_params)
+                            reducer->start_broadcast(t->host(), t->size(), 0);
+                    }
+                    reducer->wait();
+
+                    for (size_t i = 1; i < devices.size(); ++i)
+                    {
+                        visit_layer_parameter_gradients(devices[i]->net, [&](size_t j, tensor& t) {
+                            memcpy(t, *reference_grads[j]);
+                        });
+                        if (broadcast)
+                        {
+                            visit_layer_parameters(devices[i]->net, [&](size_t j, tensor& t) {
+                                memcpy(t, *reference_params[j]);
+                            });
+                        }
+                    }
+                }
+                // The loss is averaged over the nodes so they all make the same decisions
+                // about the learning rate.
+                if (reducer)
+                {
+                    float node_loss = theloss;
+                    reducer->average(&node_loss, 1);
+                    theloss = node_loss;
+                }
+                record_loss(theloss);
+
 
                 // Now apply all the updates to each device.
-                for (size_t i = 0; i < devices.size(); ++i)
-                    tp[i]->add_task_by_value([&,i](){ if (next_job.have_data[i]) update_parameters(i); });
-                // and wait for the updates to all happen.
-                for (size_t i = 0; i < devices.size(); ++i)
-                    tp[i]->wait_for_all_tasks();
+                if (!overlap_updates)
+                {
+                    for (size_t i = 0; i < devices.size(); ++i)
+                        tp[i]->add_task_by_value([&,i](){ if (next_job.have_data[i]) update_parameters(i); });
+                    // and wait for the updates to all happen.
+                    for (size_t i = 0; i < devices.size(); ++i)
+                        tp[i]->wait_for_all_tasks();
+                }
 
 
                 // Every now and then force all the parameters to be the same just to make
@@ -1008,6 +1497,9 @@ namespace dlib
                 do_it_now)
             {
                 wait_for_thread_to_pause();
+                // The sync files must be complete before we look at them or pick which
+                // one to overwrite next.
+                wait_for_pending_sync();
 
                 // compact network before saving to disk.
                 this->net.clean(); 
@@ -1028,10 +1520,29 @@ namespace dlib
                 {
 
                     const std::string filename = oldest_syncfile();
-                    serialize(filename) << *this;
-
-                    if (verbose)
-                        std::cout << "Saved state to " << filename << std::endl;
+                    if (async_sync)
+                    {
+                        // Snapshot the state into memory, which is quick, and let another
+                        // thread do the slow part of getting it onto the disk while
+                        // training carries on.  The snapshot is moved, not copied, into
+                        // the writing thread, so only one copy of it exists at a time.
+                        std::vector<char> data;
+                        {
+                            vectorstream sout(data);
+                            serialize(*this, sout);
+                        }
+                        pending_sync = std::async(std::launch::async, 
+                            [filename](const std::vector<char>& data) { impl::write_file_durably(filename, data); },
+                            std::move(data));
+                        if (verbose)
+                            std::cout << "Saving state to " << filename << std::endl;
+                    }
+                    else
+                    {
+                        serialize(filename) << *this;
+                        if (verbose)
+                            std::cout << "Saved state to " << filename << std::endl;
+                    }
                 }
 
                 last_sync_time = std::chrono::system_clock::now();
@@ -1040,6 +1551,14 @@ namespace dlib
             }
         }
 
+        void wait_for_pending_sync (
+        )
+        {
+            // get() rethrows any error from writing the file.
+            if (pending_sync.valid())
+                pending_sync.get();
+        }
+
         std::string newest_syncfile (
         )
         {
@@ -1111,39 +1630,40 @@ namespace dlib
                 int device_id_,
                 net_type& net_,
                 const solver_type& solver_
-            ) : device_id(device_id_), net(net_), solvers(num_computational_layers, solver_) {}
+            ) : device_id(device_id_), net(net_), solvers(num_computational_layers, solver_), accumulated_gradients(num_computational_layers) {}
 
             device_data(
                 int device_id_,
                 net_type& net_,
                 const solver_type& solver_,
                 clone_net
-            ) : device_id(device_id_), net_copy(std::make_shared<net_type>(net_)), net(*net_copy), solvers(num_computational_layers, solver_) {}
+            ) : device_id(device_id_), net_copy(std::make_shared<net_type>(net_)), net(*net_copy), solvers(num_computational_layers, solver_), accumulated_gradients(num_computational_layers) {}
 
             int device_id;
             std::shared_ptr<net_type> net_copy;
             net_type& net;
             std::vector<solver_type> solvers;
+            // The sum of the gradients from the micro-batches since the last update.
+            std::vector<resizable_tensor> accumulated_gradients;
         };
 
         template <
             typename data_iterator,
             typename label_iterator
             >
-        void send_job (
-            bool test_only,
+        static void pack_job (
+            const std::vector<std::shared_ptr<device_data>>& devices,
             data_iterator dbegin, 
             data_iterator dend,
-            label_iterator lbegin
+            label_iterator lbegin,
+            job_t& job
         )
         {
-            propagate_exception();
             size_t num = std::distance(dbegin, dend);
             size_t devs = devices.size();
             job.t.resize(devs);
             job.labels.resize(devs);
             job.have_data.resize(devs);
-            job.test_only = test_only;
 
             // chop the data into devs blocks, each of about block_size elements.
             size_t block_size = (num+devs-1)/devs;
@@ -1169,6 +1689,39 @@ namespace dlib
             }
 
             dlib::cuda::set_device(prev_dev);
+        }
+
+        template <
+            typename data_iterator,
+            typename label_iterator
+            >
+        void send_job (
+            bool test_only,
+            data_iterator dbegin, 
+            data_iterator dend,
+            label_iterator lbegin
+        )
+        {
+            propagate_exception();
+            pack_job(devices, dbegin, dend, lbegin, job);
+            job.test_only = test_only;
+            job_pipe.enqueue(job);
+        }
+
+        void send_job (
+            dnn_data_loader<net_type>& loader
+        )
+        {
+            propagate_exception();
+            // The pack threads hold on to the device contexts rather than to this
+            // object, so it doesn't matter which of the two is destroyed first.
+            auto devs = devices;
+            loader.start_packing(this, 
+                [devs](const std::vector<input_type>& x, const std::vector<training_label_type>& y, job_t& j)
+                { pack_job(devs, x.begin(), x.end(), y.begin(), j); });
+            if (!loader.dequeue(job))
+                throw error("The dnn_data_loader has stopped producing data.");
+            job.test_only = false;
             job_pipe.enqueue(job);
         }
 
@@ -1254,6 +1807,13 @@ namespace dlib
         std::chrono::time_point<std::chrono::system_clock> last_sync_time;
         std::string sync_filename;
         std::chrono::seconds time_between_syncs;
+        bool async_sync = false;
+        std::future<void> pending_sync;
+        std::unique_ptr<ring_all_reducer> reducer;
+        bool broadcast_parameters = false;
+        unsigned long gradient_accumulation_steps = 1;
+        unsigned long micro_batch_counter = 0;
+        double accumulated_loss = 0;
         unsigned long epoch_iteration;
         size_t epoch_pos;
         std::chrono::time_point<std::chrono::system_clock> last_time;
@@ -1305,12 +1865,19 @@ namespace dlib
         temp.clean();
         serialize(temp, sout);
         out << "  net size: " << sout.str().size()/1024.0/1024.0 << "MB" << endl;
+        const size_t checkpointed_bytes = get_checkpointed_activation_bytes(trainer.get_net());
+        if (checkpointed_bytes != 0)
+            out << "  memory saved by checkpoints: " << checkpointed_bytes/1024.0/1024.0 << "MB" << endl;
         // Don't include the loss params in the hash since we print them on the next line.
         // They also aren't really part of the "architecture" of the network.
         out << "  net architecture hash: " << md5(cast_to_string(trainer.get_net().subnet())) << endl;
         out << "  loss: " << trainer.get_net().loss_details() << endl;
 
         out << "  synchronization file:                       " << trainer.get_synchronization_file() << endl;
+        if (trainer.get_gradient_accumulation_steps() > 1)
+            out << "  gradient accumulation steps:                " << trainer.get_gradient_accumulation_steps() << endl;
+        if (trainer.get_num_nodes() > 1)
+            out << "  distributed training node:                  " << trainer.get_node_rank() << " of " << trainer.get_num_nodes() << endl;
         out << "  trainer.get_solvers()[0]:                   " << trainer.get_solvers()[0] << endl;
         auto sched = trainer.get_learning_rate_schedule();
         if (sched.size() != 0)
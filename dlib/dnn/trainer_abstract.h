@@ -5,6 +5,8 @@
 
 #include "core_abstract.h"
 #include "solvers_abstract.h"
+#include "data_loader_abstract.h"
+#include "ring_all_reduce_abstract.h"
 #include <vector>
 #include <chrono>
 
@@ -46,6 +48,11 @@ namespace dlib
                 dnn_trainer is constructed.  It will continue to use that device even if
                 you later change it by a call to cudaSetDevice().
 
+                In CPU builds the solver is applied to each layer on a separate thread as
+                soon as back propagation has produced that layer's gradient, so updating
+                the deep layers overlaps with back propagating through the shallow ones.
+                This gives the same results as updating the whole network afterwards.
+
             EXCEPTIONS
                 If an exception is thrown by any part of the neural network during training
                 then the exception will be propagated out of the trainer to the user.
@@ -376,6 +383,141 @@ namespace dlib
                   state to.  If the return value is "" then synchronization is disabled.
         !*/
 
+        void set_asynchronous_sync (
+            bool enabled
+        );
+        /*!
+            ensures
+                - #get_asynchronous_sync() == enabled
+                - Waits for any file write started by an earlier asynchronous sync to
+                  finish before changing the setting.
+        !*/
+
+        bool get_asynchronous_sync (
+        ) const;
+        /*!
+            ensures
+                - returns true if syncs to the synchronization file happen in the
+                  background and false otherwise.  By default this is false.
+                - When true, each sync serializes the trainer state into memory, which
+                  only briefly pauses training, and then a background thread writes that
+                  snapshot to a temporary file, flushes it to the physical disk, and
+                  renames it over the sync file.  So a sync file is never left partially
+                  written, and training continues while the write is in progress.  The
+                  cost is that the snapshot needs as much extra RAM as the sync file
+                  takes on disk.
+                - Since the write happens in the background, a function like get_net()
+                  that forces a sync may return before the file is on disk.  Call
+                  wait_for_sync_to_disk() if you need it to be.  Only one write is ever
+                  in flight at once: the next sync waits for the previous write to
+                  finish.  If a background write fails then the resulting exception is
+                  thrown by the next sync or by wait_for_sync_to_disk().
+        !*/
+
+        void wait_for_sync_to_disk (
+        );
+        /*!
+            ensures
+                - Blocks until any background write started by an asynchronous sync has
+                  finished.  If it failed, throws the exception describing why.
+                - Returns immediately if no such write is in progress.
+        !*/
+
+        void set_gradient_accumulation_steps (
+            unsigned long steps
+        );
+        /*!
+            requires
+                - steps > 0
+            ensures
+                - #get_gradient_accumulation_steps() == steps
+                - Any gradient accumulated so far, but not yet applied, is discarded.
+        !*/
+
+        unsigned long get_gradient_accumulation_steps (
+        ) const;
+        /*!
+            ensures
+                - returns the number of mini-batches whose gradients are accumulated before
+                  the network is updated.  The trainer averages the parameter gradients of
+                  get_gradient_accumulation_steps() consecutive mini-batches, including
+                  the ones given to train_one_step(), and then applies the solvers once.
+                  So training with get_mini_batch_size() == M and
+                  get_gradient_accumulation_steps() == K works like training with a
+                  mini-batch of M*K samples (apart from layers like bn_ that look at the
+                  whole mini-batch), while only needing the memory for M.
+                - The loss recorded for each update, and therefore get_average_loss() and
+                  the learning rate logic, is the average over the K mini-batches.  The
+                  iterations without progress thresholds and the learning rate schedule
+                  count updates, while get_train_one_step_calls() counts mini-batches.
+                - The partly accumulated gradient isn't saved in synchronization files.
+                - The default is 1, i.e. no accumulation.
+        !*/
+
+        void set_distributed_training (
+            const std::vector<network_address>& nodes,
+            size_t rank,
+            unsigned long timeout = 60000
+        );
+        /*!
+            requires
+                - nodes.size() <= 1 || rank < nodes.size()
+            ensures
+                - Makes this trainer node number rank of a data-parallel training job
+                  spread over nodes.size() processes, usually on different machines.
+                  Each process trains its own copy of the network on its own share of the
+                  training data, and after every mini-batch the parameter gradients are
+                  averaged over all the processes, using a ring_all_reducer connected to
+                  the given nodes, before the solvers are applied.  So the processes
+                  stay in lockstep and together train the network as one trainer would
+                  with a mini-batch nodes.size() times bigger.
+                - In CPU builds with one device per process, each layer's gradient is
+                  averaged, and the layer updated, as soon as back propagation has
+                  computed it, so most of the communication overlaps with the back
+                  propagation of the layers below.  Otherwise the gradients are averaged
+                  once back propagation is done.
+                  When there are several local devices the gradients are first averaged
+                  over the devices and then over the nodes.
+                - The loss of each mini-batch is averaged over the nodes too, so
+                  get_average_loss(), the learning rate schedule, and the decision to
+                  stop training are identical on every node.
+                - On the next mini-batch, and every 2000 mini-batches after that, the
+                  parameters of node 0 are copied to all the other nodes before the
+                  update, so they start from the same network and can't drift apart.
+                - #get_num_nodes() == max(1,nodes.size())
+                - #get_node_rank() == (nodes.size() > 1 ? rank : 0)
+                - If nodes.size() <= 1 then distributed training is turned off.
+                - Since the nodes synchronize on every mini-batch, every node must make
+                  the same sequence of calls to train_one_step() and test_one_step(), or
+                  call train() with the same number of mini-batches per epoch.  A node
+                  that does anything else stalls the others.  It is usually best to have
+                  only node 0 print progress and write synchronization files.
+                - To try this out on one machine, start several processes that use
+                  addresses like "127.0.0.1:5000", "127.0.0.1:5001", and so on.
+            throws
+                - socket_error
+                  The nodes couldn't all be connected within timeout milliseconds.  See
+                  ring_all_reducer.  If a node dies during training then the other
+                  nodes get a socket_error from their next call to this object.
+        !*/
+
+        size_t get_num_nodes (
+        ) const;
+        /*!
+            ensures
+                - returns the number of processes this trainer is training with,
+                  including itself.  This is 1 unless set_distributed_training() was
+                  called with more than one node.
+        !*/
+
+        size_t get_node_rank (
+        ) const;
+        /*!
+            ensures
+                - returns this trainer's position in the list of nodes given to
+                  set_distributed_training(), or 0 if training isn't distributed.
+        !*/
+
         void train (
             const std::vector<input_type>& data,
             const std::vector<training_label_type>& labels 
@@ -434,6 +576,28 @@ namespace dlib
                   stopped touching the net. 
         !*/
 
+        void train (
+            dnn_data_loader<net_type>& loader
+        );
+        /*!
+            requires
+                - loader has not been used with any other dnn_trainer.
+                - The network given to this trainer's constructor outlives loader.
+            ensures
+                - Trains the network like the train() methods above, except the training
+                  data comes from loader.  Each epoch is loader.batches_per_epoch()
+                  mini-batches of loader.get_mini_batch_size() samples.  The
+                  get_mini_batch_size() value of this trainer isn't used.
+                - The mini-batches are loaded, augmented, and converted into tensors by
+                  loader's own threads while the network trains on earlier mini-batches,
+                  so the devices don't have to wait on that work.  See
+                  dnn_data_loader::get_stats() to find out if they wait anyway.
+                - This function blocks until all threads inside the dnn_trainer have
+                  stopped touching the net. 
+                - Any exception thrown by the loader's load or augment functions is
+                  rethrown from this function.
+        !*/
+
         void train_one_step (
             const std::vector<input_type>& data,
             const std::vector<training_label_type>& labels 
@@ -542,6 +706,26 @@ namespace dlib
                   accessing the network.
                 - #get_train_one_step_calls() == get_train_one_step_calls() + 1.
         !*/
+
+        void train_one_step (
+            dnn_data_loader<net_type>& loader
+        );
+        /*!
+            requires
+                - loader has not been used with any other dnn_trainer.
+                - The network given to this trainer's constructor outlives loader.
+            ensures
+                - Performs one stochastic gradient update step on the next mini-batch
+                  produced by loader.  Calling this in a loop is equivalent to calling
+                  train(loader), except that you decide when to stop.
+                - Any exception thrown by the loader's load or augment functions is
+                  rethrown from this function.
+                - The network training will happen in another thread.  Therefore, after
+                  calling this function you should call get_net() before you touch the net
+                  object from the calling thread to ensure no other threads are still
+                  accessing the network.
+                - #get_train_one_step_calls() == get_train_one_step_calls() + 1.
+        !*/
         
         double get_average_loss (
         ) const;
@@ -92,6 +92,12 @@ namespace dlib
                 out << "<layer idx='"<<idx<<"' type='skip' id='"<<(tag_id<T>::id)<<"'/>\n";
             }
 
+            template <template<typename> class T, typename U>
+            void operator()(size_t idx, const checkpoint<T,U>& l) 
+            {
+                out << "<layer idx='"<<idx<<"' type='checkpoint'/>\n";
+            }
+
         private:
 
             std::ostream& out;
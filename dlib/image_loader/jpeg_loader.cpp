@@ -46,6 +46,18 @@ namespace dlib
         read_image( f.full_name().c_str() );
     }
 
+// ----------------------------------------------------------------------------------------
+
+    jpeg_loader::
+    jpeg_loader( const unsigned char* image_buffer, size_t buffer_size ) : height_( 0 ), width_( 0 ), output_components_(0)
+    {
+        if ( image_buffer == NULL )
+        {
+            throw image_load_error("jpeg_loader: invalid image buffer, it is NULL");
+        }
+        read_image( NULL, image_buffer, buffer_size, "memory buffer" );
+    }
+
 // ----------------------------------------------------------------------------------------
 
     bool jpeg_loader::is_gray() const
@@ -84,6 +96,41 @@ namespace dlib
         longjmp(myerr->setjmp_buffer, 1);
     }
 
+// ----------------------------------------------------------------------------------------
+
+    // libjpeg only knows how to read from FILE objects, so this source manager lets it
+    // read from a buffer in memory instead.
+    void jpeg_loader_init_source (j_decompress_ptr)
+    {
+    }
+
+    boolean jpeg_loader_fill_input_buffer (j_decompress_ptr cinfo)
+    {
+        // We only get here if the image is truncated.  Hand libjpeg an end of image
+        // marker so it finishes with whatever it has, like it does for a short file.
+        static const JOCTET eoi[2] = { 0xFF, JPEG_EOI };
+        cinfo->src->next_input_byte = eoi;
+        cinfo->src->bytes_in_buffer = 2;
+        return TRUE;
+    }
+
+    void jpeg_loader_skip_input_data (j_decompress_ptr cinfo, long num_bytes)
+    {
+        if (num_bytes <= 0)
+            return;
+        while (num_bytes > (long)cinfo->src->bytes_in_buffer)
+        {
+            num_bytes -= (long)cinfo->src->bytes_in_buffer;
+            jpeg_loader_fill_input_buffer(cinfo);
+        }
+        cinfo->src->next_input_byte += num_bytes;
+        cinfo->src->bytes_in_buffer -= num_bytes;
+    }
+
+    void jpeg_loader_term_source (j_decompress_ptr)
+    {
+    }
+
 // ----------------------------------------------------------------------------------------
 
     void jpeg_loader::read_image( const char* filename )
@@ -98,8 +145,30 @@ namespace dlib
             throw image_load_error(std::string("jpeg_loader: unable to open file ") + filename);
         }
 
+        try
+        {
+            read_image( fp, NULL, 0, filename );
+        }
+        catch (...)
+        {
+            fclose( fp );
+            throw;
+        }
+        fclose( fp );
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void jpeg_loader::read_image( 
+        FILE* fp, 
+        const unsigned char* image_buffer, 
+        size_t buffer_size,
+        const char* source_name
+    )
+    {
         jpeg_decompress_struct cinfo;
         jpeg_loader_error_mgr jerr;
+        jpeg_source_mgr memory_src;
 
         cinfo.err = jpeg_std_error(&jerr.pub);
 
@@ -109,17 +178,30 @@ namespace dlib
         if (setjmp(jerr.setjmp_buffer)) 
         {
             /* If we get here, the JPEG code has signaled an error.
-             * We need to clean up the JPEG object, close the input file, and return.
+             * We need to clean up the JPEG object and return.
              */
             jpeg_destroy_decompress(&cinfo);
-            fclose(fp);
-            throw image_load_error(std::string("jpeg_loader: error while reading ") + filename);
+            throw image_load_error(std::string("jpeg_loader: error while reading ") + source_name);
         }
 
 
         jpeg_create_decompress(&cinfo);
 
-        jpeg_stdio_src(&cinfo, fp);
+        if (fp)
+        {
+            jpeg_stdio_src(&cinfo, fp);
+        }
+        else
+        {
+            memory_src.init_source = jpeg_loader_init_source;
+            memory_src.fill_input_buffer = jpeg_loader_fill_input_buffer;
+            memory_src.skip_input_data = jpeg_loader_skip_input_data;
+            memory_src.resync_to_restart = jpeg_resync_to_restart;
+            memory_src.term_source = jpeg_loader_term_source;
+            memory_src.next_input_byte = image_buffer;
+            memory_src.bytes_in_buffer = buffer_size;
+            cinfo.src = &memory_src;
+        }
 
         jpeg_read_header(&cinfo, TRUE);
 
@@ -133,10 +215,9 @@ namespace dlib
             output_components_ != 3 &&
             output_components_ != 4)
         {
-            fclose( fp );
             jpeg_destroy_decompress(&cinfo);
             std::ostringstream sout;
-            sout << "jpeg_loader: Unsupported number of colors (" << output_components_ << ") in file " << filename;
+            sout << "jpeg_loader: Unsupported number of colors (" << output_components_ << ") in " << source_name;
             throw image_load_error(sout.str());
         }
 
@@ -158,8 +239,6 @@ namespace dlib
 
         jpeg_finish_decompress(&cinfo);
         jpeg_destroy_decompress(&cinfo);
-
-        fclose( fp );
     }
 
 // ----------------------------------------------------------------------------------------
@@ -4,6 +4,7 @@
 #define DLIB_JPEG_IMPORT
 
 #include <vector>
+#include <cstdio>
 
 #include "jpeg_loader_abstract.h"
 #include "image_loader.h"
@@ -20,6 +21,7 @@ namespace dlib
         jpeg_loader( const char* filename );
         jpeg_loader( const std::string& filename );
         jpeg_loader( const dlib::file& f );
+        jpeg_loader( const unsigned char* image_buffer, size_t buffer_size );
 
         bool is_gray() const;
         bool is_rgb() const;
@@ -76,6 +78,7 @@ namespace dlib
         }
 
         void read_image( const char* filename );
+        void read_image( FILE* fp, const unsigned char* image_buffer, size_t buffer_size, const char* source_name );
         unsigned long height_; 
         unsigned long width_;
         unsigned long output_components_;
@@ -65,6 +65,25 @@ namespace dlib
                   us from loading the given JPEG file.
         !*/
 
+        jpeg_loader( 
+            const unsigned char* image_buffer,
+            size_t buffer_size
+        );
+        /*!
+            requires
+                - image_buffer points to buffer_size bytes holding the contents of a JPEG
+                  file.
+            ensures
+                - loads the JPEG image stored in the given buffer into this object.  The
+                  buffer is only used during this call, it doesn't need to outlive the
+                  jpeg_loader.
+            throws
+                - std::bad_alloc
+                - image_load_error
+                  This exception is thrown if there is some error that prevents
+                  us from loading the given JPEG image.
+        !*/
+
         ~jpeg_loader(
         );
         /*!
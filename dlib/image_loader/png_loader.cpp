@@ -53,6 +53,18 @@ namespace dlib
         read_image( f.full_name().c_str() );
     }
 
+// ----------------------------------------------------------------------------------------
+
+    png_loader::
+    png_loader( const unsigned char* image_buffer, size_t buffer_size ) : height_( 0 ), width_( 0 )
+    {
+        if ( image_buffer == NULL )
+        {
+            throw image_load_error("png_loader: invalid image buffer, it is NULL");
+        }
+        read_image( NULL, image_buffer, buffer_size, "memory buffer" );
+    }
+
 // ----------------------------------------------------------------------------------------
 
     const unsigned char* png_loader::get_row( unsigned i ) const
@@ -108,9 +120,24 @@ namespace dlib
     {
     }
 
+    struct png_loader_memory_source
+    {
+        const unsigned char* data;
+        size_t size;
+    };
+
+    void png_loader_read_from_memory(png_structp png_ptr, png_bytep out, png_size_t length)
+    {
+        png_loader_memory_source* src = (png_loader_memory_source*)png_get_io_ptr(png_ptr);
+        if (length > src->size)
+            png_error(png_ptr, "unexpected end of image buffer");
+        std::memcpy(out, src->data, length);
+        src->data += length;
+        src->size -= length;
+    }
+
     void png_loader::read_image( const char* filename )
     {
-        ld_.reset(new LibpngData);
         if ( filename == NULL )
         {
             throw image_load_error("png_loader: invalid filename, it is NULL");
@@ -120,21 +147,53 @@ namespace dlib
         {
             throw image_load_error(std::string("png_loader: unable to open file ") + filename);
         }
-        png_byte sig[8];
-        if (fread( sig, 1, 8, fp ) != 8)
+        try
+        {
+            read_image( fp, NULL, 0, filename );
+        }
+        catch (...)
         {
             fclose( fp );
-            throw image_load_error(std::string("png_loader: error reading file ") + filename);
+            throw;
+        }
+        fclose( fp );
+    }
+
+    void png_loader::read_image( 
+        FILE* fp, 
+        const unsigned char* image_buffer, 
+        size_t buffer_size,
+        const char* filename
+    )
+    {
+        ld_.reset(new LibpngData);
+        ld_->row_pointers_ = NULL;
+        png_loader_memory_source memory_src;
+        png_byte sig[8];
+        if (fp)
+        {
+            if (fread( sig, 1, 8, fp ) != 8)
+            {
+                throw image_load_error(std::string("png_loader: error reading file ") + filename);
+            }
+        }
+        else
+        {
+            if (buffer_size < 8)
+            {
+                throw image_load_error(std::string("png_loader: error reading ") + filename);
+            }
+            std::memcpy(sig, image_buffer, 8);
+            memory_src.data = image_buffer + 8;
+            memory_src.size = buffer_size - 8;
         }
         if ( png_sig_cmp( sig, 0, 8 ) != 0 )
         {
-            fclose( fp );
             throw image_load_error(std::string("png_loader: format error in file ") + filename);
         }
         ld_->png_ptr_ = png_create_read_struct( PNG_LIBPNG_VER_STRING, NULL, &png_loader_user_error_fn_silent, &png_loader_user_warning_fn_silent );
         if ( ld_->png_ptr_ == NULL )
         {
-            fclose( fp );
             std::ostringstream sout;
             sout << "Error, unable to allocate png structure while opening file " << filename << std::endl;
             const char* runtime_version = png_get_header_ver(NULL);
@@ -149,14 +208,12 @@ namespace dlib
         ld_->info_ptr_ = png_create_info_struct( ld_->png_ptr_ );
         if ( ld_->info_ptr_ == NULL )
         {
-            fclose( fp );
             png_destroy_read_struct( &( ld_->png_ptr_ ), ( png_infopp )NULL, ( png_infopp )NULL );
             throw image_load_error(std::string("png_loader: parse error in file ") + filename);
         }
         ld_->end_info_ = png_create_info_struct( ld_->png_ptr_ );
         if ( ld_->end_info_ == NULL )
         {
-            fclose( fp );
             png_destroy_read_struct( &( ld_->png_ptr_ ), &( ld_->info_ptr_ ), ( png_infopp )NULL );
             throw image_load_error(std::string("png_loader: parse error in file ") + filename);
         }
@@ -164,14 +221,16 @@ namespace dlib
         if (setjmp(png_jmpbuf(ld_->png_ptr_)))
         {
             // If we get here, we had a problem writing the file 
-            fclose(fp);
             png_destroy_read_struct( &( ld_->png_ptr_ ), &( ld_->info_ptr_ ), &( ld_->end_info_ ) );
             throw image_load_error(std::string("png_loader: parse error in file ") + filename);
         }
 
         png_set_palette_to_rgb(ld_->png_ptr_);
 
-        png_init_io( ld_->png_ptr_, fp );
+        if (fp)
+            png_init_io( ld_->png_ptr_, fp );
+        else
+            png_set_read_fn( ld_->png_ptr_, &memory_src, png_loader_read_from_memory );
         png_set_sig_bytes( ld_->png_ptr_, 8 );
         // flags force one byte per channel output
         byte_orderer bo;
@@ -190,21 +249,18 @@ namespace dlib
             color_type_ != PNG_COLOR_TYPE_RGB_ALPHA &&
             color_type_ != PNG_COLOR_TYPE_GRAY_ALPHA)
         {
-            fclose( fp );
             png_destroy_read_struct( &( ld_->png_ptr_ ), &( ld_->info_ptr_ ), &( ld_->end_info_ ) );
             throw image_load_error(std::string("png_loader: unsupported color type in file ") + filename);
         }
 
         if (bit_depth_ != 8 && bit_depth_ != 16)
         {
-            fclose( fp );
             png_destroy_read_struct( &( ld_->png_ptr_ ), &( ld_->info_ptr_ ), &( ld_->end_info_ ) );
             throw image_load_error("png_loader: unsupported bit depth of " + cast_to_string(bit_depth_) + " in file " + std::string(filename));
         }
 
         ld_->row_pointers_ = png_get_rows( ld_->png_ptr_, ld_->info_ptr_ );
 
-        fclose( fp );
         if ( ld_->row_pointers_ == NULL )
         {
             png_destroy_read_struct( &( ld_->png_ptr_ ), &( ld_->info_ptr_ ), &( ld_->end_info_ ) );
@@ -4,6 +4,7 @@
 #define DLIB_PNG_IMPORT
 
 #include <memory>
+#include <cstdio>
 
 #include "png_loader_abstract.h"
 #include "image_loader.h"
@@ -21,6 +22,7 @@ namespace dlib
         png_loader( const char* filename );
         png_loader( const std::string& filename );
         png_loader( const dlib::file& f );
+        png_loader( const unsigned char* image_buffer, size_t buffer_size );
         ~png_loader();
 
         bool is_gray() const;
@@ -191,6 +193,7 @@ namespace dlib
     private:
         const unsigned char* get_row( unsigned i ) const;
         void read_image( const char* filename );
+        void read_image( FILE* fp, const unsigned char* image_buffer, size_t buffer_size, const char* filename );
         unsigned height_, width_;
         unsigned bit_depth_;
         int color_type_;
@@ -0,0 +1,343 @@
+// Copyright (C) 2026  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_NON_MAX_SUPPRESSIoN_Hh_
+#define DLIB_NON_MAX_SUPPRESSIoN_Hh_
+
+#include "non_max_suppression_abstract.h"
+#include "box_overlap_testing.h"
+#include "../geometry.h"
+#include "../uintn.h"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <vector>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    class nms_grid
+    {
+    public:
+
+        nms_grid(
+        ) = default;
+
+        explicit nms_grid(
+            const test_box_overlap& overlaps_
+        ) : overlaps(overlaps_) {}
+
+        const test_box_overlap& get_overlap_tester (
+        ) const { return overlaps; }
+
+        void set_overlap_tester (
+            const test_box_overlap& overlaps_
+        ) { overlaps = overlaps_; }
+
+        void reset (
+            const rectangle& area_,
+            unsigned long cell_size_
+        )
+        {
+            DLIB_ASSERT(cell_size_ > 0);
+            clear();
+            area = area_;
+            cell_size = cell_size_;
+            if (area.is_empty())
+            {
+                num_cols = 1;
+                num_rows = 1;
+            }
+            else
+            {
+                num_cols = (area.width()+cell_size-1)/cell_size;
+                num_rows = (area.height()+cell_size-1)/cell_size;
+            }
+            if (cells.size() < num_cols*num_rows)
+                cells.resize(num_cols*num_rows);
+        }
+
+        void reset (
+            const std::vector<rectangle>& candidates
+        )
+        {
+            reset_from(candidates.begin(), candidates.end(), [](const rectangle& r) -> const rectangle& { return r; });
+        }
+
+        template <typename T>
+        void reset (
+            const std::vector<T>& candidates
+        )
+        {
+            reset_from(candidates.begin(), candidates.end(), [](const T& d) -> const rectangle& { return d.rect; });
+        }
+
+        void clear (
+        )
+        {
+            for (auto c : used_cells)
+                cells[c].clear();
+            used_cells.clear();
+            boxes.clear();
+            stamps.clear();
+        }
+
+        size_t size (
+        ) const { return boxes.size(); }
+
+        const rectangle& operator[] (
+            size_t idx
+        ) const { return boxes[idx]; }
+
+        void add_box (
+            const rectangle& rect
+        )
+        {
+            const uint32 id = boxes.size();
+            boxes.push_back(rect);
+            stamps.push_back(0);
+            if (rect.is_empty())
+                return;
+
+            long c0, r0, c1, r1;
+            cell_range(rect, c0, r0, c1, r1);
+            for (long r = r0; r <= r1; ++r)
+            {
+                for (long c = c0; c <= c1; ++c)
+                {
+                    auto& cell = cells[r*num_cols + c];
+                    if (cell.empty())
+                        used_cells.push_back(r*num_cols + c);
+                    cell.push_back(id);
+                }
+            }
+        }
+
+        bool overlaps_any_box (
+            const rectangle& rect
+        )
+        {
+            bool found = false;
+            for_each_candidate(rect, [&](uint32 id) -> bool {
+                if (overlaps(boxes[id], rect))
+                {
+                    found = true;
+                    return false;
+                }
+                return true;
+            });
+            return found;
+        }
+
+        void find_intersecting_boxes (
+            const rectangle& rect,
+            std::vector<size_t>& idxs
+        )
+        {
+            idxs.clear();
+            for_each_candidate(rect, [&](uint32 id) -> bool {
+                if (!boxes[id].intersect(rect).is_empty())
+                    idxs.push_back(id);
+                return true;
+            });
+            std::sort(idxs.begin(), idxs.end());
+        }
+
+    private:
+
+        template <typename iterator, typename get_rect>
+        void reset_from (
+            iterator begin,
+            iterator end,
+            get_rect rect_of
+        )
+        {
+            // Size the cells to about the average box, so a typical box lands in a few
+            // cells, but don't let the grid get bigger than max_cells_per_side cells on a
+            // side no matter how spread out the boxes are.
+            const long max_cells_per_side = 128;
+            rectangle bounds;
+            double total_size = 0;
+            size_t num = 0;
+            for (auto i = begin; i != end; ++i)
+            {
+                const rectangle& r = rect_of(*i);
+                if (r.is_empty())
+                    continue;
+                bounds += r;
+                total_size += r.width() + r.height();
+                ++num;
+            }
+            long size = num == 0 ? 1 : (long)(total_size/(2*num));
+            const long extent = std::max(bounds.width(), bounds.height());
+            size = std::max(size, (extent+max_cells_per_side-1)/max_cells_per_side);
+            reset(bounds, std::max(size, 1L));
+        }
+
+        void cell_range (
+            const rectangle& rect,
+            long& c0,
+            long& r0,
+            long& c1,
+            long& r1
+        ) const
+        {
+            // Boxes that stick out of the area are clamped to the cells on its border.
+            // Clamping keeps overlapping boxes in overlapping ranges of cells, so this is
+            // still exact.
+            c0 = to_cell(rect.left(), area.left(), num_cols);
+            c1 = to_cell(rect.right(), area.left(), num_cols);
+            r0 = to_cell(rect.top(), area.top(), num_rows);
+            r1 = to_cell(rect.bottom(), area.top(), num_rows);
+        }
+
+        long to_cell (
+            long coord,
+            long origin,
+            long num_cells
+        ) const
+        {
+            if (coord <= origin)
+                return 0;
+            return std::min<long>((coord-origin)/(long)cell_size, num_cells-1);
+        }
+
+        template <typename visitor>
+        void for_each_candidate (
+            const rectangle& rect,
+            visitor visit
+        )
+        {
+            if (rect.is_empty() || boxes.size() == 0)
+                return;
+
+            // A box can be in many cells, so we mark the ones we have already visited
+            // with the current stamp to visit each of them only once.
+            if (++current_stamp == 0)
+            {
+                std::fill(stamps.begin(), stamps.end(), 0);
+                current_stamp = 1;
+            }
+
+            long c0, r0, c1, r1;
+            cell_range(rect, c0, r0, c1, r1);
+            for (long r = r0; r <= r1; ++r)
+            {
+                for (long c = c0; c <= c1; ++c)
+                {
+                    for (auto id : cells[r*num_cols + c])
+                    {
+                        if (stamps[id] == current_stamp)
+                            continue;
+                        stamps[id] = current_stamp;
+                        if (!visit(id))
+                            return;
+                    }
+                }
+            }
+        }
+
+        test_box_overlap overlaps;
+        rectangle area;
+        unsigned long cell_size = 1;
+        unsigned long num_cols = 1;
+        unsigned long num_rows = 1;
+        std::vector<std::vector<uint32>> cells = std::vector<std::vector<uint32>>(1);
+        std::vector<uint32> used_cells;
+        std::vector<rectangle> boxes;
+        std::vector<uint32> stamps;
+        uint32 current_stamp = 0;
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    template <typename T>
+    void non_max_suppression (
+        std::vector<T>& dets,
+        const test_box_overlap& overlaps
+    )
+    {
+        nms_grid grid(overlaps);
+        grid.reset(dets);
+        size_t num_kept = 0;
+        for (size_t i = 0; i < dets.size(); ++i)
+        {
+            if (grid.overlaps_any_box(dets[i].rect))
+                continue;
+            grid.add_box(dets[i].rect);
+            if (num_kept != i)
+                dets[num_kept] = std::move(dets[i]);
+            ++num_kept;
+        }
+        dets.erase(dets.begin()+num_kept, dets.end());
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <typename T>
+    void soft_non_max_suppression (
+        std::vector<T>& dets,
+        const test_box_overlap& overlaps,
+        double sigma = 0.5,
+        double score_threshold = 0,
+        double min_weight = 0.001
+    )
+    {
+        DLIB_CASSERT(sigma > 0);
+        DLIB_CASSERT(0 <= min_weight && min_weight < 1);
+
+        // All the candidates go into the grid so that each kept detection can find the
+        // ones it overlaps.
+        nms_grid grid(overlaps);
+        grid.reset(dets);
+        for (auto& d : dets)
+            grid.add_box(d.rect);
+
+        std::vector<double> margin(dets.size()), weight(dets.size(), 1);
+        std::vector<char> done(dets.size(), 0);
+        std::priority_queue<std::pair<double,size_t>> queue;
+        for (size_t i = 0; i < dets.size(); ++i)
+        {
+            margin[i] = std::max(0.0, dets[i].detection_confidence - score_threshold);
+            queue.push(std::make_pair(margin[i], i));
+        }
+
+        std::vector<T> kept;
+        std::vector<size_t> near;
+        while (!queue.empty())
+        {
+            const auto next = queue.top();
+            queue.pop();
+            const size_t i = next.second;
+            // Skip detections already kept or dropped, as well as stale queue entries
+            // from before a detection's score was lowered.
+            if (done[i] || next.first != margin[i]*weight[i])
+                continue;
+            done[i] = 1;
+            kept.push_back(std::move(dets[i]));
+            kept.back().detection_confidence = score_threshold + next.first;
+
+            const rectangle& rect = kept.back().rect;
+            grid.find_intersecting_boxes(rect, near);
+            for (auto j : near)
+            {
+                if (done[j] || !overlaps(rect, grid[j]))
+                    continue;
+                const double iou = box_intersection_over_union(rect, grid[j]);
+                weight[j] *= std::exp(-iou*iou/sigma);
+                if (weight[j] < min_weight)
+                    done[j] = 1;
+                else
+                    queue.push(std::make_pair(margin[j]*weight[j], j));
+            }
+        }
+        dets.swap(kept);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_NON_MAX_SUPPRESSIoN_Hh_
+
@@ -0,0 +1,220 @@
+// Copyright (C) 2026  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#undef DLIB_NON_MAX_SUPPRESSIoN_ABSTRACT_Hh_
+#ifdef DLIB_NON_MAX_SUPPRESSIoN_ABSTRACT_Hh_
+
+#include "box_overlap_testing_abstract.h"
+#include "../geometry.h"
+#include <vector>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    class nms_grid
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object is a set of boxes bucketed by a uniform grid, so that you can
+                quickly find the boxes in the set that overlap a new box.  It's the engine
+                behind non_max_suppression(), and is useful for writing your own
+                non-max suppression loops when the rule for keeping a box is more
+                complicated than "it doesn't overlap anything kept so far".  E.g.
+                    nms_grid grid(overlaps);
+                    grid.reset(dets);
+                    for (auto& d : dets)
+                    {
+                        if (grid.overlaps_any_box(d.rect))
+                            continue;
+                        if (want_to_keep(d))
+                            grid.add_box(d.rect);
+                    }
+
+                test_box_overlap never reports two boxes as overlapping unless they
+                intersect.  So only boxes sharing a grid cell with the new box are tested,
+                and the results are exactly the same as testing every box.  A box that
+                falls outside the grid's area is still found, just less quickly.
+        !*/
+
+    public:
+
+        nms_grid(
+        );
+        /*!
+            ensures
+                - #get_overlap_tester() == test_box_overlap()
+                - #size() == 0
+        !*/
+
+        explicit nms_grid(
+            const test_box_overlap& overlaps
+        );
+        /*!
+            ensures
+                - #get_overlap_tester() == overlaps
+                - #size() == 0
+        !*/
+
+        const test_box_overlap& get_overlap_tester (
+        ) const;
+        /*!
+            ensures
+                - returns the test overlaps_any_box() uses to decide if two boxes overlap.
+        !*/
+
+        void set_overlap_tester (
+            const test_box_overlap& overlaps
+        );
+        /*!
+            ensures
+                - #get_overlap_tester() == overlaps
+        !*/
+
+        void reset (
+            const rectangle& area,
+            unsigned long cell_size
+        );
+        /*!
+            requires
+                - cell_size > 0
+            ensures
+                - #size() == 0
+                - Lays the grid out over area, using square cells cell_size pixels on a
+                  side.
+        !*/
+
+        template <typename T>
+        void reset (
+            const std::vector<T>& candidates
+        );
+        /*!
+            requires
+                - T is rectangle or an object with a public rectangle member called rect,
+                  e.g. rect_detection or mmod_rect.
+            ensures
+                - #size() == 0
+                - Lays the grid out to suit the given boxes, which are usually all the
+                  boxes that will later be given to add_box() and overlaps_any_box().  The
+                  grid covers their bounding box, with cells about the size of the
+                  average box.
+        !*/
+
+        void clear (
+        );
+        /*!
+            ensures
+                - #size() == 0
+                - The grid layout is kept.
+        !*/
+
+        size_t size (
+        ) const;
+        /*!
+            ensures
+                - returns the number of boxes added with add_box().
+        !*/
+
+        const rectangle& operator[] (
+            size_t idx
+        ) const;
+        /*!
+            requires
+                - idx < size()
+            ensures
+                - returns the idx-th box given to add_box().
+        !*/
+
+        void add_box (
+            const rectangle& rect
+        );
+        /*!
+            ensures
+                - #size() == size() + 1
+                - #(*this)[size()] == rect
+        !*/
+
+        bool overlaps_any_box (
+            const rectangle& rect
+        );
+        /*!
+            ensures
+                - returns true if get_overlap_tester()((*this)[i], rect) is true for any
+                  i < size(), and false otherwise.
+        !*/
+
+        void find_intersecting_boxes (
+            const rectangle& rect,
+            std::vector<size_t>& idxs
+        );
+        /*!
+            ensures
+                - #idxs == the sorted indices of all the boxes in this object that
+                  intersect rect.  That is, the i < size() for which
+                  (*this)[i].intersect(rect) isn't empty.
+        !*/
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    template <typename T>
+    void non_max_suppression (
+        std::vector<T>& dets,
+        const test_box_overlap& overlaps
+    );
+    /*!
+        requires
+            - T is an object with a public rectangle member called rect, e.g.
+              rect_detection or mmod_rect.
+            - dets is sorted so the most confident detections come first.
+        ensures
+            - Performs greedy non-max suppression.  That is, goes over dets in order and
+              removes every detection that overlaps, according to overlaps, a
+              detection that was kept before it.  The detections that are kept stay in
+              the same order.
+            - This gives the same result as comparing each detection against every
+              kept one, but only compares nearby detections, so it stays fast when
+              there are a lot of them.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    template <typename T>
+    void soft_non_max_suppression (
+        std::vector<T>& dets,
+        const test_box_overlap& overlaps,
+        double sigma = 0.5,
+        double score_threshold = 0,
+        double min_weight = 0.001
+    );
+    /*!
+        requires
+            - T is an object with a public rectangle member called rect and a public
+              double member called detection_confidence, e.g. rect_detection or
+              mmod_rect.
+            - sigma > 0
+            - 0 <= min_weight < 1
+            - all the detections have detection_confidence > score_threshold.
+        ensures
+            - Performs Gaussian soft non-max suppression, as described in the paper:
+                Improving Object Detection With One Line of Code by Bodla et al.
+              Rather than removing the detections that overlap a kept detection, it
+              lowers their confidence and lets them compete again.
+            - In detail, it repeatedly keeps the detection with the highest confidence.
+              Every remaining detection D that overlaps it according to overlaps then has
+              the part of its confidence above score_threshold multiplied by
+              exp(-iou*iou/sigma), where iou is the intersection over union of the two
+              boxes.  Once the product of all the factors applied to D falls below
+              min_weight, D is removed.
+            - #dets contains the kept detections, with their lowered confidences, sorted
+              from the most to the least confident.
+            - As sigma goes to 0 this becomes the same as non_max_suppression().
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_NON_MAX_SUPPRESSIoN_ABSTRACT_Hh_
+
+
@@ -806,22 +806,6 @@ namespace dlib
             std::sort(dets.rbegin(), dets.rend(), compare_pair_rect);
         }
 
-        inline bool overlaps_any_box (
-            const test_box_overlap& tester,
-            const std::vector<rect_detection>& rects,
-            const rect_detection& rect
-        ) 
-        {
-            for (unsigned long i = 0; i < rects.size(); ++i)
-            {
-                // Only compare detections from the same detector.  That is, we don't want
-                // the output of one detector to stop on the output of another detector. 
-                if (rects[i].weight_index == rect.weight_index && tester(rects[i].rect, rect.rect))
-                    return true;
-            }
-            return false;
-        }
-
     }
 
 // ----------------------------------------------------------------------------------------
@@ -1305,15 +1289,24 @@ namespace dlib
         }
 
 
-        // Do non-max suppression
+        // Do non-max suppression.  Only detections from the same detector are compared,
+        // so each detector gets its own grid.  That is, we don't want the output of one
+        // detector to stop on the output of another detector.
         if (detectors.size() > 1)
             std::sort(dets_accum.rbegin(), dets_accum.rend());
+        std::vector<nms_grid> grids(detectors.size());
+        for (unsigned long i = 0; i < detectors.size(); ++i)
+        {
+            grids[i].set_overlap_tester(detectors[i].get_overlap_tester());
+            grids[i].reset(dets_accum);
+        }
         for (unsigned long i = 0; i < dets_accum.size(); ++i)
         {
-            const test_box_overlap tester = detectors[dets_accum[i].weight_index].get_overlap_tester();
-            if (impl::overlaps_any_box(tester, dets, dets_accum[i]))
+            nms_grid& grid = grids[dets_accum[i].weight_index];
+            if (grid.overlaps_any_box(dets_accum[i].rect))
                 continue;
 
+            grid.add_box(dets_accum[i].rect);
             dets.push_back(dets_accum[i]);
         }
     }
@@ -105,13 +105,14 @@ namespace dlib
         }
 
         template <
-            typename array_type
+            typename array_type,
+            typename crop_array_type
             >
         void operator() (
             size_t num_crops,
             const array_type& images,
             const std::vector<std::vector<mmod_rect>>& rects,
-            array_type& crops,
+            crop_array_type& crops,
             std::vector<std::vector<mmod_rect>>& crop_rects
         )
         {
@@ -122,13 +123,14 @@ namespace dlib
         }
 
         template <
-            typename array_type
+            typename array_type,
+            typename crop_array_type
             >
         void append (
             size_t num_crops,
             const array_type& images,
             const std::vector<std::vector<mmod_rect>>& rects,
-            array_type& crops,
+            crop_array_type& crops,
             std::vector<std::vector<mmod_rect>>& crop_rects
         )
         {
@@ -200,13 +200,14 @@ namespace dlib
         !*/
 
         template <
-            typename array_type
+            typename array_type,
+            typename crop_array_type
             >
         void append (
             size_t num_crops,
             const array_type& images,
             const std::vector<std::vector<mmod_rect>>& rects,
-            array_type& crops,
+            crop_array_type& crops,
             std::vector<std::vector<mmod_rect>>& crop_rects
         );
         /*!
@@ -218,6 +219,12 @@ namespace dlib
                 - array_type is a type with an interface compatible with dlib::array or
                   std::vector and it must in turn contain image objects that implement the
                   interface defined in dlib/image_processing/generic_image.h 
+                  Only images.size() and images[i] are used, so array_type can also be
+                  something like image_dataset_shard_view that produces its images on
+                  demand.
+                - crop_array_type is a type with an interface compatible with dlib::array
+                  or std::vector and it must in turn contain image objects that implement
+                  the interface defined in dlib/image_processing/generic_image.h 
             ensures
                 - Randomly extracts num_crops chips from images and appends them to the end
                   of crops.  We also copy the object metadata for each extracted crop and
@@ -230,13 +237,14 @@ namespace dlib
         !*/
 
         template <
-            typename array_type
+            typename array_type,
+            typename crop_array_type
             >
         void operator() (
             size_t num_crops,
             const array_type& images,
             const std::vector<std::vector<mmod_rect>>& rects,
-            array_type& crops,
+            crop_array_type& crops,
             std::vector<std::vector<mmod_rect>>& crop_rects
         );
         /*!
@@ -247,6 +255,12 @@ namespace dlib
                 - array_type is a type with an interface compatible with dlib::array or
                   std::vector and it must in turn contain image objects that implement the
                   interface defined in dlib/image_processing/generic_image.h 
+                  Only images.size() and images[i] are used, so array_type can also be
+                  something like image_dataset_shard_view that produces its images on
+                  demand.
+                - crop_array_type is a type with an interface compatible with dlib::array
+                  or std::vector and it must in turn contain image objects that implement
+                  the interface defined in dlib/image_processing/generic_image.h 
             ensures
                 - Randomly extracts num_crops chips from images.  We also copy the object
                   metadata for each extracted crop and store it into #crop_rects.  In
@@ -5,9 +5,13 @@
 #include <dlib/svm_threaded.h>
 #include <dlib/data_io.h>
 #include <dlib/sparse_vector.h>
+#include <dlib/image_io.h>
+#include <dlib/image_transforms.h>
 #include "create_iris_datafile.h"
 #include <vector>
 #include <sstream>
+#include <fstream>
+#include <iterator>
 
 namespace  
 {
@@ -205,6 +209,151 @@ namespace
         }
 
 
+        static bool equal_images(const matrix<rgb_pixel>& a, const matrix<rgb_pixel>& b)
+        {
+            if (a.nr() != b.nr() || a.nc() != b.nc())
+                return false;
+            for (long r = 0; r < a.nr(); ++r)
+            {
+                for (long c = 0; c < a.nc(); ++c)
+                {
+                    if (a(r,c).red != b(r,c).red || a(r,c).green != b(r,c).green || a(r,c).blue != b(r,c).blue)
+                        return false;
+                }
+            }
+            return true;
+        }
+
+        void test_image_dataset_shard()
+        {
+            print_spinner();
+
+            using namespace image_dataset_metadata;
+            dlib::rand rnd;
+            matrix<rgb_pixel> color(30,40);
+            for (auto& p : color)
+                p = rgb_pixel(rnd.get_random_8bit_number(), rnd.get_random_8bit_number(), rnd.get_random_8bit_number());
+            matrix<unsigned char> gray(25,20);
+            for (auto& p : gray)
+                p = rnd.get_random_8bit_number();
+            save_png(color, "shard_color.png");
+            save_png(gray, "shard_gray.png");
+            save_bmp(color, "shard_color.bmp");
+#ifdef DLIB_JPEG_SUPPORT
+            save_jpeg(color, "shard_color.jpg");
+#endif
+
+            dataset data;
+            image img("shard_color.png");
+            img.boxes.push_back(box(rectangle(1,2,10,12)));
+            img.boxes.back().label = "cat";
+            img.boxes.back().parts["eye"] = point(3,4);
+            img.boxes.push_back(box(rectangle(5,5,20,20)));
+            img.boxes.back().ignore = true;
+            data.images.push_back(img);
+            data.images.push_back(image("shard_gray.png"));
+            img = image("shard_color.bmp");
+            img.boxes.push_back(box(rectangle(0,0,8,8)));
+            img.boxes.back().parts["nose"] = point(1,1);
+            data.images.push_back(img);
+#ifdef DLIB_JPEG_SUPPORT
+            data.images.push_back(image("shard_color.jpg"));
+#endif
+            save_image_dataset_metadata(data, "shard_dataset.xml");
+
+            std::vector<matrix<rgb_pixel>> images;
+            std::vector<std::vector<mmod_rect>> boxes;
+            load_image_dataset(images, boxes, "shard_dataset.xml");
+
+            for (auto encoding : {image_shard_encoding::original, image_shard_encoding::raw})
+            {
+                convert_image_dataset_to_shard(image_dataset_file("shard_dataset.xml"), "shard.dat", encoding);
+                image_dataset_shard shard("shard.dat");
+                DLIB_TEST(shard.size() == images.size());
+                DLIB_TEST(shard.get_parts_list() == std::vector<std::string>({"eye", "nose"}));
+                DLIB_TEST(shard.get_all_boxes() == boxes);
+                DLIB_TEST(shard.get_image_filename(1) == "shard_gray.png");
+                for (size_t i = 0; i < shard.size(); ++i)
+                {
+                    matrix<rgb_pixel> temp;
+                    std::vector<mmod_rect> temp_boxes;
+                    shard.get(i, temp, temp_boxes);
+                    DLIB_TEST(equal_images(temp, images[i]));
+                    DLIB_TEST(temp_boxes == boxes[i]);
+                }
+                matrix<unsigned char> gray2;
+                shard.get_image(1, gray2);
+                DLIB_TEST(gray2 == gray);
+
+                std::vector<full_object_detection> dets;
+                shard.get_object_detections(0, dets);
+                DLIB_TEST(dets.size() == 2);
+                DLIB_TEST(dets[0].get_rect() == rectangle(1,2,10,12));
+                DLIB_TEST(dets[0].part(0) == point(3,4));
+                DLIB_TEST(dets[0].part(1) == OBJECT_PART_NOT_PRESENT);
+                shard.get_object_detections(1, dets);
+                DLIB_TEST(dets.size() == 0);
+
+                // The shard can feed random_cropper directly.
+                random_cropper cropper;
+                cropper.set_chip_dims(10,10);
+                std::vector<matrix<rgb_pixel>> crops;
+                std::vector<std::vector<mmod_rect>> crop_boxes;
+                cropper(4, image_dataset_shard_view<matrix<rgb_pixel>>(shard), boxes, crops, crop_boxes);
+                DLIB_TEST(crops.size() == 4 && crop_boxes.size() == 4);
+                DLIB_TEST(crops[0].nr() == 10 && crops[0].nc() == 10);
+            }
+
+            // The options of image_dataset_file are honored.
+            convert_image_dataset_to_shard(image_dataset_file("shard_dataset.xml").skip_empty_images(), "shard.dat");
+            image_dataset_shard shard("shard.dat");
+            DLIB_TEST(shard.size() == 2);
+            DLIB_TEST(shard.get_image_filename(1) == "shard_color.bmp");
+
+            std::ofstream("shard_bad.dat") << "not a shard";
+            bool found_error = false;
+            try { shard.open("shard_bad.dat"); } catch (serialization_error&) { found_error = true; }
+            DLIB_TEST(found_error);
+            // A failed open leaves the shard as it was.
+            DLIB_TEST(shard.size() == 2);
+
+            // A record count so large that the size of the index overflows.
+            std::string contents;
+            {
+                std::ifstream fin("shard.dat", std::ios::binary);
+                contents.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+            }
+            contents.replace(16, 8, std::string(8, '\xff'));
+            std::ofstream("shard_bad.dat", std::ios::binary) << contents;
+            found_error = false;
+            try { shard.open("shard_bad.dat"); } catch (serialization_error&) { found_error = true; }
+            DLIB_TEST(found_error);
+            DLIB_TEST(shard.size() == 2);
+
+            // A raw record claiming to be a -1x-1 image.  nr*nc*channels is 1, which
+            // matches the record's single byte of pixel data.
+            matrix<unsigned char> pixel(1,1);
+            pixel = 7;
+            save_png(pixel, "shard_pixel.png");
+            dataset pixel_data;
+            pixel_data.images.push_back(image("shard_pixel.png"));
+            save_image_dataset_metadata(pixel_data, "shard_pixel.xml");
+            convert_image_dataset_to_shard(image_dataset_file("shard_pixel.xml"), "shard_pixel.dat", image_shard_encoding::raw);
+            {
+                std::ifstream fin("shard_pixel.dat", std::ios::binary);
+                contents.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+            }
+            // The serialized nr, nc, channels and num_bytes, which are all 1.
+            const auto pos = contents.find(std::string(8, '\x01'));
+            DLIB_TEST(pos != std::string::npos);
+            contents.replace(pos, 4, "\x81\x01\x81\x01");
+            std::ofstream("shard_bad.dat", std::ios::binary) << contents;
+            image_dataset_shard pixel_shard("shard_bad.dat");
+            found_error = false;
+            try { pixel_shard.get_image(0, pixel); } catch (serialization_error&) { found_error = true; }
+            DLIB_TEST(found_error);
+        }
+
         void perform_test (
         )
         {
@@ -212,6 +361,7 @@ namespace
             create_iris_datafile();
 
             test_sparse_to_dense();
+            test_image_dataset_shard();
 
             run_test<std::map<unsigned int, double> >();
             run_test<std::map<unsigned int, float> >();
@@ -9,6 +9,8 @@
 #include <vector>
 #include <random>
 #include <numeric>
+#include <thread>
+#include <future>
 #include "../dnn.h"
 
 #include "tester.h"
@@ -1450,6 +1452,205 @@ namespace
 
 #endif // DLIB_USE_CUDA
 
+// ----------------------------------------------------------------------------------------
+
+    void reference_conv (
+        resizable_tensor& output,
+        const tensor& data,
+        const tensor& filters,
+        int stride_y,
+        int stride_x,
+        int padding_y,
+        int padding_x,
+        int dilation_y,
+        int dilation_x
+    )
+    {
+        output.set_size(data.num_samples(),
+                        filters.num_samples(),
+                        1+(data.nr()+2*padding_y-(dilation_y*(filters.nr()-1)+1))/stride_y,
+                        1+(data.nc()+2*padding_x-(dilation_x*(filters.nc()-1)+1))/stride_x);
+        // For grouped convolutions each filter only sees the channels in its group.
+        const long filters_per_group = filters.num_samples()/(data.k()/filters.k());
+        for (long n = 0; n < output.num_samples(); ++n)
+        {
+            for (long o = 0; o < output.k(); ++o)
+            {
+                matrix<float> out = zeros_matrix<float>(output.nr(), output.nc());
+                for (long kk = 0; kk < filters.k(); ++kk)
+                {
+                    const long k = (o/filters_per_group)*filters.k() + kk;
+                    const auto img = image_plane(data,n,k);
+                    const auto filt = image_plane(filters,o,kk);
+                    for (long r = 0; r < output.nr(); ++r)
+                    {
+                        for (long c = 0; c < output.nc(); ++c)
+                        {
+                            float sum = 0;
+                            for (long y = 0; y < filters.nr(); ++y)
+                            {
+                                for (long x = 0; x < filters.nc(); ++x)
+                                {
+                                    const long yy = r*stride_y + y*dilation_y - padding_y;
+                                    const long xx = c*stride_x + x*dilation_x - padding_x;
+                                    if (0 <= yy && yy < data.nr() && 0 <= xx && xx < data.nc())
+                                        sum += filt(y,x)*img(yy,xx);
+                                }
+                            }
+                            out(r,c) += sum;
+                        }
+                    }
+                }
+                set_ptrm(output.host()+((n*output.k()+o)*output.nr())*output.nc(), output.nr(), output.nc()) = out;
+            }
+        }
+    }
+
+    void reference_conv_gradients (
+        resizable_tensor& data_gradient,
+        resizable_tensor& filters_gradient,
+        const tensor& gradient_input,
+        const tensor& data,
+        const tensor& filters,
+        int stride_y,
+        int stride_x,
+        int padding_y,
+        int padding_x,
+        int dilation_y,
+        int dilation_x
+    )
+    {
+        data_gradient.copy_size(data);
+        filters_gradient.copy_size(filters);
+        data_gradient = 0;
+        filters_gradient = 0;
+        const float* gi = gradient_input.host();
+        const float* d = data.host();
+        const float* f = filters.host();
+        float* dg = data_gradient.host();
+        float* fg = filters_gradient.host();
+        const long filters_per_group = filters.num_samples()/(data.k()/filters.k());
+        for (long n = 0; n < gradient_input.num_samples(); ++n)
+        {
+            for (long o = 0; o < gradient_input.k(); ++o)
+            {
+                for (long r = 0; r < gradient_input.nr(); ++r)
+                {
+                    for (long c = 0; c < gradient_input.nc(); ++c)
+                    {
+                        const float g = gi[((n*gradient_input.k()+o)*gradient_input.nr()+r)*gradient_input.nc()+c];
+                        for (long kk = 0; kk < filters.k(); ++kk)
+                        {
+                            const long k = (o/filters_per_group)*filters.k() + kk;
+                            for (long y = 0; y < filters.nr(); ++y)
+                            {
+                                for (long x = 0; x < filters.nc(); ++x)
+                                {
+                                    const long yy = r*stride_y + y*dilation_y - padding_y;
+                                    const long xx = c*stride_x + x*dilation_x - padding_x;
+                                    if (0 <= yy && yy < data.nr() && 0 <= xx && xx < data.nc())
+                                    {
+                                        const long didx = ((n*data.k()+k)*data.nr()+yy)*data.nc()+xx;
+                                        const long fidx = ((o*filters.k()+kk)*filters.nr()+y)*filters.nc()+x;
+                                        dg[didx] += g*f[fidx];
+                                        fg[fidx] += g*d[didx];
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void test_conv_cpu()
+    {
+        cpu::tensor_conv conv;
+
+        dlib::rand prnd;
+        for (int iter = 0; iter < 100; ++iter)
+        {
+            print_spinner();
+
+            // Every third iteration is a grouped convolution, which is depthwise when
+            // each group has a single channel.
+            const long groups = (iter%3 == 2) ? prnd.get_random_32bit_number()%4+2 : 1;
+            resizable_tensor data(prnd.get_random_32bit_number()%3+1,
+                (prnd.get_random_32bit_number()%5+1)*groups,
+                prnd.get_random_32bit_number()%30+1,
+                prnd.get_random_32bit_number()%40+1
+            );
+            resizable_tensor filters(
+                (prnd.get_random_32bit_number()%7+1)*groups,
+                data.k()/groups,
+                prnd.get_random_32bit_number()%7+1,
+                prnd.get_random_32bit_number()%7+1
+            );
+
+            tt::tensor_rand rnd;
+            rnd.fill_uniform(data);
+            rnd.fill_uniform(filters);
+
+            // Use stride_x==1 most of the time since that's the case the direct
+            // convolution code handles.
+            const int stride_y = prnd.get_random_32bit_number()%3+1;
+            const int stride_x = (iter%4 == 0) ? prnd.get_random_32bit_number()%3+1 : 1;
+            const int dilation_y = (iter%5 == 1) ? prnd.get_random_32bit_number()%3+1 : 1;
+            const int dilation_x = (iter%5 == 1) ? prnd.get_random_32bit_number()%3+1 : 1;
+            const long span_nr = dilation_y*(filters.nr()-1)+1;
+            const long span_nc = dilation_x*(filters.nc()-1)+1;
+            int padding_y = prnd.get_random_32bit_number()%(span_nr/2+1);
+            int padding_x = prnd.get_random_32bit_number()%(span_nc/2+1);
+            if (!(span_nr <= data.nr() + 2*padding_y))
+                padding_y = (span_nr-data.nr()+1)/2;
+            if (!(span_nc <= data.nc() + 2*padding_x))
+                padding_x = (span_nc-data.nc()+1)/2;
+
+            resizable_tensor output, expected;
+            reference_conv(expected, data, filters, stride_y, stride_x, padding_y, padding_x, dilation_y, dilation_x);
+
+            conv.setup(data,filters,stride_y,stride_x,padding_y,padding_x,dilation_y,dilation_x);
+            conv(false, output, data, filters);
+            const float output_scale = max(abs(mat(expected)))+1;
+            DLIB_TEST_MSG(max(abs(mat(output)-mat(expected)))/output_scale < 1e-5, max(abs(mat(output)-mat(expected)))
+                 <<"\n\t filters: "<< filters.nr() << "x" << filters.nc()
+                 <<"\n\t groups: "<< groups
+                 <<"\n\t dilation: "<< dilation_y << "x" << dilation_x
+                 <<"\n\t padding_y: "<< padding_y
+                 <<"\n\t padding_x: "<< padding_x
+                 );
+
+            conv(true, output, data, filters);
+            DLIB_TEST_MSG(max(abs(mat(output)-2*mat(expected)))/output_scale < 1e-5, max(abs(mat(output)-2*mat(expected))));
+
+            resizable_tensor gi, data_gradient, filters_gradient, expected_data_gradient, expected_filters_gradient;
+            gi.copy_size(output);
+            rnd.fill_uniform(gi);
+            reference_conv_gradients(expected_data_gradient, expected_filters_gradient, gi, data, filters,
+                stride_y, stride_x, padding_y, padding_x, dilation_y, dilation_x);
+
+            data_gradient.copy_size(data);
+            data_gradient = 1;
+            conv.get_gradient_for_data(false, gi, filters, data_gradient);
+            const float data_scale = max(abs(mat(expected_data_gradient)))+1;
+            DLIB_TEST(max(abs(mat(data_gradient)-mat(expected_data_gradient)))/data_scale < 1e-5);
+            conv.get_gradient_for_data(true, gi, filters, data_gradient);
+            DLIB_TEST(max(abs(mat(data_gradient)-2*mat(expected_data_gradient)))/data_scale < 1e-5);
+
+            filters_gradient.copy_size(filters);
+            filters_gradient = 1;
+            conv.get_gradient_for_filters(false, gi, data, filters_gradient);
+            // The filter gradient sums over the whole batch so compare it relative to its
+            // magnitude.
+            const float filters_scale = max(abs(mat(expected_filters_gradient)))+1;
+            DLIB_TEST_MSG(max(abs(mat(filters_gradient)-mat(expected_filters_gradient)))/filters_scale < 1e-5,
+                max(abs(mat(filters_gradient)-mat(expected_filters_gradient)))/filters_scale);
+            conv.get_gradient_for_filters(true, gi, data, filters_gradient);
+            DLIB_TEST(max(abs(mat(filters_gradient)-2*mat(expected_filters_gradient)))/filters_scale < 1e-5);
+        }
+    }
+
 // ----------------------------------------------------------------------------------------
 
     void test_max_pool(
@@ -1733,6 +1934,18 @@ namespace
             auto res = test_layer(l);
             DLIB_TEST_MSG(res, res);
         }
+        {
+            print_spinner();
+            con_<3,3,3,1,1,2,2,1,2,2> l;
+            auto res = test_layer(l);
+            DLIB_TEST_MSG(res, res);
+        }
+        {
+            print_spinner();
+            con_<2,3,2,2,1,2,1,1,2,2> l;
+            auto res = test_layer(l);
+            DLIB_TEST_MSG(res, res);
+        }
         {
             print_spinner();
             fc_<1,FC_HAS_BIAS> l;
@@ -3009,6 +3222,91 @@ namespace
         dlib::deserialize(net2, in);
     }
 
+// ----------------------------------------------------------------------------------------
+
+    void test_loss_metric()
+    {
+        print_spinner();
+
+        // Compares loss_metric_ against a plain implementation of its loss function
+        // that looks at all the pairs one at a time.
+        using net_type = loss_metric<fc_no_bias<16,input<matrix<float,0,1>>>>;
+        net_type net;
+        dlib::rand rnd;
+        const long num = 301;
+        std::vector<matrix<float,0,1>> x(num);
+        std::vector<unsigned long> y(num);
+        for (long i = 0; i < num; ++i)
+        {
+            x[i] = matrix_cast<float>(gaussian_randm(8,1,i));
+            y[i] = rnd.get_random_32bit_number()%12;
+        }
+
+        resizable_tensor input;
+        net.to_tensor(x.begin(), x.end(), input);
+        net.subnet().forward(input);
+        const matrix<float> emb = mat(net.subnet().get_output());
+
+        double mean_dist = 0;
+        for (long r = 0; r < num; ++r)
+            for (long c = 0; c < num; ++c)
+                mean_dist += length(rowm(emb,r)-rowm(emb,c))/(num*num);
+        net.loss_details() = loss_metric_(0.1*mean_dist, mean_dist);
+        const float margin = net.loss_details().get_margin();
+        const float dist_thresh = net.loss_details().get_distance_threshold();
+
+        const double loss = net.compute_loss(input, y.begin());
+        const matrix<float> grad = mat(net.subnet().get_gradient_input());
+
+        double num_pos = 0, num_neg = 0;
+        std::vector<double> neg_dists;
+        for (long r = 0; r < num; ++r)
+        {
+            for (long c = r+1; c < num; ++c)
+            {
+                if (y[r] == y[c])
+                {
+                    ++num_pos;
+                }
+                else
+                {
+                    ++num_neg;
+                    neg_dists.push_back(length(rowm(emb,r)-rowm(emb,c)));
+                }
+            }
+        }
+        std::sort(neg_dists.begin(), neg_dists.end());
+        const double neg_thresh = neg_dists[std::min(num_pos,num_neg)-1];
+        const double scale = 0.5/num_pos;
+
+        double true_loss = 0;
+        matrix<float> true_grad = zeros_matrix<float>(num, emb.nc());
+        for (long r = 0; r < num; ++r)
+        {
+            for (long c = 0; c < num; ++c)
+            {
+                if (r == c)
+                    continue;
+                const matrix<float,1,0> diff = rowm(emb,r)-rowm(emb,c);
+                const double dist = length(diff);
+                if (y[r] == y[c] && dist >= dist_thresh-margin)
+                {
+                    true_loss += scale*(dist - (dist_thresh-margin));
+                    set_rowm(true_grad,r) += scale*diff/dist;
+                }
+                else if (y[r] != y[c] && dist <= dist_thresh+margin && dist <= neg_thresh)
+                {
+                    true_loss += scale*((dist_thresh+margin) - dist);
+                    set_rowm(true_grad,r) -= scale*diff/std::max(dist,0.001);
+                }
+            }
+        }
+
+        DLIB_TEST_MSG(true_loss > 0, true_loss);
+        DLIB_TEST_MSG(std::abs(loss-true_loss) < 1e-4*true_loss, loss << " " << true_loss);
+        DLIB_TEST_MSG(max(abs(grad-true_grad)) < 1e-4*max(abs(true_grad)), max(abs(grad-true_grad)));
+    }
+
 // ----------------------------------------------------------------------------------------
 
     void test_loss_dot()
@@ -3049,6 +3347,2000 @@ namespace
         }
     }
 
+// ----------------------------------------------------------------------------------------
+
+    template <template <typename> class BN, typename SUBNET>
+    using fuse_test_block = relu<BN<con<6,3,3,1,1,SUBNET>>>;
+
+    template <typename T>
+    std::string serialized_version (
+        const T& item
+    )
+    {
+        std::ostringstream sout;
+        serialize(item, sout);
+        std::istringstream sin(sout.str());
+        std::string version;
+        deserialize(version, sin);
+        return version;
+    }
+
+    void test_fuse_layers()
+    {
+        print_spinner();
+
+        using net_type = loss_multiclass_log<fc<5,relu<bn_fc<fc<8,
+            fuse_test_block<bn_con,relu<bn_con<con<4,5,5,2,2,input<matrix<float>>>>>>>>>>>;
+        using anet_type = loss_multiclass_log<fc<5,relu<affine<fc<8,
+            fuse_test_block<affine,relu<affine<con<4,5,5,2,2,input<matrix<float>>>>>>>>>>>;
+
+        std::vector<matrix<float>> images;
+        for (int i = 0; i < 4; ++i)
+            images.push_back(matrix_cast<float>(gaussian_randm(16,16,i)));
+
+        // Run a batch through the bn_ version so that every layer gets setup and the
+        // running statistics of the bn_ layers get filled in.  Then randomize all the
+        // parameters so the affine_ layers we make from the bn_ layers aren't trivial.
+        net_type net;
+        resizable_tensor x;
+        net.to_tensor(images.begin(), images.end(), x);
+        net.subnet().forward(x);
+        dlib::rand rnd;
+        visit_layer_parameters(net, [&](size_t, tensor& t)
+        {
+            for (auto& v : t)
+                v = rnd.get_random_gaussian()*0.5 + 1;
+        });
+
+        anet_type anet = net;
+        resizable_tensor expected = anet.subnet().forward(x);
+
+        // Layers that haven't been fused keep their old serialization versions.
+        DLIB_TEST(serialized_version(layer<3>(anet).layer_details()) == "affine_");
+        DLIB_TEST(serialized_version(relu_()) == "relu_");
+
+        fuse_layers(anet);
+        resizable_tensor out = anet.subnet().forward(x);
+        const float scale = max(abs(mat(expected)));
+        DLIB_TEST_MSG(max(abs(mat(out)-mat(expected)))/scale < 1e-5, max(abs(mat(out)-mat(expected)))/scale);
+
+        // The folded affine_ layers are disabled and hold no parameters.
+        DLIB_TEST(layer<3>(anet).layer_details().is_disabled());
+        DLIB_TEST(layer<3>(anet).layer_details().get_gamma().get().size() == 0);
+        DLIB_TEST(layer<3>(anet).layer_details().get_beta().get().size() == 0);
+        DLIB_TEST(serialized_version(layer<3>(anet).layer_details()) == "affine_2");
+        relu_ disabled_relu;
+        disabled_relu.disable();
+        DLIB_TEST(serialized_version(disabled_relu) == "relu_2");
+
+        // Every affine_ and the relu_ layers on top of con_ layers should be gone.
+        std::ostringstream sout;
+        net_to_xml(anet, sout);
+        const std::string xml = sout.str();
+        DLIB_TEST(xml.find("<affine_con>") == std::string::npos);
+        DLIB_TEST(xml.find("<affine_fc>") == std::string::npos);
+        DLIB_TEST(xml.find("use_relu='1'") != std::string::npos);
+
+        // The fused network should survive serialization.
+        std::ostringstream out_stream;
+        serialize(anet, out_stream);
+        std::istringstream in_stream(out_stream.str());
+        anet_type anet2;
+        deserialize(anet2, in_stream);
+        resizable_tensor out2 = anet2.subnet().forward(x);
+        DLIB_TEST(max(abs(mat(out2)-mat(out))) == 0);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_quantize_layers()
+    {
+        print_spinner();
+
+        using net_type = loss_multiclass_log<fc<5,relu<fc<16,
+            relu<con<8,3,3,1,1,relu<con<6,5,5,2,2,input<matrix<float>>>>>>>>>>;
+
+        std::vector<matrix<float>> images;
+        for (int i = 0; i < 20; ++i)
+            images.push_back(matrix_cast<float>(gaussian_randm(20,20,i)));
+
+        net_type net;
+        resizable_tensor x;
+        net.to_tensor(images.begin(), images.end(), x);
+        net.subnet().forward(x);
+
+        net_type qnet = net;
+        quantize_layers(qnet, images.begin(), images.begin()+10, 4);
+        DLIB_TEST(layer<1>(qnet).layer_details().is_quantized());
+        DLIB_TEST(layer<3>(qnet).layer_details().is_quantized());
+        DLIB_TEST(layer<5>(qnet).layer_details().is_quantized());
+        DLIB_TEST(layer<7>(qnet).layer_details().is_quantized());
+        DLIB_TEST(layer<7>(qnet).layer_details().get_input_scale() > 0);
+
+        // Check the drift on samples that weren't part of the calibration set.
+        const matrix<double,1,3> drift = test_output_drift(net, qnet, images.begin()+10, images.end());
+        DLIB_TEST_MSG(drift(2) < 0.1, drift);
+        DLIB_TEST(drift(1) >= drift(0));
+        const matrix<double,1,3> no_drift = test_output_drift(net, net, images.begin(), images.end());
+        DLIB_TEST(max(abs(no_drift)) == 0);
+
+        // The quantized network stores its weights in 8 bits, so it should be much
+        // smaller on disk, and it should come back from disk unchanged.
+        std::ostringstream sout, qsout;
+        serialize(net, sout);
+        serialize(qnet, qsout);
+        DLIB_TEST_MSG(qsout.str().size() < sout.str().size()/2, qsout.str().size() << " " << sout.str().size());
+
+        std::istringstream sin(qsout.str());
+        net_type qnet2;
+        deserialize(qnet2, sin);
+        DLIB_TEST(layer<1>(qnet2).layer_details().is_quantized());
+        DLIB_TEST(max(abs(test_output_drift(qnet, qnet2, images.begin(), images.end()))) == 0);
+
+        // Networks without a loss layer can be quantized too.
+        using plain_net_type = fc<5,relu<con<6,5,5,2,2,input<matrix<float>>>>>;
+        plain_net_type pnet;
+        pnet.to_tensor(images.begin(), images.end(), x);
+        pnet.forward(x);
+        plain_net_type qpnet = pnet;
+        quantize_layers(qpnet, images.begin(), images.begin()+10);
+        DLIB_TEST(layer<0>(qpnet).layer_details().is_quantized());
+        DLIB_TEST(layer<2>(qpnet).layer_details().is_quantized());
+        const matrix<double,1,3> pdrift = test_output_drift(pnet, qpnet, images.begin()+10, images.end());
+        DLIB_TEST_MSG(pdrift(2) < 0.1, pdrift);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    resizable_tensor dequantize_rows (
+        const std::vector<int8_t>& q,
+        const std::vector<float>& scales,
+        const tensor& shape
+    )
+    {
+        resizable_tensor out;
+        out.copy_size(shape);
+        const size_t row_size = out.size()/scales.size();
+        for (size_t i = 0; i < out.size(); ++i)
+            out.host()[i] = q[i]*scales[i/row_size];
+        return out;
+    }
+
+    resizable_tensor quantize_dequantize (
+        const tensor& data,
+        float scale
+    )
+    {
+        // The same rounding and clipping the int8 kernels apply to their input.
+        resizable_tensor out;
+        out.copy_size(data);
+        const float inv_scale = 1/scale;
+        for (size_t i = 0; i < data.size(); ++i)
+        {
+            const float v = std::min(127.0f, std::max(-127.0f, data.host()[i]*inv_scale));
+            out.host()[i] = static_cast<int>(v >= 0 ? v+0.5f : v-0.5f)*scale;
+        }
+        return out;
+    }
+
+    void test_quantized_kernels()
+    {
+        print_spinner();
+        dlib::rand rnd;
+        auto randomize = [&](tensor& t) { for (auto& v : t) v = rnd.get_random_gaussian(); };
+
+        struct conv_case { long k, nr, nc, nf, fnr, fnc; int sy, sx, py, px, dy, dx; };
+        // Odd filter sizes, strides, padding and dilation, with filter sizes and output
+        // column counts that aren't multiples of the SIMD width.
+        const conv_case cases[] = {
+            {3, 9, 11, 5, 3, 3, 1, 1, 1, 1, 1, 1},
+            {2, 10, 13, 7, 5, 3, 2, 2, 2, 1, 1, 1},
+            {3, 11, 9, 6, 3, 3, 1, 2, 2, 2, 2, 2},
+            {5, 7, 7, 3, 1, 1, 2, 3, 0, 0, 1, 1},
+            {1, 12, 15, 9, 7, 5, 3, 1, 3, 2, 1, 2}
+        };
+        for (const auto& c : cases)
+        {
+            resizable_tensor data(3, c.k, c.nr, c.nc), filters(c.nf, c.k, c.fnr, c.fnc);
+            randomize(data);
+            randomize(filters);
+            std::vector<int8_t> qfilters;
+            std::vector<float> filter_scales;
+            tt::quantize_rows(qfilters, filter_scales, filters);
+            // A scale that clips some of the inputs.
+            const float data_scale = 2.0f/127;
+
+            resizable_tensor output;
+            tt::quantized_conv(output, data, data_scale, qfilters, filter_scales, c.nf, c.fnr, c.fnc,
+                c.sy, c.sx, c.py, c.px, c.dy, c.dx);
+
+            const resizable_tensor dq_data = quantize_dequantize(data, data_scale);
+            const resizable_tensor dq_filters = dequantize_rows(qfilters, filter_scales, filters);
+            resizable_tensor expected;
+            tt::tensor_conv conv;
+            conv.setup(dq_data, dq_filters, c.sy, c.sx, c.py, c.px, c.dy, c.dx);
+            conv(false, expected, dq_data, dq_filters);
+
+            DLIB_TEST(have_same_dimensions(output, expected));
+            const float scale = max(abs(mat(expected)));
+            DLIB_TEST_MSG(max(abs(mat(output)-mat(expected)))/scale < 1e-5,
+                max(abs(mat(output)-mat(expected)))/scale << " filters: " << c.fnr << "x" << c.fnc);
+        }
+
+        // 5 samples, 19 outputs and 37 inputs don't line up with the 4x2 tiles, the
+        // blocks of 16 outputs, or the SIMD width.
+        resizable_tensor data(5, 37), weights(19, 37);
+        randomize(data);
+        randomize(weights);
+        std::vector<int8_t> qweights;
+        std::vector<float> weight_scales;
+        tt::quantize_rows(qweights, weight_scales, weights);
+        const float data_scale = 2.0f/127;
+        resizable_tensor output;
+        tt::quantized_fc(output, data, data_scale, qweights, weight_scales, 19);
+        const matrix<float> expected = mat(quantize_dequantize(data, data_scale))*
+            trans(mat(dequantize_rows(qweights, weight_scales, weights)));
+        DLIB_TEST(output.num_samples() == 5 && output.k() == 19);
+        DLIB_TEST_MSG(max(abs(mat(output)-expected))/max(abs(expected)) < 1e-5,
+            max(abs(mat(output)-expected))/max(abs(expected)));
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <typename SUBNET>
+    using inference_test_block = relu<add_prev1<con<4,3,3,1,1,relu<con<4,3,3,1,1,tag1<SUBNET>>>>>>;
+
+    void test_inference_mode()
+    {
+        print_spinner();
+
+        using net_type = loss_multiclass_log<fc<3,inference_test_block<
+            repeat<2,inference_test_block,relu<con<4,3,3,1,1,input<matrix<float>>>>>>>>;
+
+        std::vector<matrix<float>> images;
+        for (int i = 0; i < 3; ++i)
+            images.push_back(matrix_cast<float>(gaussian_randm(12,12,i)));
+
+        net_type net;
+        resizable_tensor x;
+        net.to_tensor(images.begin(), images.end(), x);
+        const resizable_tensor expected = net.subnet().forward(x);
+
+        net_type inet = net;
+        enable_inference_mode(inet);
+        for (int iter = 0; iter < 3; ++iter)
+        {
+            // Later passes run entirely out of the memory pool, and should give exactly
+            // the same answer.
+            resizable_tensor out = inet.subnet().forward(x);
+            DLIB_TEST(max(abs(mat(out)-mat(expected))) == 0);
+        }
+
+        // The outputs nothing else needs are given back to the pool, but tagged outputs
+        // and the output of the top layer are kept.
+        DLIB_TEST(layer<2>(inet).get_output().size() == 0);
+        DLIB_TEST(layer<5>(inet).get_output().size() == 0);
+        DLIB_TEST(layer<7>(inet).get_output().size() != 0);
+        DLIB_TEST(layer<1>(inet).get_output().size() != 0);
+        DLIB_TEST(layer<2>(net).get_output().size() != 0);
+
+        // Changing the batch size still works.
+        net.to_tensor(images.begin(), images.begin()+1, x);
+        resizable_tensor expected1 = net.subnet().forward(x);
+        DLIB_TEST(max(abs(mat(inet.subnet().forward(x))-mat(expected1))) == 0);
+
+        disable_inference_mode(inet);
+        DLIB_TEST(max(abs(mat(inet.subnet().forward(x))-mat(expected1))) == 0);
+        DLIB_TEST(layer<2>(inet).get_output().size() != 0);
+
+        // Once the second tag1 has been computed nothing can reach the first one, so its
+        // output is released too.
+        using net_type2 = loss_multiclass_log<fc<3,inference_test_block<inference_test_block<
+            relu<con<4,3,3,1,1,input<matrix<float>>>>>>>>;
+        net_type2 net2;
+        net2.to_tensor(images.begin(), images.end(), x);
+        const resizable_tensor expected2 = net2.subnet().forward(x);
+        enable_inference_mode(net2);
+        DLIB_TEST(max(abs(mat(net2.subnet().forward(x))-mat(expected2))) == 0);
+        DLIB_TEST(layer<7>(net2).get_output().size() != 0);
+        DLIB_TEST(layer<13>(net2).get_output().size() == 0);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <typename SUBNET>
+    using checkpoint_test_block = relu<add_prev1<bn_con<con<4,3,3,1,1,relu<bn_con<con<4,3,3,1,1,tag1<SUBNET>>>>>>>>;
+    template <typename SUBNET>
+    using checkpointed_test_block = checkpoint<checkpoint_test_block,SUBNET>;
+
+    void test_checkpoint()
+    {
+        print_spinner();
+
+        using plain_net_type = loss_multiclass_log<fc<3,relu<checkpoint_test_block<checkpoint_test_block<
+            relu<con<4,3,3,1,1,input<matrix<float>>>>>>>>>;
+        using net_type = loss_multiclass_log<fc<3,relu<checkpointed_test_block<checkpointed_test_block<
+            relu<con<4,3,3,1,1,input<matrix<float>>>>>>>>>;
+        DLIB_TEST(net_type::num_layers == plain_net_type::num_layers+2);
+        DLIB_TEST(net_type::num_computational_layers == plain_net_type::num_computational_layers);
+
+        std::vector<matrix<float>> images;
+        std::vector<unsigned long> labels;
+        for (int i = 0; i < 6; ++i)
+        {
+            images.push_back(matrix_cast<float>(gaussian_randm(8,8,i)));
+            labels.push_back(i%3);
+        }
+
+        net_type net;
+        plain_net_type plain;
+        resizable_tensor x;
+        net.to_tensor(images.begin(), images.end(), x);
+        plain.to_tensor(images.begin(), images.end(), x);
+        net.subnet().forward(x);
+        plain.subnet().forward(x);
+
+        // Give both networks the same parameters.
+        std::vector<tensor*> params;
+        visit_layer_parameters(net, [&](size_t, tensor& t) { params.push_back(&t); });
+        DLIB_TEST(params.size() == plain_net_type::num_computational_layers);
+        visit_layer_parameters(plain, [&](size_t i, tensor& t) { memcpy(t, *params[i]); });
+
+        const resizable_tensor out = net.subnet().forward(x);
+        DLIB_TEST(max(abs(mat(out)-mat(plain.subnet().forward(x)))) < 1e-6);
+
+        // layer<12> is the lower checkpoint and layer<15> a bn_con inside its block.  Only
+        // the checkpoint keeps its output.
+        DLIB_TEST(max(abs(mat(layer<12>(net).get_output())-mat(layer<11>(plain).get_output()))) < 1e-6);
+        DLIB_TEST(layer<15>(net).get_output().size() == 0);
+        DLIB_TEST(layer<13>(plain).get_output().size() != 0);
+        DLIB_TEST(layer<12>(net).get_activation_bytes_released() > 0);
+
+        // Backprop gives the same gradients.
+        const double loss = net.compute_parameter_gradients(x, labels.begin());
+        const double plain_loss = plain.compute_parameter_gradients(x, labels.begin());
+        DLIB_TEST(std::abs(loss-plain_loss) < 1e-6);
+        std::vector<matrix<float>> grads;
+        visit_layer_parameter_gradients(net, [&](size_t, tensor& t) { grads.push_back(mat(t)); });
+        float grad_diff = 0;
+        visit_layer_parameter_gradients(plain, [&](size_t i, tensor& t)
+        {
+            DLIB_TEST(grads[i].size() == (long)t.size());
+            if (t.size() != 0)
+                grad_diff = std::max(grad_diff, max(abs(mat(t)-grads[i])));
+        });
+        DLIB_TEST_MSG(grad_diff < 1e-5, grad_diff);
+        DLIB_TEST(layer<15>(net).get_output().size() == 0);
+        DLIB_TEST(get_checkpointed_activation_bytes(net) > 0);
+
+        // And so training them does the same thing.
+        dnn_trainer<net_type> trainer(net, sgd(0.0005, 0.9));
+        dnn_trainer<plain_net_type> plain_trainer(plain, sgd(0.0005, 0.9));
+        for (int iter = 0; iter < 5; ++iter)
+        {
+            trainer.train_one_step(images, labels);
+            plain_trainer.train_one_step(images, labels);
+        }
+        trainer.get_net();
+        plain_trainer.get_net();
+        std::vector<matrix<float>> trained;
+        visit_layer_parameters(net, [&](size_t, tensor& t) { trained.push_back(mat(t)); });
+        float param_diff = 0;
+        visit_layer_parameters(plain, [&](size_t i, tensor& t)
+        {
+            if (t.size() != 0)
+                param_diff = std::max(param_diff, max(abs(mat(t)-trained[i])));
+        });
+        DLIB_TEST_MSG(param_diff < 1e-5, param_diff);
+        std::ostringstream sout;
+        sout << trainer;
+        DLIB_TEST(sout.str().find("memory saved by checkpoints") != std::string::npos);
+        sout.str("");
+        net_to_xml(net, sout);
+        DLIB_TEST(sout.str().find("type='checkpoint'") != std::string::npos);
+
+        sout.str("");
+        serialize(net, sout);
+        std::istringstream sin(sout.str());
+        net_type net2;
+        deserialize(net2, sin);
+        DLIB_TEST(max(abs(mat(net2.subnet().forward(x))-mat(net.subnet().forward(x)))) < 1e-6);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <typename SUBNET>
+    using recompute_bn_block = relu<bn_con<con<4,3,3,1,1,SUBNET>>>;
+    template <typename SUBNET>
+    using recompute_dropout_block = dropout<fc<8,SUBNET>>;
+    template <typename SUBNET>
+    using checkpointed_bn_block = checkpoint<recompute_bn_block,SUBNET>;
+    template <typename SUBNET>
+    using checkpointed_dropout_block = checkpoint<recompute_dropout_block,SUBNET>;
+
+    void test_checkpoint_recompute()
+    {
+        print_spinner();
+
+        using plain_net_type = loss_multiclass_log<fc<3,recompute_dropout_block<recompute_bn_block<
+            relu<con<4,3,3,1,1,input<matrix<float>>>>>>>>;
+        using net_type = loss_multiclass_log<fc<3,checkpointed_dropout_block<checkpointed_bn_block<
+            relu<con<4,3,3,1,1,input<matrix<float>>>>>>>>;
+
+        std::vector<matrix<float>> images;
+        std::vector<unsigned long> labels;
+        for (int i = 0; i < 12; ++i)
+        {
+            // Two batches with quite different statistics.
+            images.push_back(matrix_cast<float>(gaussian_randm(8,8,i)*(i < 6 ? 1 : 3) + (i < 6 ? 0 : 1)));
+            labels.push_back(i%3);
+        }
+
+        // Seed std::rand() the same way for both networks so that their dropout layers
+        // draw the same masks.
+        std::srand(1234);
+        net_type net;
+        std::srand(1234);
+        plain_net_type plain;
+
+        resizable_tensor xa, xb, x1;
+        net.to_tensor(images.begin(), images.begin()+6, xa);
+        net.to_tensor(images.begin()+6, images.end(), xb);
+        net.to_tensor(images.begin(), images.begin()+1, x1);
+        plain.to_tensor(images.begin(), images.begin()+1, x1);
+        net.subnet().forward(xa);
+        plain.subnet().forward(xa);
+        std::vector<tensor*> params;
+        visit_layer_parameters(net, [&](size_t, tensor& t) { params.push_back(&t); });
+        visit_layer_parameters(plain, [&](size_t i, tensor& t) { memcpy(t, *params[i]); });
+        // The running statistics too, since they were computed with different filters.
+        layer<5>(plain).layer_details() = layer<7>(net).layer_details();
+
+        // With a window of 1 the running statistics depend on how many times each batch
+        // was counted, so updating them again during the recomputation would show.
+        layer<7>(net).layer_details().set_running_stats_window_size(1);
+        layer<5>(plain).layer_details().set_running_stats_window_size(1);
+
+        net.compute_parameter_gradients(xa, labels.begin());
+        plain.compute_parameter_gradients(xa, labels.begin());
+        const double loss = net.compute_parameter_gradients(xb, labels.begin()+6);
+        const double plain_loss = plain.compute_parameter_gradients(xb, labels.begin()+6);
+        DLIB_TEST(std::abs(loss-plain_loss) < 1e-6);
+
+        // The recomputation reused the dropout mask from forward(), so the gradients
+        // match the plain network's.
+        std::vector<matrix<float>> grads;
+        visit_layer_parameter_gradients(net, [&](size_t, tensor& t) { grads.push_back(mat(t)); });
+        float grad_diff = 0;
+        visit_layer_parameter_gradients(plain, [&](size_t i, tensor& t)
+        {
+            if (t.size() != 0)
+                grad_diff = std::max(grad_diff, max(abs(mat(t)-grads[i])));
+        });
+        DLIB_TEST_MSG(grad_diff < 1e-5, grad_diff);
+
+        // A single sample uses the running statistics, which were only updated once
+        // per batch.
+        net.subnet().forward(x1);
+        plain.subnet().forward(x1);
+        const float stats_diff = max(abs(mat(layer<5>(net).get_output())-mat(layer<4>(plain).get_output())));
+        DLIB_TEST_MSG(stats_diff < 1e-5, stats_diff);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_profiler()
+    {
+        print_spinner();
+
+        using net_type = loss_multiclass_log<fc<3,relu<con<4,3,3,1,1,tag1<input<matrix<float>>>>>>>;
+        net_type net;
+        std::vector<matrix<float>> images;
+        std::vector<unsigned long> labels;
+        for (int i = 0; i < 4; ++i)
+        {
+            images.push_back(matrix_cast<float>(gaussian_randm(8,8,i)));
+            labels.push_back(i%3);
+        }
+        resizable_tensor x;
+        net.to_tensor(images.begin(), images.end(), x);
+        net(images);
+
+        // Nothing is recorded unless the profiler is running.
+        dnn_profiler prof;
+        DLIB_TEST(!prof.is_running());
+        DLIB_TEST(prof.num_calls_recorded() == 0);
+
+        prof.start();
+        DLIB_TEST(prof.is_running());
+        net.to_tensor(images.begin(), images.end(), x);
+        net.compute_parameter_gradients(x, labels.begin());
+        prof.stop();
+        const size_t num_calls = prof.num_calls_recorded();
+        net(images);
+        DLIB_TEST(prof.num_calls_recorded() == num_calls);
+
+        const auto profiles = prof.get_layer_profiles(net);
+        DLIB_TEST(profiles.size() == 5);
+        const size_t expected_index[] = {0, 1, 2, 3, 5};
+        const char* expected_type[] = {"loss_multiclass_log", "fc", "relu", "con", "input<matrix>"};
+        for (size_t i = 0; i < profiles.size(); ++i)
+        {
+            DLIB_TEST(profiles[i].layer_index == expected_index[i]);
+            DLIB_TEST_MSG(profiles[i].layer_type == expected_type[i], profiles[i].layer_type);
+            DLIB_TEST(profiles[i].forward_calls == 1);
+            // The loss is recorded as a single call and the input can't go backward.
+            const unsigned long expected_backward = (i == 0 || i == 4) ? 0 : 1;
+            DLIB_TEST(profiles[i].backward_calls == expected_backward);
+        }
+        DLIB_TEST(profiles[1].forward_flops == 4*3*(2*4*8*8+1));
+        DLIB_TEST(profiles[1].backward_flops == 2*profiles[1].forward_flops);
+        DLIB_TEST(profiles[2].forward_flops == 4*4*8*8);
+        DLIB_TEST(profiles[1].allocated_bytes >= layer<1>(net).layer_details().get_layer_params().size()*sizeof(float));
+        DLIB_TEST(profiles[3].bytes_moved > 0);
+
+        std::ostringstream sout;
+        prof.print_report(net, sout);
+        DLIB_TEST(sout.str().find("<3>     con") != std::string::npos);
+        DLIB_TEST(sout.str().find("loss_multiclass_log") != std::string::npos);
+        sout.str("");
+        prof.write_chrome_trace(net, sout);
+        DLIB_TEST(sout.str().find("{\"traceEvents\":[") == 0);
+        DLIB_TEST(sout.str().find("\"name\":\"layer<1> fc\",\"cat\":\"backward\",\"ph\":\"X\"") != std::string::npos);
+        DLIB_TEST(sout.str().find("unknown layer") == std::string::npos);
+
+        // Calls made by the trainer's threads are recorded too.
+        prof.clear();
+        DLIB_TEST(prof.num_calls_recorded() == 0);
+        dnn_trainer<net_type> trainer(net);
+        prof.start();
+        trainer.train_one_step(images, labels);
+        trainer.get_net();
+        prof.stop();
+        const auto trainer_profiles = prof.get_layer_profiles(net);
+        DLIB_TEST(trainer_profiles.size() == 5);
+        DLIB_TEST(trainer_profiles[3].backward_calls == 1);
+
+        // Only the most recent calls are kept for the trace, but the totals count them
+        // all.
+        prof.clear();
+        prof.set_max_trace_events(3);
+        prof.start();
+        for (int i = 0; i < 10; ++i)
+            net(images);
+        prof.stop();
+        DLIB_TEST(prof.num_calls_recorded() == 10*5);
+        DLIB_TEST(prof.num_trace_events() == 3);
+        DLIB_TEST(prof.get_layer_profiles(net)[2].forward_calls == 10);
+        sout.str("");
+        prof.write_chrome_trace(net, sout);
+        size_t num_trace_events = 0;
+        for (auto pos = sout.str().find("\"ph\":\"X\""); pos != std::string::npos; pos = sout.str().find("\"ph\":\"X\"", pos+1))
+            ++num_trace_events;
+        DLIB_TEST(num_trace_events == 3);
+        // The loss is the last call of each pass.
+        DLIB_TEST(sout.str().find("loss_multiclass_log\",\"cat\":\"forward\",\"ph\":\"X\",\"pid\":0,\"tid\":0") != std::string::npos);
+        prof.set_max_trace_events(1);
+        DLIB_TEST(prof.num_trace_events() == 1);
+
+        // A profiler can be stopped and destroyed while another thread is running a
+        // network.
+        std::atomic<bool> done(false);
+        std::thread t([&]() {
+            net_type tnet;
+            while (!done)
+                tnet(images);
+        });
+        for (int i = 0; i < 50; ++i)
+        {
+            std::unique_ptr<dnn_profiler> p(new dnn_profiler);
+            p->start();
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        done = true;
+        t.join();
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_loss_mmod_nms()
+    {
+        print_spinner();
+
+        using net_type = loss_mmod<con<1,5,5,1,1,input_rgb_image_pyramid<pyramid_down<6>>>>;
+        mmod_options options;
+        options.detector_windows.push_back(mmod_options::detector_window_details(20,20));
+        mmod_options all_options = options;
+        all_options.overlaps_nms = test_box_overlap(1,1);
+        mmod_options soft_options = options;
+        soft_options.soft_nms_sigma = 0.5;
+
+        net_type net(options), all_net(all_options), soft_net(soft_options);
+        matrix<rgb_pixel> img(60,70);
+        dlib::rand rnd;
+        for (auto& p : img)
+            p = rgb_pixel(rnd.get_random_8bit_number(), rnd.get_random_8bit_number(), rnd.get_random_8bit_number());
+
+        // Give all the nets the same random weights.
+        all_net(img);
+        soft_net(img);
+        const std::vector<mmod_rect> dets = net.process(img, -1e30);
+        std::vector<tensor*> params;
+        visit_layer_parameters(net, [&](size_t, tensor& t) { params.push_back(&t); });
+        visit_layer_parameters(all_net, [&](size_t i, tensor& t) { memcpy(t, *params[i]); });
+        visit_layer_parameters(soft_net, [&](size_t i, tensor& t) { memcpy(t, *params[i]); });
+
+        // With an overlap test that never fires we get every location, best first.
+        const std::vector<mmod_rect> all_dets = all_net.process(img, -1e30);
+        DLIB_TEST(all_dets.size() == layer<1>(all_net).get_output().size());
+        for (size_t i = 1; i < all_dets.size(); ++i)
+            DLIB_TEST(all_dets[i-1].detection_confidence >= all_dets[i].detection_confidence);
+
+        // Which the regular net must suppress the same way as checking every kept box.
+        std::vector<mmod_rect> expected;
+        for (auto& d : all_dets)
+        {
+            bool hit = false;
+            for (auto& e : expected)
+                hit = hit || options.overlaps_nms(e.rect, d.rect);
+            if (!hit)
+                expected.push_back(d);
+        }
+        DLIB_TEST(dets.size() == expected.size());
+        for (size_t i = 0; i < dets.size() && i < expected.size(); ++i)
+        {
+            DLIB_TEST(dets[i].rect == expected[i].rect);
+            DLIB_TEST(dets[i].detection_confidence == expected[i].detection_confidence);
+        }
+
+        // Soft-NMS lowers scores toward the threshold, so it needs a sensible one.
+        const double thresh = all_dets.back().detection_confidence - 1;
+        const std::vector<mmod_rect> soft_dets = soft_net.process(img, thresh);
+        DLIB_TEST(soft_dets.size() > dets.size());
+        DLIB_TEST(soft_dets[0].rect == dets[0].rect);
+        for (auto& d : soft_dets)
+            DLIB_TEST(d.detection_confidence > thresh);
+
+        // The training loss uses the same NMS.
+        resizable_tensor x;
+        std::vector<matrix<rgb_pixel>> imgs(1, img);
+        std::vector<std::vector<mmod_rect>> labels(1, std::vector<mmod_rect>(1, mmod_rect(centered_rect(point(30,30),20,20))));
+        net.to_tensor(imgs.begin(), imgs.end(), x);
+        DLIB_TEST(std::isfinite(net.compute_loss(x, labels.begin())));
+
+        std::ostringstream sout;
+        serialize(soft_options, sout);
+        serialize(options, sout);
+        std::istringstream sin(sout.str());
+        mmod_options temp;
+        deserialize(temp, sin);
+        DLIB_TEST(temp.soft_nms_sigma == 0.5);
+        deserialize(temp, sin);
+        DLIB_TEST(temp.soft_nms_sigma == 0);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_rgb_input_conversion()
+    {
+        print_spinner();
+
+        dlib::rand rnd;
+        const float avg_red = 122.5, avg_green = 117, avg_blue = 104.25;
+
+        // Check against the obvious pixel by pixel conversion, for an image that's too
+        // small to use threads and a batch big enough to use them.
+        for (auto size : {std::make_pair(37L,53L), std::make_pair(150L,301L)})
+        {
+            const long nr = size.first;
+            const long nc = size.second;
+            std::vector<matrix<rgb_pixel>> imgs(3);
+            for (auto& img : imgs)
+            {
+                img.set_size(nr, nc);
+                for (auto& p : img)
+                    p = rgb_pixel(rnd.get_random_8bit_number(), rnd.get_random_8bit_number(), rnd.get_random_8bit_number());
+            }
+
+            resizable_tensor expected(imgs.size(), 3, nr, nc);
+            float* e = expected.host();
+            for (auto& img : imgs)
+            {
+                for (long r = 0; r < nr; ++r)
+                    for (long c = 0; c < nc; ++c)
+                        e[r*nc+c] = (img(r,c).red-avg_red)/256.0;
+                e += nr*nc;
+                for (long r = 0; r < nr; ++r)
+                    for (long c = 0; c < nc; ++c)
+                        e[r*nc+c] = (img(r,c).green-avg_green)/256.0;
+                e += nr*nc;
+                for (long r = 0; r < nr; ++r)
+                    for (long c = 0; c < nc; ++c)
+                        e[r*nc+c] = (img(r,c).blue-avg_blue)/256.0;
+                e += nr*nc;
+            }
+
+            resizable_tensor x;
+            input_rgb_image(avg_red, avg_green, avg_blue).to_tensor(imgs.begin(), imgs.end(), x);
+            DLIB_TEST(max(abs(mat(x) - mat(expected))) == 0);
+
+            // The same pixels in an external buffer with padding at the end of each row.
+            const long stride = nc + 5;
+            std::vector<rgb_pixel> buffer(imgs.size()*nr*stride);
+            std::vector<const_sub_image_proxy<matrix<rgb_pixel>>> views;
+            for (size_t i = 0; i < imgs.size(); ++i)
+            {
+                for (long r = 0; r < nr; ++r)
+                    for (long c = 0; c < nc; ++c)
+                        buffer[(i*nr + r)*stride + c] = imgs[i](r,c);
+                views.push_back(sub_image((const rgb_pixel*)&buffer[i*nr*stride], nr, nc, stride));
+            }
+            input_generic_rgb_image<const_sub_image_proxy<matrix<rgb_pixel>>> view_input(avg_red, avg_green, avg_blue);
+            view_input.to_tensor(views.begin(), views.end(), x);
+            DLIB_TEST(max(abs(mat(x) - mat(expected))) == 0);
+
+            // BGR and RGBA pixels put the channels in other places.
+            std::vector<array2d<bgr_pixel>> bgr_imgs(imgs.size());
+            std::vector<matrix<rgb_alpha_pixel>> rgba_imgs(imgs.size());
+            for (size_t i = 0; i < imgs.size(); ++i)
+            {
+                assign_image(bgr_imgs[i], imgs[i]);
+                assign_image(rgba_imgs[i], imgs[i]);
+            }
+            input_generic_rgb_image<array2d<bgr_pixel>>(avg_red, avg_green, avg_blue).to_tensor(bgr_imgs.begin(), bgr_imgs.end(), x);
+            DLIB_TEST(max(abs(mat(x) - mat(expected))) == 0);
+            input_generic_rgb_image<matrix<rgb_alpha_pixel>>(avg_red, avg_green, avg_blue).to_tensor(rgba_imgs.begin(), rgba_imgs.end(), x);
+            DLIB_TEST(max(abs(mat(x) - mat(expected))) == 0);
+        }
+
+        // Other pixel types are converted to rgb_pixel first.
+        matrix<unsigned char> gray(20,21);
+        for (auto& p : gray)
+            p = rnd.get_random_8bit_number();
+        resizable_tensor x;
+        input_generic_rgb_image<matrix<unsigned char>>(avg_red, avg_green, avg_blue).to_tensor(&gray, &gray+1, x);
+        DLIB_TEST(x.k() == 3 && x.nr() == 20 && x.nc() == 21);
+        const float avgs[3] = {avg_red, avg_green, avg_blue};
+        for (long k = 0; k < 3; ++k)
+            for (long r = 0; r < gray.nr(); ++r)
+                for (long c = 0; c < gray.nc(); ++c)
+                    DLIB_TEST(x.host()[(k*gray.nr() + r)*gray.nc() + c] == (gray(r,c)-avgs[k])/256.0f);
+
+        // A network trained with input_rgb_image can be loaded with the generic input.
+        std::ostringstream sout;
+        serialize(input_rgb_image(1,2,3), sout);
+        std::istringstream sin(sout.str());
+        input_generic_rgb_image<array2d<rgb_pixel>> generic;
+        deserialize(generic, sin);
+        DLIB_TEST(generic.get_avg_red() == 1 && generic.get_avg_green() == 2 && generic.get_avg_blue() == 3);
+        input_rgb_image back(generic);
+        DLIB_TEST(back.get_avg_blue() == 3);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    namespace recurrent_reference
+    {
+        // The obvious way to compute an LSTM or GRU, one sample at a time.
+
+        typedef matrix<float,1,0> row;
+
+        row sigm(const row& v) { return matrix_cast<float>(1/(1+exp(-matrix_cast<double>(v)))); }
+        row tanhm(const row& v) { return matrix_cast<float>(tanh(matrix_cast<double>(v))); }
+        row part(const row& v, long j, long H) { return colm(v, range(j*H,(j+1)*H-1)); }
+
+        template <unsigned long num_outputs>
+        matrix<float> output (
+            const lstm_<num_outputs>& l,
+            const std::array<matrix<float>,4>& seq
+        )
+        {
+            const long H = l.get_num_outputs();
+            const matrix<float> W = mat(l.get_weights());
+            const matrix<float> U = mat(l.get_recurrent_weights());
+            const row b = mat(l.get_biases());
+            row h = zeros_matrix<float>(1,H), c = zeros_matrix<float>(1,H);
+            matrix<float> out(seq.size(), H);
+            for (size_t t = 0; t < seq.size(); ++t)
+            {
+                const row x = trans(reshape_to_column_vector(seq[t]));
+                const row pre = x*W + h*U + b;
+                const row i = sigm(part(pre,0,H));
+                const row f = sigm(part(pre,1,H));
+                const row g = tanhm(part(pre,2,H));
+                const row o = sigm(part(pre,3,H));
+                c = pointwise_multiply(f,c) + pointwise_multiply(i,g);
+                h = pointwise_multiply(o, tanhm(c));
+                set_rowm(out, t) = h;
+            }
+            return out;
+        }
+
+        template <unsigned long num_outputs>
+        matrix<float> output (
+            const gru_<num_outputs>& l,
+            const std::array<matrix<float>,4>& seq
+        )
+        {
+            const long H = l.get_num_outputs();
+            const matrix<float> W = mat(l.get_weights());
+            const matrix<float> U = mat(l.get_recurrent_weights());
+            const row b = mat(l.get_biases());
+            const row rb = mat(l.get_recurrent_biases());
+            row h = zeros_matrix<float>(1,H);
+            matrix<float> out(seq.size(), H);
+            for (size_t t = 0; t < seq.size(); ++t)
+            {
+                const row x = trans(reshape_to_column_vector(seq[t]));
+                const row a = x*W + b;
+                const row r = h*U + rb;
+                const row z = sigm(part(a,0,H) + part(r,0,H));
+                const row rr = sigm(part(a,1,H) + part(r,1,H));
+                const row n = tanhm(part(a,2,H) + pointwise_multiply(rr, part(r,2,H)));
+                h = pointwise_multiply(1-z, n) + pointwise_multiply(z, h);
+                set_rowm(out, t) = h;
+            }
+            return out;
+        }
+    }
+
+    template <typename net_type>
+    void test_recurrent_layer (
+    )
+    {
+        dlib::rand rnd;
+        net_type net;
+        std::vector<std::array<matrix<float>,4>> seqs(3);
+        for (auto& seq : seqs)
+            for (auto& x : seq)
+                x = matrix_cast<float>(randm(2,3,rnd)) - 0.5f;
+
+        resizable_tensor x;
+        net.to_tensor(seqs.begin(), seqs.end(), x);
+        const tensor& out = net.forward(x);
+        DLIB_TEST(out.num_samples() == 3);
+        DLIB_TEST(out.k() == 4);
+        DLIB_TEST(out.nr() == 1);
+        DLIB_TEST(out.nc() == 11);
+        for (size_t i = 0; i < seqs.size(); ++i)
+        {
+            const matrix<float> expected = recurrent_reference::output(net.layer_details(), seqs[i]);
+            const matrix<float> actual = reshape(rowm(mat(out),i), 4, 11);
+            DLIB_TEST_MSG(max(abs(expected - actual)) < 1e-5, max(abs(expected - actual)));
+        }
+
+        std::ostringstream sout;
+        serialize(net, sout);
+        net_type net2;
+        std::istringstream sin(sout.str());
+        deserialize(net2, sin);
+        DLIB_TEST(max(abs(mat(net2.forward(x)) - mat(net.forward(x)))) == 0);
+    }
+
+    struct sequence_subnet
+    {
+        resizable_tensor output, gradient_input;
+        const tensor& get_output() const { return output; }
+        tensor& get_gradient_input() { return gradient_input; }
+    };
+
+    template <typename layer_type>
+    void test_recurrent_gradients (
+    )
+    {
+        // test_layer() perturbs each value by a small fraction of itself.  Changing any
+        // value a recurrent layer sees changes all the later outputs, so such small
+        // changes get lost in float rounding.  So check the gradients against central
+        // differences with a fixed step instead.
+        print_spinner();
+        dlib::rand rnd;
+        for (int iter = 0; iter < 3; ++iter)
+        {
+            sequence_subnet sub;
+            sub.output.set_size(rnd.get_random_32bit_number()%3+1, rnd.get_random_32bit_number()%4+2, 2, 3);
+            for (auto& v : sub.output)
+                v = rnd.get_random_gaussian();
+            // Non-zero so we check that backward() adds to it.
+            sub.gradient_input.copy_size(sub.output);
+            sub.gradient_input = 1;
+
+            layer_type l;
+            l.setup(sub);
+            resizable_tensor out, gi, params_grad;
+            l.forward(sub, out);
+            gi.copy_size(out);
+            for (auto& v : gi)
+                v = rnd.get_random_gaussian();
+            params_grad.copy_size(l.get_layer_params());
+            l.backward(gi, sub, params_grad);
+
+            const float eps = 0.01;
+            auto check = [&](float& val, double derivative)
+            {
+                const float old = val;
+                val = old + eps;
+                l.forward(sub, out);
+                const double f1 = dot(out, gi);
+                val = old - eps;
+                l.forward(sub, out);
+                const double f2 = dot(out, gi);
+                val = old;
+                const double reference = (f1-f2)/(2*eps);
+                DLIB_TEST_MSG(std::abs(reference - derivative) < 3e-3 + 0.01*std::abs(reference),
+                    "reference: " << reference << "  derivative: " << derivative);
+            };
+            for (size_t i = 0; i < params_grad.size(); ++i)
+                check(l.get_layer_params().host()[i], params_grad.host()[i]);
+            for (size_t i = 0; i < sub.output.size(); ++i)
+                check(sub.output.host()[i], sub.gradient_input.host()[i] - 1);
+        }
+    }
+
+    template <typename net_type>
+    double train_sequence_memory (
+        const std::vector<std::array<matrix<float>,4>>& seqs,
+        const std::vector<float>& labels
+    )
+    {
+        net_type net;
+        dnn_trainer<net_type,adam> trainer(net, adam(0,0.9,0.999));
+        trainer.set_learning_rate(0.01);
+        trainer.set_mini_batch_size(50);
+        trainer.set_max_num_epochs(150);
+        trainer.train(seqs, labels);
+        const std::vector<float> out = net(seqs);
+        double err = 0;
+        for (size_t i = 0; i < seqs.size(); ++i)
+            err += std::pow(out[i]-labels[i], 2);
+        return err/seqs.size();
+    }
+
+    void test_recurrent_layers()
+    {
+        // 11 units so both the simd and the scalar code in the cells get used.
+        print_spinner();
+        test_recurrent_layer<lstm<11,input<std::array<matrix<float>,4>>>>();
+        print_spinner();
+        test_recurrent_layer<gru<11,input<std::array<matrix<float>,4>>>>();
+        test_recurrent_gradients<lstm_<3>>();
+        test_recurrent_gradients<lstm_<10>>();
+        test_recurrent_gradients<gru_<3>>();
+        test_recurrent_gradients<gru_<10>>();
+
+        // Make sure the layers can learn to carry something across time.  The target is
+        // the value at the first time step and the network only sees the output of the
+        // last one.
+        print_spinner();
+        dlib::rand rnd;
+        std::vector<std::array<matrix<float>,4>> seqs(200);
+        std::vector<float> labels;
+        for (auto& seq : seqs)
+        {
+            for (auto& x : seq)
+                x = matrix_cast<float>(randm(1,1,rnd))*2 - 1;
+            labels.push_back(seq[0](0));
+        }
+        using lstm_net = loss_mean_squared<fc<1,extract<3*8,1,1,8,lstm<8,input<std::array<matrix<float>,4>>>>>>;
+        using gru_net = loss_mean_squared<fc<1,extract<3*8,1,1,8,gru<8,input<std::array<matrix<float>,4>>>>>>;
+        const double lstm_err = train_sequence_memory<lstm_net>(seqs, labels);
+        DLIB_TEST_MSG(lstm_err < 0.02, lstm_err);
+        print_spinner();
+        const double gru_err = train_sequence_memory<gru_net>(seqs, labels);
+        DLIB_TEST_MSG(gru_err < 0.02, gru_err);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_mmod_cascade()
+    {
+        print_spinner();
+
+        using net_type = loss_mmod<con<1,5,5,1,1,relu<bn_con<con<4,5,5,2,2,relu<con<4,3,3,1,1,
+                         max_pool<3,3,2,2,input_rgb_image_pyramid<pyramid_down<6>>>>>>>>>>;
+        mmod_options options;
+        options.detector_windows.push_back(mmod_options::detector_window_details(20,20));
+        net_type net(options);
+
+        matrix<rgb_pixel> img(130,150);
+        dlib::rand rnd;
+        for (auto& p : img)
+            p = rgb_pixel(rnd.get_random_8bit_number(), rnd.get_random_8bit_number(), rnd.get_random_8bit_number());
+
+        // Pick a threshold that only a few percent of the locations are above.
+        net(img);
+        std::vector<float> scores(layer<1>(net).get_output().begin(), layer<1>(net).get_output().end());
+        std::sort(scores.begin(), scores.end());
+        const size_t idx = scores.size()*98/100;
+        const double thresh = (scores[idx] + scores[idx+1])/2;
+        const std::vector<mmod_rect> expected = net.process(img, thresh);
+        DLIB_TEST(expected.size() > 0);
+
+        auto same_dets = [](const std::vector<mmod_rect>& a, const std::vector<mmod_rect>& b) -> bool
+        {
+            if (a.size() != b.size())
+                return false;
+            for (size_t i = 0; i < a.size(); ++i)
+            {
+                if (a[i].rect != b[i].rect || std::abs(a[i].detection_confidence - b[i].detection_confidence) > 1e-4)
+                    return false;
+            }
+            return true;
+        };
+
+        mmod_cascade<net_type::subnet_type> cascade(net, 4);
+
+        // Evaluating every tile piece by piece gives the same output as the full network.
+        auto keep_all = [](const tensor&, const std::vector<rectangle>& areas, std::vector<bool>& keep) { keep.assign(areas.size(), true); };
+        DLIB_TEST(same_dets(cascade(img, keep_all, thresh), expected));
+        DLIB_TEST(cascade.get_fraction_of_tiles_evaluated() == 1);
+
+        // Using the network itself as the first stage skips most of the tiles and still
+        // finds everything.
+        mmod_prefilter<net_type::subnet_type> prefilter(net, thresh);
+        DLIB_TEST(same_dets(cascade(img, prefilter, thresh), expected));
+        DLIB_TEST(0 < cascade.get_fraction_of_tiles_evaluated() && cascade.get_fraction_of_tiles_evaluated() < 0.5);
+        cascade.set_tile_size(7);
+        DLIB_TEST(same_dets(cascade(img, prefilter, thresh), expected));
+
+        auto keep_none = [](const tensor&, const std::vector<rectangle>& areas, std::vector<bool>& keep) { keep.assign(areas.size(), false); };
+        DLIB_TEST(cascade(img, keep_none, thresh).size() == 0);
+        DLIB_TEST(cascade.get_fraction_of_tiles_evaluated() == 0);
+
+        // Networks that mix distant parts of the image together can't be split up.
+        using res_net_type = loss_mmod<con<1,3,3,1,1,add_prev1<con<3,3,3,1,1,tag1<input_rgb_image_pyramid<pyramid_down<6>>>>>>>;
+        res_net_type res_net(options);
+        bool found_error = false;
+        try
+        {
+            mmod_cascade<res_net_type::subnet_type> temp(res_net);
+        }
+        catch (dlib::error&)
+        {
+            found_error = true;
+        }
+        DLIB_TEST(found_error);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_16bit_tensor_serialization()
+    {
+        print_spinner();
+
+        auto to_fp16 = [](float v) { uint16_t h; cpu::float_to_fp16(&h, &v, 1); return h; };
+        auto to_bf16 = [](float v) { uint16_t h; cpu::float_to_bf16(&h, &v, 1); return h; };
+        auto from_fp16 = [](uint16_t h) { float v; cpu::fp16_to_float(&v, &h, 1); return v; };
+        DLIB_TEST(to_fp16(1) == 0x3c00);
+        DLIB_TEST(to_fp16(-2) == 0xc000);
+        DLIB_TEST(to_fp16(65504) == 0x7bff);
+        DLIB_TEST(to_fp16(65520) == 0x7c00);
+        DLIB_TEST(to_fp16(std::pow(2.0f,-24.0f)) == 0x0001);
+        DLIB_TEST(to_fp16(std::numeric_limits<float>::infinity()) == 0x7c00);
+        DLIB_TEST(from_fp16(0x0001) == std::pow(2.0f,-24.0f));
+        DLIB_TEST(from_fp16(0xfc00) == -std::numeric_limits<float>::infinity());
+        DLIB_TEST(std::isnan(from_fp16(to_fp16(std::numeric_limits<float>::quiet_NaN()))));
+        DLIB_TEST(to_bf16(1) == 0x3f80);
+        // Ties round to even.
+        DLIB_TEST(to_bf16(1.00390625f) == 0x3f80);
+        DLIB_TEST(to_bf16(1.01171875f) == 0x3f82);
+        DLIB_TEST(to_bf16(std::numeric_limits<float>::quiet_NaN()) != 0x7f80);
+
+        // The vectorized paths must agree with the scalar ones.
+        resizable_tensor x(3,5,7,12);
+        tt::tensor_rand rnd(0);
+        rnd.fill_gaussian(x, 0, 1000);
+        std::vector<uint16_t> h(x.size());
+        std::vector<float> back(x.size());
+        cpu::float_to_fp16(h.data(), x.host(), x.size());
+        cpu::fp16_to_float(back.data(), h.data(), h.size());
+        for (size_t i = 0; i < x.size(); ++i)
+        {
+            DLIB_TEST(h[i] == to_fp16(x.host()[i]));
+            DLIB_TEST(std::abs(back[i]-x.host()[i]) <= std::abs(x.host()[i])*std::pow(2.0f,-11.0f));
+        }
+        cpu::float_to_bf16(h.data(), x.host(), x.size());
+        cpu::bf16_to_float(back.data(), h.data(), h.size());
+        for (size_t i = 0; i < x.size(); ++i)
+        {
+            DLIB_TEST(h[i] == to_bf16(x.host()[i]));
+            DLIB_TEST(std::abs(back[i]-x.host()[i]) <= std::abs(x.host()[i])*std::pow(2.0f,-8.0f));
+        }
+
+        // Networks saved with 16 bit tensors are about half the size and load with the
+        // normal deserialize().
+        using net_type = loss_multiclass_log<fc<5,relu<fc<16,relu<con<8,3,3,1,1,input<matrix<float>>>>>>>>;
+        net_type net;
+        std::vector<matrix<float>> images;
+        for (int i = 0; i < 4; ++i)
+            images.push_back(matrix_cast<float>(gaussian_randm(10,10,i)));
+        net.to_tensor(images.begin(), images.end(), x);
+        net.subnet().forward(x);
+
+        std::ostringstream sout;
+        serialize(net, sout);
+        DLIB_TEST(get_tensor_serialization_format(sout) == tensor_serialization_format::fp32);
+        for (auto format : {tensor_serialization_format::fp16, tensor_serialization_format::bf16})
+        {
+            std::ostringstream hout;
+            set_tensor_serialization_format(hout, format);
+            DLIB_TEST(get_tensor_serialization_format(hout) == format);
+            serialize(net, hout);
+            DLIB_TEST_MSG(hout.str().size() < sout.str().size()*0.55, hout.str().size() << " " << sout.str().size());
+
+            std::istringstream sin(hout.str());
+            net_type net2;
+            deserialize(net2, sin);
+            const matrix<double,1,3> drift = test_output_drift(net, net2, images.begin(), images.end());
+            DLIB_TEST_MSG(drift(2) < 0.02, drift);
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_grouped_con()
+    {
+        print_spinner();
+
+        using net_type = loss_multiclass_log<fc<2,relu<depthwise_con<8,3,3,1,1,
+                         relu<grouped_con<8,2,3,3,2,2,con<4,3,3,1,1,input<matrix<float>>>>>>>>>;
+        net_type net;
+        DLIB_TEST(layer<3>(net).layer_details().groups() == 8);
+        DLIB_TEST(layer<5>(net).layer_details().groups() == 2);
+
+        // The two classes are bright and dark images, which the network should have no
+        // trouble learning.
+        std::vector<matrix<float>> images;
+        std::vector<unsigned long> labels;
+        dlib::rand rnd(0);
+        for (int i = 0; i < 40; ++i)
+        {
+            matrix<float> img(12,12);
+            for (auto& v : img)
+                v = (i%2 ? 1 : -1) + 0.3*rnd.get_random_gaussian();
+            images.push_back(img);
+            labels.push_back(i%2);
+        }
+
+        dnn_trainer<net_type> trainer(net, sgd(), {0});
+        trainer.set_learning_rate(0.01);
+        trainer.set_mini_batch_size(10);
+        trainer.set_max_num_epochs(30);
+        trainer.train(images, labels);
+
+        // Each filter only spans the channels in its group.
+        DLIB_TEST(layer<3>(net).layer_details().get_filters().k() == 1);
+        DLIB_TEST(layer<3>(net).layer_details().get_layer_params().size() == 8*3*3 + 8);
+        DLIB_TEST(layer<5>(net).layer_details().get_filters().k() == 2);
+        DLIB_TEST(layer<5>(net).layer_details().get_layer_params().size() == 8*2*3*3 + 8);
+
+        const std::vector<unsigned long> predicted = net(images);
+        DLIB_TEST(predicted == labels);
+
+        // The strided grouped layer halves the resolution, the depthwise one doesn't.
+        const dpoint p = input_tensor_to_output_tensor(layer<3>(net), dpoint(9,7));
+        DLIB_TEST(p == dpoint(4,3));
+        DLIB_TEST(output_tensor_to_input_tensor(layer<3>(net), p) == dpoint(9,7));
+
+        std::ostringstream sout;
+        net_to_xml(net, sout);
+        DLIB_TEST(sout.str().find("groups='8'") != std::string::npos);
+        DLIB_TEST(sout.str().find("groups='2'") != std::string::npos);
+
+        sout.str("");
+        serialize(net, sout);
+        std::istringstream sin(sout.str());
+        net_type net2;
+        deserialize(net2, sin);
+        DLIB_TEST(max(abs(test_output_drift(net, net2, images.begin(), images.end()))) == 0);
+
+        // A grouped layer can't be loaded into an ungrouped one.
+        sout.str("");
+        serialize(layer<5>(net).layer_details(), sout);
+        sin.str(sout.str());
+        con_<8,3,3,2,2> ungrouped;
+        bool found_error = false;
+        try
+        {
+            deserialize(ungrouped, sin);
+        }
+        catch (serialization_error&)
+        {
+            found_error = true;
+        }
+        DLIB_TEST(found_error);
+
+        // Grouped layers are left in floating point by quantize_layers().
+        quantize_layers(net, images.begin(), images.end());
+        DLIB_TEST(layer<1>(net).layer_details().is_quantized());
+        DLIB_TEST(!layer<3>(net).layer_details().is_quantized());
+        DLIB_TEST(!layer<5>(net).layer_details().is_quantized());
+        DLIB_TEST(layer<6>(net).layer_details().is_quantized());
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_dilated_con()
+    {
+        print_spinner();
+
+        using net_type = loss_multiclass_log<fc<2,relu<dilated_con<4,3,3,4,4,
+                         relu<dilated_con<4,3,3,2,2,con<4,3,3,1,1,input<matrix<float>>>>>>>>>;
+        net_type net;
+        DLIB_TEST(layer<3>(net).layer_details().dilation_y() == 4);
+        DLIB_TEST(layer<3>(net).layer_details().dilation_x() == 4);
+        DLIB_TEST(layer<3>(net).layer_details().padding_y() == 4);
+        DLIB_TEST(layer<5>(net).layer_details().dilation_y() == 2);
+
+        std::vector<matrix<float>> images;
+        std::vector<unsigned long> labels;
+        dlib::rand rnd(0);
+        for (int i = 0; i < 20; ++i)
+        {
+            matrix<float> img(13,11);
+            for (auto& v : img)
+                v = (i%2 ? 1 : -1) + 0.3*rnd.get_random_gaussian();
+            images.push_back(img);
+            labels.push_back(i%2);
+        }
+        net(images[0]);
+
+        // The dilated layers see a 13x13 window but keep the resolution and have no more
+        // parameters than an ordinary 3x3 con.
+        DLIB_TEST(layer<2>(net).get_output().nr() == 13);
+        DLIB_TEST(layer<2>(net).get_output().nc() == 11);
+        DLIB_TEST(layer<3>(net).layer_details().get_layer_params().size() == 4*4*3*3 + 4);
+        const dpoint p(8,5);
+        DLIB_TEST(input_tensor_to_output_tensor(layer<3>(net), p) == p);
+
+        dnn_trainer<net_type> trainer(net, sgd(), {0});
+        trainer.set_learning_rate(0.01);
+        trainer.set_mini_batch_size(10);
+        trainer.set_max_num_epochs(30);
+        trainer.train(images, labels);
+        DLIB_TEST(net(images) == labels);
+
+        std::ostringstream sout;
+        net_to_xml(net, sout);
+        DLIB_TEST(sout.str().find("dilation_y='4'") != std::string::npos);
+        DLIB_TEST(sout.str().find("dilation_x='2'") != std::string::npos);
+
+        sout.str("");
+        serialize(net, sout);
+        std::istringstream sin(sout.str());
+        net_type net2;
+        deserialize(net2, sin);
+        DLIB_TEST(max(abs(test_output_drift(net, net2, images.begin(), images.end()))) == 0);
+
+        // A dilated layer can't be loaded into an ordinary one.
+        sout.str("");
+        serialize(layer<5>(net).layer_details(), sout);
+        sin.str(sout.str());
+        con_<4,3,3,1,1,2,2> dense;
+        bool found_error = false;
+        try
+        {
+            deserialize(dense, sin);
+        }
+        catch (serialization_error&)
+        {
+            found_error = true;
+        }
+        DLIB_TEST(found_error);
+
+        // The int8 path handles dilation as well.
+        resizable_tensor x, out1;
+        net.to_tensor(images.begin(), images.end(), x);
+        out1 = net.subnet().forward(x);
+        quantize_layers(net, images.begin(), images.end());
+        DLIB_TEST(layer<3>(net).layer_details().is_quantized());
+        const tensor& out2 = net.subnet().forward(x);
+        DLIB_TEST(max(abs(mat(out2)-mat(out1)))/(max(abs(mat(out1)))+1) < 0.1);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <typename T>
+    bool same_params(const T& l1, const T& l2)
+    {
+        const tensor& p1 = l1.layer_details().get_layer_params();
+        const tensor& p2 = l2.layer_details().get_layer_params();
+        return p1.size() != 0 && p1.host() == p2.host();
+    }
+
+    void test_shared_weights()
+    {
+        print_spinner();
+
+        {
+            gpu_data a, b;
+            a.set_size(10);
+            for (size_t i = 0; i < a.size(); ++i)
+                a.host()[i] = i;
+            b.share_data_with(a);
+            const gpu_data& ca = a;
+            const gpu_data& cb = b;
+            DLIB_TEST(b.size() == 10);
+            DLIB_TEST(ca.host() == cb.host());
+            DLIB_TEST(a.shares_data() && b.shares_data());
+
+            // Writing gives b its own copy and leaves a alone.
+            b.host()[3] = -1;
+            DLIB_TEST(ca.host() != cb.host());
+            DLIB_TEST(ca.host()[3] == 3 && cb.host()[3] == -1 && cb.host()[4] == 4);
+            DLIB_TEST(!b.shares_data());
+            // a is the only one left using the old memory so it can write in place.
+            DLIB_TEST(!a.shares_data());
+            const float* p = ca.host();
+            a.host_write_only()[0] = 7;
+            DLIB_TEST(ca.host() == p);
+        }
+
+        using net_type = loss_multiclass_log<fc<3,prelu<fc<10,relu<con<4,3,3,1,1,input<matrix<float>>>>>>>>;
+        net_type net;
+        std::vector<matrix<float>> images;
+        for (int i = 0; i < 10; ++i)
+            images.push_back(matrix_cast<float>(gaussian_randm(6,5,i)));
+        const std::vector<unsigned long> expected = net(images);
+
+        net_type net2;
+        copy_net_sharing_weights(net, net2);
+        DLIB_TEST(same_params(layer<1>(net), layer<1>(net2)));
+        DLIB_TEST(same_params(layer<2>(net), layer<2>(net2)));
+        DLIB_TEST(same_params(layer<3>(net), layer<3>(net2)));
+        DLIB_TEST(same_params(layer<5>(net), layer<5>(net2)));
+
+        // Running the copy doesn't touch the parameters, so they stay shared.
+        DLIB_TEST(net2(images) == expected);
+        DLIB_TEST(net(images) == expected);
+        DLIB_TEST(same_params(layer<1>(net), layer<1>(net2)));
+        DLIB_TEST(same_params(layer<5>(net), layer<5>(net2)));
+
+        // Changing the parameters of one network doesn't change the other.
+        layer<5>(net2).layer_details().get_layer_params() = 0;
+        DLIB_TEST(!same_params(layer<5>(net), layer<5>(net2)));
+        DLIB_TEST(max(abs(mat(layer<5>(net).layer_details().get_layer_params()))) > 0);
+        DLIB_TEST(same_params(layer<1>(net), layer<1>(net2)));
+        DLIB_TEST(net(images) == expected);
+
+        // Ordinary copies still get their own memory.
+        net_type net3(net);
+        DLIB_TEST(!same_params(layer<1>(net), layer<1>(net3)));
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_mapped_model()
+    {
+        print_spinner();
+
+        {
+            std::shared_ptr<std::vector<float>> memory = std::make_shared<std::vector<float>>(10);
+            for (size_t i = 0; i < memory->size(); ++i)
+                (*memory)[i] = i;
+            gpu_data a;
+            a.set_read_only_memory(std::shared_ptr<const float>(memory, memory->data()), memory->size());
+            const gpu_data& ca = a;
+            DLIB_TEST(a.size() == 10);
+            DLIB_TEST(ca.host() == memory->data());
+            DLIB_TEST(a.has_read_only_memory());
+
+            // Even though nothing else references the memory, writing must not touch it.
+            gpu_data b;
+            b.share_data_with(a);
+            DLIB_TEST(b.has_read_only_memory());
+            b.set_size(0);
+            a.host()[3] = -1;
+            DLIB_TEST(!a.has_read_only_memory());
+            DLIB_TEST(ca.host() != memory->data());
+            DLIB_TEST(ca.host()[3] == -1 && ca.host()[4] == 4);
+            DLIB_TEST((*memory)[3] == 3);
+        }
+
+        using net_type = loss_multiclass_log<fc<3,prelu<fc<10,relu<bn_con<con<4,3,3,1,1,input<matrix<float>>>>>>>>>;
+        net_type net;
+        std::vector<matrix<float>> images;
+        std::vector<unsigned long> labels;
+        for (int i = 0; i < 20; ++i)
+        {
+            images.push_back(matrix_cast<float>(gaussian_randm(6,5,i)));
+            labels.push_back(i%3);
+        }
+        dnn_trainer<net_type> trainer(net, sgd());
+        for (int i = 0; i < 5; ++i)
+            trainer.train_one_step(images, labels);
+        trainer.get_net();
+        net.clean();
+        const std::vector<unsigned long> expected = net(images);
+
+        const std::string filename = "dnn_mapped_model_test.dat";
+        const std::vector<std::string> names = {"a", "b", "c"};
+        save_mapped_model(filename, net, names);
+
+        net_type net2;
+        std::vector<std::string> names2;
+        load_mapped_model(filename, net2, names2);
+        DLIB_TEST(names2 == names);
+        DLIB_TEST(max(abs(mat(layer<1>(net).layer_details().get_layer_params()) -
+                          mat(layer<1>(net2).layer_details().get_layer_params()))) == 0);
+        DLIB_TEST(net2(images) == expected);
+
+        // The parameters point into the mapped file, one aligned block each.
+        const tensor& params = layer<1>(net2).layer_details().get_layer_params();
+        const float* mapped = params.host();
+        DLIB_TEST(reinterpret_cast<std::uintptr_t>(mapped)%64 == 0);
+
+        // Networks sharing the mapped weights still see the file's values.
+        net_type net3;
+        copy_net_sharing_weights(net2, net3);
+        DLIB_TEST(net3(images) == expected);
+
+        // Writing to the parameters makes a private copy instead of touching the file.
+        layer<1>(net2).layer_details().get_layer_params() = 0;
+        DLIB_TEST(params.host() != mapped);
+        DLIB_TEST(net3(images) == expected);
+        net_type net4;
+        load_mapped_model(filename, net4);
+        DLIB_TEST(net4(images) == expected);
+
+        // Training a loaded network works as usual.
+        dnn_trainer<net_type> trainer4(net4, sgd());
+        trainer4.train_one_step(images, labels);
+        trainer4.get_net();
+        DLIB_TEST(max(abs(mat(layer<1>(net).layer_details().get_layer_params()) -
+                          mat(layer<1>(net4).layer_details().get_layer_params()))) > 0);
+
+        // A mapped model can't be read by plain deserialize().
+        bool threw = false;
+        try { deserialize(filename) >> net4; } catch (serialization_error&) { threw = true; }
+        DLIB_TEST(threw);
+
+        std::remove(filename.c_str());
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_inference_server()
+    {
+        print_spinner();
+
+        using net_type = loss_multiclass_log<fc<5,relu<fc<10,input<matrix<float>>>>>>;
+        net_type net;
+        std::vector<matrix<float>> images;
+        for (int i = 0; i < 100; ++i)
+            images.push_back(matrix_cast<float>(gaussian_randm(3,4,i)));
+        const std::vector<unsigned long> expected = net(images);
+
+        {
+            // With a long delay a single worker only runs full batches, except for the
+            // leftovers once the delay runs out.
+            dnn_inference_server<net_type> server(net, 1, 8, std::chrono::seconds(1));
+            std::vector<std::future<unsigned long>> results;
+            for (int i = 0; i < 20; ++i)
+                results.push_back(server(images[i]));
+            for (int i = 0; i < 20; ++i)
+                DLIB_TEST(results[i].get() == expected[i]);
+
+            const auto stats = server.get_stats();
+            DLIB_TEST(stats.num_requests == 20);
+            DLIB_TEST(stats.num_batches == 3);
+            DLIB_TEST(stats.batch_size_histogram.size() == 9);
+            DLIB_TEST(stats.batch_size_histogram[8] == 2);
+            DLIB_TEST(stats.batch_size_histogram[4] == 1);
+            DLIB_TEST(sum(mat(stats.queue_depth_histogram)) == 20);
+            DLIB_TEST(server.queue_depth() == 0);
+
+            server.clear_stats();
+            DLIB_TEST(server.get_stats().num_requests == 0);
+        }
+
+        // Many threads hammering a server with several workers all get their own answers.
+        dnn_inference_server<net_type> server(net, 3, 16, std::chrono::microseconds(500));
+        // The server keeps its own copies, so changing net mustn't matter.
+        net = net_type();
+        std::vector<std::thread> clients;
+        std::vector<unsigned long> results(images.size());
+        for (int t = 0; t < 4; ++t)
+        {
+            clients.emplace_back([&,t]() {
+                std::vector<std::future<unsigned long>> futures;
+                for (size_t i = t; i < images.size(); i += 4)
+                    futures.push_back(server(images[i]));
+                size_t j = 0;
+                for (size_t i = t; i < images.size(); i += 4)
+                    results[i] = futures[j++].get();
+            });
+        }
+        for (auto& t : clients)
+            t.join();
+        DLIB_TEST(results == expected);
+
+        const auto stats = server.get_stats();
+        DLIB_TEST(stats.num_requests == images.size());
+        unsigned long long total = 0;
+        for (size_t i = 0; i < stats.batch_size_histogram.size(); ++i)
+            total += i*stats.batch_size_histogram[i];
+        DLIB_TEST(total == images.size());
+        DLIB_TEST(server.num_workers() == 3);
+        std::ostringstream sout;
+        sout << stats;
+        DLIB_TEST(sout.str().find("requests: 100") != std::string::npos);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_async_sync()
+    {
+        print_spinner();
+
+        using net_type = loss_mean_squared<fc<1,relu<fc<5,input<matrix<float>>>>>>;
+        std::vector<matrix<float>> x;
+        std::vector<float> y;
+        for (int i = 0; i < 40; ++i)
+        {
+            x.push_back(matrix_cast<float>(gaussian_randm(3,1,i)));
+            y.push_back(sum(x.back()));
+        }
+
+        const std::string sync_file = "dnn_async_sync_test.dat";
+        std::remove(sync_file.c_str());
+        std::remove((sync_file+"_").c_str());
+
+        net_type net;
+        {
+            dnn_trainer<net_type> trainer(net);
+            trainer.set_asynchronous_sync(true);
+            DLIB_TEST(trainer.get_asynchronous_sync());
+            trainer.set_synchronization_file(sync_file, std::chrono::seconds(1000));
+            trainer.set_mini_batch_size(10);
+            for (int i = 0; i < 20; ++i)
+                trainer.train_one_step(x, y);
+            trainer.get_net();
+            trainer.wait_for_sync_to_disk();
+            DLIB_TEST(file_exists(sync_file));
+            DLIB_TEST(!file_exists(sync_file+".tmp"));
+
+            // A second sync goes to the other file.
+            for (int i = 0; i < 5; ++i)
+                trainer.train_one_step(x, y);
+            trainer.get_net();
+        }
+        // The trainer finishes its write before it's destroyed.
+        DLIB_TEST(file_exists(sync_file+"_"));
+
+        // A new trainer picks up the state the first one saved last.
+        net_type net2;
+        dnn_trainer<net_type> trainer2(net2);
+        trainer2.set_synchronization_file(sync_file, std::chrono::seconds(1000));
+        DLIB_TEST(max(abs(mat(layer<1>(net).layer_details().get_layer_params()) -
+                          mat(layer<1>(net2).layer_details().get_layer_params()))) == 0);
+        DLIB_TEST(max(abs(mat(layer<3>(net).layer_details().get_layer_params()) -
+                          mat(layer<3>(net2).layer_details().get_layer_params()))) == 0);
+        DLIB_TEST(trainer2.get_train_one_step_calls() == 25);
+
+        std::remove(sync_file.c_str());
+        std::remove((sync_file+"_").c_str());
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_data_loader()
+    {
+        print_spinner();
+
+        using net_type = loss_mean_squared<fc<1,input<matrix<float>>>>;
+        std::vector<matrix<float>> x;
+        std::vector<float> y;
+        for (int i = 0; i < 103; ++i)
+        {
+            x.push_back(matrix_cast<float>(gaussian_randm(2,1,i)));
+            y.push_back(2*x.back()(0) - x.back()(1) + 1);
+        }
+
+        std::mutex m;
+        std::vector<int> times_loaded(x.size(), 0);
+        auto load = [&](size_t i, matrix<float>& sample, float& label)
+        {
+            sample = x[i];
+            label = y[i];
+            std::lock_guard<std::mutex> lock(m);
+            ++times_loaded[i];
+        };
+        // Adding 0 keeps the problem the same but makes the augment stage run.
+        auto augment = [](matrix<float>& sample, float&, dlib::rand& rnd)
+        {
+            sample += 0*rnd.get_random_float();
+        };
+
+        {
+            // Every sample is visited once per epoch.
+            net_type net;
+            dnn_data_loader_options options;
+            options.num_load_threads = 1;
+            options.prefetch_depth = 1;
+            dnn_data_loader<net_type> loader(x.size(), 10, load, augment, options);
+            DLIB_TEST(loader.batches_per_epoch() == 11);
+            dnn_trainer<net_type> trainer(net);
+            for (size_t i = 0; i < 2*loader.batches_per_epoch(); ++i)
+                trainer.train_one_step(loader);
+            trainer.get_net();
+            const auto stats = loader.get_stats();
+            DLIB_TEST(stats.num_batches_consumed == 22);
+            DLIB_TEST(stats.pack.num_batches >= 22);
+            DLIB_TEST(stats.augment.num_batches >= stats.pack.num_batches);
+            DLIB_TEST(stats.load.num_batches >= stats.augment.num_batches);
+            std::lock_guard<std::mutex> lock(m);
+            // The loader might have read part of the third epoch already.
+            for (auto n : times_loaded)
+                DLIB_TEST(2 <= n && n <= 3);
+        }
+
+        // Training with a loader gives a working model.
+        net_type net;
+        dnn_trainer<net_type> trainer(net, sgd(0,0.9));
+        trainer.set_learning_rate(0.01);
+        trainer.set_max_num_epochs(200);
+        dnn_data_loader<net_type> loader(x.size(), 16, load);
+        trainer.train(loader);
+        const auto& w = layer<1>(net).layer_details().get_weights();
+        const auto& b = layer<1>(net).layer_details().get_biases();
+        DLIB_TEST_MSG(std::abs(w.host()[0]-2) < 0.01 && std::abs(w.host()[1]+1) < 0.01 && std::abs(b.host()[0]-1) < 0.01,
+            w.host()[0] << " " << w.host()[1] << " " << b.host()[0]);
+        std::ostringstream sout;
+        sout << loader.get_stats();
+        DLIB_TEST(sout.str().find("trainer batches: 1400") != std::string::npos);
+
+        // Errors in the load function come out of the trainer.
+        dnn_data_loader<net_type> bad_loader(x.size(), 16,
+            [](size_t, matrix<float>&, float&) { throw dlib::error("can't read file"); });
+        dnn_trainer<net_type> trainer2(net);
+        bool found_error = false;
+        try
+        {
+            trainer2.train_one_step(bad_loader);
+        }
+        catch (dlib::error& e)
+        {
+            found_error = std::string(e.what()) == "can't read file";
+        }
+        DLIB_TEST(found_error);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_gradient_accumulation()
+    {
+        print_spinner();
+
+        using net_type = loss_mean_squared<fc<1,relu<fc<8,relu<fc<8,input<matrix<float>>>>>>>>;
+        std::vector<matrix<float>> x;
+        std::vector<float> y;
+        for (int i = 0; i < 20; ++i)
+        {
+            x.push_back(matrix_cast<float>(gaussian_randm(3,1,i)));
+            y.push_back(x.back()(0) - 2*x.back()(1)*x.back()(2));
+        }
+        const std::vector<matrix<float>> x1(x.begin(), x.begin()+10), x2(x.begin()+10, x.end());
+        const std::vector<float> y1(y.begin(), y.begin()+10), y2(y.begin()+10, y.end());
+
+        auto params_of = [](net_type& net)
+        {
+            std::vector<matrix<float>> params;
+            visit_layer_parameters(net, [&](size_t, tensor& t) { params.push_back(mat(t)); });
+            return params;
+        };
+        auto max_diff = [](const std::vector<matrix<float>>& a, const std::vector<matrix<float>>& b)
+        {
+            float diff = 0;
+            for (size_t i = 0; i < a.size(); ++i)
+            {
+                if (a[i].size() != 0)
+                    diff = std::max(diff, max(abs(a[i]-b[i])));
+            }
+            return diff;
+        };
+
+        net_type net0;
+        net0(x[0]);
+
+        // The trainer, which updates each layer as soon as its gradient is ready, does
+        // exactly what updating the whole network at the end does.
+        {
+            net_type net = net0, expected = net0;
+            dnn_trainer<net_type,adam> trainer(net, adam(0.0005, 0.9, 0.999));
+            std::vector<adam> solvers(net_type::num_computational_layers, adam(0.0005, 0.9, 0.999));
+            for (int iter = 0; iter < 3; ++iter)
+            {
+                trainer.train_one_step(x, y);
+                expected.compute_parameter_gradients(x.begin(), x.end(), y.begin());
+                expected.update_parameters(make_sstack(solvers), trainer.get_learning_rate());
+            }
+            trainer.get_net();
+            DLIB_TEST(max_diff(params_of(net), params_of(expected)) == 0);
+        }
+
+        // Accumulating two half batches is the same as one whole batch.
+        {
+            net_type net_a = net0, net_b = net0;
+            dnn_trainer<net_type,adam> trainer_a(net_a, adam(0.0005, 0.9, 0.999));
+            dnn_trainer<net_type,adam> trainer_b(net_b, adam(0.0005, 0.9, 0.999));
+            DLIB_TEST(trainer_b.get_gradient_accumulation_steps() == 1);
+            trainer_b.set_gradient_accumulation_steps(2);
+            DLIB_TEST(trainer_b.get_gradient_accumulation_steps() == 2);
+            for (int iter = 0; iter < 3; ++iter)
+            {
+                trainer_a.train_one_step(x, y);
+                trainer_b.train_one_step(x1, y1);
+                // Nothing happens until the second half is in.
+                trainer_b.get_net();
+                if (iter == 0)
+                    DLIB_TEST(max_diff(params_of(net_b), params_of(net0)) == 0);
+                trainer_b.train_one_step(x2, y2);
+            }
+            trainer_a.get_net();
+            trainer_b.get_net();
+            DLIB_TEST(trainer_b.get_train_one_step_calls() == 6);
+            DLIB_TEST_MSG(max_diff(params_of(net_a), params_of(net_b)) < 1e-5, max_diff(params_of(net_a), params_of(net_b)));
+            DLIB_TEST(max_diff(params_of(net_a), params_of(net0)) > 1e-4);
+            DLIB_TEST(std::abs(trainer_a.get_average_loss() - trainer_b.get_average_loss()) < 1e-5);
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <typename solver_type>
+    void train_with_solver(
+        const solver_type& solver,
+        double learning_rate
+    )
+    {
+        using net_type = loss_mean_squared<fc<1,relu<fc<16,input<matrix<float>>>>>>;
+        std::vector<matrix<float>> x;
+        std::vector<float> y;
+        for (int i = 0; i < 50; ++i)
+        {
+            x.push_back(matrix_cast<float>(gaussian_randm(3,1,i)));
+            y.push_back(x.back()(0) - 2*x.back()(1) + 0.5*x.back()(2));
+        }
+
+        net_type net;
+        dnn_trainer<net_type,solver_type> trainer(net, solver);
+        trainer.set_learning_rate(learning_rate);
+        trainer.set_min_learning_rate(1e-9);
+        trainer.set_mini_batch_size(50);
+        trainer.set_max_num_epochs(500);
+        trainer.train(x, y);
+        const double loss = trainer.get_average_loss();
+        dlog << LINFO << solver << " loss: " << loss;
+        DLIB_TEST_MSG(loss < 0.05, solver << " loss: " << loss);
+
+        std::ostringstream sout;
+        serialize(trainer.get_solvers()[0], sout);
+        std::istringstream sin(sout.str());
+        solver_type s2;
+        deserialize(s2, sin);
+        std::ostringstream sout2;
+        serialize(s2, sout2);
+        DLIB_TEST(sout.str() == sout2.str());
+        DLIB_TEST(s2.get_weight_decay() == solver.get_weight_decay());
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_solver_kernels()
+    {
+        print_spinner();
+
+        // Big enough to be split over threads, with a range that doesn't line up with
+        // the simd width at either end.
+        const size_t n = 100004, begin = 5, end = n-3;
+        tt::tensor_rand rnd;
+        resizable_tensor params(n), params_grad(n), m0(n), v0(n), s0(n);
+        rnd.fill_gaussian(params);
+        rnd.fill_gaussian(params_grad);
+        rnd.fill_uniform(m0);
+        rnd.fill_uniform(v0);
+        rnd.fill_uniform(s0);
+        const float t = 3, lr = 0.01, wd = 0.001, m1 = 0.9, m2 = 0.99;
+        const float c1 = 1/(1-std::pow(m1,t)), c2 = 1/(1-std::pow(m2,t));
+        const float alpha = lr*std::sqrt(1-std::pow(m2,t))/(1-std::pow(m1,t));
+        const float* p = params.host();
+        const float* g = params_grad.host();
+
+        auto check = [&](const tensor& a, const std::vector<float>& b, float tol)
+        {
+            const float* pa = a.host();
+            float err = 0;
+            for (size_t i = 0; i < n; ++i)
+                err = std::max(err, std::abs(pa[i]-b[i])/(1+std::abs(b[i])));
+            DLIB_TEST_MSG(err < tol, err);
+        };
+
+        std::vector<float> m(m0.begin(), m0.end()), v(v0.begin(), v0.end()), s(s0.begin(), s0.end());
+        resizable_tensor tm(m0), tv(v0), ts(s0);
+
+        // sgd and nesterov
+        for (size_t i = begin; i < end; ++i)
+        {
+            const float d = -lr*wd*p[i] - lr*g[i];
+            v[i] = m1*v[i] + d;
+            s[i] = m1*v[i] + d;
+        }
+        tt::compute_nesterov_update(begin, end, ts, tv, lr, wd, m1, params, params_grad);
+        check(tv, v, 1e-6);
+        check(ts, s, 1e-6);
+        tv = v0;
+        tt::compute_sgd_update(begin, end, tv, lr, wd, m1, params, params_grad);
+        check(tv, v, 1e-6);
+
+        // adam and adamw
+        m.assign(m0.begin(), m0.end());
+        v.assign(v0.begin(), v0.end());
+        s.assign(s0.begin(), s0.end());
+        std::vector<float> mw(m), vw(v), sw(s);
+        for (size_t i = begin; i < end; ++i)
+        {
+            float gg = wd*p[i] + g[i];
+            m[i] = m1*m[i] + (1-m1)*gg;
+            v[i] = m2*v[i] + (1-m2)*gg*gg;
+            s[i] = -alpha*m[i]/(std::sqrt(v[i]) + 1e-8);
+            gg = g[i];
+            mw[i] = m1*mw[i] + (1-m1)*gg;
+            vw[i] = m2*vw[i] + (1-m2)*gg*gg;
+            sw[i] = -alpha*mw[i]/(std::sqrt(vw[i]) + 1e-8) - lr*wd*p[i];
+        }
+        tm = m0; tv = v0; ts = s0;
+        tt::compute_adam_update(begin, end, ts, tm, tv, t, lr, wd, m1, m2, params, params_grad);
+        check(tm, m, 1e-6);
+        check(tv, v, 1e-6);
+        check(ts, s, 1e-5);
+        tm = m0; tv = v0; ts = s0;
+        tt::compute_adamw_update(begin, end, ts, tm, tv, t, lr, wd, m1, m2, params, params_grad);
+        check(tm, mw, 1e-6);
+        check(tv, vw, 1e-6);
+        check(ts, sw, 1e-5);
+
+        // lamb
+        mw.assign(m0.begin(), m0.end());
+        vw.assign(v0.begin(), v0.end());
+        sw.assign(s0.begin(), s0.end());
+        double pnorm = 0, rnorm = 0;
+        for (size_t i = begin; i < end; ++i)
+        {
+            mw[i] = m1*mw[i] + (1-m1)*g[i];
+            vw[i] = m2*vw[i] + (1-m2)*g[i]*g[i];
+            sw[i] = c1*mw[i]/(std::sqrt(c2*vw[i]) + 1e-6) + wd*p[i];
+            pnorm += p[i]*p[i];
+            rnorm += sw[i]*sw[i];
+        }
+        for (size_t i = begin; i < end; ++i)
+            sw[i] *= -lr*std::sqrt(pnorm/rnorm);
+        tm = m0; tv = v0; ts = s0;
+        tt::compute_lamb_update(begin, end, ts, tm, tv, t, lr, wd, m1, m2, params, params_grad);
+        check(tm, mw, 1e-6);
+        check(tv, vw, 1e-6);
+        check(ts, sw, 1e-5);
+
+        // The new solvers train a small network and serialize.
+        train_with_solver(nesterov_sgd(0.0005, 0.9), 0.01);
+        train_with_solver(adamw(0.01, 0.9, 0.999), 0.01);
+        train_with_solver(lamb(0.01, 0.9, 0.999), 0.01);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_distributed_training()
+    {
+        print_spinner();
+
+        {
+            // ring_all_reducer gives every node the same sums, whatever the array sizes.
+            const std::vector<network_address> nodes = {"127.0.0.1:12380", "127.0.0.1:12381", "127.0.0.1:12382"};
+            const std::vector<size_t> sizes = {1, 2, 3, 7, 100000};
+            auto node = [&](size_t rank) -> std::vector<std::vector<float>>
+            {
+                ring_all_reducer comm(nodes, rank, 20000);
+                DLIB_TEST(comm.num_nodes() == 3 && comm.rank() == rank);
+                std::vector<std::vector<float>> results;
+                for (auto n : sizes)
+                {
+                    std::vector<float> v(n), a(n), b(n);
+                    for (size_t i = 0; i < n; ++i)
+                    {
+                        v[i] = (rank+1)*0.1f + i;
+                        a[i] = v[i];
+                        b[i] = rank == 1 ? i*0.5f : -1;
+                    }
+                    comm.start_sum(v.data(), v.size());
+                    comm.start_average(a.data(), a.size());
+                    comm.start_broadcast(b.data(), b.size(), 1);
+                    comm.wait();
+                    results.push_back(v);
+                    results.push_back(a);
+                    results.push_back(b);
+                }
+                return results;
+            };
+            auto r0 = std::async(std::launch::async, node, 0);
+            auto r1 = std::async(std::launch::async, node, 1);
+            auto r2 = std::async(std::launch::async, node, 2);
+            const auto res0 = r0.get();
+            const auto res1 = r1.get();
+            const auto res2 = r2.get();
+            DLIB_TEST(res0 == res1 && res0 == res2);
+            for (size_t k = 0; k < sizes.size(); ++k)
+            {
+                const auto& v = res0[3*k];
+                const auto& a = res0[3*k+1];
+                const auto& b = res0[3*k+2];
+                for (size_t i = 0; i < sizes[k]; ++i)
+                {
+                    DLIB_TEST(std::abs(v[i] - (0.6f + 3*i)) <= 1e-6*(1+3*i));
+                    DLIB_TEST(std::abs(a[i] - (0.2f + i)) <= 1e-6*(1+i));
+                    DLIB_TEST(b[i] == i*0.5f);
+                }
+            }
+        }
+
+        {
+            // Two trainers, each with half the data, end up with the same network, and
+            // that network fits all the data.
+            using net_type = loss_mean_squared<fc<1,relu<fc<8,input<matrix<float>>>>>>;
+            std::vector<matrix<float>> x;
+            std::vector<float> y;
+            for (int i = 0; i < 200; ++i)
+            {
+                x.push_back(matrix_cast<float>(gaussian_randm(2,1,i)));
+                y.push_back(2*x.back()(0) - x.back()(1) + 1);
+            }
+
+            const std::vector<network_address> nodes = {"127.0.0.1:12390", "127.0.0.1:12391"};
+            std::vector<net_type> nets(nodes.size());
+            std::vector<double> losses(nodes.size());
+            auto node = [&](size_t rank)
+            {
+                net_type& net = nets[rank];
+                dnn_trainer<net_type> trainer(net, sgd(0.0001,0.9));
+                trainer.set_learning_rate(0.01);
+                trainer.set_distributed_training(nodes, rank, 20000);
+                DLIB_TEST(trainer.get_num_nodes() == 2 && trainer.get_node_rank() == rank);
+                std::vector<matrix<float>> xs;
+                std::vector<float> ys;
+                for (size_t i = rank; i < x.size(); i += nodes.size())
+                {
+                    xs.push_back(x[i]);
+                    ys.push_back(y[i]);
+                }
+                for (int iter = 0; iter < 500; ++iter)
+                {
+                    const size_t start = (iter*10)%xs.size();
+                    std::vector<matrix<float>> bx(xs.begin()+start, xs.begin()+start+10);
+                    std::vector<float> by(ys.begin()+start, ys.begin()+start+10);
+                    trainer.train_one_step(bx, by);
+                }
+                trainer.get_net();
+                losses[rank] = trainer.get_average_loss();
+            };
+            auto f0 = std::async(std::launch::async, node, 0);
+            auto f1 = std::async(std::launch::async, node, 1);
+            f0.get();
+            f1.get();
+
+            DLIB_TEST(losses[0] == losses[1]);
+            std::vector<matrix<float>> params;
+            visit_layer_parameters(nets[0], [&](size_t, tensor& t) { params.push_back(mat(t)); });
+            visit_layer_parameters(nets[1], [&](size_t j, tensor& t) {
+                DLIB_TEST(static_cast<size_t>(params[j].size()) == t.size());
+                if (t.size() != 0)
+                    DLIB_TEST(max(abs(params[j] - mat(t))) == 0);
+            });
+
+            double err = 0;
+            for (size_t i = 0; i < x.size(); ++i)
+                err += std::abs(nets[0](x[i]) - y[i]);
+            DLIB_TEST_MSG(err/x.size() < 0.1, err/x.size());
+        }
+    }
+
 // ----------------------------------------------------------------------------------------
 
     class dnn_tester : public tester
@@ -3085,6 +5377,7 @@ namespace
             test_copy_tensor_gpu();
             test_copy_tensor_add_to_gpu();
 #endif
+            test_conv_cpu();
             test_tensor_resize_bilinear(2, 3, 6,6, 11, 11);
             test_tensor_resize_bilinear(2, 3, 6,6, 3, 4);
             test_tensor_resize_bilinear(2, 3, 5,6, 12, 21);
@@ -3136,6 +5429,29 @@ namespace
             test_loss_multiclass_per_pixel_weighted();
             test_serialization();
             test_loss_dot();
+            test_loss_metric();
+            test_fuse_layers();
+            test_quantized_kernels();
+            test_quantize_layers();
+            test_inference_mode();
+            test_checkpoint();
+            test_checkpoint_recompute();
+            test_profiler();
+            test_loss_mmod_nms();
+            test_mmod_cascade();
+            test_rgb_input_conversion();
+            test_recurrent_layers();
+            test_16bit_tensor_serialization();
+            test_grouped_con();
+            test_dilated_con();
+            test_shared_weights();
+            test_mapped_model();
+            test_inference_server();
+            test_async_sync();
+            test_data_loader();
+            test_gradient_accumulation();
+            test_solver_kernels();
+            test_distributed_training();
         }
 
         void perform_test()
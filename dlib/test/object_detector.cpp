@@ -993,6 +993,90 @@ namespace
         }
     }
 
+// ----------------------------------------------------------------------------------------
+
+    void test_non_max_suppression (
+    )
+    {
+        print_spinner();
+        dlog << LINFO << "test_non_max_suppression()";
+
+        dlib::rand rnd;
+        for (int round = 0; round < 20; ++round)
+        {
+            // Make clusters of boxes of many sizes, some sticking out of the others.
+            std::vector<rect_detection> dets;
+            for (int i = 0; i < 400; ++i)
+            {
+                const point center(rnd.get_random_32bit_number()%(100+round*50), rnd.get_random_32bit_number()%300);
+                const long size = 1 + rnd.get_random_32bit_number()%(round%3 == 0 ? 200 : 30);
+                rect_detection d;
+                d.rect = centered_rect(center, size, size + rnd.get_random_32bit_number()%10);
+                d.detection_confidence = rnd.get_random_double() + 0.01;
+                d.weight_index = 0;
+                dets.push_back(d);
+            }
+            std::sort(dets.rbegin(), dets.rend());
+
+            const test_box_overlap overlaps(rnd.get_random_double()*0.7, 0.5 + rnd.get_random_double()*0.5);
+
+            // Compare to testing every kept box.
+            std::vector<rect_detection> expected;
+            for (auto& d : dets)
+            {
+                bool hit = false;
+                for (auto& e : expected)
+                    hit = hit || overlaps(e.rect, d.rect);
+                if (!hit)
+                    expected.push_back(d);
+            }
+            std::vector<rect_detection> kept = dets;
+            non_max_suppression(kept, overlaps);
+            DLIB_TEST(kept.size() == expected.size());
+            for (size_t i = 0; i < kept.size() && i < expected.size(); ++i)
+                DLIB_TEST(kept[i].rect == expected[i].rect);
+
+            nms_grid grid;
+            grid.reset(dets);
+            for (size_t i = 0; i < 100; ++i)
+                grid.add_box(dets[i].rect);
+            std::vector<size_t> idxs, expected_idxs;
+            for (size_t i = 100; i < 120; ++i)
+            {
+                expected_idxs.clear();
+                for (size_t j = 0; j < grid.size(); ++j)
+                {
+                    if (!grid[j].intersect(dets[i].rect).is_empty())
+                        expected_idxs.push_back(j);
+                }
+                grid.find_intersecting_boxes(dets[i].rect, idxs);
+                DLIB_TEST(idxs == expected_idxs);
+            }
+            // Boxes outside the area the grid was laid out for are still found.
+            grid.add_box(rectangle(-1000,-1000,-900,-900));
+            grid.find_intersecting_boxes(rectangle(-950,-950,-500,-500), idxs);
+            DLIB_TEST(idxs.size() == 1 && idxs[0] == 100);
+
+            // A tiny sigma makes soft-NMS the same as hard NMS.
+            std::vector<rect_detection> soft = dets;
+            soft_non_max_suppression(soft, overlaps, 1e-12);
+            DLIB_TEST(soft.size() == expected.size());
+            for (size_t i = 0; i < soft.size() && i < expected.size(); ++i)
+            {
+                DLIB_TEST(soft[i].rect == expected[i].rect);
+                DLIB_TEST(soft[i].detection_confidence == expected[i].detection_confidence);
+            }
+
+            // Otherwise it keeps more boxes, sorted by their lowered scores.
+            soft = dets;
+            soft_non_max_suppression(soft, overlaps, 0.5, 0, 0.01);
+            DLIB_TEST(soft.size() >= expected.size());
+            for (size_t i = 1; i < soft.size(); ++i)
+                DLIB_TEST(soft[i-1].detection_confidence >= soft[i].detection_confidence);
+            DLIB_TEST(soft[0].rect == dets[0].rect);
+        }
+    }
+
 // ----------------------------------------------------------------------------------------
 
     class object_detector_tester : public tester
@@ -1007,6 +1091,7 @@ namespace
         void perform_test (
         )
         {
+            test_non_max_suppression();
             test_fhog_pyramid();
             test_1_boxes();
             test_1_poly_nn_boxes();
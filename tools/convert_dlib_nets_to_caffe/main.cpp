@@ -296,7 +296,19 @@ void convert_dlib_xml_to_caffe_python_code(
             fout << ", stride_h=" << i->attribute("stride_y");
             fout << ", pad_w=" << i->attribute("padding_x");
             fout << ", pad_h=" << i->attribute("padding_y");
+            // Networks saved before con_ supported groups don't have this attribute.
+            if (i->attributes.count("groups") != 0)
+                fout << ", group=" << i->attribute("groups");
+            if (i->attributes.count("dilation_y") != 0 &&
+                (i->attribute("dilation_y") != 1 || i->attribute("dilation_x") != 1))
+            {
+                // caffe takes the dilation as a repeated field ordered like the spatial
+                // axes, i.e. height first.
+                fout << ", dilation=[" << i->attribute("dilation_y") << ", " << i->attribute("dilation_x") << "]";
+            }
             fout << ");\n";
+            if (i->attributes.count("use_relu") != 0 && i->attribute("use_relu") != 0)
+                throw dlib::error("Networks with relu layers fused into con layers can't be converted.  Convert the network before calling fuse_layers() on it.");
         }
         else if (i->detail_name == "relu")
         {
@@ -726,8 +738,15 @@ void compute_output_tensor_shapes(const matrix<long,4,1>& input_tensor_shape, st
                 long stride_y = i->attribute("stride_y");
                 long padding_x = i->attribute("padding_x");
                 long padding_y = i->attribute("padding_y");
-                long nr = 1+(input_shape(2) + 2*padding_y - filter_nr)/stride_y;
-                long nc = 1+(input_shape(3) + 2*padding_x - filter_nc)/stride_x;
+                long dilation_x = 1;
+                long dilation_y = 1;
+                if (i->attributes.count("dilation_y") != 0)
+                {
+                    dilation_x = i->attribute("dilation_x");
+                    dilation_y = i->attribute("dilation_y");
+                }
+                long nr = 1+(input_shape(2) + 2*padding_y - (dilation_y*(filter_nr-1)+1))/stride_y;
+                long nc = 1+(input_shape(3) + 2*padding_x - (dilation_x*(filter_nc-1)+1))/stride_x;
                 i->output_tensor_shape = {input_shape(0), num_filters, nr, nc};
             }
             else if (i->detail_name == "max_pool" || i->detail_name == "avg_pool")
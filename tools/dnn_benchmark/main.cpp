@@ -0,0 +1,363 @@
+/*
+    This program times some of the standard dlib networks, the ResNet-34 from
+    dnn_imagenet_ex.cpp, the face detector from dnn_mmod_face_detection_ex.cpp, and the
+    face recognition ResNet from dnn_face_recognition_ex.cpp, at several batch sizes and
+    thread counts.  The networks use random weights and run on random images, since
+    only their speed matters here.
+
+    For each network and batch size it prints the time per batch and, if asked to, the
+    per-layer report from dnn_profiler and a Chrome trace.  E.g.
+        ./dnn_benchmark --batch-sizes 1,8,32 --threads 1,4 --report
+*/
+
+#include <dlib/dnn.h>
+#include <dlib/cmd_line_parser.h>
+#include <dlib/string.h>
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+using namespace dlib;
+
+// ----------------------------------------------------------------------------------------
+
+// The networks are templated on their normalization layer so we can time training with
+// bn_con and inference with affine, the same way the examples use them.
+
+template <template <int,template<typename>class,int,typename> class block, int N, template<typename>class BN, typename SUBNET>
+using residual = add_prev1<block<N,BN,1,tag1<SUBNET>>>;
+
+template <template <int,template<typename>class,int,typename> class block, int N, template<typename>class BN, typename SUBNET>
+using residual_down = add_prev2<avg_pool<2,2,2,2,skip1<tag2<block<N,BN,2,tag1<SUBNET>>>>>>;
+
+template <int N, template <typename> class BN, int stride, typename SUBNET>
+using block  = BN<con<N,3,3,1,1,relu<BN<con<N,3,3,stride,stride,SUBNET>>>>>;
+
+template <int N, template <typename> class BN, typename SUBNET> using ares      = relu<residual<block,N,BN,SUBNET>>;
+template <int N, template <typename> class BN, typename SUBNET> using ares_down = relu<residual_down<block,N,BN,SUBNET>>;
+
+// The ResNet-34 from dnn_imagenet_ex.cpp
+template <template <typename> class BN, typename SUBNET> using level1 = ares<512,BN,ares<512,BN,ares_down<512,BN,SUBNET>>>;
+template <template <typename> class BN, typename SUBNET> using level2 = ares<256,BN,ares<256,BN,ares<256,BN,ares<256,BN,ares<256,BN,ares_down<256,BN,SUBNET>>>>>>;
+template <template <typename> class BN, typename SUBNET> using level3 = ares<128,BN,ares<128,BN,ares<128,BN,ares_down<128,BN,SUBNET>>>>;
+template <template <typename> class BN, typename SUBNET> using level4 = ares<64,BN,ares<64,BN,ares<64,BN,SUBNET>>>;
+
+template <template <typename> class BN>
+using imagenet_net_type = loss_multiclass_log<fc<1000,avg_pool_everything<
+                            level1<BN,
+                            level2<BN,
+                            level3<BN,
+                            level4<BN,
+                            max_pool<3,3,2,2,relu<BN<con<64,7,7,2,2,
+                            input_rgb_image_sized<227>
+                            >>>>>>>>>>>;
+
+// The face recognition ResNet from dnn_face_recognition_ex.cpp
+template <template <typename> class BN, typename SUBNET> using alevel0 = ares_down<256,BN,SUBNET>;
+template <template <typename> class BN, typename SUBNET> using alevel1 = ares<256,BN,ares<256,BN,ares_down<256,BN,SUBNET>>>;
+template <template <typename> class BN, typename SUBNET> using alevel2 = ares<128,BN,ares<128,BN,ares_down<128,BN,SUBNET>>>;
+template <template <typename> class BN, typename SUBNET> using alevel3 = ares<64,BN,ares<64,BN,ares<64,BN,ares_down<64,BN,SUBNET>>>>;
+template <template <typename> class BN, typename SUBNET> using alevel4 = ares<32,BN,ares<32,BN,ares<32,BN,SUBNET>>>;
+
+template <template <typename> class BN>
+using metric_net_type = loss_metric<fc_no_bias<128,avg_pool_everything<
+                            alevel0<BN,
+                            alevel1<BN,
+                            alevel2<BN,
+                            alevel3<BN,
+                            alevel4<BN,
+                            max_pool<3,3,2,2,relu<BN<con<32,7,7,2,2,
+                            input_rgb_image_sized<150>
+                            >>>>>>>>>>>>;
+
+// The face detector from dnn_mmod_face_detection_ex.cpp
+template <long num_filters, typename SUBNET> using con5d = con<num_filters,5,5,2,2,SUBNET>;
+template <long num_filters, typename SUBNET> using con5  = con<num_filters,5,5,1,1,SUBNET>;
+
+template <template <typename> class BN, typename SUBNET>
+using downsampler  = relu<BN<con5d<32, relu<BN<con5d<32, relu<BN<con5d<16,SUBNET>>>>>>>>>;
+template <template <typename> class BN, typename SUBNET> using rcon5  = relu<BN<con5<45,SUBNET>>>;
+
+template <template <typename> class BN>
+using mmod_net_type = loss_mmod<con<1,9,9,1,1,rcon5<BN,rcon5<BN,rcon5<BN,downsampler<BN,
+                            input_rgb_image_pyramid<pyramid_down<6>>>>>>>>;
+
+// ----------------------------------------------------------------------------------------
+
+struct benchmark_options
+{
+    std::vector<unsigned long> batch_sizes;
+    unsigned long iterations = 10;
+    bool train = false;
+    bool report = false;
+    std::string trace_prefix;
+};
+
+std::vector<unsigned long> parse_list (
+    const std::string& str
+)
+{
+    std::vector<unsigned long> values;
+    for (auto& s : split(str, ","))
+    {
+        const auto v = string_cast<unsigned long>(trim(s));
+        if (v == 0)
+            throw dlib::error("The values given to --batch-sizes and --threads must be positive.");
+        values.push_back(v);
+    }
+    return values;
+}
+
+std::vector<matrix<rgb_pixel>> random_images (
+    size_t num,
+    long nr,
+    long nc
+)
+{
+    dlib::rand rnd;
+    std::vector<matrix<rgb_pixel>> images(num);
+    for (auto& img : images)
+    {
+        img.set_size(nr, nc);
+        for (auto& p : img)
+            p = rgb_pixel(rnd.get_random_8bit_number(), rnd.get_random_8bit_number(), rnd.get_random_8bit_number());
+    }
+    return images;
+}
+
+// ----------------------------------------------------------------------------------------
+
+template <typename net_type, typename label_type>
+void benchmark (
+    const std::string& name,
+    net_type& net,
+    const std::vector<matrix<rgb_pixel>>& all_images,
+    const std::vector<label_type>& all_labels,
+    const benchmark_options& opts
+)
+{
+    const char* threads = std::getenv("DLIB_NUM_THREADS");
+    for (auto batch_size : opts.batch_sizes)
+    {
+        const std::vector<matrix<rgb_pixel>> images(all_images.begin(), all_images.begin()+batch_size);
+        const std::vector<label_type> labels(all_labels.begin(), all_labels.begin()+batch_size);
+
+        resizable_tensor x;
+        auto run_once = [&]()
+        {
+            if (opts.train)
+            {
+                net.to_tensor(images.begin(), images.end(), x);
+                net.compute_parameter_gradients(x, labels.begin());
+            }
+            else
+            {
+                net(images, batch_size);
+            }
+        };
+
+        // The first run allocates all the tensors, so it isn't timed.
+        run_once();
+
+        const auto start = std::chrono::steady_clock::now();
+        for (unsigned long i = 0; i < opts.iterations; ++i)
+            run_once();
+        const std::chrono::duration<double,std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        const double ms_per_batch = elapsed.count()/opts.iterations;
+
+        cout << name << (opts.train ? " training" : " inference")
+             << ", batch size " << batch_size
+             << ", threads " << (threads ? threads : "default") << ": "
+             << ms_per_batch << " ms per batch, "
+             << 1000*batch_size/ms_per_batch << " images per second" << endl;
+
+        // Profiling slows the network down a little, so it's done in a separate run.
+        if (opts.report || opts.trace_prefix.size() != 0)
+        {
+            dnn_profiler prof;
+            prof.start();
+            for (unsigned long i = 0; i < opts.iterations; ++i)
+                run_once();
+            prof.stop();
+
+            if (opts.report)
+            {
+                prof.print_report(net, cout);
+                cout << endl;
+            }
+            if (opts.trace_prefix.size() != 0)
+            {
+                const std::string filename = opts.trace_prefix + "_" + name + "_batch" + cast_to_string(batch_size) +
+                    "_threads" + (threads ? threads : "default") + ".json";
+                prof.write_chrome_trace(net, filename);
+                cout << "wrote " << filename << endl;
+            }
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------------------
+
+template <template <typename> class BN>
+void run_benchmarks (
+    const std::vector<std::string>& nets,
+    const benchmark_options& opts
+)
+{
+    const unsigned long max_batch_size = max(mat(opts.batch_sizes));
+    for (auto& name : nets)
+    {
+        if (name == "imagenet")
+        {
+            imagenet_net_type<BN> net;
+            std::vector<unsigned long> labels(max_batch_size);
+            for (size_t i = 0; i < labels.size(); ++i)
+                labels[i] = i%1000;
+            benchmark(name, net, random_images(max_batch_size, 227, 227), labels, opts);
+        }
+        else if (name == "metric")
+        {
+            // loss_metric needs both matching and non-matching pairs in each training
+            // batch, so the smallest batches can only be used for inference.
+            benchmark_options metric_opts = opts;
+            if (opts.train)
+            {
+                metric_opts.batch_sizes.clear();
+                for (auto batch_size : opts.batch_sizes)
+                {
+                    if (batch_size >= 4)
+                        metric_opts.batch_sizes.push_back(batch_size);
+                    else
+                        cout << name << " training, batch size " << batch_size << ": skipped, it must be at least 4" << endl;
+                }
+            }
+            metric_net_type<BN> net;
+            std::vector<unsigned long> labels(max_batch_size);
+            for (size_t i = 0; i < labels.size(); ++i)
+                labels[i] = i/2;
+            benchmark(name, net, random_images(max_batch_size, 150, 150), labels, metric_opts);
+        }
+        else if (name == "mmod")
+        {
+            mmod_options options;
+            options.detector_windows.push_back(mmod_options::detector_window_details(40,40));
+            mmod_net_type<BN> net(options);
+            std::vector<std::vector<mmod_rect>> labels(max_batch_size);
+            for (auto& l : labels)
+                l.push_back(rectangle(100,100,139,139));
+            benchmark(name, net, random_images(max_batch_size, 240, 320), labels, opts);
+        }
+        else
+        {
+            throw dlib::error("Unknown network: " + name);
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------------------
+
+void set_environment_variable (
+    const std::string& name,
+    const std::string& value
+)
+{
+#ifdef _WIN32
+    _putenv_s(name.c_str(), value.c_str());
+#else
+    setenv(name.c_str(), value.c_str(), 1);
+#endif
+}
+
+int run_with_thread_counts (
+    int argc,
+    char** argv,
+    const std::vector<unsigned long>& thread_counts
+)
+{
+    // dlib's thread pool and most BLAS libraries read their thread counts from the
+    // environment when they start, so each thread count gets its own process.
+    std::string args;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--threads")
+        {
+            ++i;
+            continue;
+        }
+        if (arg.find("--threads=") == 0)
+            continue;
+        args += " \"" + arg + "\"";
+    }
+
+    int result = 0;
+    for (auto n : thread_counts)
+    {
+        set_environment_variable("DLIB_NUM_THREADS", cast_to_string(n));
+        set_environment_variable("OPENBLAS_NUM_THREADS", cast_to_string(n));
+        set_environment_variable("OMP_NUM_THREADS", cast_to_string(n));
+        set_environment_variable("MKL_NUM_THREADS", cast_to_string(n));
+        if (std::system(("\"" + std::string(argv[0]) + "\"" + args).c_str()) != 0)
+            result = 1;
+    }
+    return result;
+}
+
+// ----------------------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        command_line_parser parser;
+
+        parser.add_option("h","Displays this information.");
+        parser.add_option("nets","Comma separated list of the networks to time, from imagenet, mmod, and metric (default: all of them).",1);
+        parser.add_option("batch-sizes","Comma separated list of batch sizes (default: 1,8,32).",1);
+        parser.add_option("threads","Comma separated list of thread counts.  Each one is run in a new process with "
+                          "DLIB_NUM_THREADS and the BLAS thread count set to it.  (default: don't change them)",1);
+        parser.add_option("iterations","Time <arg> batches for each batch size (default: 10).",1);
+        parser.add_option("train","Time training steps, i.e. forward and backward, instead of inference.");
+        parser.add_option("report","Print the per-layer dnn_profiler report for each run.");
+        parser.add_option("trace","Write a Chrome trace of each run to a file whose name starts with <arg>.",1);
+
+        parser.parse(argc, argv);
+
+        const char* singles[] = {"h","nets","batch-sizes","threads","iterations","train","report","trace"};
+        parser.check_one_time_options(singles);
+        parser.check_option_arg_range("iterations", 1, 1000000);
+
+        if (parser.option("h"))
+        {
+            cout << "Usage: dnn_benchmark [options]\n";
+            parser.print_options(cout);
+            cout << endl;
+            return EXIT_SUCCESS;
+        }
+
+        if (parser.option("threads"))
+            return run_with_thread_counts(argc, argv, parse_list(parser.option("threads").argument()));
+
+        benchmark_options opts;
+        opts.batch_sizes = parse_list(get_option(parser, "batch-sizes", "1,8,32"));
+        opts.iterations = get_option(parser, "iterations", 10);
+        opts.train = parser.option("train");
+        opts.report = parser.option("report");
+        opts.trace_prefix = get_option(parser, "trace", "");
+
+        const std::vector<std::string> nets = split(get_option(parser, "nets", "imagenet,mmod,metric"), ",");
+
+        if (opts.train)
+            run_benchmarks<bn_con>(nets, opts);
+        else
+            run_benchmarks<affine>(nets, opts);
+    }
+    catch (std::exception& e)
+    {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+}
+
+// ----------------------------------------------------------------------------------------
+